@@ -0,0 +1 @@
+#define OO_CP_INTF_VER c6abb15815514aa1c84e7332f7133f45
@@ -0,0 +1,16 @@
+# SPDX-License-Identifier: GPL-2.0
+################################################################################
+#
+# Driver for Solarflare and Xilinx network controllers and boards
+# Copyright 2019 Solarflare Communications Inc.
+# Copyright 2019-2020 Xilinx Inc.
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License version 2 as published
+# by the Free Software Foundation, incorporated herein by reference.
+#
+################################################################################
+# This file is for backward compatibility with older Onload versions.
+
+TOPDIR=../../../..
+exec $TOPDIR/scripts/kernel_compat_funcs.sh "$@"
@@ -0,0 +1 @@
+#define EFCH_INTF_VER  "39529da6f9e63ab28c24c71336dbd3f7"
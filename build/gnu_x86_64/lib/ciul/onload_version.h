@@ -0,0 +1,8 @@
+// Autogenerated file, do not edit
+#define ONLOAD_PRODUCT "Onload"
+#define ONLOAD_COPYRIGHT "Copyright (c) 2002-2026 Advanced Micro Devices, Inc."
+#ifndef ONLOAD_BUILD_PROFILE
+#define ONLOAD_BUILD_PROFILE ""
+#endif
+#define ONLOAD_VERSION "3a1ab39 2026-10-18 master "ONLOAD_BUILD_PROFILE
+#define ONLOAD_SHORT_VERSION "master "ONLOAD_BUILD_PROFILE
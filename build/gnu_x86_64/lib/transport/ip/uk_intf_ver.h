@@ -0,0 +1 @@
+#define OO_UK_INTF_VER  "f8200ebf29f09a3c229ff0c1ca46640a"
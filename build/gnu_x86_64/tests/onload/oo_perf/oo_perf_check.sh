@@ -0,0 +1,50 @@
+#!/bin/sh
+# SPDX-License-Identifier: BSD-2-Clause
+# X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc.
+#
+# Runs oo_perf over Onload's software loopback, so that no NIC is needed,
+# and optionally compares the results with a baseline from an earlier run.
+#
+#   oo_perf_check [-o <output>] [-b <baseline>] [oo_perf options...]
+#
+# The exit status is that of oo_perf: 1 if any result regressed.
+
+bin=$(cd "$(dirname "$0")" && pwd)
+out=
+args=
+
+usage() {
+  echo "usage: $0 [-o <output>] [-b <baseline>] [oo_perf options...]" >&2
+  exit 1
+}
+
+while [ $# -gt 0 ]; do
+  case "$1" in
+    -o) [ $# -ge 2 ] || usage; out="$2"; shift 2;;
+    -h) usage;;
+    *)  args="$args $1"; shift;;
+  esac
+done
+
+if ! command -v onload >/dev/null; then
+  echo "$0: onload not found in PATH" >&2
+  exit 1
+fi
+
+export EF_NO_HW=1
+export EF_TCP_SERVER_LOOPBACK=1
+export EF_TCP_CLIENT_LOOPBACK=1
+export EF_PIPE=1
+export EF_MCAST_SEND=3
+export EF_MCAST_RECV=1
+# The epoll test opens a few thousand sockets.
+export EF_MAX_ENDPOINTS=${EF_MAX_ENDPOINTS:-8192}
+ulimit -n 8192 2>/dev/null
+
+if [ -n "$out" ]; then
+  # shellcheck disable=SC2086
+  onload "$bin/oo_perf" -m 239.100.1.2 $args | tee "$out"
+  exit $(tail -n 1 "$out" | grep -q "regression" && echo 1 || echo 0)
+fi
+# shellcheck disable=SC2086
+exec onload "$bin/oo_perf" -m 239.100.1.2 $args
@@ -176,6 +176,10 @@ EFRM_NEED_DEBUGFS_LOOKUP_AND_REMOVE nsymbol debugfs_lookup_and_remove include/li
 
 EFRM_HAVE_WARN_FLUSHING_SYSTEMWIDE_WQ symbol __warn_flushing_systemwide_wq include/linux/workqueue.h
 
+EFRM_HAVE_XSK_SHARED_UMEM_QUEUES	member	struct_xdp_sock	fq_tmp	include/net/xdp_sock.h
+
+EFRM_HAVE_SK_PREFER_BUSY_POLL	member	struct_sock	sk_prefer_busy_poll	include/net/sock.h
+
 # TODO move onload-related stuff from net kernel_compat
 " | grep -E -v -e '^#' -e '^$' | sed 's/[ \t][ \t]*/:/g'
 }
@@ -15,6 +15,7 @@ struct efab_af_xdp_offsets_ring
   int64_t producer;
   int64_t consumer;
   int64_t desc;
+  int64_t flags;
 };
 
 struct efab_af_xdp_offsets_rings
@@ -25,10 +26,21 @@ struct efab_af_xdp_offsets_rings
   struct efab_af_xdp_offsets_ring cr;
 };
 
+/* Flags in efab_af_xdp_offsets::flags, set by the kernel once the socket
+ * is bound. */
+/* The rings' flags say whether the kernel needs a kick (XDP_USE_NEED_WAKEUP) */
+#define EFAB_AF_XDP_FLAG_NEED_WAKEUP  0x1
+/* The socket prefers busy polling: kicks drive the queue's NAPI context */
+#define EFAB_AF_XDP_FLAG_BUSY_POLL    0x2
+/* Bound with XDP_USE_SG, so packets may span several buffers.  Drivers may
+ * refuse this in zero-copy mode, in which case it is left clear. */
+#define EFAB_AF_XDP_FLAG_SG           0x4
+
 struct efab_af_xdp_offsets
 {
   int64_t mmap_bytes;
   struct efab_af_xdp_offsets_rings rings;
+  int64_t flags;
 };
 
 #endif
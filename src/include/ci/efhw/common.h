@@ -64,6 +64,7 @@ typedef union {
 #define EFHW_VI_JUMBO_EN           0x01    /*! scatter RX over multiple desc */
 #define EFHW_VI_RX_ZEROCOPY        0x02    /*! Zerocopy for AF_XDP */
 #define EFHW_VI_TX_M2M_D2C         0x04    /*! mem2mem and desc2cmpt */
+#define EFHW_VI_AF_XDP_BUSY_POLL   0x08    /*! Busy poll AF_XDP socket */
 #define EFHW_VI_TX_PHYS_ADDR_EN    0x20    /*! TX physical address mode */
 #define EFHW_VI_RX_PHYS_ADDR_EN    0x40    /*! RX physical address mode */
 #define EFHW_VI_TX_IP_CSUM_DIS     0x100   /*! enable ip checksum generation */
@@ -81,6 +81,8 @@ enum efrm_vi_q_flags {
 	EFRM_VI_TCP_UDP_CSUM          = 0x4,
 	/** RXQ: Force zerocopy with AF_XDP - this also affects TX */
 	EFRM_VI_RX_ZEROCOPY           = 0x8,
+	/** RXQ: AF_XDP: prefer busy polling and only kick when needed */
+	EFRM_VI_AF_XDP_BUSY_POLL      = 0x10,
 	/** TXQ: Outgoing packets must match an Ethernet filter. */
 	EFRM_VI_ETH_FILTER            = 0x20,
 	/** TXQ: Outgoing packets must match a TCP/UDP filter. */
@@ -474,6 +474,16 @@ extern unsigned ci_netif_build_future_intf_mask(ci_netif* ni) CI_HF;
 extern void ci_netif_error_detected(ci_netif*, unsigned error_flag,
                                     const char* caller) CI_HF;
 
+#if CI_CFG_TIMESTAMPING
+/* A hardware RX timestamp in nanoseconds, as held in
+ * ci_netif_state_nic_t::rx_drained_ns. */
+ci_inline ci_uint64 ci_rx_stamp_ns(const struct oo_timespec* ts)
+{
+  return (ci_uint64) (ci_uint32) ts->tv_sec * 1000000000ull +
+         (ci_uint32) ts->tv_nsec;
+}
+#endif
+
 #if OO_DO_STACK_POLL
 #ifndef __KERNEL__
 extern int  ci_netif_poll_intf_future(ci_netif*, int intf_i, ci_uint64 now_frc)
@@ -1689,7 +1699,13 @@ extern int /*bool*/
 ci_tcp_maybe_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 
 extern void ci_tcp_recovered(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+#if CI_CFG_TCP_RACK
+extern void ci_tcp_rack_detect_and_recover(ci_netif* ni,
+                                           ci_tcp_state* ts) CI_HF;
+#endif
 
+extern int ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts,
+                                        unsigned start, unsigned end) CI_HF;
 extern void ci_tcp_clear_sacks(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_retrans_init_ptrs(ci_netif* ni, ci_tcp_state* ts,
                                      unsigned* recover_seq_out) CI_HF;
@@ -1869,6 +1885,7 @@ extern void ci_netif_active_wild_sharer_closed(ci_netif* ni, ci_sock_cmn* s);
 extern int ci_netif_active_wild_nic_hash(ci_netif *ni,
                                          ci_addr_t laddr, ci_uint16 lport,
                                          ci_addr_t raddr, ci_uint16 rport);
+extern int ci_netif_active_wild_nic_hash_lport(ci_uint16 lport);
 
 extern struct oo_p_dllink_state
 ci_netif_get_active_wild_list(ci_netif* ni, int aw_pool, ci_addr_t laddr);
@@ -1920,6 +1937,7 @@ extern void ci_tcp_timeout_kalive(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_zwin(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_delack(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts) CI_HF;
+extern void ci_tcp_timeout_mux(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_cork(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_recycle(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_stop_timers(ci_netif* netif, ci_tcp_state* ts) CI_HF;
@@ -2022,6 +2040,26 @@ extern void ci_tcp_perform_deferred_socket_work(ci_netif*, ci_tcp_state*)CI_HF;
  */
 extern int  ci_netif_lock_or_defer_work(ci_netif*, citp_waitable*) CI_HF;
 
+/* Returns true if [w] is at the head of the stack lock's list of sockets
+ * with deferred work.  The thread holding the lock takes that list and does
+ * the work of every socket on it before it drops the lock, so that work is
+ * done after this returns true, and before anyone else gets the lock.
+ * Anything that is on the socket's queues when this is called is seen by
+ * that work.
+ *
+ * The DEFERRED flag alone does not tell us this: it is set before the
+ * socket is pushed onto the list, and the thread doing that can be
+ * descheduled in between.
+ */
+ci_inline int ci_netif_deferred_work_queued(ci_netif* ni, citp_waitable* w)
+{
+  ci_uint64 v;
+  ci_mb();
+  v = ni->state->lock.lock;
+  return (v & CI_EPLOCK_LOCKED) &&
+         (v & CI_EPLOCK_NETIF_SOCKET_LIST) == W_ID(w) + 1;
+}
+
 
 #ifndef __KERNEL__
 extern int ci_tcp_connect(citp_socket*, const struct sockaddr*, socklen_t,
@@ -2846,19 +2884,54 @@ ci_inline int ci_netif_need_timer_prime(ci_netif* ni, ci_uint64 frc_now) {
 }
 
 
-ci_inline int ci_netif_need_poll_spinning(ci_netif* ni, ci_uint64 frc_now)
+ci_inline int ci_netif_need_poll_idle(ci_netif* ni, ci_uint64 frc_now)
 {
   return ci_netif_has_event(ni) ||
          ci_netif_need_timer_prime(ni, frc_now);
 }
 
 
+/* AF_XDP sockets in busy-poll mode are serviced by the kick that polling
+ * the stack makes when their queue is idle, so a thread spinning on such a
+ * stack always wants to poll it.
+ */
+ci_inline int ci_netif_need_poll_spinning(ci_netif* ni, ci_uint64 frc_now)
+{
+#ifndef __KERNEL__
+  if( ni->flags & CI_NETIF_FLAGS_AF_XDP_BUSY_POLL )
+    return 1;
+#endif
+  return ci_netif_need_poll_idle(ni, frc_now);
+}
+
+
+/* Applies EF_SPIN_ADAPTIVE to [max_spin], the number of cycles a blocking
+** call would otherwise spin for after any SO_RCVTIMEO limit.  When the
+** stack's learnt budget is shorter the spin no longer runs into the socket
+** timeout, so *[spin_limit_by_so] is cleared.
+*/
+ci_inline ci_uint64 ci_netif_spin_adaptive_cap(ci_netif* ni,
+                                               ci_uint64 max_spin,
+                                               int* spin_limit_by_so)
+{
+  if( NI_OPTS(ni).spin_adaptive &&
+      ni->state->spin_adaptive_cycles < max_spin ) {
+    *spin_limit_by_so = 0;
+    return ni->state->spin_adaptive_cycles;
+  }
+  return max_spin;
+}
+
+extern void ci_netif_spin_adaptive_update(ci_netif* ni, citp_waitable* w,
+                                          ci_uint64 waited) CI_HF;
+
+
 /* See ci_netif_need_poll() for description.  Use this when you already
 ** know a recent frc.
 */
 ci_inline int ci_netif_need_poll_frc(ci_netif* ni, ci_uint64 frc_now) {
   return ci_netif_not_primed(ni) &&
-         ci_netif_need_poll_spinning(ni, frc_now);
+         ci_netif_need_poll_idle(ni, frc_now);
 }
 
 
@@ -3047,6 +3120,26 @@ ci_inline void __ci_netif_pkt_clean(ci_ip_pkt_fmt* pkt)
 }
 
 
+/* Completes the copy of a received efct packet whose payload was left in
+ * the superbuf (EF_EFCT_RX_COPY_ON_ACCEPT).  Must be called before
+ * anything beyond the packet's headers is read, or the packet is made
+ * visible to other threads.
+ */
+#ifndef __KERNEL__
+extern void __ci_netif_pkt_efct_fill(ci_netif* ni, ci_ip_pkt_fmt* pkt) CI_HF;
+#endif
+
+ci_inline void ci_netif_pkt_efct_fill(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+{
+#ifndef __KERNEL__
+  if(CI_UNLIKELY( pkt->rx_flags & CI_PKT_RX_FLAG_EFCT_DEFER ))
+    __ci_netif_pkt_efct_fill(ni, pkt);
+#else
+  ci_assert_nflags(pkt->rx_flags, CI_PKT_RX_FLAG_EFCT_DEFER);
+#endif
+}
+
+
 ci_inline ci_ip_pkt_fmt* ci_netif_pkt_get(ci_netif* ni, int bufset_id)
 {
   ci_ip_pkt_fmt* pkt;
@@ -3836,6 +3929,63 @@ ci_inline int ci_udp_recv_q_bytes2packets(int bytes_limit)
 ***************************** TCP timers *****************************
 *********************************************************************/
 
+/* A socket's RTO, delayed-ack, zero-window and keepalive timers share one
+ * entry on the timer wheel, [tcp_tid], which is armed for no later than the
+ * earliest pending deadline in [timer_time].  Only bringing that deadline
+ * forward touches the wheel: a deadline that moves later, or a timer that
+ * is cleared while others are pending, just leaves the wheel entry to fire
+ * early, and ci_tcp_timeout_mux() re-arms it.  Connection-dense stacks
+ * restart their RTO and keepalive timers on almost every ACK, so this keeps
+ * most of those restarts off the wheel.
+ */
+
+ci_inline int ci_tcp_timer_pending(const ci_tcp_state* ts, int timer)
+{
+  ci_assert_lt((unsigned) timer, CI_TCP_TIMER_N);
+  return (ts->timers_pending >> timer) & 1;
+}
+
+ci_inline ci_iptime_t ci_tcp_timer_time(const ci_tcp_state* ts, int timer)
+{
+  ci_assert(ci_tcp_timer_pending(ts, timer));
+  return ts->timer_time[timer];
+}
+
+/* Set or move a timer, whether or not it is pending. */
+ci_inline void ci_tcp_timer_modify(ci_netif* ni, ci_tcp_state* ts, int timer,
+                                   ci_iptime_t t)
+{
+  ts->timer_time[timer] = t;
+  ts->timers_pending |= 1u << timer;
+  if( ! ci_ip_timer_pending(ni, &ts->tcp_tid) ) {
+    ci_ip_timer_set(ni, &ts->tcp_tid, t);
+    CITP_STATS_NETIF_INC(ni, tcp_timer_wheel_ops);
+  }
+  else if( TIME_LT(t, ts->tcp_tid.time) ) {
+    ci_ip_timer_modify(ni, &ts->tcp_tid, t);
+    CITP_STATS_NETIF_INC(ni, tcp_timer_wheel_ops);
+  }
+  else {
+    CITP_STATS_NETIF_INC(ni, tcp_timer_deferred_ops);
+  }
+}
+
+/* Set a non-pending timer. */
+ci_inline void ci_tcp_timer_set(ci_netif* ni, ci_tcp_state* ts, int timer,
+                                ci_iptime_t t)
+{
+  ci_assert(! ci_tcp_timer_pending(ts, timer));
+  ci_tcp_timer_modify(ni, ts, timer, t);
+}
+
+/* Clear a timer, whether or not it is pending. */
+ci_inline void ci_tcp_timer_clear(ci_netif* ni, ci_tcp_state* ts, int timer)
+{
+  ts->timers_pending &=~ (1u << timer);
+  if( ts->timers_pending == 0 )
+    ci_ip_timer_clear(ni, &ts->tcp_tid);
+}
+
 
 /* RTO handlers */
 static inline int ci_tcp_retransq_is_empty(ci_tcp_state* ts)
@@ -3849,16 +3999,25 @@ ci_inline void ci_tcp_rto_check_and_set(ci_netif* netif, ci_tcp_state* ts) {
   ci_assert(!ci_tcp_retransq_is_empty(ts)); 
   /* shouldn't set an RTO timer in a state that doesn't allow them */
   ci_assert(!(ts->s.b.state & CI_TCP_STATE_NO_TIMERS));
-  if( ! ci_ip_timer_pending(netif, &ts->rto_tid) ) {
+  if( ! ci_tcp_timer_pending(ts, CI_TCP_TIMER_RTO) ) {
 #if CI_CFG_TAIL_DROP_PROBE
     ts->tcpflags &=~ CI_TCPT_FLAG_TAIL_DROP_TIMING;
 #endif
-    ci_ip_timer_set(netif, &ts->rto_tid, ci_tcp_time_now(netif) + ts->rto);
+#if CI_CFG_TCP_RACK
+    ts->tcpflags &=~ CI_TCPT_FLAG_RACK_TIMING;
+#endif
+    ci_tcp_timer_set(netif, ts, CI_TCP_TIMER_RTO,
+                     ci_tcp_time_now(netif) + ts->rto);
   }
 }
 
 ci_inline void ci_tcp_rto_clear(ci_netif* netif, ci_tcp_state* ts)
-{ ci_ip_timer_clear(netif, &ts->rto_tid); }
+{
+#if CI_CFG_TCP_RACK
+  ts->tcpflags &=~ CI_TCPT_FLAG_RACK_TIMING;
+#endif
+  ci_tcp_timer_clear(netif, ts, CI_TCP_TIMER_RTO);
+}
 
 ci_inline void ci_tcp_rto_restart(ci_netif* netif, ci_tcp_state* ts) {
   /* shouldn't set an RTO if retrans queue is empty */
@@ -3868,7 +4027,11 @@ ci_inline void ci_tcp_rto_restart(ci_netif* netif, ci_tcp_state* ts) {
 #if CI_CFG_TAIL_DROP_PROBE
   ts->tcpflags &=~ CI_TCPT_FLAG_TAIL_DROP_TIMING;
 #endif
-  ci_ip_timer_modify(netif, &ts->rto_tid, ci_tcp_time_now(netif) + ts->rto);
+#if CI_CFG_TCP_RACK
+  ts->tcpflags &=~ CI_TCPT_FLAG_RACK_TIMING;
+#endif
+  ci_tcp_timer_modify(netif, ts, CI_TCP_TIMER_RTO,
+                      ci_tcp_time_now(netif) + ts->rto);
 }
 
 ci_inline void ci_tcp_rto_set_with_timeout(ci_netif* netif, ci_tcp_state* ts,
@@ -3877,7 +4040,8 @@ ci_inline void ci_tcp_rto_set_with_timeout(ci_netif* netif, ci_tcp_state* ts,
   ci_assert(!ci_tcp_retransq_is_empty(ts));
   /* shouldn't set an RTO timer in a state that doesn't allow them */
   ci_assert(!(ts->s.b.state & CI_TCP_STATE_NO_TIMERS));
-  ci_ip_timer_set(netif, &ts->rto_tid, ci_tcp_time_now(netif) + timeout);
+  ci_tcp_timer_set(netif, ts, CI_TCP_TIMER_RTO,
+                   ci_tcp_time_now(netif) + timeout);
 }
 
 #define ci_tcp_rto_set(ni, ts) ci_tcp_rto_set_with_timeout((ni), (ts), \
@@ -3893,13 +4057,13 @@ ci_inline void ci_tcp_delack_check_and_set(ci_netif* netif,
                                            ci_tcp_state* ts) {
   /* shouldn't set a timer in a state that doesn't allow them */
   ci_assert(!(ts->s.b.state & CI_TCP_STATE_NO_TIMERS));
-  if( !ci_ip_timer_pending(netif, &ts->delack_tid) )
-    ci_ip_timer_set(netif, &ts->delack_tid, ci_tcp_time_now(netif) +
-                    NI_CONF(netif).tconst_delack);
+  if( ! ci_tcp_timer_pending(ts, CI_TCP_TIMER_DELACK) )
+    ci_tcp_timer_set(netif, ts, CI_TCP_TIMER_DELACK,
+                     ci_tcp_time_now(netif) + NI_CONF(netif).tconst_delack);
 }
 
 ci_inline void ci_tcp_delack_clear(ci_netif* netif, ci_tcp_state* ts)
-{ ci_ip_timer_clear(netif, &ts->delack_tid); }
+{ ci_tcp_timer_clear(netif, ts, CI_TCP_TIMER_DELACK); }
 
 #if CI_CFG_DYNAMIC_ACK_RATE
 ci_inline void ci_tcp_delack_soon(ci_netif* netif, ci_tcp_state* ts) 
@@ -3909,10 +4073,8 @@ ci_inline void ci_tcp_delack_soon(ci_netif* netif, ci_tcp_state* ts)
   ci_assert_gt(ts->acks_pending & CI_TCP_ACKS_PENDING_MASK,
                NI_OPTS(netif).delack_thresh);
   ts->acks_pending |= CI_TCP_DELACK_SOON_FLAG;
-  if( ci_ip_timer_pending(netif, &ts->delack_tid) )
-    ci_ip_timer_modify(netif, &ts->delack_tid, ci_tcp_time_now(netif)+1);
-  else
-    ci_ip_timer_set(netif, &ts->delack_tid, ci_tcp_time_now(netif)+1);
+  ci_tcp_timer_modify(netif, ts, CI_TCP_TIMER_DELACK,
+                      ci_tcp_time_now(netif) + 1);
 }
 #endif
 
@@ -3987,8 +4149,31 @@ ci_inline unsigned ci_tcp_taildrop_timeout(const ci_netif* netif,
 
 #endif
 
+#if CI_CFG_TCP_RACK
+ci_inline int ci_tcp_rack_enabled(const ci_netif* ni, const ci_tcp_state* ts)
+{
+  return NI_OPTS(ni).tcp_rack &&
+         (ts->tcpflags & CI_TCPT_FLAG_SACK) &&
+         (ts->s.b.state & CI_TCP_STATE_SYNCHRONISED);
+}
+#endif
+
 /* keep alive timers */
 
+/* Keepalive deadlines that are far enough away are rounded up to a coarse
+ * bucket, so that the timers of idle sockets expire together in a few
+ * wheel slots rather than being spread over every tick.  The error is
+ * small next to keepalive times, which are in seconds. */
+#define CI_TCP_KALIVE_BUCKET_BITS  7
+
+ci_inline ci_iptime_t ci_tcp_kalive_bucket(ci_iptime_t t, ci_iptime_t rel)
+{
+  const ci_iptime_t mask = (1u << CI_TCP_KALIVE_BUCKET_BITS) - 1;
+  if( rel < (mask + 1) * 8 )
+    return t;
+  return (t + mask) & ~mask;
+}
+
 /*
  * Restart keepalive timer in case CI_TCPT_FLAG_KALIVE flag is set on the
  * socket. It runs timer if it is not running yet.
@@ -4008,7 +4193,8 @@ ci_inline void ci_tcp_kalive_restart(ci_netif *netif, ci_tcp_state* ts,
              ts->s.b.state != CI_TCP_LISTEN );
 
   if( ts->s.s_flags & CI_SOCK_FLAG_KALIVE )
-    ci_ip_timer_modify(netif, &ts->kalive_tid, ci_tcp_time_now(netif) + t);
+    ci_tcp_timer_modify(netif, ts, CI_TCP_TIMER_KALIVE,
+                        ci_tcp_kalive_bucket(ci_tcp_time_now(netif) + t, t));
   else
     /*
      * ka_probes is not cleared somewhere, as soon as with disabled
@@ -4068,7 +4254,7 @@ ci_inline unsigned ci_tcp_kalive_probes_get(ci_tcp_state* ts)
 { return ts->c.ka_probe_th; }
 
 ci_inline void ci_tcp_kalive_check_and_clear(ci_netif* netif, ci_tcp_state* ts)
-{ ci_ip_timer_clear(netif, &ts->kalive_tid); }
+{ ci_tcp_timer_clear(netif, ts, CI_TCP_TIMER_KALIVE); }
 
 
 /* Sort out the keepalive timer when an ACK is received */
@@ -4098,7 +4284,7 @@ ci_inline void ci_tcp_zwin_set(ci_netif* netif, ci_tcp_state* ts)
   else
     t = ts->rto << ts->zwin_probes;
   ci_assert(TIME_GT(t, 0));
-  ci_ip_timer_set(netif, &ts->zwin_tid, ci_tcp_time_now(netif) + t);
+  ci_tcp_timer_set(netif, ts, CI_TCP_TIMER_ZWIN, ci_tcp_time_now(netif) + t);
 }
 
 
@@ -4149,6 +4335,32 @@ ci_inline void ci_tcp_retrans_drop(ci_netif* ni, ci_tcp_state* ts)
     ci_nvme_plugin_idp_dropped_queue_cleanup(ni, ts, &ts->retrans);
 #endif
   ci_ip_queue_drop(ni, &ts->retrans);
+  ts->sack_hint = OO_PP_NULL;
+  ts->sacked_pkts = 0;
+}
+
+/* Returns the last packet of the SACKed block whose head is [pkt].
+**
+** Only the head of a SACKed block is guaranteed to have an exact
+** [block_end]: packets inside the block keep the value they were given
+** when they were marked, which points no further than the end of the
+** block.  Given any SACKed packet, following [block_end] and then the
+** following SACKed packets finds the end of its block.
+*/
+ci_inline ci_ip_pkt_fmt* ci_tcp_sack_block_end(ci_netif* ni,
+                                               ci_ip_pkt_fmt* pkt)
+{
+  ci_ip_pkt_fmt* next;
+
+  ci_assert(pkt->flags & CI_PKT_FLAG_RTQ_SACKED);
+  pkt = PKT_CHK(ni, pkt->pf.tcp_tx.block_end);
+  while( OO_PP_NOT_NULL(pkt->next) ) {
+    next = PKT_CHK(ni, pkt->next);
+    if( ~next->flags & CI_PKT_FLAG_RTQ_SACKED )
+      break;
+    pkt = PKT_CHK(ni, next->pf.tcp_tx.block_end);
+  }
+  return pkt;
 }
 
 extern int ci_tcp_add_fin(ci_tcp_state* ts, ci_netif* netif) CI_HF;
@@ -4968,6 +5180,68 @@ ci_inline void ci_netif_poll_free_pkts(ci_netif* ni,
   CITP_STATS_NETIF_ADD(ni, pkt_nonb, ps->tx_pkt_free_list_n);
 }
 
+ci_inline void ci_netif_poll_state_init(struct ci_netif_poll_state* ps)
+{
+  ps->tx_pkt_free_list_insert = &ps->tx_pkt_free_list;
+  ps->tx_pkt_free_list_n = 0;
+  ps->rx_pkt_free_list_insert = &ps->rx_pkt_free_list;
+  ps->rx_pkt_free_list_n = 0;
+  ps->rx_lookup_ts = NULL;
+}
+
+/* Release a received packet from within a poll.  If that drops the last
+ * reference to a plain main-pool buffer, it goes onto the poll's free
+ * list rather than back to its packet set, provided the list is empty or
+ * holds buffers of the same set.  Anything else is freed as usual.
+ */
+ci_inline void ci_netif_poll_pkt_release_rx(ci_netif* ni,
+                                            struct ci_netif_poll_state* ps,
+                                            ci_ip_pkt_fmt* pkt)
+{
+  int bufset_id = PKT_SET_ID(pkt);
+
+  ci_assert_gt(pkt->refcount, 0);
+  ci_assert(ci_netif_is_locked(ni));
+
+  if( ps == NULL || pkt->refcount != 1 ||
+      (pkt->flags & CI_PKT_FLAG_NONB_POOL) ||
+      (pkt->rx_flags & CI_PKT_RX_FLAG_UDP_FANOUT) ||
+      OO_PP_NOT_NULL(pkt->frag_next) ||
+#if CI_CFG_POISON_BUFS
+      NI_OPTS(ni).poison_rx_buf ||
+#endif
+      (ps->rx_pkt_free_list_n != 0 && bufset_id != ps->rx_pkt_free_set) ) {
+    ci_netif_pkt_release_rx(ni, pkt);
+    return;
+  }
+
+  ci_assert_equal(pkt->pio_addr, -1);
+  pkt->refcount = 0;
+  if( pkt->flags & CI_PKT_FLAG_RX )
+    --ni->state->n_rx_pkts;
+  __ci_netif_pkt_clean(pkt);
+  ps->rx_pkt_free_set = bufset_id;
+  *ps->rx_pkt_free_list_insert = OO_PKT_P(pkt);
+  ps->rx_pkt_free_list_insert = &pkt->next;
+  ++ps->rx_pkt_free_list_n;
+}
+
+/* Return the packets collected by ci_netif_poll_pkt_release_rx() to their
+ * packet set. */
+ci_inline void ci_netif_poll_free_rx_pkts(ci_netif* ni,
+                                          struct ci_netif_poll_state* ps)
+{
+  oo_pktbuf_set* set = &ni->packets->set[ps->rx_pkt_free_set];
+
+  *ps->rx_pkt_free_list_insert = set->free;
+  set->free = ps->rx_pkt_free_list;
+  set->n_free += ps->rx_pkt_free_list_n;
+  ni->packets->n_free += ps->rx_pkt_free_list_n;
+  ps->rx_pkt_free_list_insert = &ps->rx_pkt_free_list;
+  ps->rx_pkt_free_list_n = 0;
+  CHECK_FREEPKTS(ni);
+}
+
 
 ci_inline int citp_shutdown_how_is_valid(int how)
 {
@@ -234,6 +234,10 @@ typedef union {
     struct oo_timespec first_tx_hw_stamp; /* Timestamp of the first transmit */
 #endif
     ci_user_ptr_t     next CI_ALIGN(8);   /* for ci_tcp_sendmsg() local use only! */
+#if CI_CFG_TCP_RACK
+    ci_uint64         xmit_frc;      /* time of the latest (re)transmit,
+                                      * for RACK; set only with EF_TCP_RACK */
+#endif
   } tcp_tx CI_ALIGN(8);
   struct {
     ci_uint32         pay_len;              /*!< length of UDP payload */
@@ -405,6 +409,10 @@ struct ci_ip_pkt_fmt_s {
                                    * processing (EF100 feature). The user_mark
                                    * is put in pf.tcp_rx.lo.rx_sock */
 #define CI_PKT_RX_FLAG_RX_SHARED       0x08 /* Packet comes from shared RXQ */
+#define CI_PKT_RX_FLAG_UDP_FANOUT      0x10 /* UDP fan-out node: return to
+                                             * udp_fanout_pool when freed */
+#define CI_PKT_RX_FLAG_EFCT_DEFER      0x20 /* Payload beyond the headers is
+                                             * still in the efct superbuf */
   ci_uint8              rx_flags;
 
   /*! Number of these buffers that are chained together using
@@ -843,10 +851,6 @@ typedef struct {
   ci_iptime_t                 time;          /* absolute time to expire  */
   oo_p                        statep;        /* state offset of the timer */
   ci_iptime_callback_fn_t     fn;            /* function code for demux  */
-# define CI_IP_TIMER_TCP_RTO            0x1  /* TCP RTO callback         */
-# define CI_IP_TIMER_TCP_DELACK         0x2  /* TCP delack callback      */
-# define CI_IP_TIMER_TCP_ZWIN           0x3  /* TCP zero window callback */
-# define CI_IP_TIMER_TCP_KALIVE         0x4  /* TCP keep alive callback  */
 # define CI_IP_TIMER_TCP_LISTEN         0x5  /* TCP listen callback      */
 # define CI_IP_TIMER_NETIF_TIMEOUT      0x6  /* netif timeout state timer*/
 # define CI_IP_TIMER_PMTU_DISCOVER      0x7  /* IP PMTU discovery        */
@@ -855,9 +859,18 @@ typedef struct {
 # define CI_IP_TIMER_NETIF_STATS        0xa  /* netif statistics timer   */
 # define CI_IP_TIMER_TCP_CORK           0xb  /* TCP_CORK timer           */
 # define CI_IP_TIMER_NETIF_TCP_RECYCLE  0xc  /* EF100 plugin recycling   */
+# define CI_IP_TIMER_TCP_MUX            0xd  /* TCP multiplexed timers   */
 } ci_ip_timer;
 
 
+/* Per-socket TCP timers multiplexed onto ci_tcp_state::tcp_tid. */
+#define CI_TCP_TIMER_RTO      0  /* retransmit (also TLP and RACK)     */
+#define CI_TCP_TIMER_DELACK   1  /* delayed acknowledgement            */
+#define CI_TCP_TIMER_ZWIN     2  /* zero window probe                  */
+#define CI_TCP_TIMER_KALIVE   3  /* keep alive                         */
+#define CI_TCP_TIMER_N        4
+
+
 /*!
 ** ci_pio_buddy_allocator:  A buddy allocator to allow a pio region linked to
 ** a vi to be divided up into smaller chunks.
@@ -1101,6 +1114,10 @@ typedef struct {
   struct oo_timespec    last_rx_timestamp;
   /* Sync flags of the last packet received */
   ci_uint32             last_sync_flags;
+  /* No packet stamped at or before this time (in ns) remains in the event
+   * queue: updated each time the queue is polled until empty.  Read
+   * without the stack lock, hence a single 64-bit word. */
+  ci_uint64             rx_drained_ns CI_ALIGN(8);
 #endif
 
 # define CI_NETIF_NIC_ERROR_REMAP               0x00000001u
@@ -1262,6 +1279,11 @@ struct ci_netif_state_s {
   oo_pkt_p              mem_pressure_pkt_pool;
   ci_int32              mem_pressure_pkt_pool_n;
 
+  /* Free UDP fan-out nodes (EF_UDP_FANOUT_POOL).  These are accounted in
+   * [n_rx_pkts] both while free and while queued on a socket. */
+  oo_pkt_p              udp_fanout_pool;
+  ci_int32              udp_fanout_pool_n;
+
   /* Number of packets that are in use by or available to threads not
   ** holding the netif lock.  This includes packets in the nonb_pkt_pool,
   ** and ones allocated from that pool and not yet returned to data
@@ -1383,6 +1405,22 @@ struct ci_netif_state_s {
   ci_uint64             buzz_cycles         CI_ALIGN(8);
   ci_uint64             timer_prime_cycles  CI_ALIGN(8);
 
+  /* State of the spin budget controller (EF_SPIN_ADAPTIVE): the current
+   * budget, and the number of consecutive waits that outlasted the full
+   * spin timeout.
+   */
+  ci_uint64             spin_adaptive_cycles  CI_ALIGN(8);
+  ci_uint32             spin_adaptive_misses;
+
+  /* State of the interrupt moderation controller (EF_INT_ADAPTIVE_USEC):
+   * the current moderation interval (0 for immediate wakeups), the number
+   * of consecutive quiet interrupts, and the time of the last interrupt.
+   * Updated only by the interrupt handler with the stack lock held.
+   */
+  ci_uint32             int_adaptive_usec;
+  ci_uint32             int_adaptive_quiet;
+  ci_uint64             int_adaptive_last_frc  CI_ALIGN(8);
+
   CI_ULCONST ci_uint32  timesync_bytes;
   CI_ULCONST ci_uint32  io_mmap_bytes;
   CI_ULCONST ci_uint32  buf_mmap_bytes;
@@ -2620,6 +2658,9 @@ struct ci_tcp_state_s {
    * because packet allocation failed.  Must send FIN, really. */
 #define CI_TCPT_FLAG_FIN_PENDING        0x800000
 
+  /* RACK reordering timer is running (rto timer is used) */
+#define CI_TCPT_FLAG_RACK_TIMING        0x1000000
+
   /* flags advertised on SYN */
 # define CI_TCPT_SYN_FLAGS \
         (CI_TCPT_FLAG_WSCL | CI_TCPT_FLAG_TSO | CI_TCPT_FLAG_SACK)
@@ -2761,6 +2802,8 @@ struct ci_tcp_state_s {
   ci_uint32            congrecover; /* snd_nxt when loss detected         */
   oo_pkt_p             retrans_ptr; /* next packet to retransmit          */
   ci_uint32            retrans_seq; /* seq of next packet to retransmit   */
+  oo_pkt_p             sack_hint;   /* head of highest SACKed block       */
+  ci_uint32            sacked_pkts; /* packets in rtq marked as SACKed    */
 
   ci_uint32            cwnd;        /* congestion window                  */
   ci_uint32            cwnd_extra;  /* adjustments when congested         */
@@ -2777,6 +2820,23 @@ struct ci_tcp_state_s {
   ci_uint32            taildrop_mark;
 #endif
 
+#if CI_CFG_TCP_RACK
+  /* RACK state, RFC 8985.  Describes the most recently sent segment that
+   * has been delivered (cumulatively or selectively acked). */
+  struct {
+    ci_uint64          xmit_frc;    /* when it was (last) sent            */
+    ci_uint32          end_seq;     /* its end sequence number            */
+    ci_uint32          rtt_us;      /* RTT measured from it               */
+    ci_uint32          min_rtt_us;  /* min RTT seen; 0 until measured     */
+    ci_uint32          fack;        /* highest end seq delivered          */
+    ci_uint32          lost_end;    /* retransmit up to here in recovery  */
+    ci_uint8           reo_wnd_mult; /* DSACK-driven reo window scaling   */
+    ci_uint8           reo_wnd_persist; /* recoveries until mult resets   */
+    ci_uint8           reordering_seen;
+    ci_uint8           advanced;    /* updated by the current ACK         */
+  } rack;
+#endif
+
   /* Keep alive probes, and sending ACKs after gaps that may cause
    * other end to validated its congetion window 
    */
@@ -2855,11 +2915,12 @@ struct ci_tcp_state_s {
   ci_uint16            zwin_probes; /* zero window probes counter         */
   ci_uint16            zwin_acks;   /* zero window acks counter           */
 
-  /* timer ids for timers */
-  ci_ip_timer          rto_tid;     /* retransmit timer                   */
-  ci_ip_timer          delack_tid;  /* delayed acknowledgement timer      */
-  ci_ip_timer          zwin_tid;    /* zero window probe timer            */
-  ci_ip_timer          kalive_tid;  /* keep alive timer                   */
+  /* The retransmit, delayed-ack, zero-window and keepalive timers share a
+   * single entry on the timer wheel, armed for no later than the earliest
+   * of their deadlines.  See ci_tcp_timer_set(). */
+  ci_ip_timer          tcp_tid;     /* wheel entry for the timers below   */
+  ci_iptime_t          timer_time[CI_TCP_TIMER_N]; /* deadlines           */
+  ci_uint32            timers_pending; /* bitmask of 1 << CI_TCP_TIMER_*  */
 #if CI_CFG_TCP_SOCK_STATS
   ci_ip_timer          stats_tid;   /* Statistics report timer            */
 #endif
@@ -271,6 +271,8 @@ struct ci_netif_s {
 # define CI_NETIF_FLAGS_DONT_USE_ANON    0x40
   /* Packets have been prefaulted */
 # define CI_NETIF_FLAGS_PREFAULTED       0x80
+  /* An AF_XDP interface runs in busy-poll mode (EF_AF_XDP_BUSY_POLL) */
+# define CI_NETIF_FLAGS_AF_XDP_BUSY_POLL 0x200
 
 #else
 
@@ -316,6 +318,14 @@ struct ci_netif_s {
    * overflow. */
   ef_request_id tx_events[EF_VI_TRANSMIT_BATCH];
   ef_request_id rx_events[EF_VI_RECEIVE_BATCH];
+#ifndef __KERNEL__
+  /* EF_EFCT_RX_COPY_ON_ACCEPT: the superbuf reference held while
+   * ci_netif_poll_evq() handles an efct packet, and the packet itself
+   * until its payload has been copied out of the superbuf. */
+  ef_vi*         efct_defer_vi;
+  ci_uint32      efct_defer_id;
+  ci_ip_pkt_fmt* efct_defer_pkt;
+#endif
   /* See also copy in ci_netif_state. */
   unsigned      error_flags;
 
@@ -380,6 +390,19 @@ struct ci_netif_poll_state {
   oo_pkt_p  tx_pkt_free_list;
   oo_pkt_p* tx_pkt_free_list_insert;
   int       tx_pkt_free_list_n;
+  /* RX packets freed during this poll, all from packet set
+   * [rx_pkt_free_set].  They go back to the set's free list in one go at
+   * the end of the poll, just before the RX rings are refilled. */
+  oo_pkt_p  rx_pkt_free_list;
+  oo_pkt_p* rx_pkt_free_list_insert;
+  int       rx_pkt_free_list_n;
+  int       rx_pkt_free_set;
+  /* Lookup cache: the connection that took the last TCP segment in this
+   * poll, and the interface it arrived on.  Segments of a flow tend to
+   * arrive in bursts, so this is tried before the filter table. */
+  struct ci_tcp_state_s* rx_lookup_ts;
+  ci_int16  rx_lookup_intf_i;
+  ci_int16  rx_lookup_vlan;
 };
 
 
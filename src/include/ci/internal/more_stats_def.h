@@ -142,4 +142,14 @@ OO_STAT(MORE_STATS_DERIVED_DESC,
         unsigned, ef_vi_rx_ev_bad_q_label, count)
 OO_STAT(MORE_STATS_DERIVED_DESC,
         unsigned, ef_vi_evq_gap, count)
+OO_STAT("Number of system calls made to get an AF_XDP socket to process its "
+        "rings.",
+        unsigned, ef_vi_xdp_kicks, count)
+OO_STAT("Number of AF_XDP system calls skipped because the kernel reported "
+        "that it was already processing the rings (see "
+        "EF_AF_XDP_BUSY_POLL).",
+        unsigned, ef_vi_xdp_kicks_elided, count)
+OO_STAT("Number of system calls made to get an AF_XDP socket to take "
+        "buffers from a fill ring that had run dry.",
+        unsigned, ef_vi_xdp_rx_kicks, count)
 
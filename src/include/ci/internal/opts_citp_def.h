@@ -83,6 +83,15 @@ CI_CFG_OPT("EF_POLL_FAST", ul_poll_fast, ci_uint32,
 "practice a vast majority of applications work fine with this option.",
            1, , 1, 0, 1, yesno)
 
+CI_CFG_OPT("EF_POLL_CACHE", ul_poll_cache, ci_uint32,
+"Remember, between one poll() or select() call and the next in the same "
+"thread, which accelerated sockets were found not ready.  When the same "
+"descriptors are passed again, those sockets are skipped unless they have "
+"had an event since, so that a large set with few ready sockets is checked "
+"quickly.  Applies to calls with at least this many file descriptors.  "
+"Set to zero to disable.",
+           , , 64, MIN, MAX, count)
+
 #define CITP_EPOLL_KERNEL        0
 #define CITP_EPOLL_UL            1
 #define CITP_EPOLL_KERNEL_ACCEL  2
@@ -109,6 +118,18 @@ CI_CFG_OPT("EF_EPOLL_SPIN", ul_epoll_spin, ci_uint32,
 "kernel and block.  The spin timeout is set by EF_SPIN_USEC or EF_POLL_USEC.",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_EPOLL_SPIN_ADAPTIVE", ul_epoll_spin_adaptive, ci_uint32,
+"Adapt the time spent spinning in epoll_wait() to the observed arrival "
+"pattern of each epoll set.  Onload keeps a moving average of how long "
+"epoll_wait() has had to wait for events on each set, and spins for a small "
+"multiple of that (bounded below by the cost of a few passes over the "
+"member stacks, and above by EF_SPIN_USEC).  When the expected wait exceeds "
+"EF_SPIN_USEC, epoll_wait() blocks straight away rather than spinning "
+"in vain.  This is useful for applications with many mostly-idle threads "
+"each spinning in epoll_wait().  Only applies when EF_EPOLL_SPIN is "
+"enabled and EF_UL_EPOLL=1 or 3.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_EPOLL_CTL_FAST", ul_epoll_ctl_fast, ci_uint32, 
 "Avoid system calls in epoll_ctl() when using an accelerated epoll "
 "implementation.  System calls are deferred until epoll_wait() blocks, and in "
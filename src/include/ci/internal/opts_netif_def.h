@@ -191,6 +191,24 @@ CI_CFG_OPT("EF_INT_REPRIME", int_reprime, ci_uint32,
 "Enable interrupts more aggressively than the default.",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_INT_ADAPTIVE_USEC", int_adaptive_usec, ci_uint32,
+"Upper limit in microseconds for adaptive interrupt moderation in interrupt "
+"driven stacks (EF_INT_DRIVEN).  Set to zero (the default) to disable."
+"\n"
+"When enabled, an interrupt that finds a large batch of events, or that "
+"follows closely on the previous one, raises the stack's moderation "
+"interval, doubling it up to this limit.  While the interval is non-zero the "
+"interrupt handler re-arms the event queue's count-down timer rather than "
+"asking for a wakeup on the next event, so that events arriving in the "
+"interval are handled by a single interrupt.  After several interrupts in a "
+"row that find only one or two events, the interval is halved, and below "
+"a few microseconds the stack returns to immediate wakeups.  Quiet stacks "
+"therefore keep the latency of immediate wakeups."
+"\n"
+"Only supported on adapters with an event queue timer (EF10).  Ignored if "
+"EF_HELPER_USEC is set.",
+           ,  , 0, MIN, MAX, time:usec)
+
 #define MULTICAST_LIMITATIONS_NOTE                                      \
     "\nSee the OpenOnload manual for further details on multicast operation."
 
@@ -403,6 +421,16 @@ CI_CFG_OPT("EF_TAIL_DROP_PROBE", tail_drop_probe, ci_uint32,
            , , 1, 0, 1, yesno)
 #endif
 
+#if CI_CFG_TCP_RACK
+CI_CFG_OPT("EF_TCP_RACK", tcp_rack, ci_uint32,
+"Use RACK (RFC 8985) time-based loss detection on TCP connections that "
+"have negotiated SACK.  A segment is deemed lost when a segment sent later "
+"has been delivered and more than a reordering window has passed since it "
+"was sent, rather than after EF_RETRANSMIT_THRESHOLD duplicate ACKs.  "
+"Combine with EF_TAIL_DROP_PROBE for RACK-TLP.",
+           1, , 0, 0, 1, yesno)
+#endif
+
 CI_CFG_OPT("EF_TCP_RST_DELAYED_CONN", rst_delayed_conn, ci_uint32,
 "This option tells Onload to reset TCP connections rather than allow data to "
 "be transmitted late.  Specifically, TCP connections are reset if the "
@@ -978,6 +1006,18 @@ CI_CFG_OPT("EF_SPIN_USEC", spin_usec, ci_uint32,
            "" /* documented in opts_citp_def.h */,
            ,  poll_cycles, 0, MIN, MAX, time:usec)
 
+CI_CFG_OPT("EF_SPIN_ADAPTIVE", spin_adaptive, ci_uint32,
+"Adapt the time that blocking receive calls on this stack spin to how long "
+"they actually wait.  The stack keeps a spin budget of at most the socket's "
+"spin timeout (EF_SPIN_USEC or SO_BUSY_POLL).  A call that blocks but is "
+"woken within the spin timeout grows the budget to cover that wait.  "
+"Several calls in a row that wait longer than the spin timeout halve the "
+"budget, until it reaches zero and calls on the stack block straight away, "
+"relying on interrupts.  This keeps mostly quiet stacks from spinning in "
+"vain.  Applies to TCP and UDP receive calls; see EF_EPOLL_SPIN_ADAPTIVE "
+"for epoll_wait().",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_BUZZ_USEC", buzz_usec, ci_uint32,
 "Sets the timeout in microseconds for lock buzzing options.  Set to zero to "
 "disable lock buzzing (spinning).  Will buzz forever if set to -1.  Also set "
@@ -1202,6 +1242,29 @@ CI_CFG_OPT("EF_UDP_RCVBUF", udp_rcvbuf_user, ci_uint32,
 "double the amount requested, mimicking the behavior of the Linux kernel.)",
            ,  udp_rcvbuf, 0, 0, SMAX/2, bincount)
 
+CI_CFG_OPT("EF_UDP_FANOUT_POOL", udp_fanout_pool, ci_int32,
+"When a received UDP datagram (typically multicast) matches more than one "
+"socket in a stack, each socket beyond the first is given a light-weight "
+"queue node that refers to the single shared copy of the datagram.  This "
+"option sets the number of such nodes that the stack keeps on a dedicated "
+"free list, so that steady-state fan-out needs no allocation from the main "
+"packet pool and is not subject to EF_MAX_RX_PACKETS.  Nodes held on the "
+"free list count towards EF_MAX_RX_PACKETS, and are returned to the main "
+"pool under memory pressure.  Set to 0 to disable the pool.",
+           , , 0, 0, 1000000000, count)
+
+CI_CFG_OPT("EF_EFCT_RX_COPY_ON_ACCEPT", efct_rx_copy_on_accept, ci_uint32,
+"On NICs that receive into shared buffers (X3), copy only the headers of "
+"each received frame into a packet buffer up front, and copy the rest of "
+"the frame only once a UDP socket in this stack has accepted the datagram.  "
+"Frames that no socket wants, which are common on receive queues shared "
+"with other applications, are then dropped without copying their "
+"payload.  This is not zero-copy receive: every datagram delivered to a "
+"socket, including those read with onload_zc_recv(), is still copied in "
+"full.  TCP segments are always copied in full.  Has no effect when "
+"polling in the kernel.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_TCP_BACKLOG_MAX", tcp_backlog_max, ci_uint32,
 "Places an upper limit on the number of embryonic (half-open) connections for "
 "one listening socket; see also EF_TCP_SYNRECV_MAX.\n"
@@ -1351,6 +1414,16 @@ CI_CFG_OPT("EF_FREE_PACKETS_LOW_WATERMARK", free_packets_low, ci_uint16,
 "spare packets.  Default value 0 is interpreted as EF_RXQ_SIZE/2",
            , , 0, MIN, MAX, count)
 
+CI_CFG_OPT("EF_PKT_ALLOC_BACKGROUND", pkt_alloc_background, ci_int32,
+"When set, the packet pool is grown ahead of demand by a kernel work item "
+"rather than by the thread that notices free packets running low.  Growth "
+"is triggered by EF_FREE_PACKETS_LOW_WATERMARK and by the rate at which "
+"free packets were consumed over the last periodic timer interval.  The "
+"application thread then only needs the stack lock briefly to add the new "
+"packets.  A thread that runs out of packets altogether still allocates "
+"them itself.  Packets allocated in the background do not use huge pages.",
+           , , 0, 0, 1, yesno)
+
 #if CI_CFG_PIO
 CI_CFG_OPT("EF_PIO_THRESHOLD", pio_thresh, ci_uint16,
 "Sets a threshold for the size of packet that will use PIO (if turned on "
@@ -1739,6 +1812,18 @@ CI_CFG_OPT("EF_AF_XDP_ZEROCOPY", af_xdp_zerocopy, ci_uint32,
 "Enables zerocopy on AF_XDP NICs. Support for zerocopy is required. ",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_AF_XDP_BUSY_POLL", af_xdp_busy_poll, ci_uint32,
+"Run AF_XDP sockets in busy-poll mode.  The socket prefers busy polling "
+"(SO_PREFER_BUSY_POLL, SO_BUSY_POLL_BUDGET) so that a thread spinning on "
+"the stack drives the NAPI context of the queue itself, and is bound with "
+"XDP_USE_NEED_WAKEUP so that Onload only makes the system call to kick "
+"transmit when the kernel asks for it.  For best results the interface "
+"should also be configured to defer interrupts (napi_defer_hard_irqs and "
+"gro_flush_timeout), and EF_POLL_USEC should be set.  The number of kicks "
+"made and skipped is reported by onload_stackdump more_stats.  Ignored on "
+"other NICs, and on kernels without support for these options.",
+           , , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_ICMP_PKTS", icmp_msg_max, ci_uint32,
            "Maximum number of ICMP messages which can be queued to "
            "one Onload stack.",
@@ -68,6 +68,10 @@ OO_STAT("Number of network events handled by periodic timer.  Indicates your "
 OO_STAT("Number of times periodic timer could not get the stack lock.  "
         "Not severe.",
         ci_uint32, periodic_lock_contends, count)
+OO_STAT("Number of times the bulk periodic poll (periodic_poll_bulk module "
+        "parameter) found nothing to do for this stack and left it "
+        "unlocked.",
+        ci_uint32, periodic_bulk_skips, count)
 OO_STAT("Number of interrupts.  Expected if interrupt driven; otherwise "
         "suggests timeout of one kind or another.",
         ci_uint32, interrupts, count)
@@ -94,6 +98,21 @@ OO_STAT("Number of times an interrupt could not lock the stack.  Usually "
 OO_STAT("Number of times an interrupt handler was limited by NAPI budget.  "
         "This potentially leads to drops if there's a microburst.",
         ci_uint32, interrupt_budget_limited, count)
+OO_STAT("Number of times adaptive interrupt moderation raised the stack's "
+        "moderation interval (EF_INT_ADAPTIVE_USEC).",
+        ci_uint32, int_adaptive_raise, count)
+OO_STAT("Number of times adaptive interrupt moderation lowered the stack's "
+        "moderation interval.",
+        ci_uint32, int_adaptive_lower, count)
+OO_STAT("Number of times an interrupt handler armed the event queue timer "
+        "instead of requesting an immediate wakeup.",
+        ci_uint32, int_adaptive_timer_primes, count)
+OO_STAT("Number of times a blocking receive grew the stack's adaptive spin "
+        "budget (EF_SPIN_ADAPTIVE).",
+        ci_uint32, spin_adaptive_grow, count)
+OO_STAT("Number of times the stack's adaptive spin budget was halved after "
+        "waits that outlasted the spin timeout.",
+        ci_uint32, spin_adaptive_shrink, count)
 OO_STAT("Number of times poll has been deferred to lock holder.  i.e. There "
         "was contention, and this reader thread gave way.",
         ci_uint32, deferred_polls, count)
@@ -226,6 +245,10 @@ OO_STAT("Number of times TCP sendmsg() found the non-blocking pool empty.",
         ci_uint32, tcp_send_nonb_pool_empty, count)
 OO_STAT("Number of times TCP sendmsg() contended the stack lock.",
         ci_uint32, tcp_send_ni_lock_contends, count)
+OO_STAT("Number of times TCP sendmsg() left data on the prequeue for work "
+        "that another thread had already deferred on the socket, rather "
+        "than waiting for the stack lock.",
+        ci_uint32, tcp_send_defer_joined, count)
 OO_STAT("Number of times TCP sendmsg() failed to find an acceleratable route.",
         ci_uint32, tcp_send_fail_noroute, count)
 OO_STAT("Number of times UDP sendmsg() contended the stack lock.",
@@ -314,6 +337,30 @@ OO_STAT("Number of tail-drop probes that were probably unnecessary.",
 OO_STAT("Number of tail-drop probes that probably recovered loss.",
         ci_uint32, tail_drop_probe_success, count)
 #endif
+#if CI_CFG_TCP_RACK
+OO_STAT("Number of TCP segments deemed lost by RACK.",
+        ci_uint32, tcp_rack_marked_lost, count)
+OO_STAT("Number of TCP retransmissions deemed lost by RACK.",
+        ci_uint32, tcp_rack_lost_retrans, count)
+OO_STAT("Number of fast recoveries started by RACK.",
+        ci_uint32, tcp_rack_recoveries, count)
+OO_STAT("Number of expiries of the RACK reordering timer.",
+        ci_uint32, tcp_rack_reo_timeouts, count)
+OO_STAT("Number of TCP connections on which RACK observed reordering.",
+        ci_uint32, tcp_rack_reordering_seen, count)
+#endif
+OO_STAT("Number of TCP timer operations (RTO, delayed-ack, zero-window, "
+        "keepalive) that inserted or moved the socket's entry on the timer "
+        "wheel.",
+        ci_uint64, tcp_timer_wheel_ops, count)
+OO_STAT("Number of TCP timer operations that only recorded a new deadline, "
+        "leaving the socket's wheel entry in place.",
+        ci_uint64, tcp_timer_deferred_ops, count)
+OO_STAT("Number of expiries of sockets' TCP timer wheel entries.",
+        ci_uint64, tcp_timer_expiries, count)
+OO_STAT("Number of expiries of sockets' TCP timer wheel entries that found "
+        "no timer due, and just re-armed the entry.",
+        ci_uint64, tcp_timer_early_expiries, count)
 OO_STAT("Number of times a connection has been reset while in accept queue; "
         "not yet a fully-connected socket.",
         ci_uint32, rst_recv_acceptq, count)
@@ -474,6 +521,9 @@ OO_STAT("Number of TCP segments received in-order when ROB is non-empty.  "
         "indicate a higher latency connection where packets had already "
         "been sent ahead of the re-ordering being detected.",
         ci_uint32, rx_rob_non_empty, count)
+OO_STAT("Number of TCP segments that hit the per-poll lookup cache, and so "
+        "were delivered to their connection without a filter table lookup.",
+        ci_uint32, rx_lookup_cache_hits, count)
 OO_STAT("Number of TCP segments retransmited.",
         ci_uint32, retransmits, count)
 OO_STAT("Number of ACK packets not sent in response of invalid incoming TCP "
@@ -615,6 +665,14 @@ OO_STAT("A UDP packet has arrived into the Onload stack, but it doesn't "
         "or the socket just closed (and there were already matching packets"
         "in the RX ring).",
         ci_uint32, udp_rx_no_match_drops, count)
+OO_STAT("Number of received frames whose payload was copied out of the "
+        "shared receive buffer only after a socket had accepted them.  See "
+        "EF_EFCT_RX_COPY_ON_ACCEPT.",
+        ci_uint32, efct_rx_defer_fills, count)
+OO_STAT("Number of received frames that were dropped without copying their "
+        "payload out of the shared receive buffer.  See "
+        "EF_EFCT_RX_COPY_ON_ACCEPT.",
+        ci_uint32, efct_rx_defer_skips, count)
 OO_STAT("We've been asked to free up a UDP socket (i.e. nothing references "
         "that fd any more) - but there are still some transmits waiting to "
         "complete.  The socket will be freed up once those transmits complete.",
@@ -760,6 +818,20 @@ OO_STAT("Number of proactive packet buffers allocations because of "
         "EF_FREE_PACKETS_LOW_WATERMARK or fragmentation of free packets "
         "between packet sets.",
         ci_uint32, proactive_packet_allocation, count)
+OO_STAT("Number of times a UDP datagram was queued on an additional socket "
+        "using a node from the fan-out pool.  See EF_UDP_FANOUT_POOL.",
+        ci_uint32, udp_fanout_pool_hit, count)
+OO_STAT("Number of times a UDP fan-out node had to be allocated from the main "
+        "packet pool because the fan-out pool was empty.  See "
+        "EF_UDP_FANOUT_POOL.",
+        ci_uint32, udp_fanout_pool_miss, count)
+OO_STAT("Number of packet sets allocated synchronously, by the thread that "
+        "needed them or while holding the stack lock.  See also "
+        "pkt_set_grow_bg.",
+        ci_uint32, pkt_set_grow_fg, count)
+OO_STAT("Number of packet sets allocated ahead of demand by the kernel work "
+        "item.  See EF_PKT_ALLOC_BACKGROUND.",
+        ci_uint32, pkt_set_grow_bg, count)
 OO_STAT("Number of times the stack lock was deferred from driverlink "
         "context to workqueue.",
         ci_uint32, stack_locks_deferred, count)
@@ -781,6 +853,9 @@ OO_STAT("Number of times a socket could be added to a epoll set with "
         "You probably want to increase EF_MAX_ENDPOINTS if this count "
         "is non-zero.",
         ci_uint32, epoll_sb_state_alloc_failed, count)
+OO_STAT("Number of times onload_ordered_epoll_wait() had to poll this "
+        "stack's event queues until empty to find a safe ordering limit.",
+        ci_uint32, woda_drain_polls, count)
 OO_STAT("Number of times that fd allocation failed for a socket in this stack.",
         ci_uint32, sock_attach_fd_alloc_fail, count)
 OO_STAT("Number of times that a socket has used a MAC filter.",
@@ -402,6 +402,11 @@
 */
 #define CI_CFG_TAIL_DROP_PROBE 1
 
+/* RACK time-based loss detection (RFC 8985).  Together with the tail drop
+ * probe above this gives RACK-TLP.
+ */
+#define CI_CFG_TCP_RACK 1
+
 /* Dump users of TCP and UDP sockets to a log file. */
 #define CI_CFG_LOG_SOCKET_USERS         0
 
@@ -114,6 +114,10 @@ extern ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input,
                                   int n);
   /*!< Toeplitz hash */
 
+extern void ci_toeplitz_hash_byte_table(const ci_uint8 *key, int offset,
+                                        ci_uint32 *table);
+  /*!< Per-value contribution of one input byte to the Toeplitz hash */
+
 #if !defined(__KERNEL__)
 
 extern ci_uint32
@@ -98,9 +98,12 @@ extern int oo_cp_get_acceleratable_ifindices(struct oo_cplane_handle*,
 #endif
 
 
+/* [flow_hash] is a hash of the connection's addresses, ports and protocol,
+ * such as onload_hash3() gives. */
 extern int
 cp_svc_check_dnat(struct oo_cplane_handle* cp,
-                  ci_addr_sh_t* dst_addr, ci_uint16* dst_port);
+                  ci_addr_sh_t* dst_addr, ci_uint16* dst_port,
+                  ci_uint32 flow_hash);
 
 
 extern ci_ifid_t
@@ -358,13 +361,13 @@ oo_cp_find_ipif_by_ip(struct oo_cplane_handle* cp, ci_ip_addr_t ip,
   cicp_rowid_t id;
   cp_version_t version;
   int rc = 0;
+  int n;
 
   CP_VERLOCK_START(version, mib, cp)
 
-  for( id = 0; id < mib->dim->ipif_max; id++ ) {
-    if( cicp_ipif_row_is_free(&mib->ipif[id]) )
-      break;
-
+  CP_IFADDR_CHAIN_FOR_EACH(id, n, mib->ipif_index, mib->dim->ipif_max,
+                           cp_ipif_addr_bucket(ip, mib->dim->ipif_max),
+                           addr_head, addr_next) {
     if( mib->ipif[id].net_ip == ip ) {
       if( check(cp, mib->ipif[id].ifindex, data) ) {
         rc = 1;
@@ -384,13 +387,13 @@ oo_cp_find_ipif_by_ip6(struct oo_cplane_handle* cp, ci_ip6_addr_t ip,
   cicp_rowid_t id;
   cp_version_t version;
   int rc = 0;
+  int n;
 
   CP_VERLOCK_START(version, mib, cp)
 
-  for( id = 0; id < mib->dim->ip6if_max; id++ ) {
-    if( cicp_ip6if_row_is_free(&mib->ip6if[id]) )
-      break;
-
+  CP_IFADDR_CHAIN_FOR_EACH(id, n, mib->ip6if_index, mib->dim->ip6if_max,
+                           cp_ip6if_addr_bucket(ip, mib->dim->ip6if_max),
+                           addr_head, addr_next) {
     if( CI_IP6_ADDR_CMP(mib->ip6if[id].net_ip6, ip) == 0 ) {
       if( check(cp, mib->ip6if[id].ifindex, data) ) {
         rc = 1;
@@ -416,13 +419,13 @@ oo_cp_find_llap_by_ip(struct oo_cplane_handle* cp, ci_ip_addr_t ip,
   cicp_rowid_t id;
   cp_version_t version;
   int rc = 0;
+  int n;
 
   CP_VERLOCK_START(version, mib, cp)
 
-  for( id = 0; id < mib->dim->ipif_max; id++ ) {
-    if( cicp_ipif_row_is_free(&mib->ipif[id]) )
-      break;
-
+  CP_IFADDR_CHAIN_FOR_EACH(id, n, mib->ipif_index, mib->dim->ipif_max,
+                           cp_ipif_addr_bucket(ip, mib->dim->ipif_max),
+                           addr_head, addr_next) {
     if( mib->ipif[id].net_ip == ip ) {
       cicp_rowid_t llap_id = cp_llap_find_row(mib, mib->ipif[id].ifindex);
       if( llap_id == CICP_ROWID_BAD )
@@ -446,13 +449,13 @@ oo_cp_find_llap_by_ip6(struct oo_cplane_handle* cp, ci_ip6_addr_t ip6,
   cicp_rowid_t id;
   cp_version_t version;
   int rc = 0;
+  int n;
 
   CP_VERLOCK_START(version, mib, cp)
 
-  for( id = 0; id < mib->dim->ip6if_max; id++ ) {
-    if( cicp_ip6if_row_is_free(&mib->ip6if[id]) )
-      break;
-
+  CP_IFADDR_CHAIN_FOR_EACH(id, n, mib->ip6if_index, mib->dim->ip6if_max,
+                           cp_ip6if_addr_bucket(ip6, mib->dim->ip6if_max),
+                           addr_head, addr_next) {
     if( !CI_IP6_ADDR_CMP(mib->ip6if[id].net_ip6, ip6) ) {
       cicp_rowid_t llap_id = cp_llap_find_row(mib, mib->ip6if[id].ifindex);
       if( llap_id == CICP_ROWID_BAD )
@@ -513,12 +516,14 @@ oo_cp_ifindex_to_ip(struct oo_cplane_handle* cp, ci_ifid_t ifindex)
   cicp_rowid_t id;
   cp_version_t version;
   ci_ip_addr_t ip = INADDR_ANY;
+  int n;
 
   CP_VERLOCK_START(version, mib, cp)
 
-  for( id = 0; id < mib->dim->ipif_max; id++ ) {
-    if( cicp_ipif_row_is_free(&mib->ipif[id]) )
-      break;
+  CP_IFADDR_CHAIN_FOR_EACH(id, n, mib->ipif_index, mib->dim->ipif_max,
+                           cp_ifaddr_ifindex_bucket(ifindex,
+                                                    mib->dim->ipif_max),
+                           ifindex_head, ifindex_next) {
     /* Fixme: check IFA_F_SECONDARY flag, get a primary address */
     if( mib->ipif[id].ifindex == ifindex ) {
       ip = mib->ipif[id].net_ip;
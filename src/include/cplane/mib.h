@@ -270,6 +270,56 @@ cicp_ip6if_row_is_free(cicp_ip6if_row_t *row)
   return row->net_ipset == CI_IP_PREFIXLEN_BAD;
 }
 
+/* Hashed index of the ipif or ip6if table, by address and by ifindex.  It
+ * has as many entries as the table it indexes: entry i is the head of the
+ * i-th hash chain, and also links row i to the next row in its chains.
+ * Chains are in ascending row order, so walking a chain finds rows in the
+ * same order as a scan of the table would.  The server links a new row onto
+ * the tails of its chains, and rebuilds the index when rows are removed or
+ * moved. */
+struct cp_ifaddr_index {
+  cicp_rowid_t addr_head;
+  cicp_rowid_t addr_next;
+  cicp_rowid_t ifindex_head;
+  cicp_rowid_t ifindex_next;
+};
+
+static inline unsigned
+cp_ifaddr_bucket(ci_uint32 hash, int size)
+{
+  return ((ci_uint64) (hash * 0x9e3779b1u) * size) >> 32;
+}
+
+static inline unsigned
+cp_ipif_addr_bucket(ci_ip_addr_t ip, int size)
+{
+  return cp_ifaddr_bucket(ip, size);
+}
+
+static inline unsigned
+cp_ip6if_addr_bucket(const ci_ip6_addr_t ip6, int size)
+{
+  ci_uint32 w[4];
+  memcpy(w, ip6, sizeof(w));
+  return cp_ifaddr_bucket(w[0] ^ w[1] ^ w[2] ^ w[3], size);
+}
+
+static inline unsigned
+cp_ifaddr_ifindex_bucket(ci_ifid_t ifindex, int size)
+{
+  return cp_ifaddr_bucket(ifindex, size);
+}
+
+/* Walks one chain of an ifaddr index.  The index may be changing under the
+ * reader's feet, so a row id that is out of range ends the walk, and the
+ * walk is bounded by the size of the table so that a torn chain can't loop
+ * for ever.  The caller finds that the version has changed and retries. */
+#define CP_IFADDR_CHAIN_FOR_EACH(id_, n_, index_, max_, bucket_, head_, next_) \
+  for( (n_) = 0, \
+       (id_) = (max_) > 0 ? (index_)[bucket_].head_ : CICP_ROWID_BAD; \
+       (id_) >= 0 && (id_) < (max_) && (n_) < (max_); \
+       (id_) = (index_)[id_].next_, (n_)++ )
+
 /*
  *** Route Cache table ***
  */
@@ -567,6 +617,8 @@ struct cp_tables_dim {
   ci_int32 svc_arrays_max;
   /* Number of k8s service endpoints (front and back end) */
   ci_int32 svc_ep_max;
+  /* Number of k8s service Maglev lookup tables */
+  ci_int32 svc_lookups_max;
 
   /* Number of fwd cache rows, must be 2^n */
   ci_uint8 fwd_ln2;
@@ -663,6 +715,9 @@ struct cp_svc_ep_dllist {
       cicp_rowid_t tail_array_id;
       /* Number of backends in linked list and array */
       size_t n_backends;
+      /* Index of Maglev lookup table in mib svc_lookups field, or
+       * CICP_ROWID_BAD if the service doesn't have one */
+      cicp_rowid_t lookup_id;
     } service;
 
     struct {
@@ -693,6 +748,26 @@ struct cp_svc_ep_array {
   struct cp_svc_endpoint eps[CP_SVC_BACKENDS_PER_ARRAY];
 };
 
+/* Number of slots in a service's Maglev lookup table.  This is prime, and
+ * large compared to CP_SVC_LOOKUP_MAX_BACKENDS so that each backend's share
+ * of the slots is close to equal. */
+#define CP_SVC_LOOKUP_SIZE 4093
+
+/* Services with more backends than this have no lookup table, and choose
+ * their backends from the arrays directly. */
+#define CP_SVC_LOOKUP_MAX_BACKENDS 1024
+
+/* A Maglev consistent-hashing table for a k8s service, mapping a hash onto
+ * one of the service's backends in constant time.  It is repopulated
+ * whenever a backend is added or removed, in a way that leaves most slots
+ * with the backend they had. */
+struct cp_svc_lookup {
+  /* Index in svc_arrays of each array in the service's chain, in order. */
+  cicp_rowid_t arrays[CP_SVC_LOOKUP_MAX_BACKENDS / CP_SVC_BACKENDS_PER_ARRAY];
+  /* Backend element_id for each slot. */
+  ci_uint16 slots[CP_SVC_LOOKUP_SIZE];
+};
+
 #define CP_STRING_LEN 256
 
 typedef struct cp_string { char value[CP_STRING_LEN]; } cp_string_t;
@@ -732,6 +807,8 @@ struct cp_mibs {
   cicp_llap_row_t* llap;
   cicp_ipif_row_t* ipif;
   cicp_ip6if_row_t* ip6if;
+  struct cp_ifaddr_index* ipif_index;
+  struct cp_ifaddr_index* ip6if_index;
 
 #ifndef __KERNEL__
   /* Struct containing fwd table rows and prefix bitmap.
@@ -758,6 +835,10 @@ struct cp_mibs {
   /* Table of k8s service backends organised by service.
    * Logically an array of arrays, each of length CP_SVC_BACKENDS_PER_ARRAY. */
   struct cp_svc_ep_array* svc_arrays;
+
+  /* Maglev lookup tables for selecting k8s service backends.  Not every
+   * service has one; see cp_svc_ep_dllist::u.service.lookup_id. */
+  struct cp_svc_lookup* svc_lookups;
 };
 
 
@@ -929,12 +1010,14 @@ static inline cicp_rowid_t
 cp_ipif_any_row_by_ifindex(struct cp_mibs* mib, ci_ifid_t ifindex)
 {
   cicp_rowid_t i;
+  int n;
 
-  for( i = 0; i < mib->dim->ipif_max; i++ ) {
+  CP_IFADDR_CHAIN_FOR_EACH(i, n, mib->ipif_index, mib->dim->ipif_max,
+                           cp_ifaddr_ifindex_bucket(ifindex,
+                                                    mib->dim->ipif_max),
+                           ifindex_head, ifindex_next) {
     if( mib->ipif[i].ifindex == ifindex )
       return i;
-    if( cicp_ipif_row_is_free(&mib->ipif[i]) )
-      return CICP_ROWID_BAD;
   }
   return CICP_ROWID_BAD;
 }
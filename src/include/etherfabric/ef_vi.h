@@ -680,6 +680,8 @@ typedef struct {
   uint32_t  ct_removed;
   /** Timestamp in nanoseconds */
   uint32_t  ts_nsec;
+  /** Descriptors added when the kernel was last kicked (AF_XDP only) */
+  uint32_t  xdp_kicked;                         /* af_xdp only */
 } ef_vi_txq_state;
 
 /*! \brief State of efct receive queue
@@ -715,14 +717,16 @@ typedef struct {
   uint32_t  added;
   /** Descriptors removed from the ring */
   uint32_t  removed;
-  /** Packets received as part of a jumbo (7000-series only) */
-  uint32_t  in_jumbo;                           /* ef10 only */
-  /** Bytes received as part of a jumbo (7000-series only) */
-  uint32_t  bytes_acc;                          /* ef10 only */
+  /** Packets received as part of a jumbo (7000-series and AF_XDP only) */
+  uint32_t  in_jumbo;                           /* ef10 and af_xdp only */
+  /** Bytes received as part of a jumbo (7000-series and AF_XDP only) */
+  uint32_t  bytes_acc;                          /* ef10 and af_xdp only */
   /** Last descriptor index completed (7000-series only) */
   uint16_t  last_desc_i;                        /* ef10 only */
   /** Credit for packed stream handling (7000-series only) */
   uint16_t  rx_ps_credit_avail;                 /* ef10 only */
+  /** Descriptors added when the kernel was last kicked (AF_XDP only) */
+  uint32_t  xdp_kicked;                         /* af_xdp only */
   ef_vi_efct_rxq_ptr rxq_ptr[EF_VI_MAX_EFCT_RXQS]; /* efct only */
 } ef_vi_rxq_state;
 
@@ -828,6 +832,12 @@ typedef struct {
   uint32_t rx_ev_bad_q_label;
   /** Gaps in the event queue (empty slot followed by event) */
   uint32_t evq_gap;
+  /** AF_XDP system calls made to kick the kernel for TX or busy polling */
+  uint32_t xdp_kicks;
+  /** AF_XDP kicks skipped because the kernel did not need waking */
+  uint32_t xdp_kicks_elided;
+  /** AF_XDP system calls made to restart a stalled fill ring */
+  uint32_t xdp_rx_kicks;
 } ef_vi_stats;
 
 /*! \brief The type of NIC in use
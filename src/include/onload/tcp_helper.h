@@ -154,6 +154,20 @@ struct oo_iobufs_usermem_group {
 };
 
 
+/* A packet set whose memory has been allocated and mapped, but which has not
+ * yet been added to the stack.  See EF_PKT_ALLOC_BACKGROUND. */
+struct tcp_helper_pkt_set {
+  struct oo_iobufset* iobrs[CI_CFG_MAX_INTERFACES];
+  struct oo_buffer_pages* pages;
+  uint64_t* hw_addrs;
+  int page_order;
+  /* Huge pages were wanted but not available for this set. */
+  int huge_page_failed;
+  /* tcp_helper_resource_t::pkt_grow_reset_gen when the set was mapped. */
+  ci_uint32 reset_gen;
+};
+
+
 /* Kernel data to track allocations initiated by onload_zc_register_buffers */
 struct oo_iobufs_usermem {
   int n_groups;
@@ -231,6 +245,18 @@ typedef struct tcp_helper_resource_s {
   /* List of endpoints requiring work in non-atomic context. */
   ci_sllist     non_atomic_list;
 
+  /* Background growth of the packet pool (EF_PKT_ALLOC_BACKGROUND). */
+  struct work_struct pkt_grow_work;
+  /* Set allocated by pkt_grow_work, waiting for the stack lock to be
+   * installed.  Valid when pkt_grow_ready is set. */
+  struct tcp_helper_pkt_set pkt_grow_pending;
+  volatile ci_uint32 pkt_grow_ready;
+  /* Bumped on each NIC reset.  The reset remaps only installed sets, so a
+   * pending set mapped under an older generation must not be installed. */
+  volatile ci_uint32 pkt_grow_reset_gen;
+  /* packets->n_free at the last periodic tick, to estimate demand. */
+  ci_int32      pkt_grow_last_free;
+
 #if CI_CFG_NIC_RESET_SUPPORT
   /* For deferring resets to a non-atomic context. */
 #define ONLOAD_RESET_WQ_NAME "onload-rst-wq:%s"
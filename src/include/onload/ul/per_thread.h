@@ -36,6 +36,8 @@
 #endif
 
 
+struct oo_ul_poll_cache;
+
 struct oo_per_thread {
   ci_netif_config_opts*      thread_local_netif_opts;
   int                        initialised;
@@ -47,6 +49,7 @@ struct oo_per_thread {
   struct oo_timesync         timesync;
   unsigned                   spinstate; 
   int                        in_vfork_child;
+  struct oo_ul_poll_cache*   poll_cache;
   void*                      vfork_scratch[OO_VFORK_SCRATCH_SIZE];
 };
 
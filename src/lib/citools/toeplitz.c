@@ -40,6 +40,37 @@ ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input, int n)
   return result;
 }
 
+/* The Toeplitz hash is linear: the hash of an input is the XOR of the
+ * hashes of its set bits taken one at a time.  This fills [table] with the
+ * contribution made by each of the 256 possible values of the byte at
+ * [offset] in the input, so that callers hashing many inputs that differ
+ * only in a few bytes (e.g. candidate local ports for a fixed 3-tuple) can
+ * combine a single full hash with one lookup per varying byte.  The key
+ * must be at least [offset] + 5 bytes long.
+ */
+void ci_toeplitz_hash_byte_table(const ci_uint8 *key, int offset,
+                                 ci_uint32 *table)
+{
+  ci_uint32 key_bits, bit_hash[8];
+  int i, v;
+
+  key += offset;
+  key_bits = (key[0] << 24) | (key[1] << 16) | (key[2] << 8) | key[3];
+
+  /* bit_hash[i] is the contribution of bit (1 << i) of the byte.  Input
+   * bits are consumed most significant first, so bit 7 sees the key window
+   * at the start of the byte and lower bits see it shifted along.
+   */
+  for( i = 0; i < 8; ++i )
+    bit_hash[7 - i] = i ? (key_bits << i) | (key[4] >> (8 - i)) : key_bits;
+
+  table[0] = 0;
+  for( v = 1; v < 256; ++v ) {
+    int low_bit = ci_ffs64(v) - 1;
+    table[v] = table[v & (v - 1)] ^ bit_hash[low_bit];
+  }
+}
+
 #if !defined(__KERNEL__)
 
 #if defined(CI_HAVE_X86INTRIN)
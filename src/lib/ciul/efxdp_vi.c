@@ -20,47 +20,116 @@
 #include "af_xdp_defs.h"
 #include "logging.h"
 
+/* Multi-buffer descriptors (linux >= 6.6): set on every descriptor of a
+ * packet except the last. */
+#ifndef XDP_PKT_CONTD
+#define XDP_PKT_CONTD (1 << 0)
+#endif
+
+/* Need-wakeup flag in a ring's flags word (linux >= 5.4). */
+#ifndef XDP_RING_NEED_WAKEUP
+#define XDP_RING_NEED_WAKEUP (1 << 0)
+#endif
+
+/* Access the AF_XDP rings, using the offsets provided in the mapped memory.
+ * The (fake) event queue pointer must be initialised to point to the start
+ * of this memory in order to access the offsets.
+ */
+static struct efab_af_xdp_offsets* xdp_offsets(ef_vi* vi)
+{
+  return (struct efab_af_xdp_offsets*)vi->evq_base;
+}
+
+#define RING_THING(vi, ring, thing) \
+  ((void*)(vi->evq_base + xdp_offsets(vi)->rings.ring.thing))
+
+#define RING_PRODUCER(vi, ring) \
+  ((volatile uint32_t*)RING_THING(vi, ring, producer))
+
+#define RING_CONSUMER(vi, ring) \
+  ((volatile uint32_t*)RING_THING(vi, ring, consumer))
+
+#define RING_FLAGS(vi, ring) \
+  ((volatile uint32_t*)RING_THING(vi, ring, flags))
+
+#define RING_DESC(vi, ring) RING_THING(vi, ring, desc)
+
+#define EFXDP_STATS_INC(vi, field) \
+  do {                             \
+    if( (vi)->vi_stats != NULL )   \
+      ++(vi)->vi_stats->field;     \
+  } while( 0 )
+
 /* Currently, AF_XDP requires a system call to start transmitting.
  *
  * There is a limit (undocumented, so we can't rely on it being 16) to the
  * number of packets which will be sent each time. We use the "previous"
  * field to store the last packet known to be sent; if this does not cover
  * all those in the queue, we will try again once a send has completed.
+ *
+ * When the socket is bound with XDP_USE_NEED_WAKEUP, the kernel clears the
+ * flag in the TX ring while its NAPI context is running (or being busy
+ * polled) and will get to the new descriptors without being asked, so we
+ * skip the system call.
  */
 #define AF_XDP_TX_BATCH_MAX 16
 static int efxdp_tx_need_kick(ef_vi* vi)
 {
   ef_vi_txq_state* qs = &vi->ep_state->txq;
-  return qs->previous != qs->added;
+  if( qs->previous == qs->added )
+    return 0;
+  if( (xdp_offsets(vi)->flags & EFAB_AF_XDP_FLAG_NEED_WAKEUP) &&
+      ! (*RING_FLAGS(vi, tx) & XDP_RING_NEED_WAKEUP) ) {
+    qs->previous = qs->added;
+    EFXDP_STATS_INC(vi, xdp_kicks_elided);
+    return 0;
+  }
+  return 1;
+}
+
+/* Any kick lets the kernel see everything in both rings, and in busy-poll
+ * mode runs its NAPI context as well. */
+static int efxdp_kick(ef_vi* vi)
+{
+  ef_vi_state* s = vi->ep_state;
+  uint32_t rx_added = s->rxq.added;
+  uint32_t tx_added = s->txq.added;
+  int rc = vi->xdp_kick(vi);
+
+  if( rc == 0 ) {
+    s->rxq.xdp_kicked = rx_added;
+    s->txq.xdp_kicked = tx_added;
+  }
+  return rc;
 }
 
 static void efxdp_tx_kick(ef_vi* vi)
 {
-  if( vi->xdp_kick(vi) == 0 ) {
+  EFXDP_STATS_INC(vi, xdp_kicks);
+  if( efxdp_kick(vi) == 0 ) {
     ef_vi_txq_state* qs = &vi->ep_state->txq;
     qs->previous = qs->added;
   }
 }
 
-/* Access the AF_XDP rings, using the offsets provided in the mapped memory.
- * The (fake) event queue pointer must be initialised to point to the start
- * of this memory in order to access the offsets.
- */
-static struct efab_af_xdp_offsets* xdp_offsets(ef_vi* vi)
+/* Wakes a driver that stopped receiving for want of fill buffers.  This
+ * says nothing about how far the kernel has got with the TX ring. */
+static void efxdp_rx_kick(ef_vi* vi)
 {
-  return (struct efab_af_xdp_offsets*)vi->evq_base;
+  EFXDP_STATS_INC(vi, xdp_rx_kicks);
+  efxdp_kick(vi);
 }
 
-#define RING_THING(vi, ring, thing) \
-  ((void*)(vi->evq_base + xdp_offsets(vi)->rings.ring.thing))
-
-#define RING_PRODUCER(vi, ring) \
-  ((volatile uint32_t*)RING_THING(vi, ring, producer))
-
-#define RING_CONSUMER(vi, ring) \
-  ((volatile uint32_t*)RING_THING(vi, ring, consumer))
-
-#define RING_DESC(vi, ring) RING_THING(vi, ring, desc)
+/* A socket which prefers busy polling gets its queues serviced by whoever
+ * kicks it.  Kicking on every poll of an idle queue would cost a system call
+ * per poll for nothing, so kick only when there is something new in the
+ * fill or TX ring since the last kick. */
+static int efxdp_busy_poll_need_kick(ef_vi* vi)
+{
+  ef_vi_state* s = vi->ep_state;
+  return s->rxq.xdp_kicked != s->rxq.added ||
+         s->txq.xdp_kicked != s->txq.added;
+}
 
 static int efxdp_ef_vi_transmitv_init(ef_vi* vi, const ef_iovec* iov,
                                       int iov_len, ef_request_id dma_id)
@@ -70,16 +139,28 @@ static int efxdp_ef_vi_transmitv_init(ef_vi* vi, const ef_iovec* iov,
   struct xdp_desc* dq = RING_DESC(vi, tx);
   int i;
 
-  if( iov_len != 1 )
-    return -EINVAL; /* Multiple buffers per packet not supported */
+  EF_VI_BUG_ON(iov_len <= 0);
 
-  if( qs->added - qs->removed >= q->mask )
+  /* The kernel could not bind the socket for multi-buffer packets. */
+  if( iov_len != 1 && ! (xdp_offsets(vi)->flags & EFAB_AF_XDP_FLAG_SG) )
+    return -EINVAL;
+
+  if( qs->added - qs->removed + iov_len > q->mask )
     return -EAGAIN;
 
-  i = qs->added++ & q->mask;
-  dq[i].addr = iov->iov_base;
-  dq[i].len = iov->iov_len;
-  EF_VI_BUG_ON(q->ids[i] != EF_REQUEST_ID_MASK);
+  /* A packet spanning several buffers uses one descriptor per buffer, each
+   * but the last marked as continued.  Completions are per descriptor, so
+   * as on ef10 the dma_id goes with the last one. */
+  for( ; ; ++iov ) {
+    i = qs->added++ & q->mask;
+    dq[i].addr = iov->iov_base;
+    dq[i].len = iov->iov_len;
+    EF_VI_BUG_ON(q->ids[i] != EF_REQUEST_ID_MASK);
+    if( --iov_len == 0 )
+      break;
+    dq[i].options = XDP_PKT_CONTD;
+  }
+  dq[i].options = 0;
   q->ids[i] = dma_id;
   return 0;
 }
@@ -96,9 +177,10 @@ static void efxdp_ef_vi_transmit_push(ef_vi* vi)
    *  * at least every packets if queue is quarter stuffed.
    */
   EF_VI_BUG_ON(vi->ep_state->txq.added == vi->ep_state->txq.previous);
-  if( vi->ep_state->txq.added - vi->ep_state->txq.removed < 3 ||
-      (vi->ep_state->txq.added ^ vi->ep_state->txq.previous) /
-      (AF_XDP_TX_BATCH_MAX >> 2) )
+  if( (vi->ep_state->txq.added - vi->ep_state->txq.removed < 3 ||
+       (vi->ep_state->txq.added ^ vi->ep_state->txq.previous) /
+       (AF_XDP_TX_BATCH_MAX >> 2)) &&
+      efxdp_tx_need_kick(vi) )
     efxdp_tx_kick(vi);
 }
 
@@ -261,6 +343,11 @@ static void efxdp_ef_vi_receive_push(ef_vi* vi)
 {
   wmb();
   *RING_PRODUCER(vi, fr) = vi->ep_state->rxq.added;
+  /* With XDP_USE_NEED_WAKEUP a driver that ran out of fill buffers stops
+   * receiving until it is kicked. */
+  if( (xdp_offsets(vi)->flags & EFAB_AF_XDP_FLAG_NEED_WAKEUP) &&
+      (*RING_FLAGS(vi, fr) & XDP_RING_NEED_WAKEUP) )
+    efxdp_rx_kick(vi);
 }
 
 static void efxdp_ef_eventq_prime(ef_vi* vi)
@@ -268,14 +355,20 @@ static void efxdp_ef_eventq_prime(ef_vi* vi)
   // TODO
 }
 
+static int efxdp_has_event(ef_vi* vi, int look_ahead)
+{
+  return *RING_CONSUMER(vi, rx) - *RING_PRODUCER(vi, rx) +
+         *RING_CONSUMER(vi, cr) - *RING_PRODUCER(vi, cr)
+         > look_ahead;
+}
+
 int efxdp_ef_eventq_check_event(const ef_vi* _vi, int look_ahead)
 {
   ef_vi* vi = (ef_vi*) _vi; /* drop const */
+
   EF_VI_ASSERT(vi->evq_base);
   EF_VI_BUG_ON(look_ahead < 0);
-  return *RING_CONSUMER(vi, rx) - *RING_PRODUCER(vi, rx) +
-         *RING_CONSUMER(vi, cr) - *RING_PRODUCER(vi, cr)
-         > look_ahead;
+  return efxdp_has_event(vi, look_ahead);
 }
 
 
@@ -286,6 +379,12 @@ static int efxdp_ef_eventq_poll(ef_vi* vi, ef_event* evs, int evs_len)
   /* rx_buffer_len is power of two */
   EF_VI_ASSERT(((vi->rx_buffer_len - 1) & vi->rx_buffer_len) == 0);
 
+  /* In busy-poll mode, if there is nothing waiting, run the NAPI context now
+   * rather than wait for an interrupt. */
+  if( (xdp_offsets(vi)->flags & EFAB_AF_XDP_FLAG_BUSY_POLL) &&
+      ! efxdp_has_event(vi, 0) && efxdp_busy_poll_need_kick(vi) )
+    efxdp_tx_kick(vi);
+
   /* Check rx ring, which won't exist on tx-only interfaces */
   if( n < evs_len && ef_vi_receive_capacity(vi) != 0 ) {
     uint32_t cons = *RING_CONSUMER(vi, rx);
@@ -298,6 +397,7 @@ static int efxdp_ef_eventq_poll(ef_vi* vi, ef_event* evs, int evs_len)
 
       do {
         unsigned desc_i = qs->removed++ & q->mask;
+        uint32_t len = dq[desc_i].len;
 
         evs[n].rx.type = EF_EVENT_TYPE_RX;
         evs[n].rx.q_id = 0;
@@ -313,12 +413,30 @@ static int efxdp_ef_eventq_poll(ef_vi* vi, ef_event* evs, int evs_len)
 
         q->ids[desc_i] = EF_REQUEST_ID_MASK;  /* Debug only? */
 
-        /* FIXME: handle jumbo, multicast */
-        evs[n].rx.flags = EF_EVENT_FLAG_SOP;
+        /* A multi-buffer packet arrives as a run of descriptors, all but
+         * the last marked XDP_PKT_CONTD.  Report them as ef10 does: SOP on
+         * the first, CONT on all but the last, and a running byte count.
+         * The run may straddle calls to this function.
+         * FIXME: handle multicast */
+        if(likely( ! qs->in_jumbo )) {
+          evs[n].rx.flags = EF_EVENT_FLAG_SOP;
+          qs->bytes_acc = len;
+        }
+        else {
+          evs[n].rx.flags = 0;
+          qs->bytes_acc += len;
+        }
+        if(likely( ! (dq[desc_i].options & XDP_PKT_CONTD) )) {
+          qs->in_jumbo = 0;
+        }
+        else {
+          evs[n].rx.flags |= EF_EVENT_FLAG_CONT;
+          qs->in_jumbo = 1;
+        }
         /* In case of AF_XDP offset of the placement of payload from
          * the beginning of the packet buffer may vary. */
         evs[n].rx.ofs = dq[desc_i].addr & (vi->rx_buffer_len - 1); 
-        evs[n].rx.len = dq[desc_i].len;
+        evs[n].rx.len = qs->bytes_acc;
 
         ++n;
         ++cons;
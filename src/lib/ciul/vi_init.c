@@ -438,6 +438,7 @@ void ef_vi_reset_rxq(struct ef_vi* vi)
   qs->in_jumbo = 0;
   qs->bytes_acc = 0;
   qs->rx_ps_credit_avail = 1;
+  qs->xdp_kicked = 0;
   qs->last_desc_i = vi->vi_is_packed_stream ? vi->vi_rxq.mask : 0;
   if( vi->vi_rxq.mask ) {
     int i;
@@ -456,6 +457,7 @@ void ef_vi_reset_txq(struct ef_vi* vi)
   qs->ct_added = 0;
   qs->ct_removed = 0;
   qs->ts_nsec = EF_VI_TX_TIMESTAMP_TS_NSEC_INVALID;
+  qs->xdp_kicked = 0;
 
   if( vi->vi_txq.mask ) {
     int i;
@@ -76,6 +76,7 @@ static const struct cp_mib_region cp_mib_regions[] = {
 
   DB_TABLE(struct cp_svc_ep_dllist, svc_ep_table, svc_ep_max),
   DB_TABLE(struct cp_svc_ep_array, svc_arrays, svc_arrays_max),
+  DB_TABLE(struct cp_svc_lookup, svc_lookups, svc_lookups_max),
 
   END_PUBLIC_REGION(),
 
@@ -90,6 +91,8 @@ static const struct cp_mib_region cp_mib_regions[] = {
   DB_TABLE(cicp_llap_row_t, llap, llap_max),
   DB_TABLE(cicp_ipif_row_t, ipif, ipif_max),
   DB_TABLE(cicp_ip6if_row_t, ip6if, ip6if_max),
+  DB_TABLE(struct cp_ifaddr_index, ipif_index, ipif_max),
+  DB_TABLE(struct cp_ifaddr_index, ip6if_index, ip6if_max),
 };
 
 #undef END_PUBLIC_REGION
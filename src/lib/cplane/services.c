@@ -11,23 +11,70 @@
 #include <cplane/cplane.h>
 
 
-/* Returns a backend endpoint randomly selected from a service's set of
- * backends */
+/* The flow hashes passed in by the callers are cheap to compute but mix
+ * poorly, so that flows differing only in the source port would land in
+ * neighbouring slots.  This is the finaliser of MurmurHash3. */
+static inline ci_uint32 cp_svc_hash_mix(ci_uint32 h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+
+/* Returns the backend endpoint in the slot of a service's Maglev lookup
+ * table picked by hash.  The table may be changing under our feet, so
+ * returns NULL rather than follow an index that is out of range; the caller
+ * will find that the mib version has changed and try again. */
 static struct cp_svc_endpoint*
-cp_svc_select_backend(const struct cp_mibs* mib, const cicp_mac_rowid_t id)
+cp_svc_lookup_backend(const struct cp_mibs* mib,
+                      const struct cp_svc_ep_dllist* svc, ci_uint32 hash)
+{
+  const struct cp_svc_lookup* lookup;
+  cicp_rowid_t lookup_id = svc->u.service.lookup_id;
+  cicp_rowid_t array_id;
+  unsigned element_id;
+
+  if( lookup_id < 0 || lookup_id >= mib->dim->svc_lookups_max )
+    return NULL;
+  lookup = &mib->svc_lookups[lookup_id];
+  element_id = lookup->slots[hash % CP_SVC_LOOKUP_SIZE];
+  if( element_id >= CP_SVC_LOOKUP_MAX_BACKENDS )
+    return NULL;
+  array_id = lookup->arrays[element_id / CP_SVC_BACKENDS_PER_ARRAY];
+  if( array_id < 0 || array_id >= mib->dim->svc_arrays_max )
+    return NULL;
+  return &mib->svc_arrays[array_id].eps[element_id %
+                                        CP_SVC_BACKENDS_PER_ARRAY];
+}
+
+
+/* Returns the backend endpoint that a service's set of backends gives for a
+ * flow with the given hash. */
+static struct cp_svc_endpoint*
+cp_svc_select_backend(const struct cp_mibs* mib, const cicp_mac_rowid_t id,
+                      ci_uint32 flow_hash)
 {
   struct cp_svc_ep_dllist* svc = &mib->svc_ep_table[id];
   cicp_rowid_t element_id;
   struct cp_svc_ep_array* arr;
   cicp_rowid_t index;
+  ci_uint32 hash;
 
   ci_assert_equal(svc->row_type, CP_SVC_SERVICE);
   if( svc->u.service.n_backends <= 0 )
     return NULL;
   ci_assert( CICP_ROWID_IS_VALID(svc->u.service.head_array_id) );
 
-  /* Copy approximate hash generator from oo_cp_multipath_hash */
-  element_id = (ci_frc64_get() >> 4) % svc->u.service.n_backends;
+  hash = cp_svc_hash_mix(flow_hash);
+
+  if( CICP_ROWID_IS_VALID(svc->u.service.lookup_id) )
+    return cp_svc_lookup_backend(mib, svc, hash);
+
+  element_id = hash % svc->u.service.n_backends;
   cp_svc_walk_array_chain(mib, svc->u.service.head_array_id, element_id,
                           &arr, &index);
 
@@ -37,10 +84,13 @@ cp_svc_select_backend(const struct cp_mibs* mib, const cicp_mac_rowid_t id)
 
 /* Performs a DNAT operation on the provided address.  If the address points to
  * a valid service then attempt to replace the address with a backend's.
+ * [flow_hash] identifies the connection, so that every lookup made for it
+ * picks the same backend.
  * Returns positive if we need DNAT, zero if not, and negative on error. */
 int
 cp_svc_check_dnat(struct oo_cplane_handle* cp,
-                  ci_addr_sh_t* dst_addr, ci_uint16* dst_port)
+                  ci_addr_sh_t* dst_addr, ci_uint16* dst_port,
+                  ci_uint32 flow_hash)
 {
   struct cp_mibs* mib;
   cp_version_t version;
@@ -59,7 +109,7 @@ cp_svc_check_dnat(struct oo_cplane_handle* cp,
       mib->svc_ep_table[id].row_type != CP_SVC_SERVICE )
     goto out;
 
-  svc_backend = cp_svc_select_backend(mib, id);
+  svc_backend = cp_svc_select_backend(mib, id, flow_hash);
   if( svc_backend == NULL ) {
     /* Found a service, but could not get a backend.  This is invalid. */
     rc = -ENOENT;
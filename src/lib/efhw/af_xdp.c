@@ -37,9 +37,19 @@ int enable_af_xdp_flow_filters = 1;
 module_param(enable_af_xdp_flow_filters, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(enable_af_xdp_flow_filters,
                  "Enables flow filter use for AF_XDP devices ");
+static int af_xdp_shared_umem = 1;
+module_param(af_xdp_shared_umem, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(af_xdp_shared_umem,
+                 "Register packet memory once per protection domain and share "
+                 "it between the AF_XDP sockets of all its queues");
 /* filter id when no actual filter is installed */
 #define AF_XDP_NO_FILTER_MAGIC_ID 0x7FFFFF00
 
+/* Busy-poll settings for EF_AF_XDP_BUSY_POLL.  Kicks are non-blocking, so
+ * the time only needs to be non-zero; the budget is the usual NAPI weight. */
+#define AF_XDP_BUSY_POLL_USEC    20
+#define AF_XDP_BUSY_POLL_BUDGET  64
+
 /* sys_call_area: a process-mapped area which can be used to perform
  * system calls from a module.
  *
@@ -170,6 +180,13 @@ struct efhw_af_xdp_vi
   int rxq_capacity;
   int txq_capacity;
   unsigned flags;
+  bool busy_poll;
+  /* Bound to its queue, with a UMEM of this many pages which other VIs of
+   * the same protection domain can share. */
+  bool bound;
+  long umem_pages;
+  /* Bound with XDP_USE_SG: packets may span several UMEM buffers. */
+  bool sg;
 
   struct efab_af_xdp_offsets kernel_offsets;
   struct efhw_page user_offsets_page;
@@ -273,6 +290,28 @@ static struct efhw_af_xdp_vi* vi_by_instance(struct efhw_nic* nic, int instance)
   return &xdp->vi[instance];
 }
 
+/* Find a bound VI in the protection domain whose UMEM covers all of the
+ * domain's memory, so that a new VI can share it rather than registering
+ * the same pages again.  Sharing a UMEM between different queues, each
+ * with its own fill and completion rings, needs linux >= 5.10. */
+static struct efhw_af_xdp_vi* vi_with_umem(struct efhw_nic* nic, int owner_id,
+                                           long umem_pages)
+{
+#ifdef EFRM_HAVE_XSK_SHARED_UMEM_QUEUES
+  struct efhw_nic_af_xdp* xdp = nic->arch_extra;
+  int i;
+
+  if( ! af_xdp_shared_umem )
+    return NULL;
+
+  for( i = 0; i < nic->vi_lim; ++i )
+    if( xdp->vi[i].bound && xdp->vi[i].owner_id == owner_id &&
+        xdp->vi[i].umem_pages == umem_pages )
+      return &xdp->vi[i];
+#endif
+  return NULL;
+}
+
 /* Get the VI with the given owner ID */
 static struct protection_domain* pd_by_owner(struct efhw_nic* nic, int owner_id)
 {
@@ -374,6 +413,11 @@ static int xdp_prog_load(struct sys_call_area* area, int map_fd)
   prog[20] |= (uint64_t) map_fd << 32; /* immediate value */
 
   attr->prog_type = BPF_PROG_TYPE_XDP;
+#ifdef BPF_F_XDP_HAS_FRAGS
+  /* The program only looks at the headers in the first buffer, so it can
+   * be run on multi-buffer packets, which XDP_USE_SG sockets need. */
+  attr->prog_flags = BPF_F_XDP_HAS_FRAGS;
+#endif
   attr->insn_cnt = sizeof(const_prog) / sizeof(struct bpf_insn);
   attr->insns = sys_call_area_user_addr(area, prog);
   attr->license = sys_call_area_user_addr(area, license);
@@ -441,19 +485,61 @@ fail_sock:
   return rc;
 }
 
-/* Bind an AF_XDP socket to an interface */
-static int xdp_bind(struct socket* sock, int ifindex, unsigned queue, unsigned flags)
+/* Bind an AF_XDP socket to an interface.  If shared_fd is valid the socket
+ * uses the UMEM of that socket, and inherits its flags, including whether it
+ * does multi-buffer; otherwise *sg is set to say whether this socket does. */
+static int xdp_bind(struct socket* sock, int ifindex, unsigned queue,
+                    unsigned flags, int shared_fd, bool* sg)
 {
   struct sockaddr_xdp sxdp = {};
 
   sxdp.sxdp_family = PF_XDP;
   sxdp.sxdp_ifindex = ifindex;
   sxdp.sxdp_queue_id = queue;
+  if( shared_fd >= 0 ) {
+    sxdp.sxdp_flags = XDP_SHARED_UMEM;
+    sxdp.sxdp_shared_umem_fd = shared_fd;
+    return kernel_bind(sock, (struct sockaddr*)&sxdp, sizeof(sxdp));
+  }
+#ifdef XDP_USE_SG
+  {
+    /* Ask for packets spanning several buffers, so that frames larger than
+     * a packet buffer are delivered rather than dropped.  Drivers which
+     * can not do this in zero-copy mode refuse, and then we do without. */
+    int rc;
+    sxdp.sxdp_flags = flags | XDP_USE_SG;
+    rc = kernel_bind(sock, (struct sockaddr*)&sxdp, sizeof(sxdp));
+    if( rc != -EOPNOTSUPP ) {
+      *sg = rc == 0;
+      return rc;
+    }
+  }
+#endif
+  *sg = false;
   sxdp.sxdp_flags = flags;
 
   return kernel_bind(sock, (struct sockaddr*)&sxdp, sizeof(sxdp));
 }
 
+/* Make the socket prefer busy polling, so that the sendmsg() done to kick
+ * it runs the NAPI context of its queue rather than relying on interrupts.
+ * These are the fields set by SO_BUSY_POLL, SO_PREFER_BUSY_POLL and
+ * SO_BUSY_POLL_BUDGET; we have no file descriptor to call setsockopt() on.
+ * Returns the EFAB_AF_XDP_FLAG_* to report to UL. */
+static unsigned xdp_set_busy_poll(struct socket* sock)
+{
+#if defined(CONFIG_NET_RX_BUSY_POLL) && defined(EFRM_HAVE_SK_PREFER_BUSY_POLL)
+  struct sock* sk = sock->sk;
+
+  WRITE_ONCE(sk->sk_ll_usec, AF_XDP_BUSY_POLL_USEC);
+  WRITE_ONCE(sk->sk_prefer_busy_poll, 1);
+  WRITE_ONCE(sk->sk_busy_poll_budget, AF_XDP_BUSY_POLL_BUDGET);
+  return EFAB_AF_XDP_FLAG_BUSY_POLL;
+#else
+  return 0;
+#endif
+}
+
 /* Link an XDP program to an interface */
 static int xdp_set_link(struct net_device* dev, int prog_fd)
 {
@@ -653,10 +739,12 @@ static int xdp_create_ring(struct socket* sock,
   kern_offset->producer = kern_base + xdp_offset->producer;
   kern_offset->consumer = kern_base + xdp_offset->consumer;
   kern_offset->desc     = kern_base + xdp_offset->desc;
+  kern_offset->flags    = kern_base + xdp_offset->flags;
 
   user_offset->producer = user_base + xdp_offset->producer;
   user_offset->consumer = user_base + xdp_offset->consumer;
   user_offset->desc     = user_base + xdp_offset->desc;
+  user_offset->flags    = user_base + xdp_offset->flags;
 
   return 0;
 }
@@ -818,6 +906,8 @@ static int af_xdp_init(struct efhw_nic* nic, int instance,
   struct efhw_af_xdp_vi* vi;
   int owner_id;
   struct protection_domain* pd;
+  struct efhw_af_xdp_vi* umem_vi;
+  int shared_fd = -1;
   struct socket* sock;
   struct file* file;
   struct efab_af_xdp_offsets* user_offsets;
@@ -863,9 +953,24 @@ static int af_xdp_init(struct efhw_nic* nic, int instance,
   if( rc < 0 )
     goto fail;
 
-  rc = xdp_register_umem(sock, &pd->umem, chunk_size, headroom);
-  if( rc < 0 )
-    goto fail;
+  /* The fill and completion rings are created per socket below; only the
+   * memory itself is shared.  Packet buffers have the same address in
+   * every socket of the domain either way, so they can be received on one
+   * queue and sent on another. */
+  umem_vi = vi_with_umem(nic, owner_id, pd->umem.used_page_count);
+  if( umem_vi != NULL ) {
+    shared_fd = xdp_alloc_fd(umem_vi->sock->file);
+    if( shared_fd < 0 ) {
+      rc = shared_fd;
+      goto fail;
+    }
+  }
+  else {
+    rc = xdp_register_umem(sock, &pd->umem, chunk_size, headroom);
+    if( rc < 0 )
+      goto fail;
+  }
+  vi->umem_pages = pd->umem.used_page_count;
 
   rc = xdp_create_rings(sock, page_map, &vi->kernel_offsets,
                         vi->rxq_capacity, vi->txq_capacity,
@@ -879,7 +984,9 @@ static int af_xdp_init(struct efhw_nic* nic, int instance,
     goto fail;
 
   /* TODO AF_XDP: currently instance number matches net_device channel */
-  rc = xdp_bind(sock, nic->net_dev->ifindex, instance, vi->flags);
+  vi->sg = umem_vi != NULL && umem_vi->sg;
+  rc = xdp_bind(sock, nic->net_dev->ifindex, instance, vi->flags,
+                shared_fd, &vi->sg);
   if( rc == -EBUSY ) {
     /* AF_XDP resource release happens asynchronously - the socket through RCU
      * and the associated umem through deferred work on the global workqueue.
@@ -897,18 +1004,37 @@ static int af_xdp_init(struct efhw_nic* nic, int instance,
 #else
     flush_scheduled_work();
 #endif
-    rc = xdp_bind(sock, nic->net_dev->ifindex, instance, vi->flags);
+    rc = xdp_bind(sock, nic->net_dev->ifindex, instance, vi->flags,
+                  shared_fd, &vi->sg);
+  }
+  if( shared_fd >= 0 ) {
+    ci_close_fd(shared_fd);
+    shared_fd = -1;
   }
   if( rc < 0 )
     goto fail;
+  vi->bound = true;
 
   if( vi->waiter.wait.func != NULL )
     add_wait_queue(sk_sleep(vi->sock->sk), &vi->waiter.wait);
 
+#ifdef XDP_USE_NEED_WAKEUP
+  if( vi->flags & XDP_USE_NEED_WAKEUP )
+    user_offsets->flags |= EFAB_AF_XDP_FLAG_NEED_WAKEUP;
+#endif
+  /* Without it UL must stick to one buffer per packet. */
+  if( vi->sg )
+    user_offsets->flags |= EFAB_AF_XDP_FLAG_SG;
+  if( vi->busy_poll )
+    user_offsets->flags |= xdp_set_busy_poll(sock);
+  vi->kernel_offsets.flags = user_offsets->flags;
+
   user_offsets->mmap_bytes = efhw_page_map_bytes(page_map);
   return 0;
 
  fail:
+  if( shared_fd >= 0 )
+    ci_close_fd(shared_fd);
   vi->waiter.wait.func = NULL;
   xdp_release_vi(nic, vi);
   return rc;
@@ -1207,6 +1333,12 @@ af_xdp_dmaq_rx_q_init(struct efhw_nic *nic, uint32_t client_id,
   vi->owner_id = params->owner;
   vi->rxq_capacity = params->dmaq_size;
   vi->flags |= (params->flags & EFHW_VI_RX_ZEROCOPY) ? XDP_ZEROCOPY : XDP_COPY;
+  if( params->flags & EFHW_VI_AF_XDP_BUSY_POLL ) {
+    vi->busy_poll = true;
+#ifdef XDP_USE_NEED_WAKEUP
+    vi->flags |= XDP_USE_NEED_WAKEUP;
+#endif
+  }
 
   return 0;
 }
@@ -72,8 +72,8 @@ static int efab_file_move_supported_tcp(ci_netif *ni, ci_tcp_state *ts,
       ts->send_prequeue != OO_PP_ID_NULL ||
       oo_atomic_read(&ts->send_prequeue_in) != 0 ||
       !ci_ip_queue_is_empty(&ts->retrans) ||
-      ci_ip_timer_pending(ni, &ts->rto_tid) ||
-      ci_ip_timer_pending(ni, &ts->zwin_tid) ||
+      ci_tcp_timer_pending(ts, CI_TCP_TIMER_RTO) ||
+      ci_tcp_timer_pending(ts, CI_TCP_TIMER_ZWIN) ||
       ci_ip_timer_pending(ni, &ts->cork_tid) ||
       OO_PP_NOT_NULL(ts->pmtus) ) {
     if( do_assert ) {
@@ -81,8 +81,8 @@ static int efab_file_move_supported_tcp(ci_netif *ni, ci_tcp_state *ts,
       ci_assert_equal(ts->send_prequeue, OO_PP_ID_NULL);
       ci_assert_equal(oo_atomic_read(&ts->send_prequeue_in), 0);
       ci_assert(ci_ip_queue_is_empty(&ts->retrans));
-      ci_assert(! ci_ip_timer_pending(ni, &ts->rto_tid));
-      ci_assert(! ci_ip_timer_pending(ni, &ts->zwin_tid));
+      ci_assert(! ci_tcp_timer_pending(ts, CI_TCP_TIMER_RTO));
+      ci_assert(! ci_tcp_timer_pending(ts, CI_TCP_TIMER_ZWIN));
       ci_assert(! ci_ip_timer_pending(ni, &ts->cork_tid));
       ci_assert(OO_PP_IS_NULL(ts->pmtus));
     }
@@ -338,10 +338,8 @@ int efab_file_move_to_alien_stack(ci_private_t *priv, ci_netif *alien_ni,
     ci_tcp_state *mid_ts = SOCK_TO_TCP(mid_s);
 
     mid_ts->timeout_q_link = new_ts->timeout_q_link;
-    mid_ts->rto_tid = new_ts->rto_tid;
-    mid_ts->delack_tid = new_ts->delack_tid;
-    mid_ts->zwin_tid = new_ts->zwin_tid;
-    mid_ts->kalive_tid = new_ts->kalive_tid;
+    mid_ts->tcp_tid = new_ts->tcp_tid;
+    mid_ts->timers_pending = 0;
     mid_ts->cork_tid = new_ts->cork_tid;
 #if CI_CFG_TCP_SOCK_STATS
     mid_ts->stats_tid = new_ts->stats_tid;
@@ -350,6 +348,8 @@ int efab_file_move_to_alien_stack(ci_private_t *priv, ci_netif *alien_ni,
     ci_ip_queue_init(&mid_ts->recv2);
     ci_ip_queue_init(&mid_ts->send);
     ci_ip_queue_init(&mid_ts->retrans);
+    mid_ts->sack_hint = OO_PP_NULL;
+    mid_ts->sacked_pkts = 0;
     mid_ts->send_prequeue = OO_PP_ID_NULL;
     new_ts->retrans_ptr = OO_PP_NULL;
     mid_ts->tmpl_head = OO_PP_NULL;
@@ -472,8 +472,8 @@ int efab_file_move_to_alien_stack(ci_private_t *priv, ci_netif *alien_ni,
     int i;
 
     /* Stop timers */
-    ci_ip_timer_clear(&old_thr->netif, &old_ts->kalive_tid);
-    ci_ip_timer_clear(&old_thr->netif, &old_ts->delack_tid);
+    ci_tcp_timer_clear(&old_thr->netif, old_ts, CI_TCP_TIMER_KALIVE);
+    ci_tcp_timer_clear(&old_thr->netif, old_ts, CI_TCP_TIMER_DELACK);
 
     /* Recv queue have already been copied */
     ci_tcp_rx_queue_drop(&old_thr->netif, old_ts, &old_ts->recv1);
@@ -128,6 +128,19 @@ module_param(periodic_poll_skew, ulong, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(periodic_poll_skew,
                  "Allowed time skew for periodic polls.  "
                  "Defaults to 10ms.");
+int periodic_poll_bulk = 0;
+module_param(periodic_poll_bulk, int, S_IRUGO);
+MODULE_PARM_DESC(periodic_poll_bulk,
+                 "Replace the periodic poll of each Onload stack with a "
+                 "single pass over all stacks that checks their event "
+                 "queues and IP timers without taking any locks, and polls "
+                 "only the stacks that have work.  Reduces background load "
+                 "on hosts with many idle stacks.  Defaults to 0.");
+int periodic_poll_cpu = -1;
+module_param(periodic_poll_cpu, int, S_IRUGO);
+MODULE_PARM_DESC(periodic_poll_cpu,
+                 "CPU that runs the bulk periodic poll when "
+                 "periodic_poll_bulk is set.  Defaults to -1 (any CPU).");
 
 unsigned int xdp_headroom = offsetof(ci_ip_pkt_fmt, dma_start);
 static const struct kernel_param_ops xdp_headroom_param_ops;
@@ -162,6 +175,8 @@ static void
 tcp_helper_initialize_and_start_periodic_timer(tcp_helper_resource_t*);
 static void
 tcp_helper_stop_periodic_work(tcp_helper_resource_t*);
+static void oo_bulk_poll_start(void);
+static void oo_bulk_poll_stop(void);
 
 static void
 tcp_helper_close_pending_endpoints(tcp_helper_resource_t*);
@@ -175,6 +190,15 @@ static void
 tcp_helper_reset_stack_work(struct work_struct *data);
 #endif
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+static void
+tcp_helper_pkt_grow_work(struct work_struct *data);
+#endif
+
+static void
+tcp_helper_pkt_set_release(tcp_helper_resource_t* trs,
+                           struct tcp_helper_pkt_set* ps);
+
 #if CI_CFG_EPOLL3
 static void
 get_os_ready_list(tcp_helper_resource_t* thr, int ready_list);
@@ -1350,6 +1374,8 @@ get_vi_settings(ci_netif* ni, struct efhw_nic* nic,
              ni->state->pretty_name);
     }
   }
+  if( NI_OPTS(ni).af_xdp_busy_poll && nic->devtype.arch == EFHW_ARCH_AF_XDP )
+    info->efhw_flags |= EFHW_VI_AF_XDP_BUSY_POLL;
 
 #if CI_CFG_CTPIO
   if( should_try_ctpio(ni, nic, info) ) {
@@ -2041,6 +2067,15 @@ static void release_pkts(tcp_helper_resource_t* trs)
   int n_free = 0;
 #endif
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  /* Drop any set the background work item did not get to install. */
+  cancel_work_sync(&trs->pkt_grow_work);
+  if( trs->pkt_grow_ready ) {
+    trs->pkt_grow_ready = 0;
+    tcp_helper_pkt_set_release(trs, &trs->pkt_grow_pending);
+  }
+#endif
+
   for (i = 0; i < ni->pkt_sets_n; i++) {
     ci_assert(ni->pkt_bufs[i]);
 #ifndef NDEBUG
@@ -3798,8 +3833,7 @@ tcp_helper_alloc_to_aw_pool(tcp_helper_resource_t* rs,
    */
 
   idx = ni->state->active_wild_pools_n > 1 ?
-        ci_netif_active_wild_nic_hash(ni, addr_any, port->port_be16,
-                                      addr_any, 0) : 0;
+        ci_netif_active_wild_nic_hash_lport(port->port_be16) : 0;
   idx &= ni->state->active_wild_pools_n - 1;
 
   list = ci_netif_get_active_wild_list(ni, idx, laddr);
@@ -4521,6 +4555,10 @@ int tcp_helper_rm_alloc(ci_resource_onload_alloc_t* alloc,
   INIT_WORK(&rs->work_item_dtor, tcp_helper_destroy_work);
   INIT_WORK(&rs->non_atomic_work, tcp_helper_do_non_atomic);
   ci_sllist_init(&rs->non_atomic_list);
+  INIT_WORK(&rs->pkt_grow_work, tcp_helper_pkt_grow_work);
+  rs->pkt_grow_ready = 0;
+  rs->pkt_grow_reset_gen = 0;
+  rs->pkt_grow_last_free = 0;
   ci_sllist_init(&rs->ep_tobe_closed);
 #endif
   ci_irqlock_ctor(&rs->lock);
@@ -4986,8 +5024,7 @@ thr_reset_stack_tx_cb_state_init(struct thr_reset_stack_tx_cb_state* cb_state,
 {
   cb_state->intf_i = intf_i;
   cb_state->thr = thr;
-  cb_state->ps.tx_pkt_free_list_insert = &cb_state->ps.tx_pkt_free_list;
-  cb_state->ps.tx_pkt_free_list_n = 0;
+  ci_netif_poll_state_init(&cb_state->ps);
 }
 
 static void thr_reset_stack_tx_cb(ef_request_id id, void* arg)
@@ -5285,6 +5322,7 @@ void tcp_helper_reset_stack(ci_netif* ni, int intf_i)
    * is already set, but a race against stack-allocation means that's not quite
    * necessarily true. */
   thr->intfs_to_reset |= (1 << intf_i);
+  ++thr->pkt_grow_reset_gen;
   ci_irqlock_unlock(&thr->lock, &lock_flags);
 
   /* Call tcp_helper_reset_stack_locked from non-dl context only.
@@ -6083,6 +6121,10 @@ efab_tcp_driver_ctor()
 
   efab_tcp_driver.load_numa_node = numa_node_id();
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  oo_bulk_poll_start();
+#endif
+
   return 0;
 
 fail_timesync:
@@ -6108,6 +6150,9 @@ efab_tcp_driver_stop(void)
 {
   OO_DEBUG_TCPH(ci_log("%s: kill stacks", __FUNCTION__));
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  oo_bulk_poll_stop();
+#endif
   thr_table_dtor(&efab_tcp_driver.thr_table);
 
   flush_workqueue(CI_GLOBAL_WORKQUEUE);
@@ -6341,7 +6386,8 @@ efab_tcp_helper_iobufset_alloc(tcp_helper_resource_t* trs,
                                struct oo_iobufset** all_out,
                                struct oo_buffer_pages** pages_out,
                                uint64_t* hw_addrs,
-                               int* page_order)
+                               int* page_order,
+                               int* huge_page_failed)
 {
   ci_netif* ni = &trs->netif;
   int rc, intf_i;
@@ -6352,6 +6398,7 @@ efab_tcp_helper_iobufset_alloc(tcp_helper_resource_t* trs,
   OO_STACK_FOR_EACH_INTF_I(ni, intf_i)
     all_out[intf_i] = NULL;
   *pages_out = NULL;
+  *huge_page_failed = 0;
 
 #ifdef OO_DO_HUGE_PAGES
   BUILD_BUG_ON(HW_PAGES_PER_SET_S != HPAGE_SHIFT - PAGE_SHIFT);
@@ -6391,13 +6438,9 @@ efab_tcp_helper_iobufset_alloc(tcp_helper_resource_t* trs,
   if( rc != 0 )
     return rc;
 #if CI_CFG_PKTS_AS_HUGE_PAGES
-    if( (flags & OO_IOBUFSET_FLAG_HUGE_PAGE_FAILED) &&
-        !(ni->flags & CI_NETIF_FLAG_HUGE_PAGES_FAILED) ) {
-      NI_LOG(ni, RESOURCE_WARNINGS,
-             "[%s]: unable to allocate huge page, using standard pages instead",
-             ni->state->pretty_name);
-      ni->flags |= CI_NETIF_FLAG_HUGE_PAGES_FAILED;
-    }
+  /* This may run without the stack lock, so leave updating ni->flags to
+   * tcp_helper_pkt_set_huge_page_failed(). */
+  *huge_page_failed = !!(flags & OO_IOBUFSET_FLAG_HUGE_PAGE_FAILED);
 #endif
 
   rc = efab_tcp_helper_iobufset_map(trs, pages, 1 << HW_PAGES_PER_SET_S,
@@ -6716,65 +6759,94 @@ void efab_tcp_helper_unmap_usermem(tcp_helper_resource_t* trs,
 }
 
 
-int
-efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
+/* Allocates and DMA-maps the memory for one packet set.  The stack lock is
+ * not needed: nothing is visible to the stack until the set is passed to
+ * tcp_helper_pkt_set_install().  Without the lock a NIC reset may overtake
+ * the mapping, which is what [ps->reset_gen] is there to catch.
+ */
+static int
+tcp_helper_pkt_set_alloc(tcp_helper_resource_t* trs,
+                         struct tcp_helper_pkt_set* ps)
 {
-  struct oo_iobufset* iobrs[CI_CFG_MAX_INTERFACES];
-  struct oo_buffer_pages* pages;
-#ifdef OO_DO_HUGE_PAGES
-  struct oo_hugetlb_page *hugetlb_page;
-#endif
-  uint64_t *hw_addrs;
-  ci_irqlock_state_t lock_flags;
+  int rc;
+
+  ps->huge_page_failed = 0;
+  ps->reset_gen = trs->pkt_grow_reset_gen;
+  /* Sample the generation before mapping: a reset from here on makes the
+   * mapping suspect. */
+  ci_rmb();
+  ps->hw_addrs = ci_vmalloc(sizeof(uint64_t) * (1 << HW_PAGES_PER_SET_S) *
+                            CI_CFG_MAX_INTERFACES);
+  if( ps->hw_addrs == NULL ) {
+    ci_log("%s: [%d] out of memory", __func__, trs->id);
+    return -ENOMEM;
+  }
+
+  rc = efab_tcp_helper_iobufset_alloc(trs, ps->iobrs, &ps->pages,
+                                      ps->hw_addrs, &ps->page_order,
+                                      &ps->huge_page_failed);
+  if( rc < 0 )
+    ci_vfree(ps->hw_addrs);
+  return rc;
+}
+
+
+/* Stops later sets from asking for huge pages once one could not get them.
+ * Caller must hold the stack lock.
+ */
+static void
+tcp_helper_pkt_set_huge_page_failed(tcp_helper_resource_t* trs,
+                                    const struct tcp_helper_pkt_set* ps)
+{
+#if CI_CFG_PKTS_AS_HUGE_PAGES
   ci_netif* ni = &trs->netif;
-  int i, rc, bufset_id, intf_i, page_order;
 
   ci_assert(ci_netif_is_locked(ni));
+  if( ps->huge_page_failed &&
+      !(ni->flags & CI_NETIF_FLAG_HUGE_PAGES_FAILED) ) {
+    NI_LOG(ni, RESOURCE_WARNINGS,
+           "[%s]: unable to allocate huge page, using standard pages instead",
+           ni->state->pretty_name);
+    ni->flags |= CI_NETIF_FLAG_HUGE_PAGES_FAILED;
+  }
+#endif
+}
 
-  /* efab_tcp_helper_iobufset_alloc() checks for pkt_sets_max, but we do
-   * not want to go in efab_tcp_helper_no_more_bufs() in this case, so
-   * let's exit early. */
-  if( ni->pkt_sets_n == ni->pkt_sets_max )
-    return -ENOSPC;
 
-  if( ni->flags & CI_NETIF_FLAG_IN_DL_CONTEXT ) {
-    ef_eplock_holder_set_flag(&ni->state->lock,
-                              CI_EPLOCK_NETIF_NEED_PKT_SET);
-    return -EBUSY;
-  }
+static void
+tcp_helper_pkt_set_release(tcp_helper_resource_t* trs,
+                           struct tcp_helper_pkt_set* ps)
+{
+  int intf_i;
 
-  hw_addrs = ci_vmalloc(sizeof(uint64_t) * (1 << HW_PAGES_PER_SET_S) *
-                        CI_CFG_MAX_INTERFACES);
-  if( hw_addrs == NULL ) {
-    ci_log("%s: [%d] out of memory", __func__, trs->id);
-    return -ENOMEM;
-  }
+  OO_STACK_FOR_EACH_INTF_I(&trs->netif, intf_i)
+    oo_iobufset_resource_release(ps->iobrs[intf_i], 0);
+  oo_iobufset_pages_release(ps->pages);
+  ci_vfree(ps->hw_addrs);
+}
 
-  rc = efab_tcp_helper_iobufset_alloc(trs, iobrs, &pages, hw_addrs,
-                                      &page_order);
-  if(CI_UNLIKELY( rc < 0 )) {
-    /* With highly fragmented memory, iobufset_alloc may fail in
-     * atomic context but succeed later in non-atomic context.
-     * We should somehow differentiate temporary failures (atomic
-     * allocation failure) and permanent failure (out of buffer table
-     * entries).
-     */
-    if( rc == -ENOSPC ) {
-      efab_tcp_helper_no_more_bufs(trs);
-    }
-    else if( rc != -EINTR ) {
-      ++ni->state->stats.bufset_alloc_fails;
-      NI_LOG(ni, RESOURCE_WARNINGS,
-             FN_FMT "Failed to allocate packet buffers (%d)",
-             FN_PRI_ARGS(&trs->netif), rc);
-    }
-    ci_vfree(hw_addrs);
-    return rc;
-  }
+
+/* Adds a packet set allocated by tcp_helper_pkt_set_alloc() to the stack,
+ * and consumes [ps] whether or not it succeeds.  Caller must hold the stack
+ * lock.
+ */
+static int
+tcp_helper_pkt_set_install(tcp_helper_resource_t* trs,
+                           struct tcp_helper_pkt_set* ps)
+{
+#ifdef OO_DO_HUGE_PAGES
+  struct oo_hugetlb_page *hugetlb_page;
+#endif
+  ci_irqlock_state_t lock_flags;
+  ci_netif* ni = &trs->netif;
+  int i, bufset_id, intf_i, page_order;
+
+  ci_assert(ci_netif_is_locked(ni));
   /* check we get the size we are expecting */
   OO_STACK_FOR_EACH_INTF_I(ni, intf_i)
-    ci_assert(iobrs[intf_i] != NULL);
-  ci_assert(pages != NULL);
+    ci_assert(ps->iobrs[intf_i] != NULL);
+  ci_assert(ps->pages != NULL);
+  tcp_helper_pkt_set_huge_page_failed(trs, ps);
 
   /* Install the new buffer allocation, protecting against multi-threads. */
   ci_irqlock_lock(&THR_TABLE.lock, &lock_flags);
@@ -6782,24 +6854,21 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
   ci_assert_ge(ni->pkt_sets_n, 0);
   if( ni->pkt_sets_n == ni->pkt_sets_max ) {
     ci_irqlock_unlock(&THR_TABLE.lock, &lock_flags);
-    OO_STACK_FOR_EACH_INTF_I(ni, intf_i)
-      oo_iobufset_resource_release(iobrs[intf_i], 0);
-    oo_iobufset_pages_release(pages);
-    ci_vfree(hw_addrs);
+    tcp_helper_pkt_set_release(trs, ps);
     return -ENOSPC;
   }
   bufset_id = ni->pkt_sets_n;
   ci_assert_ge(bufset_id, 0);
 
   ++ni->pkt_sets_n;
-  ni->pkt_bufs[bufset_id] = pages;
+  ni->pkt_bufs[bufset_id] = ps->pages;
 #ifdef OO_DO_HUGE_PAGES
-  hugetlb_page = oo_iobufset_get_hugetlb_page(pages);
+  hugetlb_page = oo_iobufset_get_hugetlb_page(ps->pages);
   if( hugetlb_page )
     CITP_STATS_NETIF_INC(ni, pkt_huge_pages);
 #endif
   OO_STACK_FOR_EACH_INTF_I(ni, intf_i)
-    ni->nic_hw[intf_i].pkt_rs[bufset_id] = iobrs[intf_i];
+    ni->nic_hw[intf_i].pkt_rs[bufset_id] = ps->iobrs[intf_i];
   ci_irqlock_unlock(&THR_TABLE.lock, &lock_flags);
   OO_DEBUG_SHM({
     int i;
@@ -6822,6 +6891,7 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
   ni->packets->set[bufset_id].page_offset = -1;
 #endif
   ni->packets->set[bufset_id].dma_addr_base = ni->dma_addr_next;
+  page_order = ps->page_order;
   if( page_order > CI_CFG_PKTS_PER_SET_S ) {
     /* page_order=INT_MAX means that there are no hardware interfaces associated
      * with this stack. */
@@ -6854,9 +6924,9 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
   }
   OO_STACK_FOR_EACH_INTF_I(ni, intf_i) {
     set_pkt_bufset_hwaddrs(ni, bufset_id, intf_i,
-                           hw_addrs + intf_i * (1 << HW_PAGES_PER_SET_S));
+                           ps->hw_addrs + intf_i * (1 << HW_PAGES_PER_SET_S));
   }
-  ci_vfree(hw_addrs);
+  ci_vfree(ps->hw_addrs);
 
   trs->netif.state->packet_alloc_numa_nodes |= 1 << numa_node_id();
   CHECK_FREEPKTS(ni);
@@ -6864,6 +6934,163 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
 }
 
 
+
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+/* Installs the set allocated by the background work item, if there is one.
+ * Caller must hold the stack lock.  Returns 1 if the set was installed.
+ */
+static int
+tcp_helper_pkt_grow_install(tcp_helper_resource_t* trs)
+{
+  struct tcp_helper_pkt_set ps;
+
+  if( ! trs->pkt_grow_ready )
+    return 0;
+  ci_rmb();
+  /* Take our own copy before clearing the flag: once it is clear a requeued
+   * work item is free to allocate into pkt_grow_pending again. */
+  ps = trs->pkt_grow_pending;
+  ci_mb();
+  trs->pkt_grow_ready = 0;
+  if( ps.reset_gen != trs->pkt_grow_reset_gen ) {
+    /* A NIC reset came along while the set was being mapped, and its remap
+     * did not cover the set.  Drop it; the foreground path maps a fresh one
+     * under the lock if it is needed before the next periodic tick. */
+    tcp_helper_pkt_set_release(trs, &ps);
+    return 0;
+  }
+  if( tcp_helper_pkt_set_install(trs, &ps) != 0 )
+    return 0;
+  CITP_STATS_NETIF_INC(&trs->netif, pkt_set_grow_bg);
+  return 1;
+}
+#endif
+
+
+int
+efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
+{
+  struct tcp_helper_pkt_set ps;
+  ci_netif* ni = &trs->netif;
+  int rc;
+
+  ci_assert(ci_netif_is_locked(ni));
+
+  /* efab_tcp_helper_iobufset_alloc() checks for pkt_sets_max, but we do
+   * not want to go in efab_tcp_helper_no_more_bufs() in this case, so
+   * let's exit early. */
+  if( ni->pkt_sets_n == ni->pkt_sets_max )
+    return -ENOSPC;
+
+  if( ni->flags & CI_NETIF_FLAG_IN_DL_CONTEXT ) {
+    ef_eplock_holder_set_flag(&ni->state->lock,
+                              CI_EPLOCK_NETIF_NEED_PKT_SET);
+    return -EBUSY;
+  }
+
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  /* The work item may have done the expensive part for us already. */
+  if( tcp_helper_pkt_grow_install(trs) )
+    return 0;
+#endif
+
+  rc = tcp_helper_pkt_set_alloc(trs, &ps);
+  if(CI_UNLIKELY( rc < 0 )) {
+    tcp_helper_pkt_set_huge_page_failed(trs, &ps);
+    /* With highly fragmented memory, iobufset_alloc may fail in
+     * atomic context but succeed later in non-atomic context.
+     * We should somehow differentiate temporary failures (atomic
+     * allocation failure) and permanent failure (out of buffer table
+     * entries).
+     */
+    if( rc == -ENOSPC ) {
+      efab_tcp_helper_no_more_bufs(trs);
+    }
+    else if( rc != -EINTR ) {
+      ++ni->state->stats.bufset_alloc_fails;
+      NI_LOG(ni, RESOURCE_WARNINGS,
+             FN_FMT "Failed to allocate packet buffers (%d)",
+             FN_PRI_ARGS(&trs->netif), rc);
+    }
+    return rc;
+  }
+
+  rc = tcp_helper_pkt_set_install(trs, &ps);
+  if( rc == 0 )
+    CITP_STATS_NETIF_INC(ni, pkt_set_grow_fg);
+  return rc;
+}
+
+
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+/* Schedules background growth of the packet pool.  May be called in any
+ * context. */
+static void
+tcp_helper_pkt_grow_queue(tcp_helper_resource_t* trs)
+{
+  if( atomic_read(&trs->timer_running) )
+    queue_work(trs->wq, &trs->pkt_grow_work);
+}
+
+
+/* Work item for EF_PKT_ALLOC_BACKGROUND.  The slow part of growing the pool
+ * -- allocating and mapping the memory -- is done without the stack lock.
+ * If the lock is busy, the holder installs the new set when it unlocks.
+ */
+static void
+tcp_helper_pkt_grow_work(struct work_struct *data)
+{
+  tcp_helper_resource_t* trs = container_of(data, tcp_helper_resource_t,
+                                            pkt_grow_work);
+  ci_netif* ni = &trs->netif;
+
+  /* The stack is going away. */
+  if( ! atomic_read(&trs->timer_running) )
+    return;
+
+  if( ! trs->pkt_grow_ready ) {
+    if( ni->pkt_sets_n == ni->pkt_sets_max )
+      return;
+    /* On failure leave it to the foreground path to report the error and,
+     * for -ENOSPC, to reduce the stack's limits. */
+    if( tcp_helper_pkt_set_alloc(trs, &trs->pkt_grow_pending) < 0 )
+      return;
+    ci_wmb();
+    trs->pkt_grow_ready = 1;
+  }
+
+  if( efab_tcp_helper_netif_lock_or_set_flags(trs, 0,
+                                              CI_EPLOCK_NETIF_NEED_PKT_SET,
+                                              0) ) {
+    tcp_helper_pkt_grow_install(trs);
+    efab_tcp_helper_netif_unlock(trs, 0);
+  }
+}
+
+
+/* Called from the periodic timer with the stack lock held.  Grows the pool
+ * if free packets would drop below EF_FREE_PACKETS_LOW_WATERMARK within the
+ * next two ticks at the rate they were consumed during the last one.
+ */
+static void
+tcp_helper_pkt_grow_predict(tcp_helper_resource_t* trs)
+{
+  ci_netif* ni = &trs->netif;
+  ci_int32 n_free = ni->packets->n_free;
+  ci_int32 used = trs->pkt_grow_last_free - n_free;
+
+  ci_assert(ci_netif_is_locked(ni));
+
+  trs->pkt_grow_last_free = n_free;
+  if( ! NI_OPTS(ni).pkt_alloc_background ||
+      ni->pkt_sets_n == ni->pkt_sets_max )
+    return;
+  if( used > 0 && n_free - 2 * used < (ci_int32) NI_OPTS(ni).free_packets_low )
+    tcp_helper_pkt_grow_queue(trs);
+}
+#endif
+
+
 #if ! CI_CFG_UL_INTERRUPT_HELPER
 void
 tcp_helper_rm_dump(oo_fd_flags fd_flags, oo_sp sock_id,
@@ -7129,6 +7356,91 @@ static int oo_handle_wakeup_or_timeout(void* context, int is_timeout,
 }
 
 
+/* Adaptive interrupt moderation (EF_INT_ADAPTIVE_USEC).  An interrupt that
+ * finds INT_ADAPTIVE_BUSY_EVS events, or more than INT_ADAPTIVE_QUIET_EVS
+ * events less than the moderation limit after the previous interrupt,
+ * doubles the stack's moderation interval.  INT_ADAPTIVE_QUIET_IRQS
+ * interrupts in a row that find no more than INT_ADAPTIVE_QUIET_EVS events
+ * halve it.  The gap between the two thresholds stops the stack flapping
+ * between immediate wakeups and moderation.
+ */
+#define INT_ADAPTIVE_BUSY_EVS    16
+#define INT_ADAPTIVE_QUIET_EVS   2
+#define INT_ADAPTIVE_QUIET_IRQS  8
+#define INT_ADAPTIVE_MIN_USEC    4
+
+static int oo_int_adaptive_enabled(ci_netif* ni, int intf_i)
+{
+  /* Moderation uses the count-down timer, so is incompatible with using it
+   * for EF_HELPER_USEC, and needs a NIC that implements it. */
+  return NI_OPTS(ni).int_adaptive_usec != 0 &&
+         NI_OPTS(ni).timer_usec == 0 &&
+         ci_netif_vi(ni, intf_i)->nic_type.arch == EF_VI_ARCH_EF10;
+}
+
+
+static void oo_int_adaptive_update(ci_netif* ni, int n_evs)
+{
+  ci_netif_state* ns = ni->state;
+  ci_uint32 max_usec = NI_OPTS(ni).int_adaptive_usec;
+  ci_uint64 now_frc, gap;
+
+  ci_assert(ci_netif_is_locked(ni));
+
+  ci_frc64(&now_frc);
+  gap = now_frc - ns->int_adaptive_last_frc;
+  ns->int_adaptive_last_frc = now_frc;
+
+  if( n_evs >= INT_ADAPTIVE_BUSY_EVS ||
+      (n_evs > INT_ADAPTIVE_QUIET_EVS &&
+       gap < oo_usec_to_cycles64(ni, max_usec)) ) {
+    ns->int_adaptive_quiet = 0;
+    if( ns->int_adaptive_usec < max_usec ) {
+      if( ns->int_adaptive_usec == 0 )
+        ns->int_adaptive_usec = CI_MIN(INT_ADAPTIVE_MIN_USEC, max_usec);
+      else
+        ns->int_adaptive_usec = CI_MIN(ns->int_adaptive_usec * 2, max_usec);
+      CITP_STATS_NETIF_INC(ni, int_adaptive_raise);
+    }
+  }
+  else if( n_evs <= INT_ADAPTIVE_QUIET_EVS ) {
+    if( ns->int_adaptive_usec != 0 &&
+        ++ns->int_adaptive_quiet >= INT_ADAPTIVE_QUIET_IRQS ) {
+      ns->int_adaptive_quiet = 0;
+      ns->int_adaptive_usec /= 2;
+      if( ns->int_adaptive_usec < INT_ADAPTIVE_MIN_USEC )
+        ns->int_adaptive_usec = 0;
+      CITP_STATS_NETIF_INC(ni, int_adaptive_lower);
+    }
+  }
+  else {
+    ns->int_adaptive_quiet = 0;
+  }
+}
+
+
+/* Re-enables interrupts on [intf_i] after an interrupt has polled the
+ * stack.  While moderating, the event queue timer is armed instead of a
+ * wakeup, so that the next interrupt comes [int_adaptive_usec] after the
+ * next event rather than straight away.  A thread that goes to sleep on the
+ * stack still requests an immediate wakeup.
+ */
+static void oo_int_adaptive_reprime(tcp_helper_resource_t* trs, int intf_i)
+{
+  ci_netif* ni = &trs->netif;
+  ci_uint32 usec = ni->state->int_adaptive_usec;
+  int i;
+
+  if( usec == 0 || ! ci_netif_may_poll_in_kernel(ni, intf_i) ) {
+    tcp_helper_request_wakeup_nic(trs, intf_i);
+    return;
+  }
+  for( i = 0; i < ci_netif_num_evqs(ni); ++i )
+    ef_eventq_timer_prime(&ni->nic_hw[intf_i].vis[i], usec);
+  CITP_STATS_NETIF_INC(ni, int_adaptive_timer_primes);
+}
+
+
 static int oo_handle_wakeup_int_driven(void* context, int is_timeout,
                                         struct efhw_nic* nic_, int budget)
 {
@@ -7153,7 +7465,9 @@ static int oo_handle_wakeup_int_driven(void* context, int is_timeout,
     /* otherwise continue as though POLL_AND_PRIME wasn't initially set */
   }
 
-  ci_assert( ! is_timeout );
+  /* Timeouts come only from the timer armed by adaptive moderation, and
+   * are handled just like wakeups. */
+  ci_assert( ! is_timeout || NI_OPTS(ni).int_adaptive_usec );
   TCP_HELPER_RESOURCE_ASSERT_VALID(trs, -1);
   CITP_STATS_NETIF_INC(ni, interrupts);
 
@@ -7199,7 +7513,13 @@ static int oo_handle_wakeup_int_driven(void* context, int is_timeout,
          */
         if( ci_bit_test(&ni->state->evq_prime_deferred, tcph_nic->thn_intf_i) )
           ci_bit_clear(&ni->state->evq_prime_deferred, tcph_nic->thn_intf_i);
-        tcp_helper_request_wakeup_nic(trs, tcph_nic->thn_intf_i);
+        if( oo_int_adaptive_enabled(ni, tcph_nic->thn_intf_i) ) {
+          oo_int_adaptive_update(ni, n);
+          oo_int_adaptive_reprime(trs, tcph_nic->thn_intf_i);
+        }
+        else {
+          tcp_helper_request_wakeup_nic(trs, tcph_nic->thn_intf_i);
+        }
         efab_tcp_helper_netif_unlock(trs, 1);
         break;
       }
@@ -7270,6 +7590,11 @@ linux_set_periodic_timer_restart(tcp_helper_resource_t* rs,
   if (atomic_read(&rs->timer_running) == 0) 
     return;
 
+  /* The bulk pass polls idle stacks, so the stack's own timer is needed
+   * only for IP timers that are due sooner. */
+  if( periodic_poll_bulk && timeout >= periodic_poll )
+    return;
+
   /* The timeout is calculated from IP ticks, which are ususally smaller
    * than jiffies, so the timeout can occur to be 0.
    * linux_tcp_timer_do() adds 1, but even 1-jiffie timout is ususally
@@ -7317,6 +7642,11 @@ tcp_helper_request_timer(tcp_helper_resource_t* trs)
   unsigned long timer_delay;
 
   timer_delay = tcp_helper_next_ip_timer(ni);
+  /* With periodic_poll_bulk the stack's timer is usually idle. */
+  if( periodic_poll_bulk && ! delayed_work_pending(&trs->timer) ) {
+    linux_set_periodic_timer_restart(trs, timer_delay);
+    return;
+  }
   /* If the current periodic timer expiration is too far from
    * jiffies + timer_delay, then we want to re-schedule the timer. */
   if( TIME_GT(trs->timer.timer.expires,
@@ -7334,18 +7664,23 @@ tcp_helper_request_timer(tcp_helper_resource_t* trs)
 static void
 ci_netif_collect_periodic_metrics(ci_netif* ni)
 {
-  /* We have no lock here however, we are the only modifier
-   * of lowest_free_pkts count */
+  /* We have no lock here, and with periodic_poll_bulk the bulk pass and
+   * the stack's own timer may both get here at once, so lowest_free_pkts
+   * is only ever lowered by compare-and-swap. */
   uint32_t free_pkts =
     ((ni->pkt_sets_max - ni->pkt_sets_n) << CI_CFG_PKTS_PER_SET_S) +
     ni->packets->n_free;
+  ci_uint32 lowest;
 
   if( free_pkts <= 0 )
     free_pkts = 1; /* cannot allow it to be set to 0 */
 
-  if( free_pkts < ni->state->stats.lowest_free_pkts ||
-      ni->state->stats.lowest_free_pkts == 0 )
-    ni->state->stats.lowest_free_pkts = free_pkts;
+  do {
+    lowest = ni->state->stats.lowest_free_pkts;
+    if( free_pkts >= lowest && lowest != 0 )
+      return;
+  } while( ci_cas32u_fail(&ni->state->stats.lowest_free_pkts,
+                          lowest, free_pkts) );
 }
 
 static void
@@ -7372,6 +7707,7 @@ linux_tcp_timer_do(tcp_helper_resource_t* rs, unsigned long* next_timer)
       rc = ci_netif_poll(ni);
       oo_inject_packets_kernel_force(ni);
       *next_timer = tcp_helper_next_ip_timer(ni);
+      tcp_helper_pkt_grow_predict(rs);
       efab_tcp_helper_netif_unlock(rs, 0);
       CITP_STATS_NETIF_INC(ni, periodic_polls);
       if( rc > 0 )
@@ -7382,6 +7718,12 @@ linux_tcp_timer_do(tcp_helper_resource_t* rs, unsigned long* next_timer)
     }
     ci_netif_collect_periodic_metrics(ni);
   }
+  else if( NI_OPTS(ni).pkt_alloc_background &&
+           efab_tcp_helper_netif_try_lock(rs, 0) ) {
+    /* A busy stack is where the pool is most likely to run low. */
+    tcp_helper_pkt_grow_predict(rs);
+    efab_tcp_helper_netif_unlock(rs, 0);
+  }
 }
 
 static void
@@ -7414,6 +7756,126 @@ tcp_helper_initialize_and_start_periodic_timer(tcp_helper_resource_t* rs)
 }
 
 
+/* Bulk periodic poll (periodic_poll_bulk).  One work item visits every
+ * stack each periodic_poll jiffies.  It reads the event queues and the IP
+ * timer wheel without locks, and takes the stack lock only for stacks with
+ * events waiting or IP timers pending, so that hundreds of idle stacks
+ * cost no lock traffic and no cache-line bouncing.  The work runs on
+ * periodic_poll_cpu, keeping it off latency-sensitive cores.
+ */
+static struct delayed_work oo_bulk_poll_work;
+static atomic_t oo_bulk_poll_running;
+
+static int oo_bulk_poll_cpu(void)
+{
+  if( periodic_poll_cpu < 0 || periodic_poll_cpu >= nr_cpu_ids ||
+      ! cpu_online(periodic_poll_cpu) )
+    return WORK_CPU_UNBOUND;
+  return periodic_poll_cpu;
+}
+
+/* Returns true if an IP timer of [ni] may fall due by [limit].  Timers in
+ * wheel 0 give their expiry time exactly.  A timer in a higher wheel can
+ * not go off before the cascade that brings it down to wheel 0, so those
+ * count only once such a cascade is due.  The wheels are read without the
+ * stack lock, so the answer is a guess if the stack is busy.
+ */
+static int oo_bulk_poll_timer_due(ci_netif* ni, ci_iptime_t limit)
+{
+  ci_ip_timer_state* ipts = IPTIMER_STATE(ni);
+  ci_iptime_t base = ipts->sched_ticks & IPTIMER_WHEEL0_MASK;
+  unsigned b = ipts->sched_ticks - base;
+  ci_iptime_t t;
+  int i, w, n;
+
+  for( i = b / 64; i < 4; ++i ) {
+    ci_uint64 mask = ipts->busy_mask[i];
+    if( i == b / 64 )
+      mask &=~ ((1ULL << (b % 64)) - 1);
+    if( mask != 0 )
+      return TIME_LE(base + i * 64 + ci_ffs64(mask) - 1, limit);
+  }
+
+  /* Each wheel 0 wrap cascades one bucket of wheel 1, and each wheel 1
+   * wrap one of wheel 2 and so on.  If the stack has not been polled for a
+   * long time there may be many wraps to get through; give up and poll. */
+  t = base + CI_IPTIME_BUCKETS;
+  for( n = 0; TIME_LE(t, limit); ++n, t += CI_IPTIME_BUCKETS ) {
+    if( n == CI_IPTIME_BUCKETS )
+      return 1;
+    for( w = 1; w < CI_IPTIME_WHEELS; ++w ) {
+      if( ! oo_p_dllink_is_empty(ni, IPTIMER_BUCKET(ni, w, t)) )
+        return 1;
+      if( IPTIMER_BUCKETNO(w, t) != 0 )
+        break;
+    }
+  }
+  return 0;
+}
+
+/* Returns true if [ni] has events to handle or IP timers falling due
+ * within [horizon_us].  Can be wrong if the stack is busy, which is
+ * harmless: the stack is then polled by its own threads anyway.
+ */
+static int oo_bulk_poll_stack_needs_poll(ci_netif* ni, unsigned horizon_us)
+{
+  ci_ip_timer_state* ipts = IPTIMER_STATE(ni);
+  ci_iptime_t now = (ci_iptime_t) (ci_frc64_get() >> ipts->ci_ip_time_frc2tick);
+  ci_iptime_t horizon = horizon_us >>
+                        (ipts->ci_ip_time_frc2tick - ipts->ci_ip_time_frc2us);
+
+  return ci_netif_has_event(ni) ||
+         oo_bulk_poll_timer_due(ni, now + horizon);
+}
+
+static void oo_bulk_poll_work_fn(struct work_struct* work)
+{
+  unsigned horizon_us = jiffies_to_usecs(periodic_poll + periodic_poll_skew);
+  ci_netif* ni = NULL;
+
+  while( iterate_netifs_unlocked(&ni, OO_THR_REF_BASE,
+                                 OO_THR_REF_INFTY) == 0 ) {
+    tcp_helper_resource_t* trs = netif2tcp_helper_resource(ni);
+    unsigned long next_timer = periodic_poll;
+
+    if( atomic_read(&trs->timer_running) == 0 )
+      continue;
+    if( oo_bulk_poll_stack_needs_poll(ni, horizon_us) ) {
+      linux_tcp_timer_do(trs, &next_timer);
+      linux_set_periodic_timer_restart(trs, next_timer);
+    }
+    else {
+      /* Nothing has arrived to use up packets, so there is no need to take
+       * the lock to look at the pool's demand. */
+      CITP_STATS_NETIF_INC(ni, periodic_bulk_skips);
+      ci_netif_collect_periodic_metrics(ni);
+    }
+  }
+
+  if( atomic_read(&oo_bulk_poll_running) )
+    queue_delayed_work_on(oo_bulk_poll_cpu(), CI_GLOBAL_WORKQUEUE,
+                          &oo_bulk_poll_work, periodic_poll);
+}
+
+static void oo_bulk_poll_start(void)
+{
+  if( ! periodic_poll_bulk )
+    return;
+  INIT_DELAYED_WORK(&oo_bulk_poll_work, oo_bulk_poll_work_fn);
+  atomic_set(&oo_bulk_poll_running, 1);
+  queue_delayed_work_on(oo_bulk_poll_cpu(), CI_GLOBAL_WORKQUEUE,
+                        &oo_bulk_poll_work, periodic_poll);
+}
+
+static void oo_bulk_poll_stop(void)
+{
+  if( ! periodic_poll_bulk )
+    return;
+  atomic_set(&oo_bulk_poll_running, 0);
+  cancel_delayed_work_sync(&oo_bulk_poll_work);
+}
+
+
 /* This function is used when stopping a stack, and also on error paths when
  * creating a stack fails.  The workqueue and the purge_txq_work work item
  * must be initialised, but the periodic timer need not be initialised. */
@@ -7445,6 +7907,9 @@ tcp_helper_stop_periodic_work(tcp_helper_resource_t* rs)
   /* and flush, just in case the second workitem have started
    * before we cancelled it */
   flush_workqueue(rs->wq);
+  /* Background packet allocation checks timer_running, so it can not
+   * requeue itself from here on. */
+  cancel_work_sync(&rs->pkt_grow_work);
 }
 #endif
 
@@ -8055,7 +8520,17 @@ efab_tcp_helper_netif_lock_callback(eplock_helper_t* epl, ci_uint64 lock_val,
         (!orphaned && oo_want_proactive_packet_allocation(ni)) ) {
       OO_DEBUG_TCPH(ci_log("%s: [%u] NEED_PKT_SET now",
                            __FUNCTION__, thr->id));
-      efab_tcp_helper_more_bufs(thr);
+      /* With EF_PKT_ALLOC_BACKGROUND only install a set that the work item
+       * has already allocated; otherwise ask for one.  Threads that run out
+       * of packets completely still call efab_tcp_helper_more_bufs(). */
+      if( NI_OPTS(ni).pkt_alloc_background && ! orphaned ) {
+        if( (ni->flags & CI_NETIF_FLAG_IN_DL_CONTEXT) ||
+            ! tcp_helper_pkt_grow_install(thr) )
+          tcp_helper_pkt_grow_queue(thr);
+      }
+      else {
+        efab_tcp_helper_more_bufs(thr);
+      }
       flags_set &=~ CI_EPLOCK_NETIF_NEED_PKT_SET;
     }
 
@@ -296,11 +296,15 @@ cicp_user_retrieve(ci_netif*                    ni,
   if( ni->cplane_init_net != NULL &&
       ipcache_protocol(ipcache) == IPPROTO_TCP ) {
     ci_uint16 lport = sock_cp->lport_be16;
+    ci_uint32 flow_hash = onload_hash3(CI_ADDR_FROM_ADDR_SH(key.src), lport,
+                                       daddr, ipcache->dport_be16,
+                                       IPPROTO_TCP);
     pre_nat_laddr = key.src;
     /* We ignore failure returns from cp_svc_check_dnat().  In the event that
      * it fails, it leaves the address untranslated, which is the best that
      * we can do. */
-    nat_applied = cp_svc_check_dnat(ni->cplane_init_net, &key.src, &lport) > 0;
+    nat_applied = cp_svc_check_dnat(ni->cplane_init_net, &key.src, &lport,
+                                    flow_hash) > 0;
   }
   if( cicp_user_resolve(ni, ni->cplane, &ipcache->fwd_ver,
                         sock_cp->sock_cp_flags, &key, &data) != 0 )
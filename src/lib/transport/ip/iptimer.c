@@ -308,25 +308,10 @@ static void ci_ip_timer_docallback(ci_netif *netif, ci_ip_timer* ts)
   ci_assert( ts->time == IPTIMER_STATE(netif)->sched_ticks );
 
   switch(ts->fn){
-  case CI_IP_TIMER_TCP_RTO:
+  case CI_IP_TIMER_TCP_MUX:
     sp = oo_statep_to_sockp(netif, ts->statep);
     CHECK_TS(netif, SP_TO_TCP(netif, sp));
-    ci_tcp_timeout_rto(netif, SP_TO_TCP(netif, sp));
-    break;
-  case CI_IP_TIMER_TCP_DELACK:
-    sp = oo_statep_to_sockp(netif, ts->statep);
-    CHECK_TS(netif, SP_TO_TCP(netif, sp));
-    ci_tcp_timeout_delack(netif, SP_TO_TCP(netif, sp));
-    break;
-  case CI_IP_TIMER_TCP_ZWIN:
-    sp = oo_statep_to_sockp(netif, ts->statep);
-    CHECK_TS(netif, SP_TO_TCP(netif, sp));
-    ci_tcp_timeout_zwin(netif, SP_TO_TCP(netif, sp));
-    break;
-  case CI_IP_TIMER_TCP_KALIVE:
-    sp = oo_statep_to_sockp(netif, ts->statep);
-    CHECK_TS(netif, SP_TO_TCP(netif, sp));
-    ci_tcp_timeout_kalive(netif, SP_TO_TCP(netif, sp));
+    ci_tcp_timeout_mux(netif, SP_TO_TCP(netif, sp));
     break;
   case CI_IP_TIMER_TCP_LISTEN:
     sp = oo_statep_to_sockp(netif, ts->statep);
@@ -576,10 +561,7 @@ static const char* ci_ip_timer_dump(const ci_ip_timer* ts)
     #undef MAKECASE
     #define MAKECASE(id, name) case id: timer_name = name; break;
 
-    MAKECASE(CI_IP_TIMER_TCP_RTO,      "rto")
-    MAKECASE(CI_IP_TIMER_TCP_DELACK,   "delack")
-    MAKECASE(CI_IP_TIMER_TCP_ZWIN,     "zwin")
-    MAKECASE(CI_IP_TIMER_TCP_KALIVE,   "kalive")
+    MAKECASE(CI_IP_TIMER_TCP_MUX,      "tcp")
     MAKECASE(CI_IP_TIMER_TCP_LISTEN,   "listen")
     MAKECASE(CI_IP_TIMER_TCP_CORK,     "cork")
     MAKECASE(CI_IP_TIMER_NETIF_TIMEOUT, "netif")
@@ -128,7 +128,9 @@ _UK_INTF_HDRS	:= ci/internal/ip_shared_types.h	\
 		onload/dshm.h				\
 		onload/mmap.h				\
 		onload/mmap_base.h			\
-		cplane/mmap.h
+		cplane/mmap.h				\
+		etherfabric/ef_vi.h			\
+		ci/driver/efab/hardware/af_xdp.h
 
 UK_INTF_HDRS	:= $(_UK_INTF_HDRS:%=$(SRCPATH)/include/%)
 
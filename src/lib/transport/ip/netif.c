@@ -565,6 +565,25 @@ static void ci_netif_mem_pressure_pkt_pool_use(ci_netif* ni)
 }
 
 
+static void ci_netif_udp_fanout_pool_drain(ci_netif* ni)
+{
+  /* Give idle UDP fan-out nodes back to the free pool. */
+  ci_ip_pkt_fmt* pkt;
+#ifdef __KERNEL__
+  int is_locked = 1;
+#endif
+  while( ! OO_PP_IS_NULL(ni->state->udp_fanout_pool) ) {
+    pkt = PKT(ni, ni->state->udp_fanout_pool);
+    ni->state->udp_fanout_pool = pkt->next;
+    --ni->state->udp_fanout_pool_n;
+    ci_assert_equal(pkt->refcount, 0);
+    ci_assert(pkt->flags & CI_PKT_FLAG_RX);
+    ci_assert_nflags(pkt->rx_flags, CI_PKT_RX_FLAG_UDP_FANOUT);
+    ci_netif_pkt_free(ni, pkt CI_KERNEL_ARG(&is_locked));
+  }
+}
+
+
 static void ci_netif_mem_pressure_enter_critical(ci_netif* ni, int intf_i)
 {
   if( ni->state->mem_pressure & OO_MEM_PRESSURE_CRITICAL )
@@ -574,6 +593,7 @@ static void ci_netif_mem_pressure_enter_critical(ci_netif* ni, int intf_i)
   ni->state->mem_pressure |= OO_MEM_PRESSURE_CRITICAL;
   ni->state->rxq_limit = 2*CI_CFG_RX_DESC_BATCH;
   ci_netif_mem_pressure_pkt_pool_use(ni);
+  ci_netif_udp_fanout_pool_drain(ni);
   ci_netif_rx_post_all_batch(ni, intf_i);
 }
 
@@ -693,7 +713,6 @@ static int __ci_netif_rx_post(ci_netif* ni, ef_vi* vi, int intf_i,
     ni->packets->set[bufset_id].n_free -= CI_CFG_RX_DESC_BATCH;
     ni->packets->n_free -= CI_CFG_RX_DESC_BATCH;
     ni->state->n_rx_pkts  += CI_CFG_RX_DESC_BATCH;
-    ef_vi_receive_push(vi);
     posted += CI_CFG_RX_DESC_BATCH;
   } while( max - posted >= CI_CFG_RX_DESC_BATCH );
 
@@ -704,7 +723,8 @@ static int __ci_netif_rx_post(ci_netif* ni, ef_vi* vi, int intf_i,
 #define low_thresh(ni)       ((ni)->state->rxq_limit / 2)
 
 
-int ci_netif_rx_post(ci_netif* netif, int intf_i, ef_vi* vi)
+static int __ci_netif_rx_refill(ci_netif* netif, int intf_i, ef_vi* vi,
+                                int* n_pushed)
 {
   /* TODO: When under packet buffer pressure, post fewer on the receive
   ** queue.  As an easy first stab could have a threshold for the number of
@@ -816,6 +836,13 @@ int ci_netif_rx_post(ci_netif* netif, int intf_i, ef_vi* vi)
    * allocate more packets when time allows: */
   ask_for_more_packets = 1;
 
+  /* Everything below may take a while, so let the NIC have the buffers we
+   * have already written rather than leave them unposted meanwhile. */
+  if( n_posted != *n_pushed ) {
+    ef_vi_receive_push(vi);
+    *n_pushed = n_posted;
+  }
+
   /* Grab buffers from the non-blocking pool. */
   while( (pkt = ci_netif_pkt_alloc_nonb(netif)) != NULL ) {
     --netif->state->n_async_pkts;
@@ -858,6 +885,20 @@ int ci_netif_rx_post(ci_netif* netif, int intf_i, ef_vi* vi)
 }
 
 
+int ci_netif_rx_post(ci_netif* netif, int intf_i, ef_vi* vi)
+{
+  /* Descriptors are written in batches of CI_CFG_RX_DESC_BATCH, possibly
+   * from several packet sets, but we only ring the doorbell once (or once
+   * more if the refill had to go looking for buffers part way through).
+   */
+  int n_pushed = 0;
+  int n_posted = __ci_netif_rx_refill(netif, intf_i, vi, &n_pushed);
+  if( n_posted != n_pushed )
+    ef_vi_receive_push(vi);
+  return n_posted;
+}
+
+
 #if OO_DO_STACK_POLL
 static void citp_waitable_deferred_work(ci_netif* ni, citp_waitable* w)
 {
@@ -1004,6 +1045,43 @@ ci_uint64 ci_netif_purge_deferred_socket_list(ci_netif* ni)
   return l;
 }
 
+
+/* EF_SPIN_ADAPTIVE: a wait that spin could have covered but that outlasted
+ * the learnt budget grows the budget to cover it.  SPIN_ADAPTIVE_MISSES
+ * waits in a row that the socket's full spin timeout would not have
+ * covered either halve it, and below 1/64 of the timeout spinning stops
+ * altogether.  Called without the stack lock, so concurrent callers may
+ * lose updates; that is harmless for a heuristic.
+ */
+#define SPIN_ADAPTIVE_MISSES  4
+
+void ci_netif_spin_adaptive_update(ci_netif* ni, citp_waitable* w,
+                                   ci_uint64 waited)
+{
+  ci_netif_state* ns = ni->state;
+  ci_uint64 max = w->spin_cycles;
+  ci_uint64 budget = ns->spin_adaptive_cycles;
+
+  if( waited <= budget ) {
+    /* The common case: avoid dirtying a shared cache line. */
+    if( ns->spin_adaptive_misses != 0 )
+      ns->spin_adaptive_misses = 0;
+  }
+  else if( waited <= max ) {
+    budget = budget > max / 2 ? max : CI_MAX(budget * 2, waited);
+    ns->spin_adaptive_cycles = CI_MIN(budget, max);
+    ns->spin_adaptive_misses = 0;
+    CITP_STATS_NETIF_INC(ni, spin_adaptive_grow);
+  }
+  else if( budget != 0 && ++ns->spin_adaptive_misses >= SPIN_ADAPTIVE_MISSES ) {
+    budget /= 2;
+    ns->spin_adaptive_cycles = budget < max / 64 ? 0 : budget;
+    ns->spin_adaptive_misses = 0;
+    CITP_STATS_NETIF_INC(ni, spin_adaptive_shrink);
+  }
+}
+
+
 void ci_netif_merge_atomic_counters(ci_netif* ni)
 {
   ci_int32 val;
@@ -1475,32 +1553,62 @@ int ci_netif_raw_send(ci_netif* ni, int intf_i,
 
 
 #if CI_CFG_TCP_SHARED_LOCAL_PORTS
-static ci_uint32 __ci_netif_active_wild_hash(ci_netif *ni,
-                                             ci_addr_t laddr, ci_uint16 lport,
-                                             ci_addr_t raddr, ci_uint16 rport)
-{
-  /* FIXME lots of insights into efrm */
-  /* FIXME this is copy of hash in efrm_vi_set.c */
-  static const uint8_t rx_hash_key[40] = {
-    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
-    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
-    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
-    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
-    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
-  };
+/* FIXME lots of insights into efrm */
+/* FIXME this is copy of hash in efrm_vi_set.c */
+static const uint8_t rx_hash_key[40] = {
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+};
 
 #ifndef __KERNEL__
-  /* We use a transformed key for our optimised Toeplitz hash. */
-  __attribute__((aligned(sizeof(ci_uint32))))
-  static const uint8_t rx_hash_key_sse[40] = {
-    0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
-    0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
-    0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
-    0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
-    0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
-  };
+/* We use a transformed key for our optimised Toeplitz hash. */
+__attribute__((aligned(sizeof(ci_uint32))))
+static const uint8_t rx_hash_key_sse[40] = {
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+};
 #endif
 
+/* Contribution of each byte of the local port to the hash.  The key repeats
+ * every two bytes, so this is the same wherever the port sits in the IPv4
+ * or IPv6 tuple.  Filled on first use; racing initialisers write identical
+ * values.
+ */
+static ci_uint32 active_wild_lport_hash[2][256];
+static int active_wild_lport_hash_ready;
+
+
+/* Returns the contribution of [lport] to the hash of any 4-tuple.  As the
+ * Toeplitz hash is linear, the hash of a 4-tuple is the XOR of this and the
+ * hash of the same tuple with a zero local port.
+ */
+static ci_uint32 __ci_netif_active_wild_lport_hash(ci_uint16 lport)
+{
+  const ci_uint8* lport_bytes = (const ci_uint8*) &lport;
+
+  if(CI_UNLIKELY( ! active_wild_lport_hash_ready )) {
+    /* The local port is at offset 10 in the IPv4 tuple. */
+    ci_toeplitz_hash_byte_table(rx_hash_key, 10, active_wild_lport_hash[0]);
+    ci_toeplitz_hash_byte_table(rx_hash_key, 11, active_wild_lport_hash[1]);
+    ci_wmb();
+    active_wild_lport_hash_ready = 1;
+  }
+
+  return active_wild_lport_hash[0][lport_bytes[0]] ^
+         active_wild_lport_hash[1][lport_bytes[1]];
+}
+
+
+static ci_uint32 __ci_netif_active_wild_hash(ci_netif *ni,
+                                             ci_addr_t laddr, ci_uint16 lport,
+                                             ci_addr_t raddr, ci_uint16 rport)
+{
 #if CI_CFG_IPV6
   if( CI_IS_ADDR_IP6(laddr) ) {
     struct {
@@ -1554,6 +1662,18 @@ int ci_netif_active_wild_nic_hash(ci_netif *ni,
 }
 
 
+/* Returns the index in the NIC's RSS indirection table to which a 4-tuple
+ * with the given local port and an otherwise all-zero tuple would be hashed.
+ * This is a table lookup, and so is cheap enough to be done for each of many
+ * candidate ports.  XOR with ci_netif_active_wild_nic_hash() for a zero local
+ * port gives the index for a complete 4-tuple.
+ */
+int ci_netif_active_wild_nic_hash_lport(ci_uint16 lport)
+{
+  return __ci_netif_active_wild_lport_hash(lport) & RSS_HASH_MASK;
+}
+
+
 /* Returns the hash table of active wilds for the specified pool. */
 ci_inline struct oo_p_dllink*
 ci_netif_active_wild_pool_table(ci_netif* ni, int aw_pool)
@@ -1640,6 +1760,11 @@ static int __ci_netif_active_wild_rss_ok(ci_netif* ni,
   if( ni->state->cluster_size < 2 )
     return 1;
 
+  /* The port table must agree with the full hash. */
+  ci_assert_equal(ci_netif_active_wild_nic_hash(ni, laddr, lport, raddr, rport),
+                  ci_netif_active_wild_nic_hash(ni, laddr, 0, raddr, rport) ^
+                  ci_netif_active_wild_nic_hash_lport(lport));
+
   if( ci_netif_active_wild_nic_hash(ni, laddr, lport, raddr, rport)
       % ni->state->cluster_size == ni->state->rss_instance )
     return 1;
@@ -1650,16 +1775,16 @@ static int __ci_netif_active_wild_rss_ok(ci_netif* ni,
 #endif
 
 
-static int __ci_netif_active_wild_pool_select(ci_netif* ni, ci_addr_t laddr,
-                                              ci_addr_t raddr, ci_uint16 rport,
+/* [select_hash] is the RSS hash of the 3-tuple with a zero local port.  It
+ * is the same for every pool we try, so the caller computes it once.
+ */
+static int __ci_netif_active_wild_pool_select(ci_netif* ni,
+                                              ci_uint32 select_hash,
                                               int offset)
 {
   ci_uint32 pool_index = 0;
-  ci_uint32 select_hash;
 
   if( ni->state->active_wild_pools_n > 1 ) {
-    select_hash = ci_netif_active_wild_nic_hash(ni, laddr, 0, raddr, rport);
-
     ci_assert_equal(0, (offset & ~RSS_HASH_MASK));
 
     pool_index = select_hash ^ offset;
@@ -1827,14 +1952,17 @@ static oo_sp __ci_netif_active_wild_get(ci_netif* ni, ci_addr_t laddr,
   int aw_pool;
   int offset;
   oo_sp aw = OO_SP_NULL;
+  ci_uint32 select_hash = 0;
 
   ci_assert(ci_netif_is_locked(ni));
 
+  if( ni->state->active_wild_pools_n > 1 )
+    select_hash = ci_netif_active_wild_nic_hash(ni, laddr, 0, raddr, rport);
+
   for( offset = ni->state->rss_instance;
        offset < ni->state->active_wild_pools_n;
        offset += ni->state->cluster_size ) {
-    aw_pool = __ci_netif_active_wild_pool_select(ni, laddr, raddr, rport,
-                                                 offset);
+    aw_pool = __ci_netif_active_wild_pool_select(ni, select_hash, offset);
     aw = __ci_netif_active_wild_pool_get(ni, aw_pool, laddr, raddr, rport,
                                          port_out, prev_seq_out);
     if( aw != OO_SP_NULL )
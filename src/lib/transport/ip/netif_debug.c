@@ -313,15 +313,17 @@ static void ci_netif_dump_pkt_summary(ci_netif* ni, oo_dump_log_fn_t logger,
     }
   }
   used = ni->packets->n_pkts_allocated - ni->packets->n_free - ns->n_async_pkts;
-  rx_queued = ns->n_rx_pkts - rx_ring - ns->mem_pressure_pkt_pool_n;
+  rx_queued = ns->n_rx_pkts - rx_ring - ns->mem_pressure_pkt_pool_n -
+              ns->udp_fanout_pool_n;
 
   logger(log_arg, "  pkt_bufs: max=%d alloc=%d free=%d async=%d%s",
          ni->packets->sets_max * PKTS_PER_SET,
          ni->packets->n_pkts_allocated, ni->packets->n_free, ns->n_async_pkts,
          (ns->mem_pressure & OO_MEM_PRESSURE_CRITICAL) ? " CRITICAL":
          (ns->mem_pressure ? " LOW":""));
-  logger(log_arg, "  pkt_bufs: rx=%d rx_ring=%d rx_queued=%d pressure_pool=%d",
-         ns->n_rx_pkts, rx_ring, rx_queued, ns->mem_pressure_pkt_pool_n);
+  logger(log_arg, "  pkt_bufs: rx=%d rx_ring=%d rx_queued=%d pressure_pool=%d "
+         "udp_fanout_pool=%d", ns->n_rx_pkts, rx_ring, rx_queued,
+         ns->mem_pressure_pkt_pool_n, ns->udp_fanout_pool_n);
   logger(log_arg, "  pkt_bufs: tx=%d tx_ring=%d tx_oflow=%d",
          (used - ns->n_rx_pkts - ns->n_looppkts), tx_ring, tx_oflow);
   logger(log_arg, "  pkt_bufs: in_loopback=%d in_sock=%d", ns->n_looppkts,
@@ -585,6 +587,10 @@ void ci_netif_dump_extra_to_logger(ci_netif* ni, oo_dump_log_fn_t logger,
          ci_netif_pkt_tx_may_alloc(ni), ci_netif_pkt_tx_can_alloc_now(ni),
          ci_netif_pkt_nonb_pool_not_empty(ni),
          (int) ns->is_spinner, ns->n_spinners);
+  logger(log_arg, "  spin_adaptive_cycles=%"CI_PRIu64" misses=%u "
+         "int_adaptive_usec=%u quiet=%u", ns->spin_adaptive_cycles,
+         ns->spin_adaptive_misses, ns->int_adaptive_usec,
+         ns->int_adaptive_quiet);
   logger(log_arg, "  hwport_to_intf_i=%s intf_i_to_hwport=%s", hp2i, i2hp);
   logger(log_arg, "  uk_intf_ver=%s", OO_UK_INTF_VER);
   logger(log_arg, "  deferred count %d/%d", ns->defer_work_count, NI_OPTS(ni).defer_work_limit);
@@ -796,8 +802,9 @@ static void ci_netif_dump_vi(ci_netif* ni, int intf_i, oo_dump_log_fn_t logger,
   logger(log_arg, "  clk: %s%s",
          (nic->last_sync_flags & EF_VI_SYNC_FLAG_CLOCK_SET) ? "SET " : "",
          (nic->last_sync_flags & EF_VI_SYNC_FLAG_CLOCK_IN_SYNC) ? "SYNC" : "");
-  logger(log_arg, "  last_rx_stamp: %x:%x",
-         nic->last_rx_timestamp.tv_sec, nic->last_rx_timestamp.tv_nsec);
+  logger(log_arg, "  last_rx_stamp: %x:%x rx_drained_ns: %"CI_PRIu64,
+         nic->last_rx_timestamp.tv_sec, nic->last_rx_timestamp.tv_nsec,
+         nic->rx_drained_ns);
 #endif
 #if CI_CFG_CTPIO
   logger(log_arg, "  ctpio: max_frame_len=%u frame_len_check=%u ct_thresh=%u",
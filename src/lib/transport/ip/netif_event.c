@@ -333,11 +333,15 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
 
       get_rx_timestamp(netif, pkt);
 
-      if( oo_tcpdump_check(netif, pkt, pkt->intf_i) )
+      if( oo_tcpdump_check(netif, pkt, pkt->intf_i) ) {
+        ci_netif_pkt_efct_fill(netif, pkt);
         oo_tcpdump_dump_pkt(netif, pkt);
+      }
 
-      /* Demux to appropriate protocol. */
+      /* Demux to appropriate protocol.  UDP completes a deferred efct copy
+       * only once a socket accepts the datagram. */
       if( ip->ip_protocol == IPPROTO_TCP ) {
+        ci_netif_pkt_efct_fill(netif, pkt);
         ci_tcp_handle_rx(netif, ps, pkt, (ci_tcp_hdr*) payload, ip_paylen);
         CI_IPV4_STATS_INC_IN_DELIVERS( netif );
         return;
@@ -374,7 +378,7 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
     * we need to ignore those packets. */
     if( pkt->rx_flags & CI_PKT_RX_FLAG_RX_SHARED ) {
       CITP_STATS_NETIF_INC(netif, no_match_pass_to_kernel_ip_other);
-      ci_netif_pkt_release_rx_1ref(netif, pkt);
+      ci_netif_poll_pkt_release_rx(netif, ps, pkt);
       return;
     }
 
@@ -384,7 +388,7 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
     if( ci_netif_pkt_pass_to_kernel(netif, pkt) )
       CITP_STATS_NETIF_INC(netif, no_match_pass_to_kernel_ip_other);
     else
-      ci_netif_pkt_release_rx_1ref(netif, pkt);
+      ci_netif_poll_pkt_release_rx(netif, ps, pkt);
     return;
   }
 #if CI_CFG_IPV6
@@ -400,10 +404,13 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
 
     get_rx_timestamp(netif, pkt);
 
-    if( oo_tcpdump_check(netif, pkt, pkt->intf_i) )
+    if( oo_tcpdump_check(netif, pkt, pkt->intf_i) ) {
+      ci_netif_pkt_efct_fill(netif, pkt);
       oo_tcpdump_dump_pkt(netif, pkt);
+    }
 
     if( ip6_hdr->next_hdr == IPPROTO_TCP ) {
+      ci_netif_pkt_efct_fill(netif, pkt);
       ci_tcp_handle_rx(netif, ps, pkt, (ci_tcp_hdr*) payload,
                        CI_BSWAP_BE16(ip6_hdr->payload_len));
       CI_IP_STATS_INC_IN6_DELIVERS( netif );
@@ -423,14 +430,14 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
     * we need to ignore those packets. */
     if( pkt->rx_flags & CI_PKT_RX_FLAG_RX_SHARED ) {
       CITP_STATS_NETIF_INC(netif, no_match_pass_to_kernel_ip6_other);
-      ci_netif_pkt_release_rx_1ref(netif, pkt);
+      ci_netif_poll_pkt_release_rx(netif, ps, pkt);
       return;
     }
 
     if( ci_netif_pkt_pass_to_kernel(netif, pkt) )
       CITP_STATS_NETIF_INC(netif, no_match_pass_to_kernel_ip6_other);
     else
-      ci_netif_pkt_release_rx_1ref(netif, pkt);
+      ci_netif_poll_pkt_release_rx(netif, ps, pkt);
     return;
   }
 #endif
@@ -440,7 +447,7 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
   * we need to ignore those packets. */
   if( pkt->rx_flags & CI_PKT_RX_FLAG_RX_SHARED ) {
     CITP_STATS_NETIF_INC(netif, no_match_pass_to_kernel_non_ip);
-    ci_netif_pkt_release_rx_1ref(netif, pkt);
+    ci_netif_poll_pkt_release_rx(netif, ps, pkt);
     return;
   }
 
@@ -455,7 +462,7 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
     LOG_U(CI_RLLOG(10, LPF "UNEXPECTED ether_type "PKT_DBG_FMT,
                    PKT_DBG_ARGS(pkt)));
     LOG_DU(ci_hex_dump(ci_log_fn, PKT_START(pkt), 64, 0));
-    ci_netif_pkt_release_rx_1ref(netif, pkt);
+    ci_netif_poll_pkt_release_rx(netif, ps, pkt);
   }
   return;
 
@@ -463,7 +470,7 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
  drop:
   LOG_NR(log(LPF "DROP"));
   LOG_DR(ci_hex_dump(ci_log_fn, pkt, 40, 0));
-  ci_netif_pkt_release_rx_1ref(netif, pkt);
+  ci_netif_poll_pkt_release_rx(netif, ps, pkt);
   return;
 #endif
 }
@@ -519,6 +526,69 @@ static void copy_efct_to_pkt(ci_netif* netif, ef_vi* vi,
   get_efct_timestamp(netif, vi, pkt_id, pkt);
 }
 
+#ifndef __KERNEL__
+/* EF_EFCT_RX_COPY_ON_ACCEPT.  Enough of the frame to cover the Ethernet,
+ * VLAN, IP and UDP headers is copied up front.  The superbuf reference is kept
+ * until the packet has been handled: the rest of the payload is copied by
+ * ci_netif_pkt_efct_fill() when a socket accepts the packet, and not at all
+ * if the packet is dropped.
+ */
+#define EFCT_RX_DEFER_HDR_LEN  (2 * CI_CACHE_LINE_SIZE)
+
+static int copy_efct_hdrs_to_pkt(ci_netif* ni, ef_vi* vi,
+                                 uint32_t pkt_id, ci_ip_pkt_fmt* pkt)
+{
+  if( ! NI_OPTS(ni).efct_rx_copy_on_accept ||
+      pkt->pay_len <= EFCT_RX_DEFER_HDR_LEN )
+    return 0;
+
+  ci_assert(ni->efct_defer_vi == NULL);
+  memcpy(pkt->dma_start, efct_vi_rxpkt_get(vi, pkt_id),
+         EFCT_RX_DEFER_HDR_LEN);
+  get_efct_timestamp(ni, vi, pkt_id, pkt);
+  pkt->rx_flags |= CI_PKT_RX_FLAG_EFCT_DEFER;
+  ni->efct_defer_vi = vi;
+  ni->efct_defer_id = pkt_id;
+  ni->efct_defer_pkt = pkt;
+  return 1;
+}
+
+void __ci_netif_pkt_efct_fill(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+{
+  const char* payload;
+
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert_equal(pkt, ni->efct_defer_pkt);
+
+  payload = efct_vi_rxpkt_get(ni->efct_defer_vi, ni->efct_defer_id);
+  memcpy(pkt->dma_start + EFCT_RX_DEFER_HDR_LEN,
+         payload + EFCT_RX_DEFER_HDR_LEN,
+         pkt->pay_len - EFCT_RX_DEFER_HDR_LEN);
+  pkt->rx_flags &=~ CI_PKT_RX_FLAG_EFCT_DEFER;
+  ni->efct_defer_pkt = NULL;
+  CITP_STATS_NETIF_INC(ni, efct_rx_defer_fills);
+}
+
+/* Called once the deferred packet has been handled. */
+static void efct_defer_done(ci_netif* ni)
+{
+  ci_ip_pkt_fmt* pkt = ni->efct_defer_pkt;
+
+  if( pkt != NULL ) {
+    /* A packet that is still flagged was kept without a socket asking for
+     * its payload; complete it before the superbuf goes.  Otherwise it has
+     * been freed. */
+    if( pkt->rx_flags & CI_PKT_RX_FLAG_EFCT_DEFER )
+      __ci_netif_pkt_efct_fill(ni, pkt);
+    else
+      CITP_STATS_NETIF_INC(ni, efct_rx_defer_skips);
+    ni->efct_defer_pkt = NULL;
+  }
+  efct_vi_rxpkt_release(ni->efct_defer_vi, ni->efct_defer_id);
+  ni->efct_defer_vi = NULL;
+}
+#endif
+
 #ifdef __KERNEL__
 
 static unsigned convert_discard_flags_efct_ef10(unsigned flags)
@@ -722,6 +792,9 @@ ci_inline void __handle_rx_pkt(ci_netif* ni, struct ci_netif_poll_state* ps,
                                ci_ip_pkt_fmt** pkt)
 {
   if( *pkt ) {
+#ifndef __KERNEL__
+    int efct_defer = *pkt == ni->efct_defer_pkt;
+#endif
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
     if( ci_tcp_plugin_tcp_app_packet(*pkt) ) {
       handle_rx_plugin_data(ni, ps, *pkt);
@@ -732,6 +805,10 @@ ci_inline void __handle_rx_pkt(ci_netif* ni, struct ci_netif_poll_state* ps,
       ci_parse_rx_vlan(*pkt);
       handle_rx_pkt(ni, ps, *pkt);
     }
+#ifndef __KERNEL__
+    if( efct_defer )
+      efct_defer_done(ni);
+#endif
   }
 }
 
@@ -1424,7 +1501,7 @@ static void __handle_rx_discard(ci_netif* ni, struct ci_netif_poll_state* ps,
         oo_tcpdump_dump_pkt(ni, pkt);
     }
 
-    ci_netif_pkt_release_rx_1ref(ni, pkt);
+    ci_netif_poll_pkt_release_rx(ni, ps, pkt);
   }
 }
 
@@ -1866,6 +1943,10 @@ have_events:
           handle_rx_scatter(ni, &s, pkt,
                             EF_EVENT_RX_BYTES(ev[i]) - evq->rx_prefix_len,
                             ev[i].rx.flags);
+          /* AF_XDP may place continuation buffers at an offset too. */
+          if( evq->nic_type.arch == EF_VI_ARCH_AF_XDP &&
+              ! (ev[i].rx.flags & EF_EVENT_FLAG_SOP) )
+            oo_offbuf_init(&pkt->buf, PKT_START(pkt), pkt->buf_len);
         }
       }
 
@@ -1875,9 +1956,14 @@ have_events:
         pkt = alloc_rx_efct_pkt(ni, intf_i, pay_len);
         if( pkt ) {
           __handle_rx_pkt(ni, ps, &s.rx_pkt);
-          copy_efct_to_pkt(ni, evq, ev[i].rx_ref.pkt_id, pkt);
           oo_offbuf_init(&pkt->buf, pkt->dma_start, pay_len);
           s.rx_pkt = pkt;
+#ifndef __KERNEL__
+          /* The superbuf is released once the packet has been handled. */
+          if( copy_efct_hdrs_to_pkt(ni, evq, ev[i].rx_ref.pkt_id, pkt) )
+            continue;
+#endif
+          copy_efct_to_pkt(ni, evq, ev[i].rx_ref.pkt_id, pkt);
         }
         efct_vi_rxpkt_release(evq, ev[i].rx_ref.pkt_id);
       }
@@ -1997,6 +2083,10 @@ have_events:
 
       else if( EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_OFLOW ) {
         LOG_E(CI_RLLOG(1, LPF "***** EVENT QUEUE OVERFLOW *****"));
+#ifndef __KERNEL__
+        if( ni->efct_defer_vi != NULL )
+          efct_defer_done(ni);
+#endif
         return 0;
       }
 
@@ -2042,11 +2132,49 @@ have_events:
 }
 
 
+#if CI_CFG_TIMESTAMPING
+/* Latest hardware RX timestamp seen on any of the stack's interfaces. */
+static ci_uint64 ci_netif_latest_rx_ns(ci_netif* ni)
+{
+  ci_uint64 latest = 0, ns;
+  int intf_i;
+
+  OO_STACK_FOR_EACH_INTF_I(ni, intf_i) {
+    ns = ci_rx_stamp_ns(&ni->state->nic[intf_i].last_rx_timestamp);
+    if( ns > latest )
+      latest = ns;
+  }
+  return latest;
+}
+
+/* Called when [intf_i]'s event queue has been polled until empty.  Any
+ * packet still to arrive on it was received by the NIC after this poll
+ * started, and so will be stamped later than both the interface's own last
+ * packet and the latest one seen on any interface before the poll.
+ */
+static void ci_netif_rx_drained(ci_netif* ni, int intf_i,
+                                ci_uint64 latest_before_ns)
+{
+  ci_netif_state_nic_t* nsn = &ni->state->nic[intf_i];
+  ci_uint64 ns = ci_rx_stamp_ns(&nsn->last_rx_timestamp);
+
+  if( ns < latest_before_ns )
+    ns = latest_before_ns;
+  if( ns > nsn->rx_drained_ns )
+    CI_WRITE_ONCE(nsn->rx_drained_ns, ns);
+}
+#endif
+
+
 ci_inline int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
 {
   struct ci_netif_poll_state ps;
   int total_evs = 0;
   int rc;
+#if CI_CFG_TIMESTAMPING
+  ci_uint64 latest_before_ns = 0;
+  int track_drain;
+#endif
 
 #if defined(__KERNEL__) || ! defined(NDEBUG)
   if( ! ci_netif_may_poll_in_kernel(ni, intf_i) )
@@ -2054,8 +2182,12 @@ ci_inline int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
 #endif
 
   ci_assert(ci_netif_is_locked(ni));
-  ps.tx_pkt_free_list_insert = &ps.tx_pkt_free_list;
-  ps.tx_pkt_free_list_n = 0;
+  ci_netif_poll_state_init(&ps);
+#if CI_CFG_TIMESTAMPING
+  track_drain = ni->state->nic[intf_i].oo_vi_flags & OO_VI_FLAGS_RX_HW_TS_EN;
+  if( track_drain )
+    latest_before_ns = ci_netif_latest_rx_ns(ni);
+#endif
 
   do {
     rc = ci_netif_poll_evq(ni, &ps, intf_i, 0);
@@ -2067,8 +2199,16 @@ ci_inline int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
       break;
   } while( total_evs < max_evs );
 
+#if CI_CFG_TIMESTAMPING
+  if( track_drain && rc == 0 )
+    ci_netif_rx_drained(ni, intf_i, latest_before_ns);
+#endif
+
   if( ps.tx_pkt_free_list_n )
     ci_netif_poll_free_pkts(ni, &ps);
+  /* Before the refill, so that it reuses buffers that are still warm. */
+  if( ps.rx_pkt_free_list_n )
+    ci_netif_poll_free_rx_pkts(ni, &ps);
 
   /* The following steps probably aren't needed if we haven't handled any
    * events, but that is a rare case and so not worth testing for.
@@ -2156,8 +2296,7 @@ int ci_netif_poll_intf_future(ci_netif* ni, int intf_i, ci_uint64 start_frc)
   CITP_STATS_NETIF_INC(ni, rx_future);
   CITP_STATS_NETIF_INC(ni, rx_evs);
 
-  ps.tx_pkt_free_list_insert = &ps.tx_pkt_free_list;
-  ps.tx_pkt_free_list_n = 0;
+  ci_netif_poll_state_init(&ps);
 
   /* We expect the completion event within a microsecond or so. The timeout
    * of 10us is to avoid wedging the stack in the case of hardware
@@ -2236,6 +2375,8 @@ int ci_netif_poll_intf_future(ci_netif* ni, int intf_i, ci_uint64 start_frc)
   --ni->state->in_poll;
   if( ps.tx_pkt_free_list_n )
     ci_netif_poll_free_pkts(ni, &ps);
+  if( ps.rx_pkt_free_list_n )
+    ci_netif_poll_free_rx_pkts(ni, &ps);
   return rc;
 
 free_out:
@@ -85,6 +85,8 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
   assert_zero(nis->mem_pressure);
   nis->mem_pressure_pkt_pool = OO_PP_NULL;
   assert_zero(nis->mem_pressure_pkt_pool_n);
+  nis->udp_fanout_pool = OO_PP_NULL;
+  assert_zero(nis->udp_fanout_pool_n);
   nis->looppkts = OO_PP_NULL;
   nis->n_looppkts = 0;
 
@@ -162,6 +164,7 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
 
   nis->sock_spin_cycles =
             __oo_usec_to_cycles64(cpu_khz, NI_OPTS(ni).spin_usec);
+  nis->spin_adaptive_cycles = nis->sock_spin_cycles;
   nis->buzz_cycles =
             __oo_usec_to_cycles64(cpu_khz, NI_OPTS(ni).buzz_usec);
   nis->timer_prime_cycles =
@@ -969,6 +972,10 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->poll_on_demand = atoi(s);
   if( (s = getenv("EF_INT_REPRIME")) )
     opts->int_reprime = atoi(s);
+  if( (s = getenv("EF_INT_ADAPTIVE_USEC")) )
+    opts->int_adaptive_usec = atoi(s);
+  if( (s = getenv("EF_SPIN_ADAPTIVE")) )
+    opts->spin_adaptive = atoi(s);
   if( (s = getenv("EF_NONAGLE_INFLIGHT_MAX")) )
     opts->nonagle_inflight_max = atoi(s);
   if( (s = getenv("EF_FORCE_TCP_NODELAY")) )
@@ -1030,6 +1037,10 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->udp_sndbuf_user = atoi(s);
   if ( (s = getenv("EF_UDP_RCVBUF")) )
     opts->udp_rcvbuf_user = atoi(s);
+  if ( (s = getenv("EF_UDP_FANOUT_POOL")) )
+    opts->udp_fanout_pool = atoi(s);
+  if ( (s = getenv("EF_EFCT_RX_COPY_ON_ACCEPT")) )
+    opts->efct_rx_copy_on_accept = atoi(s);
 
   if( (s = getenv("EF_TCP_SNDBUF_ESTABLISHED_DEFAULT")) )
     opts->tcp_sndbuf_est_def = atoi(s);
@@ -1152,6 +1163,10 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
   if ( (s = getenv("EF_TAIL_DROP_PROBE")))
     opts->tail_drop_probe = atoi(s);
 #endif
+#if CI_CFG_TCP_RACK
+  if ( (s = getenv("EF_TCP_RACK")))
+    opts->tcp_rack = atoi(s);
+#endif
 #if CI_CFG_CONG_AVOID_SCALE_BACK
   if ( (s = getenv("EF_CONG_AVOID_SCALE_BACK")))
     opts->cong_avoid_scale_back = atoi(s);
@@ -1168,6 +1183,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->free_packets_low = atoi(s);
   if( opts->free_packets_low == 0 )
     opts->free_packets_low = opts->rxq_size / 2;
+  if ( (s = getenv("EF_PKT_ALLOC_BACKGROUND")) )
+    opts->pkt_alloc_background = atoi(s);
 
 #if CI_CFG_PIO
   if ( (s = getenv("EF_PIO")) )
@@ -1309,6 +1326,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
 
   if( (s = getenv("EF_AF_XDP_ZEROCOPY")) )
     opts->af_xdp_zerocopy = atoi(s);
+  if( (s = getenv("EF_AF_XDP_BUSY_POLL")) )
+    opts->af_xdp_busy_poll = atoi(s);
 
   if( (s = getenv("EF_ICMP_PKTS")) )
     opts->icmp_msg_max = atoi(s);
@@ -2215,6 +2234,9 @@ static int netif_tcp_helper_build(ci_netif* ni)
     vi = ci_netif_vi(ni, nic_i);
     vi->xdp_kick = af_xdp_kick;
     vi->xdp_kick_context = ni;
+    if( vi->nic_type.arch == EF_VI_ARCH_AF_XDP &&
+        NI_OPTS(ni).af_xdp_busy_poll )
+      ni->flags |= CI_NETIF_FLAGS_AF_XDP_BUSY_POLL;
 
     ci_assert_equal(vi_state_bytes, ns->vi_state_bytes);
 
@@ -2775,6 +2797,8 @@ static int ci_netif_init(ci_netif* ni, ef_driver_handle fd)
   ni->flags = 0;
   ni->error_flags = 0;
   ni->cplane_init_net = NULL;
+  ni->efct_defer_vi = NULL;
+  ni->efct_defer_pkt = NULL;
 
   ni->cplane = malloc(sizeof(struct oo_cplane_handle));
   if( ni->cplane == NULL )
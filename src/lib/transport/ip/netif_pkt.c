@@ -271,6 +271,20 @@ void ci_netif_pkt_free(ci_netif* ni, ci_ip_pkt_fmt* pkt
   }
 #endif
 
+  if( (pkt->rx_flags & CI_PKT_RX_FLAG_UDP_FANOUT) &&
+      (~pkt->flags & CI_PKT_FLAG_NONB_POOL) &&
+      ni->state->udp_fanout_pool_n < NI_OPTS(ni).udp_fanout_pool ) {
+    /* Keep the node for the next fan-out.  It stays accounted in
+     * [n_rx_pkts]. */
+    ci_assert(ci_netif_is_locked(ni));
+    __ci_netif_pkt_clean(pkt);
+    pkt->flags |= CI_PKT_FLAG_RX;
+    pkt->next = ni->state->udp_fanout_pool;
+    ni->state->udp_fanout_pool = OO_PKT_P(pkt);
+    ++ni->state->udp_fanout_pool_n;
+    return;
+  }
+
   if( pkt->flags & CI_PKT_FLAG_RX )
     CI_NETIF_STATE_MOD(ni, *p_netif_is_locked, n_rx_pkts, -);
   __ci_netif_pkt_clean(pkt);
@@ -1387,7 +1387,8 @@ complete_deferred_bind(ci_netif* netif, ci_sock_cmn* s, ci_fd_t fd)
 
 
 static int
-ci_tcp_retrieve_addr(ci_netif* netif, const struct sockaddr* serv_addr,
+ci_tcp_retrieve_addr(ci_netif* netif, ci_sock_cmn* s,
+                     const struct sockaddr* serv_addr,
                      ci_addr_t* dst_addr, ci_uint16* dst_port)
 {
   /* Address family is validated to be AF_INET or AF_INET6 earlier. */
@@ -1399,7 +1400,14 @@ ci_tcp_retrieve_addr(ci_netif* netif, const struct sockaddr* serv_addr,
   /* Only perform DNAT off of init_net */
   if( netif->cplane_init_net != NULL ) {
     ci_addr_sh_t dnat_addr = CI_ADDR_SH_FROM_ADDR(*dst_addr);
-    rc = cp_svc_check_dnat(netif->cplane_init_net, &dnat_addr, dst_port);
+    /* An unbound socket gets its local port only after this, so until then
+     * the socket stands in for it in identifying the flow. */
+    ci_uint16 lport = sock_lport_be16(s);
+    ci_uint32 flow_hash = onload_hash3(sock_ipx_laddr(s),
+                                       lport ? lport : SC_ID(s),
+                                       *dst_addr, *dst_port, IPPROTO_TCP);
+    rc = cp_svc_check_dnat(netif->cplane_init_net, &dnat_addr, dst_port,
+                           flow_hash);
     *dst_addr = CI_ADDR_FROM_ADDR_SH(dnat_addr);
   }
   return rc;
@@ -1507,7 +1515,7 @@ int ci_tcp_connect(citp_socket* ep, const struct sockaddr* serv_addr,
     /* Af first, check that address family and length is OK. */
     ci_tcp_validate_sa(s->domain, serv_addr, addrlen)
     /* Check for NAT. */
-    || (dnat = ci_tcp_retrieve_addr(ep->netif, serv_addr, &dst_addr,
+    || (dnat = ci_tcp_retrieve_addr(ep->netif, s, serv_addr, &dst_addr,
                                     &dst_port)) < 0
     /* rfc793 p54 if the foreign socket is unspecified return          */
     /* "error: foreign socket unspecified" (EINVAL), but keep it to OS */
@@ -124,8 +124,8 @@ static void ci_tcp_state_retrans_assert_valid(ci_netif* ni, ci_tcp_state* ts,
 {
   ci_ip_pkt_queue* rtq = &ts->retrans;
   ci_ip_pkt_fmt *pkt = NULL, *end, *prev_pkt;
-  int num = 0, is_sacked = 0;
-  oo_pkt_p id;
+  int num = 0, sacked = 0, is_sacked = 0;
+  oo_pkt_p id, sack_hint = OO_PP_NULL;
 
   id = rtq->head;
   prev_pkt = 0;
@@ -142,6 +142,8 @@ static void ci_tcp_state_retrans_assert_valid(ci_netif* ni, ci_tcp_state* ts,
 
     verify(IS_VALID_PKT_ID(ni, pkt->pf.tcp_tx.block_end));
     end = PKT(ni, pkt->pf.tcp_tx.block_end);
+    if( is_sacked )
+      sack_hint = id;
 
     while( 1 ) {
       if( prev_pkt )
@@ -151,6 +153,7 @@ static void ci_tcp_state_retrans_assert_valid(ci_netif* ni, ci_tcp_state* ts,
       else             verify(~pkt->flags & CI_PKT_FLAG_RTQ_SACKED);
       prev_pkt = pkt;
       ++num;
+      sacked += is_sacked;
       if( pkt == end )  break;
       verify(IS_VALID_PKT_ID(ni, pkt->next));
       pkt = PKT_CHK(ni, pkt->next);
@@ -179,6 +182,8 @@ static void ci_tcp_state_retrans_assert_valid(ci_netif* ni, ci_tcp_state* ts,
  done:
   verify( ! pkt || OO_PP_EQ(OO_PKT_P(pkt), rtq->tail));
   verify(num == rtq->num);
+  verify(sacked == ts->sacked_pkts);
+  verify(OO_PP_EQ(sack_hint, ts->sack_hint));
 }
 
 
@@ -414,16 +419,18 @@ void ci_tcp_state_assert_valid(ci_netif* netif, ci_tcp_state* ts,
   verify(ts->s.b.state <= CI_TCP_TIME_WAIT);
   ci_assert(ts->s.pkt.ipx.ip4.ip_protocol == IPPROTO_TCP);
 
-# define chk(x)                                         \
-  verify(!ci_ip_timer_pending(netif, &ts->x) ||         \
-         (~ts->s.b.state & CI_TCP_STATE_NO_TIMERS) ||   \
-         (ts->s.b.state == CI_TCP_LISTEN &&             \
-          (ts->s.s_flags & CI_SOCK_FLAG_BOUND_ALIEN)))
-  chk(rto_tid);
-  chk(delack_tid);
-  chk(zwin_tid);
-  chk(kalive_tid);
-# undef chk
+  verify(ts->timers_pending == 0 ||
+         (~ts->s.b.state & CI_TCP_STATE_NO_TIMERS) ||
+         (ts->s.b.state == CI_TCP_LISTEN &&
+          (ts->s.s_flags & CI_SOCK_FLAG_BOUND_ALIEN)));
+  /* The wheel entry is never later than the earliest deadline. */
+  if( ts->timers_pending != 0 ) {
+    int i;
+    verify(ci_ip_timer_pending(netif, &ts->tcp_tid));
+    for( i = 0; i < CI_TCP_TIMER_N; ++i )
+      verify(! ci_tcp_timer_pending(ts, i) ||
+             TIME_LE(ts->tcp_tid.time, ts->timer_time[i]));
+  }
 
   verify(SEQ_LE(tcp_snd_una(ts), tcp_snd_nxt(ts)));
   /* NB. Window can shrink, so the following is not a valid test: */
@@ -805,6 +812,13 @@ void ci_tcp_state_dump(ci_netif* ni, ci_tcp_state* ts,
   if( ts->tcpflags & CI_TCPT_FLAG_TAIL_DROP_MARKED )
     logger(log_arg, "%s  snd: tail loss probe at %x", pf, ts->taildrop_mark);
 #endif
+#if CI_CFG_TCP_RACK
+  if( ts->rack.min_rtt_us )
+    logger(log_arg, "%s  snd: rack end=%x fack=%x lost=%x rtt=%uus "
+           "min_rtt=%uus reo_mult=%u%s", pf, ts->rack.end_seq, ts->rack.fack,
+           ts->rack.lost_end, ts->rack.rtt_us, ts->rack.min_rtt_us,
+           ts->rack.reo_wnd_mult, ts->rack.reordering_seen ? " REORDER":"");
+#endif
 
   logger(log_arg, "%s  rcv: nxt-max=%08x-%08x wnd adv=%d cur=%d %s%s", pf,
          tcp_rcv_nxt(ts), tcp_rcv_wnd_right_edge_sent(ts),
@@ -852,31 +866,36 @@ void ci_tcp_state_dump(ci_netif* ni, ci_tcp_state* ts,
     logger(log_arg, "%s  nvme_plugin: last_id=%u", pf, ts->current_crc_id);
 #endif
 #ifndef __KERNEL__
-# define fmt_timer(_b, _l, _n, name, tid)                       \
-  if( ci_ip_timer_pending(ni, &tid) )                           \
+# define fmt_timer(_b, _l, _n, name, pending, time)             \
+  if( pending )                                                 \
     _n = line_fmt_timer(_b, _l, _n, #name"(%ums[%x]) ",         \
-                        ci_ip_time_ticks2ms(ni, tid.time-now),  \
-                        tid.time,                               \
+                        ci_ip_time_ticks2ms(ni, (time)-now),    \
+                        (time),                                 \
                         logger, log_arg)
 #else
-# define fmt_timer(_b, _l, _n, name, tid)                   \
-  if( ci_ip_timer_pending(ni, &tid) )                       \
+# define fmt_timer(_b, _l, _n, name, pending, time)         \
+  if( pending )                                             \
     _n = line_fmt_timer(_b, _l, _n,  #name"(%uticks[%x]) ", \
-                        tid.time-now, tid.time,             \
+                        (time)-now, (time),                 \
                         ci_log_dump_fn, NULL)
 #endif
+#define fmt_tcp_timer(_b, _l, _n, name, timer)                  \
+  fmt_timer(_b, _l, _n, name, ci_tcp_timer_pending(ts, timer),  \
+            ts->timer_time[timer])
 
   logger(log_arg, "%s  timers: ", pf);
   n = 0;
   buf[0] = '\0';
-  fmt_timer(buf, LINE_LEN, n, rto, ts->rto_tid);
-  fmt_timer(buf, LINE_LEN, n, delack, ts->delack_tid);
-  fmt_timer(buf, LINE_LEN, n, zwin, ts->zwin_tid);
-  fmt_timer(buf, LINE_LEN, n, kalive, ts->kalive_tid);
+  fmt_tcp_timer(buf, LINE_LEN, n, rto, CI_TCP_TIMER_RTO);
+  fmt_tcp_timer(buf, LINE_LEN, n, delack, CI_TCP_TIMER_DELACK);
+  fmt_tcp_timer(buf, LINE_LEN, n, zwin, CI_TCP_TIMER_ZWIN);
+  fmt_tcp_timer(buf, LINE_LEN, n, kalive, CI_TCP_TIMER_KALIVE);
   if( OO_PP_NOT_NULL(ts->pmtus) ) {
     ci_pmtu_state_t* pmtus = ci_ni_aux_p2pmtus(ni, ts->pmtus);
-    fmt_timer(buf, LINE_LEN, n, pmtu, pmtus->tid);
+    fmt_timer(buf, LINE_LEN, n, pmtu, ci_ip_timer_pending(ni, &pmtus->tid),
+              pmtus->tid.time);
   }
+#undef fmt_tcp_timer
 #undef fmt_timer
   logger(log_arg, "%s", buf);
   if( OO_PP_NOT_NULL(ts->pmtus) ) {
@@ -36,16 +36,14 @@ static void ci_tcp_state_setup_timers(ci_netif* ni, ci_tcp_state* ts)
     ci_ip_timer_init(ni, &ts->name##_tid, sp, label);           \
   } while(0)
 
-  ci_tcp_setup_timer(rto,      CI_IP_TIMER_TCP_RTO,    "rtot");
-  ci_tcp_setup_timer(delack,   CI_IP_TIMER_TCP_DELACK, "dela");
-  ci_tcp_setup_timer(zwin,     CI_IP_TIMER_TCP_ZWIN,   "zwin");
-  ci_tcp_setup_timer(kalive,   CI_IP_TIMER_TCP_KALIVE, "kalv");
+  ci_tcp_setup_timer(tcp,      CI_IP_TIMER_TCP_MUX,    "tcpt");
 #if CI_CFG_TCP_SOCK_STATS
   ci_tcp_setup_timer(stats,    CI_IP_TIMER_TCP_STATS,  "stat");
 #endif
   ci_tcp_setup_timer(cork,     CI_IP_TIMER_TCP_CORK,   "cork");
 
 #undef ci_tcp_setup_timer
+  ts->timers_pending = 0;
 }
 
 
@@ -72,6 +70,8 @@ static void ci_tcp_state_connected_opts_init(ci_netif* netif, ci_tcp_state* ts)
   ci_ip_queue_init(&ts->send);
   /* Retransmit queue is limited by peer window. */
   ci_ip_queue_init(&ts->retrans);
+  ts->sack_hint = OO_PP_NULL;
+  ts->sacked_pkts = 0;
   for(i = 0; i <= CI_TCP_SACK_MAX_BLOCKS; i++ )
       ts->last_sack[i] = OO_PP_NULL;
   ts->dsack_block = OO_PP_INVALID;
@@ -135,6 +135,10 @@ void ci_tcp_state_tcb_reinit_minimal(ci_netif* netif, ci_tcp_state* ts)
   ts->cwnd_extra = 0;
   ts->dup_acks = 0;
   ts->bytes_acked = 0;
+#if CI_CFG_TCP_RACK
+  memset(&ts->rack, 0, sizeof(ts->rack));
+  ts->rack.reo_wnd_mult = 1;
+#endif
 
   /* ts->eff_mss is not cleared as might be used without lock on send path */
   ts->ssthresh = 0;
@@ -183,10 +183,8 @@ const char* ci_tcp_congstate_str(unsigned s)
 void ci_tcp_state_verify_no_timers(ci_netif *ni, ci_tcp_state *ts)
 {
 # define chk(x) ci_assert(!ci_ip_timer_pending(ni, &ts->x))
-  chk(rto_tid);
-  chk(delack_tid);
-  chk(zwin_tid);
-  chk(kalive_tid);
+  ci_assert_equal(ts->timers_pending, 0);
+  chk(tcp_tid);
   chk(cork_tid);
 #if CI_CFG_TCP_SOCK_STATS
   chk(stats_tid);
@@ -569,10 +567,8 @@ static void ci_ip_timer_clear_ool(ci_netif* netif, ci_ip_timer* tmr)
 
 void ci_tcp_stop_timers(ci_netif* netif, ci_tcp_state* ts)
 {
-  ci_ip_timer_clear_ool(netif, &ts->rto_tid);
-  ci_ip_timer_clear_ool(netif, &ts->delack_tid);
-  ci_ip_timer_clear_ool(netif, &ts->zwin_tid);
-  ci_ip_timer_clear_ool(netif, &ts->kalive_tid);
+  ts->timers_pending = 0;
+  ci_ip_timer_clear_ool(netif, &ts->tcp_tid);
   ci_ip_timer_clear_ool(netif, &ts->cork_tid);
   if( OO_PP_NOT_NULL(ts->pmtus) ) {
     ci_pmtu_state_t* pmtus = ci_ni_aux_p2pmtus(netif, ts->pmtus);
@@ -910,6 +906,8 @@ void ci_tcp_clear_sacks(ci_netif* ni, ci_tcp_state* ts)
 
   ts->retrans_seq = tcp_snd_una(ts);
   ts->retrans_ptr = rtq->head;
+  ts->sack_hint = OO_PP_NULL;
+  ts->sacked_pkts = 0;
 }
 
 
@@ -924,16 +922,9 @@ void ci_tcp_retrans_init_ptrs(ci_netif* ni, ci_tcp_state* ts,
   ts->retrans_ptr = rtq->head;
   ts->retrans_seq = pkt->pf.tcp_tx.start_seq;
 
-  while( 1 ) {
-    if( pkt->flags & CI_PKT_FLAG_RTQ_SACKED ) {
-      /* Skip the SACK block. */
-      *recover_seq_out = pkt->pf.tcp_tx.start_seq;
-      pkt = PKT_CHK(ni, pkt->pf.tcp_tx.block_end);
-    }
-
-    if( OO_PP_IS_NULL(pkt->next) )  break;
-    pkt = PKT_CHK(ni, pkt->next);
-  }
+  /* Recovery ends at the start of the highest SACK block. */
+  if( OO_PP_NOT_NULL(ts->sack_hint) )
+    *recover_seq_out = PKT_CHK(ni, ts->sack_hint)->pf.tcp_tx.start_seq;
 }
 
 
@@ -992,6 +983,14 @@ void ci_tcp_get_fack(ci_netif* ni, ci_tcp_state* ts,
       else
         retrans_data += SEQ_SUB(ts->retrans_seq, block->pf.tcp_tx.start_seq);
     }
+    else if( OO_PP_NOT_NULL(ts->sack_hint) ) {
+      /* Nothing from here on has been retransmitted, so all that's left
+      ** is the end of the highest SACK block.
+      */
+      block = PKT_CHK(ni, ts->sack_hint);
+      fack = PKT_CHK(ni, block->pf.tcp_tx.block_end)->pf.tcp_tx.end_seq;
+      break;
+    }
 
     if( OO_PP_IS_NULL(end->next) )  break;
     block = PKT_CHK(ni, end->next);
@@ -1027,6 +1026,11 @@ void ci_tcp_recovered(ci_netif* ni, ci_tcp_state* ts)
 
   /* If we get here, we've recovered. */
 
+#if CI_CFG_TCP_RACK
+  if( ts->rack.reo_wnd_persist != 0 && --ts->rack.reo_wnd_persist == 0 )
+    ts->rack.reo_wnd_mult = 1;
+#endif
+
   ts->congstate = CI_TCP_CONG_OPEN;
   ts->cwnd_extra = 0;
   ts->dup_acks = 0;
@@ -657,6 +657,7 @@ static int ci_tcp_recvmsg_spin(ci_netif* ni, ci_tcp_state* ts,
       spin_limit_by_so = 1;
     }
   }
+  max_spin = ci_netif_spin_adaptive_cap(ni, max_spin, &spin_limit_by_so);
 
   now_frc = start_frc;
 
@@ -754,6 +755,7 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
   ci_uint64             start_frc = 0; /* suppress compiler warning */
 #ifndef __KERNEL__
   unsigned              tcp_recv_spin = 0;
+  int                   spin_missed = 0;
 #endif
   ci_uint32             timeout = ts->s.so.rcvtimeo_msec;
   struct tcp_recv_info  rinf;
@@ -901,12 +903,17 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
         rinf.rc = rc2;
         goto unlock_out;
       }
+      if( NI_OPTS(ni).spin_adaptive )
+        ci_netif_spin_adaptive_update(ni, &ts->s.b,
+                                      ci_frc64_get() - start_frc);
       goto poll_recv_queue;
     }
 
     tcp_recv_spin = 0;
+    spin_missed = NI_OPTS(ni).spin_adaptive;
     if( timeout ) {
-      ci_uint32 spin_ms = NI_OPTS(ni).spin_usec >> 10;
+      ci_uint32 spin_ms = (ci_frc64_get() - start_frc) /
+                          IPTIMER_STATE(ni)->khz;
       if( spin_ms < timeout )
         timeout -= spin_ms;
       else {
@@ -938,6 +945,13 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
     rc2 = ci_sock_sleep(ni, &ts->s.b, CI_SB_FLAG_WAKE_RX,
                         CI_SLEEP_SOCK_LOCKED | CI_SLEEP_SOCK_RQ,
                         sleep_seq, &timeout);
+#ifndef __KERNEL__
+    /* Let the adaptive spin budget learn how long this wait really was. */
+    if( rc2 == 0 && spin_missed ) {
+      ci_netif_spin_adaptive_update(ni, &ts->s.b, ci_frc64_get() - start_frc);
+      spin_missed = 0;
+    }
+#endif
     if( rc2 == 0 )
       rc2 = ci_sock_lock(ni, &ts->s.b);
     if( rc2 < 0 ) {
@@ -782,6 +782,48 @@ static void ci_tcp_reset_cwnd_on_loss(ci_netif* ni, ci_tcp_state* ts)
 }
 
 
+/* Enters fast recovery, once the caller has decided that there has been
+ * loss. */
+static void ci_tcp_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_assert(ci_ip_queue_not_empty(&ts->retrans));
+
+  ++ts->stats.fast_recovers;
+  ci_tcp_reset_cwnd_on_loss(ni, ts);
+
+  ts->congrecover = tcp_snd_nxt(ts);
+  ci_tcp_retrans_init_ptrs(ni, ts, &ts->congrecover);
+  if(!SEQ_LE(ts->congrecover, tcp_snd_nxt(ts)))
+    LOG_U(log("About to assert on congrecover: %u, %u",
+              ts->congrecover, tcp_snd_nxt(ts)));
+  ci_assert(SEQ_LE(ts->congrecover, tcp_snd_nxt(ts)));
+
+  LOG_TL(log(LNT_FMT "%s => FastRecovery dups=%d "TCP_SND_FMT,
+             LNT_PRI_ARGS(ni, ts), congstate_str(ts), ts->dup_acks,
+             TCP_SND_PRI_ARG(ts));
+         log(LNT_FMT "  "TCP_CONG_FMT,
+             LNT_PRI_ARGS(ni, ts), TCP_CONG_PRI_ARG(ts)));
+
+  ts->congstate = CI_TCP_CONG_FAST_RECOV;
+
+  if( ts->tcpflags & CI_TCPT_FLAG_SACK )
+    ci_tcp_retrans_recover(ni, ts, 1);
+  else
+    ci_tcp_retrans_one(ts, ni, PKT_CHK(ni, ts->retrans.head));
+
+  /* ?? Before or after retransmits?  Not sure. */
+  ci_tcp_clear_rtt_timing(ts);
+  /* Fast recovery => no TLP timer, force RTO */
+  ci_tcp_rto_restart(ni, ts);
+
+  CI_IP_SOCK_STATS_INC_DUPACKFREC( ts );
+  if( ts->tcpflags & CI_TCPT_FLAG_SACK )
+    CI_TCP_EXT_STATS_INC_TCP_SACK_RECOVERY( ni );
+  else
+    CI_TCP_EXT_STATS_INC_TCP_RENO_RECOVERY( ni );
+}
+
+
 /* Enters fast recovery if we've received enough dupacks.  Returns non-zero
  * iff we enter fast recovery. */
 int /*bool*/ ci_tcp_maybe_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts)
@@ -839,44 +881,12 @@ int /*bool*/ ci_tcp_maybe_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts)
     return 0;
   }
 
-  ++ts->stats.fast_recovers;
-  ci_tcp_reset_cwnd_on_loss(ni, ts);
-
-  ts->congrecover = tcp_snd_nxt(ts);
-  ci_tcp_retrans_init_ptrs(ni, ts, &ts->congrecover);
-  if(!SEQ_LE(ts->congrecover, tcp_snd_nxt(ts)))
-    LOG_U(log("About to assert on congrecover: %u, %u",
-              ts->congrecover, tcp_snd_nxt(ts)));
-  ci_assert(SEQ_LE(ts->congrecover, tcp_snd_nxt(ts)));
-
-  LOG_TL(log(LNT_FMT "%s => FastRecovery dups=%d "TCP_SND_FMT,
-             LNT_PRI_ARGS(ni, ts), congstate_str(ts), ts->dup_acks,
-             TCP_SND_PRI_ARG(ts));
-         log(LNT_FMT "  "TCP_CONG_FMT,
-             LNT_PRI_ARGS(ni, ts), TCP_CONG_PRI_ARG(ts)));
-
-  ts->congstate = CI_TCP_CONG_FAST_RECOV;
-
-  if( ts->tcpflags & CI_TCPT_FLAG_SACK )
-    ci_tcp_retrans_recover(ni, ts, 1);
-  else
-    ci_tcp_retrans_one(ts, ni, PKT_CHK(ni, ts->retrans.head));
-
-  /* ?? Before or after retransmits?  Not sure. */
-  ci_tcp_clear_rtt_timing(ts);
-  /* Fast recovery => no TLP timer, force RTO */
-  ci_tcp_rto_restart(ni, ts);
-
-  CI_IP_SOCK_STATS_INC_DUPACKFREC( ts );
-  if( ts->tcpflags & CI_TCPT_FLAG_SACK )
-    CI_TCP_EXT_STATS_INC_TCP_SACK_RECOVERY( ni );
-  else
-    CI_TCP_EXT_STATS_INC_TCP_RENO_RECOVERY( ni );
-
+  ci_tcp_enter_fast_recovery(ni, ts);
   return 1;
 }
 
 
+
 static void ci_tcp_cwnd_extra_update(ci_netif* netif, ci_tcp_state* ts)
 {
   unsigned fack;
@@ -915,7 +925,8 @@ static void ci_tcp_rx_dupack(ci_tcp_state* ts, ci_netif* netif,
              LNT_PRI_ARGS(netif, ts), ts->dup_acks, TCP_SND_PRI_ARG(ts));
          log(LNT_FMT "  %s cwnd=%i crecover=%08x now-rto_to=%u rto=%u",
              LNT_PRI_ARGS(netif, ts), congstate_str(ts), ts->cwnd,
-             ts->congrecover, ci_tcp_time_now(netif) - ts->rto_tid.time,
+             ts->congrecover,
+             ci_tcp_time_now(netif) - ts->timer_time[CI_TCP_TIMER_RTO],
              ts->rto));
   CI_IP_SOCK_STATS_INC_DUPACK( ts );
 
@@ -932,8 +943,12 @@ static void ci_tcp_rx_dupack(ci_tcp_state* ts, ci_netif* netif,
 
   if( (ts->congstate == CI_TCP_CONG_OPEN)
       | (ts->congstate == CI_TCP_CONG_NOTIFIED) ) {
-    /* Goto fast recovery if we've received enough dupacks. */
-    ci_tcp_maybe_enter_fast_recovery(netif, ts);
+    /* Goto fast recovery if we've received enough dupacks.  With RACK the
+     * decision is made by ci_tcp_rack_detect_and_recover() instead. */
+#if CI_CFG_TCP_RACK
+    if( ! ci_tcp_rack_enabled(netif, ts) )
+#endif
+      ci_tcp_maybe_enter_fast_recovery(netif, ts);
   }
   else if( ts->congstate == CI_TCP_CONG_FAST_RECOV ) {
     if( !(ts->tcpflags & CI_TCPT_FLAG_SACK) ) {
@@ -1033,11 +1048,255 @@ static void ci_tcp_try_cwndrecover(ci_tcp_state* ts, ci_netif* netif,
   ci_tcp_retrans_recover(netif, ts, 0);
 }
 
+#if CI_CFG_TCP_RACK
+/* RACK times are kept in units of ci_ip_time_frc2us, i.e. roughly in
+ * microseconds. */
+#define CI_TCP_RACK_FRC2US(ni, frc) \
+  ((ci_uint32) ((frc) >> IPTIMER_STATE(ni)->ci_ip_time_frc2us))
+
+/* Upper bound on the DSACK-driven scaling of the reordering window, and the
+ * number of recoveries over which a scaled window persists. */
+#define CI_TCP_RACK_REO_WND_MULT_MAX  8
+#define CI_TCP_RACK_REO_WND_PERSIST   16
+
+/* Updates RACK state (RFC 8985 6.2 step 2 and 3) from a packet that has
+ * just been cumulatively or selectively acknowledged. */
+static void ci_tcp_rack_update(ci_netif* ni, ci_tcp_state* ts,
+                               ci_ip_pkt_fmt* pkt)
+{
+  ci_uint64 now;
+  ci_uint32 rtt_us;
+
+  ci_frc64(&now);
+  if( pkt->pf.tcp_tx.xmit_frc == 0 || now < pkt->pf.tcp_tx.xmit_frc )
+    return;
+  rtt_us = CI_TCP_RACK_FRC2US(ni, now - pkt->pf.tcp_tx.xmit_frc);
+
+  /* This may be the ACK of the original transmission of a segment that we
+   * have since retransmitted; then the RTT is implausibly short. */
+  if( (pkt->flags & CI_PKT_FLAG_RTQ_RETRANS) &&
+      rtt_us < ts->rack.min_rtt_us )
+    return;
+
+  if( ts->rack.xmit_frc == 0 )
+    ts->rack.fack = ts->rack.lost_end = tcp_snd_una(ts);
+  if( ts->rack.min_rtt_us == 0 || rtt_us < ts->rack.min_rtt_us )
+    ts->rack.min_rtt_us = CI_MAX(rtt_us, 1);
+
+  if( SEQ_LT(ts->rack.fack, pkt->pf.tcp_tx.end_seq) ) {
+    ts->rack.fack = pkt->pf.tcp_tx.end_seq;
+  }
+  else if( ! (pkt->flags & CI_PKT_FLAG_RTQ_RETRANS) &&
+           ! ts->rack.reordering_seen ) {
+    /* An original transmission was delivered below a segment delivered
+     * earlier. */
+    ts->rack.reordering_seen = 1;
+    CITP_STATS_NETIF_INC(ni, tcp_rack_reordering_seen);
+  }
+
+  if( pkt->pf.tcp_tx.xmit_frc > ts->rack.xmit_frc ||
+      (pkt->pf.tcp_tx.xmit_frc == ts->rack.xmit_frc &&
+       SEQ_GT(pkt->pf.tcp_tx.end_seq, ts->rack.end_seq)) ) {
+    ts->rack.xmit_frc = pkt->pf.tcp_tx.xmit_frc;
+    ts->rack.end_seq = pkt->pf.tcp_tx.end_seq;
+    ts->rack.rtt_us = rtt_us;
+    ts->rack.advanced = 1;
+  }
+}
+
+
+/* Returns the reordering window, RFC 8985 6.2 step 4. */
+static ci_uint32 ci_tcp_rack_reo_wnd(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_ip_timer_state* its = IPTIMER_STATE(ni);
+  ci_uint32 reo_wnd, srtt_us;
+
+  /* Without evidence of reordering, go on the classic signals of loss:
+   * we're already recovering, or have seen DupThresh duplicate ACKs. */
+  if( ! ts->rack.reordering_seen &&
+      (ts->congstate == CI_TCP_CONG_FAST_RECOV ||
+       ts->congstate == CI_TCP_CONG_COOLING ||
+       ts->dup_acks >= ci_tcp_base_dupack_thresh(ts)) )
+    return 0;
+
+  reo_wnd = ts->rack.reo_wnd_mult * (ts->rack.min_rtt_us >> 2);
+  if( ts->sa != 0 ) {
+    srtt_us = (ci_uint32) (((ci_uint64) tcp_srtt(ts) <<
+                            its->ci_ip_time_frc2tick) >>
+                           its->ci_ip_time_frc2us);
+    reo_wnd = CI_MIN(reo_wnd, srtt_us);
+  }
+  return reo_wnd;
+}
+
+
+/* Walks the retransmit queue looking for segments that were sent before the
+ * RACK segment and have not been delivered within its RTT plus the
+ * reordering window (RFC 8985 6.2 step 5).  Advances [rack.lost_end] over
+ * newly lost segments.  A lost segment that has already been retransmitted
+ * in the current recovery is returned in [*rewind_out].  [*timeout_us] is
+ * set to the time until the next segment would be deemed lost, or zero.
+ *
+ * Returns the number of segments newly deemed lost.
+ */
+static int ci_tcp_rack_detect_loss(ci_netif* ni, ci_tcp_state* ts,
+                                   oo_pkt_p* rewind_out,
+                                   ci_uint32* timeout_us)
+{
+  ci_uint32 reo_wnd = ci_tcp_rack_reo_wnd(ni, ts);
+  int recovering = ts->congstate == CI_TCP_CONG_FAST_RECOV ||
+                   ts->congstate == CI_TCP_CONG_COOLING;
+  ci_uint32 elapsed_us, deadline_us;
+  oo_pkt_p id = ts->retrans.head;
+  ci_ip_pkt_fmt* pkt;
+  ci_uint64 now;
+  int lost = 0;
+
+  ci_frc64(&now);
+  *rewind_out = OO_PP_NULL;
+  *timeout_us = 0;
+  if( SEQ_LT(ts->rack.lost_end, tcp_snd_una(ts)) )
+    ts->rack.lost_end = tcp_snd_una(ts);
+
+  while( OO_PP_NOT_NULL(id) ) {
+    pkt = PKT_CHK(ni, id);
+    if( pkt->flags & CI_PKT_FLAG_RTQ_SACKED ) {
+      id = PKT_CHK(ni, pkt->pf.tcp_tx.block_end)->next;
+      continue;
+    }
+    id = pkt->next;
+
+    if( pkt->pf.tcp_tx.xmit_frc > ts->rack.xmit_frc ||
+        (pkt->pf.tcp_tx.xmit_frc == ts->rack.xmit_frc &&
+         SEQ_GE(pkt->pf.tcp_tx.start_seq, ts->rack.end_seq)) ) {
+      /* Sent after the RACK segment.  Segments are first sent in sequence
+       * order, so only retransmissions can be older beyond here. */
+      if( pkt->flags & CI_PKT_FLAG_RTQ_RETRANS )
+        continue;
+      break;
+    }
+
+    elapsed_us = CI_TCP_RACK_FRC2US(ni, now - pkt->pf.tcp_tx.xmit_frc);
+    deadline_us = ts->rack.rtt_us + reo_wnd;
+    if( elapsed_us < deadline_us ) {
+      *timeout_us = CI_MAX(*timeout_us, deadline_us - elapsed_us);
+      continue;
+    }
+
+    if( SEQ_GT(pkt->pf.tcp_tx.end_seq, ts->rack.lost_end) ) {
+      ts->rack.lost_end = pkt->pf.tcp_tx.end_seq;
+      CITP_STATS_NETIF_INC(ni, tcp_rack_marked_lost);
+      ++lost;
+    }
+    else if( recovering && OO_PP_IS_NULL(*rewind_out) &&
+             (pkt->flags & CI_PKT_FLAG_RTQ_RETRANS) &&
+             SEQ_LT(pkt->pf.tcp_tx.start_seq, ts->retrans_seq) &&
+             SEQ_LT(pkt->pf.tcp_tx.start_seq, ts->congrecover) ) {
+      /* Our retransmission has been lost too. */
+      *rewind_out = OO_PKT_P(pkt);
+      CITP_STATS_NETIF_INC(ni, tcp_rack_lost_retrans);
+      ++lost;
+    }
+  }
+
+  return lost;
+}
+
+
+static void ci_tcp_rack_timer_set(ci_netif* ni, ci_tcp_state* ts,
+                                  ci_uint32 timeout_us)
+{
+  ci_ip_timer_state* its = IPTIMER_STATE(ni);
+  ci_iptime_t t;
+
+  /* Round up: the timer must not fire before the reordering window has
+   * passed. */
+  t = ci_tcp_time_now(ni) + 1 +
+      (ci_iptime_t) (((ci_uint64) timeout_us << its->ci_ip_time_frc2us) >>
+                     its->ci_ip_time_frc2tick);
+
+  if( ci_tcp_timer_pending(ts, CI_TCP_TIMER_RTO) ) {
+    /* A plain RTO that is due first makes the reorder timer redundant. */
+    if( ! (ts->tcpflags & (CI_TCPT_FLAG_TAIL_DROP_TIMING |
+                           CI_TCPT_FLAG_RACK_TIMING)) &&
+        TIME_LE(ci_tcp_timer_time(ts, CI_TCP_TIMER_RTO), t) )
+      return;
+    ci_tcp_rto_clear(ni, ts);
+  }
+  ts->tcpflags &=~ CI_TCPT_FLAG_TAIL_DROP_TIMING;
+  ts->tcpflags |= CI_TCPT_FLAG_RACK_TIMING;
+  ci_tcp_timer_set(ni, ts, CI_TCP_TIMER_RTO, t);
+}
+
+
+/* Runs RACK loss detection, on receipt of an ACK that delivered something
+ * or on expiry of the reorder timer, and starts or continues fast recovery
+ * for whatever it finds to be lost.
+ */
+void ci_tcp_rack_detect_and_recover(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_uint32 timeout_us;
+  oo_pkt_p rewind;
+  ci_ip_pkt_fmt* pkt;
+
+  ts->rack.advanced = 0;
+  if( ci_ip_queue_is_empty(&ts->retrans) || ts->rack.xmit_frc == 0 ||
+      (ts->congstate & CI_TCP_CONG_RTO) ||
+      ts->congstate == CI_TCP_CONG_RTO_RECOV )
+    /* Nothing is timed yet, or RTO recovery will retransmit everything. */
+    return;
+
+  if( ci_tcp_rack_detect_loss(ni, ts, &rewind, &timeout_us) ) {
+    LOG_TL(log(LNT_FMT "RACK %s lost_end=%08x rack=%08x rtt=%uus "TCP_SND_FMT,
+               LNT_PRI_ARGS(ni, ts), congstate_str(ts), ts->rack.lost_end,
+               ts->rack.end_seq, ts->rack.rtt_us, TCP_SND_PRI_ARG(ts)));
+    if( (ts->congstate == CI_TCP_CONG_OPEN) |
+        (ts->congstate == CI_TCP_CONG_NOTIFIED) ) {
+      CITP_STATS_NETIF_INC(ni, tcp_rack_recoveries);
+      ci_tcp_enter_fast_recovery(ni, ts);
+    }
+    else {
+      if( OO_PP_NOT_NULL(rewind) ) {
+        pkt = PKT_CHK(ni, rewind);
+        ts->retrans_ptr = rewind;
+        ts->retrans_seq = pkt->pf.tcp_tx.start_seq;
+      }
+      /* New losses below [congrecover] take us back from COOLING. */
+      if( ts->congstate == CI_TCP_CONG_COOLING &&
+          SEQ_LT(ts->retrans_seq, ts->congrecover) &&
+          SEQ_LT(ts->retrans_seq, ts->rack.lost_end) )
+        ts->congstate = CI_TCP_CONG_FAST_RECOV;
+      if( ts->congstate == CI_TCP_CONG_FAST_RECOV )
+        ci_tcp_retrans_recover(ni, ts, 0);
+    }
+  }
+
+  if( timeout_us != 0 && ci_ip_queue_not_empty(&ts->retrans) )
+    ci_tcp_rack_timer_set(ni, ts, timeout_us);
+}
+
+
+/* Widens the reordering window on DSACK: our retransmission was spurious. */
+static void ci_tcp_rack_dsack(ci_netif* ni, ci_tcp_state* ts)
+{
+  if( ts->rack.reo_wnd_mult < CI_TCP_RACK_REO_WND_MULT_MAX )
+    ++ts->rack.reo_wnd_mult;
+  ts->rack.reo_wnd_persist = CI_TCP_RACK_REO_WND_PERSIST;
+}
+#endif
+
 
 /* Marks packets in the retransmit queue as having been SACKed.  Returns non-
  * zero if and only if the block allowed us to mark an entire packet, not
- * previously SACKed, as having now been SACKed. */
-static int /*bool*/
+ * previously SACKed, as having now been SACKed.
+ *
+ * The retransmit queue is indexed by its blocks: the head of each block
+ * points at the last packet of the block, so the searches below step over
+ * whole blocks, and [sack_hint] lets the common case of a SACK at or beyond
+ * the highest SACKed block start there.  Packets already SACKed are never
+ * revisited, so the work done is proportional to the number of blocks
+ * crossed plus the number of packets newly SACKed. */
+int /*bool*/
 ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
                              unsigned end)
 {
@@ -1048,6 +1307,8 @@ ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
   ci_ip_pkt_fmt* start_pkt_prev;
   ci_ip_pkt_fmt* end_block;
   ci_ip_pkt_fmt* end_pkt;
+  ci_ip_pkt_fmt* head;
+  ci_ip_pkt_fmt* last;
   ci_ip_pkt_fmt* pkt;
   oo_pkt_p next_pp;
 
@@ -1068,9 +1329,13 @@ ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
   */
 
   /* Find the block the first packet covered is in.  (The packet at the
-  ** head of rtq certainly won't qualify).
+  ** head of rtq certainly won't qualify).  No block before the highest
+  ** SACKed one can qualify if the SACK starts within or beyond it.
   */
   next_pp = rtq->head;
+  if( OO_PP_NOT_NULL(ts->sack_hint) &&
+      SEQ_GE(start, PKT_CHK(ni, ts->sack_hint)->pf.tcp_tx.start_seq) )
+    next_pp = ts->sack_hint;
   while( 1 ) {
     start_block = PKT_CHK(ni, next_pp);
     if( OO_PP_IS_NULL(start_block->pf.tcp_tx.block_end) ) {
@@ -1138,16 +1403,25 @@ ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
   ** [end_block] pointers, so find out what that'll be (ie. find the end
   ** packet).
   */
-  if( start_block == end_block )  pkt = start_pkt;
-  else                            pkt = end_block;
   end_pkt = 0;
-  while( 1 ) {
-    if( SEQ_LT(end, pkt->pf.tcp_tx.end_seq) )  break;
-    end_pkt = pkt;
-    /* This is a common case, so extra test for it here. */
-    if( SEQ_EQ(end, pkt->pf.tcp_tx.end_seq) )  break;
-    if( OO_PP_IS_NULL(pkt->next) )  break;
-    pkt = PKT_CHK(ni, end_pkt->next);
+  if( start_block != end_block &&
+      (end_block->flags & CI_PKT_FLAG_RTQ_SACKED) ) {
+    /* Whatever part of this block is covered, the new block ends where it
+    ** does, so there's no need to walk it.
+    */
+    end_pkt = end_block;
+  }
+  else {
+    if( start_block == end_block )  pkt = start_pkt;
+    else                            pkt = end_block;
+    while( 1 ) {
+      if( SEQ_LT(end, pkt->pf.tcp_tx.end_seq) )  break;
+      end_pkt = pkt;
+      /* This is a common case, so extra test for it here. */
+      if( SEQ_EQ(end, pkt->pf.tcp_tx.end_seq) )  break;
+      if( OO_PP_IS_NULL(pkt->next) )  break;
+      pkt = PKT_CHK(ni, end_pkt->next);
+    }
   }
   if( ! end_pkt ) {
     /* [start, end) didn't even cover start_pkt.  This is expected when the
@@ -1186,10 +1460,14 @@ ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
 
   /* Check whether this SACK block butts up against an existing one.  If it
   ** does we just need to snarf the end of block.  (This only happens if
-  ** other end is giving us inconsistent information).
+  ** other end is giving us inconsistent information, or if [end] falls
+  ** within a SACKed block).
   */
   next_pp = OO_PKT_P(end_pkt);
-  if( OO_PP_NOT_NULL(end_pkt->next) ) {
+  if( end_block->flags & CI_PKT_FLAG_RTQ_SACKED ) {
+    next_pp = end_block->pf.tcp_tx.block_end;
+  }
+  else if( OO_PP_NOT_NULL(end_pkt->next) ) {
     pkt = PKT_CHK(ni, end_pkt->next);
     if( pkt->flags & CI_PKT_FLAG_RTQ_SACKED ) {
       LOG_TV(log(LNT_FMT "SACK %08x-%08x inconsistent with %08x-%08x",
@@ -1199,19 +1477,42 @@ ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
       next_pp = pkt->pf.tcp_tx.block_end;
     }
   }
+  last = PKT_CHK(ni, next_pp);
 
-  /* Set [block_end] pointers for the SACKed block. */
+  /* Mark the newly SACKed packets, stepping over the blocks that were
+  ** SACKed already.  Only the head of the merged block needs its
+  ** [block_end] to be exact; see ci_tcp_sack_block_end().
+  */
   if( start_block->flags & CI_PKT_FLAG_RTQ_SACKED )
-    pkt = start_block;
+    head = start_block;
   else
-    pkt = start_pkt;
-  while( pkt != end_pkt ) {
-    pkt->pf.tcp_tx.block_end = next_pp;
-    pkt->flags |= CI_PKT_FLAG_RTQ_SACKED;
+    head = start_pkt;
+  pkt = head;
+  while( 1 ) {
+    if( pkt->flags & CI_PKT_FLAG_RTQ_SACKED ) {
+      pkt = PKT_CHK(ni, pkt->pf.tcp_tx.block_end);
+    }
+    else {
+#if CI_CFG_TCP_RACK
+      if( ci_tcp_rack_enabled(ni, ts) )
+        ci_tcp_rack_update(ni, ts, pkt);
+#endif
+      pkt->pf.tcp_tx.block_end = next_pp;
+      pkt->flags |= CI_PKT_FLAG_RTQ_SACKED;
+      ++ts->sacked_pkts;
+    }
+    if( pkt == last )  break;
     pkt = PKT_CHK(ni, pkt->next);
   }
-  pkt->pf.tcp_tx.block_end = next_pp;
-  pkt->flags |= CI_PKT_FLAG_RTQ_SACKED;
+  head->pf.tcp_tx.block_end = next_pp;
+
+  /* Keep track of the highest SACKed block.  The merged block may have
+  ** swallowed the old one.
+  */
+  if( OO_PP_IS_NULL(ts->sack_hint) ||
+      SEQ_LE(PKT_CHK(ni, ts->sack_hint)->pf.tcp_tx.start_seq,
+             last->pf.tcp_tx.start_seq) )
+    ts->sack_hint = OO_PKT_P(head);
 
   /* We took early exits from this function when this SACK block was contained
    * within an earlier one, so we know that we have recorded new SACK
@@ -1260,6 +1561,10 @@ ci_inline int ci_tcp_rx_dsack_check(ci_netif* ni, ci_tcp_state* ts,
     CITP_STATS_NETIF(++ni->state->stats.tail_drop_probe_unnecessary);
     ts->tcpflags &=~ CI_TCPT_FLAG_TAIL_DROP_MARKED;
   }
+#endif
+#if CI_CFG_TCP_RACK
+  if( rc && ci_tcp_rack_enabled(ni, ts) )
+    ci_tcp_rack_dsack(ni, ts);
 #endif
   return rc;
 }
@@ -1409,10 +1714,28 @@ static void ci_tcp_rx_free_acked_bufs(ci_netif* netif, ci_tcp_state* ts,
       ci_nvme_plugin_crc_free_acked_ids(netif, p);
 #endif
 
+    if( p->flags & CI_PKT_FLAG_RTQ_SACKED ) {
+      /* [p] heads its SACKed block, so pass the block on to the next
+       * packet. */
+      oo_pkt_p block_end = p->pf.tcp_tx.block_end;
+      int last_in_block = OO_PP_EQ(block_end, OO_PKT_P(p));
+      ci_assert_gt(ts->sacked_pkts, 0);
+      --ts->sacked_pkts;
+      if( ! last_in_block )
+        PKT_CHK(netif, p->next)->pf.tcp_tx.block_end = block_end;
+      if( OO_PP_EQ(ts->sack_hint, OO_PKT_P(p)) )
+        ts->sack_hint = last_in_block ? OO_PP_NULL : p->next;
+    }
+
     ci_ip_queue_dequeue(netif, rtq, p);
 
     ci_assert(p->refcount > 0);
 
+#if CI_CFG_TCP_RACK
+    if( ci_tcp_rack_enabled(netif, ts) && ~p->flags & CI_PKT_FLAG_RTQ_SACKED )
+      ci_tcp_rack_update(netif, ts, p);
+#endif
+
 #if CI_CFG_TIMESTAMPING
     if( (p->flags & CI_PKT_FLAG_TX_TIMESTAMPED &&
          onload_timestamping_want_tx_nic(ts->s.timestamping_flags)) ||
@@ -1639,12 +1962,12 @@ static void ci_tcp_rx_handle_ack(ci_tcp_state* ts, ci_netif* netif,
      * If retransmit queue is non-empty (i.e. if the peer shrunk window),
      * then retransmits will serve as zero window probes.
      */
-    if( ci_ip_timer_pending(netif, &ts->zwin_tid) ) {
+    if( ci_tcp_timer_pending(ts, CI_TCP_TIMER_ZWIN) ) {
       if( ts->zwin_probes > 0 ) {
         ++ts->zwin_acks;
         ts->zwin_probes = 0;
       }
-      ci_ip_timer_clear(netif, &ts->zwin_tid);
+      ci_tcp_timer_clear(netif, ts, CI_TCP_TIMER_ZWIN);
     }
     ci_tcp_zwin_set(netif, ts);
     CI_IP_SOCK_STATS_INC_ZWIN(ts);
@@ -1668,6 +1991,11 @@ static void ci_tcp_rx_handle_ack(ci_tcp_state* ts, ci_netif* netif,
   }
 #endif
 
+#if CI_CFG_TCP_RACK
+  if( ts->rack.advanced && ci_tcp_rack_enabled(netif, ts) )
+    ci_tcp_rack_detect_and_recover(netif, ts);
+#endif
+
   /* Clear keepalive counter -- it is important to clear this counter up on
    * every ACK for our keepalive request. */
   ci_tcp_kalive_reset(netif, ts);
@@ -2251,6 +2579,44 @@ static int ci_tcp_rx_ooo_stripe(ci_netif* netif, ci_tcp_state* ts,
 #endif
 
 
+/* Finds a place to start looking for where a segment starting at [seq]
+ * goes in the re-order buffer.  The blocks recorded in [last_sack] are the
+ * ones that have most recently had segments added to them, so usually one
+ * of them is immediately before the new segment and the search of the
+ * block list is avoided.  On return [prev_id] is the last known block that
+ * starts before [seq] (or NULL if there is none), and [block_id] the block
+ * after it. */
+static void ci_tcp_rx_rob_hint(ci_netif* netif, ci_tcp_state* ts,
+                               unsigned seq, oo_pkt_p* prev_id,
+                               ci_ip_pkt_fmt** prev_pkt, oo_pkt_p* block_id)
+{
+  int af = ipcache_af(&ts->s.pkt);
+  ci_ip_pkt_fmt* pkt;
+  unsigned start, best = 0;
+  int i;
+
+  *prev_id = OO_PP_NULL;
+  *block_id = ts->rob.head;
+  if( ~ts->tcpflags & CI_TCPT_FLAG_SACK )
+    return;
+
+  for( i = 0; i <= CI_TCP_SACK_MAX_BLOCKS; i++ ) {
+    if( OO_PP_IS_NULL(ts->last_sack[i]) )
+      continue;
+    pkt = PKT_CHK(netif, ts->last_sack[i]);
+    start = CI_BSWAP_BE32(PKT_IPX_TCP_HDR(af, pkt)->tcp_seq_be32);
+    if( SEQ_LT(start, seq) &&
+        (OO_PP_IS_NULL(*prev_id) || SEQ_GT(start, best)) ) {
+      *prev_id = ts->last_sack[i];
+      *prev_pkt = pkt;
+      best = start;
+    }
+  }
+  if( OO_PP_NOT_NULL(*prev_id) )
+    *block_id = PKT_TCP_RX_ROB(*prev_pkt)->next_block;
+}
+
+
 /*! Enqueue an out-of-order segment. Returns a hint about whether or
   not to ACK this packet.  This will be 0 if an ACK should be avoided,
   as it has detected that the out-or-order situation is probably due
@@ -2287,7 +2653,8 @@ static int ci_tcp_rx_enqueue_ooo(ci_netif* netif, ci_tcp_state* ts,
 
   ci_assert(OO_SP_IS_NULL(ts->local_peer));
   ci_assert(ci_ip_queue_is_valid(netif, rob));
-  for( prev_id = OO_PP_NULL, block_id = rob->head;
+  ci_tcp_rx_rob_hint(netif, ts, rxp->seq, &prev_id, &prev_pkt, &block_id);
+  for( ;
        OO_PP_NOT_NULL(block_id) &&
        (block_pkt = PKT_CHK(netif, block_id),
         SEQ_LT(CI_BSWAP_BE32(PKT_IPX_TCP_HDR(af, block_pkt)->tcp_seq_be32),
@@ -4363,7 +4730,7 @@ static void handle_rx_slow(ci_tcp_state* ts, ci_netif* netif,
       ci_assert(!pkt->pf.tcp_rx.pay_len);
       ci_assert_nflags(tcp->tcp_flags, CI_TCP_FLAG_SYN | CI_TCP_FLAG_RST |
                                        CI_TCP_FLAG_FIN);
-      ci_netif_pkt_release_rx(netif, pkt);
+      ci_netif_poll_pkt_release_rx(netif, rxp->poll_state, pkt);
     }
 
     if( TCP_ACK_FORCED(ts) ) {
@@ -4800,6 +5167,51 @@ static int ci_tcp_rx_deliver_to_listen(ci_sock_cmn* s, void* opaque_arg)
 }
 
 
+/* Filter-table callback for the established lookup: remember the
+ * connection in the poll state's lookup cache so that the next segment of
+ * the same 4-tuple can skip the filter table.
+ */
+static int ci_tcp_rx_deliver_to_conn_cached(ci_sock_cmn* s, void* opaque_arg)
+{
+  ciip_tcp_rx_pkt* rxp = opaque_arg;
+  struct ci_netif_poll_state* ps = rxp->poll_state;
+
+  if( ps != NULL ) {
+    if( s->b.state == CI_TCP_ESTABLISHED ) {
+      ps->rx_lookup_ts = SOCK_TO_TCP(s);
+      ps->rx_lookup_intf_i = rxp->pkt->intf_i;
+      ps->rx_lookup_vlan = rxp->pkt->vlan;
+    }
+    else {
+      ps->rx_lookup_ts = NULL;
+    }
+  }
+  return ci_tcp_rx_deliver_to_conn(s, opaque_arg);
+}
+
+
+/* Returns true if [ts] is the established connection that the filter table
+ * would find for this segment.  The connection may have changed state or
+ * been freed and reused since it was cached, so everything the lookup
+ * depends on is checked again here.
+ */
+ci_inline int
+ci_tcp_rx_lookup_cache_match(struct ci_netif_poll_state* ps,
+                             ci_tcp_state* ts,
+                             ci_ip_pkt_fmt* pkt, ci_tcp_hdr* tcp,
+                             ci_addr_t daddr, ci_addr_t saddr)
+{
+  return ts->s.b.state == CI_TCP_ESTABLISHED &&
+         OO_SP_IS_NULL(ts->local_peer) &&
+         ps->rx_lookup_intf_i == pkt->intf_i &&
+         ps->rx_lookup_vlan == pkt->vlan &&
+         sock_rport_be16(&ts->s) == tcp->tcp_source_be16 &&
+         sock_lport_be16(&ts->s) == tcp->tcp_dest_be16 &&
+         CI_IPX_ADDR_EQ(sock_ipx_raddr(&ts->s), saddr) &&
+         CI_IPX_ADDR_EQ(sock_ipx_laddr(&ts->s), daddr);
+}
+
+
 void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
                       ci_ip_pkt_fmt* pkt, ci_tcp_hdr* tcp, int ip_paylen)
 {
@@ -4934,13 +5346,26 @@ void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
   }
 #endif
 
+  /* Per-poll lookup cache: a segment of the same 4-tuple as the last one
+   * delivered in this poll goes straight to that connection.  This only
+   * saves the filter table lookup; each segment is still processed, ACKed
+   * and woken for as it would be without the cache.
+   */
+  if( ps != NULL && ps->rx_lookup_ts != NULL &&
+      ci_tcp_rx_lookup_cache_match(ps, ps->rx_lookup_ts, pkt, tcp,
+                                   daddr, saddr) ) {
+    CITP_STATS_NETIF_INC(netif, rx_lookup_cache_hits);
+    ci_tcp_rx_deliver_to_conn(&ps->rx_lookup_ts->s, &rxp);
+    return;
+  }
+
 #if CI_CFG_IPV6
   if( oo_pkt_af(pkt) == AF_INET6 ) {
     ci_netif_filter_for_each_match_ip6(netif,
                                        &daddr, tcp->tcp_dest_be16,
                                        &saddr, tcp->tcp_source_be16,
                                        IPPROTO_TCP, pkt->intf_i, pkt->vlan,
-                                       ci_tcp_rx_deliver_to_conn, &rxp,
+                                       ci_tcp_rx_deliver_to_conn_cached, &rxp,
                                        &rxp.hash);
     if(CI_LIKELY( rxp.pkt == NULL ))
       return;
@@ -4968,7 +5393,7 @@ void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
                                    ip4->ip_daddr_be32, tcp->tcp_dest_be16,
                                    ip4->ip_saddr_be32, tcp->tcp_source_be16,
                                    IPPROTO_TCP, pkt->intf_i, pkt->vlan,
-                                   ci_tcp_rx_deliver_to_conn, &rxp,
+                                   ci_tcp_rx_deliver_to_conn_cached, &rxp,
                                    &rxp.hash);
     if(CI_LIKELY( rxp.pkt == NULL ))
       return;
@@ -1927,6 +1927,23 @@ static int ci_tcp_send_via_prequeue(ci_netif* ni, ci_tcp_state* ts,
   }
 
   ci_assert_equal(sinf->stack_locked, 0);
+  if( (ts->s.b.sb_aflags & CI_SB_AFLAG_DEFERRED) &&
+      ci_netif_deferred_work_queued(ni, &ts->s.b) ) {
+    /* Another writer has already queued deferred work for this socket on
+     * the stack lock, and the lock holder will drain the prequeue,
+     * including the packets we have just pushed, before it lets anyone else
+     * have the lock.  Blocking on the lock here makes every further writer
+     * queue up behind the lock holder, so don't.  Our next send either goes
+     * onto the prequeue behind these packets or needs the lock, so cannot
+     * overtake them.
+     *
+     * If the socket is not yet provably on the list, fall through: the
+     * thread that set the flag may not get round to pushing it for a while,
+     * and ci_netif_lock_or_defer_work() then does the work itself.
+     */
+    CITP_STATS_NETIF_INC(ni, tcp_send_defer_joined);
+    return 1;
+  }
   if( ci_netif_lock_or_defer_work(ni, &ts->s.b) )
     sinf->stack_locked = 1;
   return 1;
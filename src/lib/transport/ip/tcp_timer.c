@@ -86,6 +86,7 @@ void ci_tcp_timer_init(ci_netif* netif)
 #if OO_DO_STACK_POLL
 
 static void ci_tcp_timeout_taildrop(ci_netif* netif, ci_tcp_state* ts);
+static void ci_tcp_timeout_rack(ci_netif* netif, ci_tcp_state* ts);
 
 
 /* Called as action on a listen timeout */
@@ -396,8 +397,8 @@ void ci_tcp_timeout_delack(ci_netif* netif, ci_tcp_state* ts)
     LOG_TR(log(LNT_FMT "DELACK now=%x acks_pending=%x NO BUFS (will retry)",
 	       LNT_PRI_ARGS(netif, ts),
 	       ci_tcp_time_now(netif), ts->acks_pending));
-    ci_ip_timer_set(netif, &ts->delack_tid,
-		    ci_tcp_time_now(netif) + NI_CONF(netif).tconst_delack);
+    ci_tcp_timer_set(netif, ts, CI_TCP_TIMER_DELACK,
+                     ci_tcp_time_now(netif) + NI_CONF(netif).tconst_delack);
   }
 }
 
@@ -438,6 +439,63 @@ void ci_tcp_send_corked_packets(ci_netif* netif, ci_tcp_state* ts)
   }
 }
 
+/* Called when a socket's timer wheel entry expires.  Runs whichever of its
+ * timers are due, and re-arms the entry for the earliest of the rest. */
+void ci_tcp_timeout_mux(ci_netif* netif, ci_tcp_state* ts)
+{
+  ci_iptime_t now = IPTIMER_STATE(netif)->sched_ticks;
+  ci_iptime_t next;
+  int i, fired = 0;
+
+  CITP_STATS_NETIF_INC(netif, tcp_timer_expiries);
+
+  /* Each handler may set or clear any of the timers, or drop the socket,
+   * which clears them all, so re-check the pending mask every time. */
+  for( i = 0; i < CI_TCP_TIMER_N; ++i ) {
+    if( ! ci_tcp_timer_pending(ts, i) || TIME_GT(ts->timer_time[i], now) )
+      continue;
+    ts->timers_pending &=~ (1u << i);
+    fired = 1;
+    switch( i ) {
+    case CI_TCP_TIMER_RTO:
+      ci_tcp_timeout_rto(netif, ts);
+      break;
+    case CI_TCP_TIMER_DELACK:
+      ci_tcp_timeout_delack(netif, ts);
+      break;
+    case CI_TCP_TIMER_ZWIN:
+      ci_tcp_timeout_zwin(netif, ts);
+      break;
+    case CI_TCP_TIMER_KALIVE:
+      ci_tcp_timeout_kalive(netif, ts);
+      break;
+    }
+  }
+  if( ! fired )
+    CITP_STATS_NETIF_INC(netif, tcp_timer_early_expiries);
+
+  if( ts->timers_pending == 0 )
+    return;
+
+  /* Timers set by the handlers have armed the entry as needed, but those
+   * that were pending already and are not yet due have not. */
+  for( i = 0; ! ci_tcp_timer_pending(ts, i); ++i )
+    ;
+  next = ts->timer_time[i];
+  for( ++i; i < CI_TCP_TIMER_N; ++i )
+    if( ci_tcp_timer_pending(ts, i) && TIME_LT(ts->timer_time[i], next) )
+      next = ts->timer_time[i];
+  if( ! ci_ip_timer_pending(netif, &ts->tcp_tid) ) {
+    ci_ip_timer_set(netif, &ts->tcp_tid, next);
+    CITP_STATS_NETIF_INC(netif, tcp_timer_wheel_ops);
+  }
+  else if( TIME_LT(next, ts->tcp_tid.time) ) {
+    ci_ip_timer_modify(netif, &ts->tcp_tid, next);
+    CITP_STATS_NETIF_INC(netif, tcp_timer_wheel_ops);
+  }
+}
+
+
 /* Called as TCP_CORK timeout */
 void ci_tcp_timeout_cork(ci_netif* netif, ci_tcp_state* ts)
 {
@@ -457,6 +515,11 @@ void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
     ci_tcp_timeout_taildrop(netif, ts);
     return;
   }
+  if( CI_CFG_TCP_RACK &&
+      (ts->tcpflags & CI_TCPT_FLAG_RACK_TIMING) ) {
+    ci_tcp_timeout_rack(netif, ts);
+    return;
+  }
 
   ci_assert(netif);
   ci_assert(ts);
@@ -572,6 +635,10 @@ void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
   }
 
   ts->congrecover = tcp_snd_nxt(ts);
+#if CI_CFG_TCP_RACK
+  /* Everything outstanding is now deemed lost (RFC 8985 6.3). */
+  ts->rack.lost_end = tcp_snd_nxt(ts);
+#endif
 
   /* Reset congestion window to one segment (RFC2581 p5). */
   ts->cwnd = CI_MAX((ci_uint32)tcp_eff_mss(ts), NI_OPTS(netif).loss_min_cwnd);
@@ -668,5 +735,26 @@ static void ci_tcp_timeout_taildrop(ci_netif* netif, ci_tcp_state* ts)
 }
 
 
+static void ci_tcp_timeout_rack(ci_netif* netif, ci_tcp_state* ts)
+{
+#if CI_CFG_TCP_RACK
+  ci_assert(ts->tcpflags & CI_TCPT_FLAG_RACK_TIMING);
+  ci_assert(!ci_tcp_retransq_is_empty(ts));
+
+  LOG_TL(log(FNTS_FMT "now=%x rack=%08x rtt=%uus "TCP_SND_FMT,
+             FNTS_PRI_ARGS(netif, ts), ci_tcp_time_now(netif),
+             ts->rack.end_seq, ts->rack.rtt_us, TCP_SND_PRI_ARG(ts)));
+  CITP_STATS_NETIF_INC(netif, tcp_rack_reo_timeouts);
+
+  /* Put the RTO back first: retransmits expect it to be running, and
+   * detection may re-arm the reorder timer in its place.
+   */
+  ts->tcpflags &=~ CI_TCPT_FLAG_RACK_TIMING;
+  ci_tcp_rto_set(netif, ts);
+  ci_tcp_rack_detect_and_recover(netif, ts);
+#endif
+}
+
+
 #endif
 /*! \cidoxg_end */
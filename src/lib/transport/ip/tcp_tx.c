@@ -1007,33 +1007,23 @@ int ci_tcp_retrans_one(ci_tcp_state* ts, ci_netif* netif, ci_ip_pkt_fmt* pkt)
     return 1; /* we've closed the connection as a result of send() */
 
   /* caller must have setup or already have a pending RTO timer */
-  ci_assert( ci_ip_timer_pending(netif, &ts->rto_tid) );
+  ci_assert( ci_tcp_timer_pending(ts, CI_TCP_TIMER_RTO) );
 
   return 0;
 }
 
 
 /* Counts the number of segments in the retransmit queue that have not been
- * SACKed.  TODO: it might be beneficial to keep track of the number of
- * un-SACKed segments/blocks, and so avoid having to walk the list here in
- * order to count them. */
+ * SACKed.  The count of SACKed segments is kept up to date as SACKs arrive
+ * and as SACKed segments are acknowledged, so this doesn't walk the list. */
 int ci_tcp_unsacked_segments_in_flight(ci_netif* ni, ci_tcp_state* ts)
 {
-  int unsacked = 0;
-  oo_pkt_p pp;
-  ci_ip_pkt_fmt *pkt;
+  int unsacked;
 
   ci_assert(ts->tcpflags & CI_TCPT_FLAG_SACK);
+  ci_assert_le(ts->sacked_pkts, ts->retrans.num);
 
-  pp = ts->retrans.head;
-  while( OO_PP_NOT_NULL(pp) ) {
-    pkt = PKT_CHK(ni, pp);
-    if( pkt->flags & CI_PKT_FLAG_RTQ_SACKED )
-      pkt = PKT_CHK(ni, pkt->pf.tcp_tx.block_end);
-    else
-      ++unsacked;
-    pp = pkt->next;
-  }
+  unsacked = ts->retrans.num - ts->sacked_pkts;
 
   LOG_TL(log(LNT_FMT "unsacked=%d", LNT_PRI_ARGS(ni, ts), unsacked));
 
@@ -1073,7 +1063,7 @@ int ci_tcp_retrans(ci_netif* ni, ci_tcp_state* ts, int seq_limit,
   while( 1 ) {
     /* Skip SACKed packets. */
     if( pkt->flags & CI_PKT_FLAG_RTQ_SACKED ) {
-      pkt = PKT_CHK(ni, pkt->pf.tcp_tx.block_end);
+      pkt = ci_tcp_sack_block_end(ni, pkt);
       ts->retrans_ptr = pkt->next;
       if( OO_PP_IS_NULL(ts->retrans_ptr) )  break;
       pkt = PKT_CHK(ni, ts->retrans_ptr);
@@ -1106,6 +1096,15 @@ int ci_tcp_retrans(ci_netif* ni, ci_tcp_state* ts, int seq_limit,
     /* Stop if we've reached the recovery sequence number. */
     if( SEQ_LE(ts->congrecover, pkt->pf.tcp_tx.start_seq) )  return 1;
 
+#if CI_CFG_TCP_RACK
+    /* RACK decides what is lost; the rest stays in flight and we remain in
+    ** recovery until it is delivered or deemed lost too.
+    */
+    if( before_sacked_only && ci_tcp_rack_enabled(ni, ts) &&
+        SEQ_LE(ts->rack.lost_end, pkt->pf.tcp_tx.start_seq) )
+      return 0;
+#endif
+
 #if CI_CFG_BURST_CONTROL
     if(ts->burst_window && ci_tcp_burst_exhausted(ni, ts)){
       LOG_TV(log(LNT_FMT "tx limited by burst avoidance",
@@ -1534,8 +1533,11 @@ void ci_tcp_tx_advance_to(ci_netif* ni, ci_tcp_state* ts,
     ts->acks_pending = 0;
 
     /* Start the RTO/TLP timer (if not already running). */
-    if( ! ci_ip_timer_pending(ni, &(ts->rto_tid)) ) {
+    if( ! ci_tcp_timer_pending(ts, CI_TCP_TIMER_RTO) ) {
       ci_iptime_t timeout;
+#if CI_CFG_TCP_RACK
+      ts->tcpflags &=~ CI_TCPT_FLAG_RACK_TIMING;
+#endif
       if( ci_tcp_taildrop_probe_enabled(ni, ts) ) {
         timeout = ci_tcp_taildrop_timeout(ni, ts);
         ts->tcpflags |= CI_TCPT_FLAG_TAIL_DROP_TIMING;
@@ -1919,7 +1921,7 @@ void ci_tcp_send_ack_loopback(ci_netif* netif, ci_tcp_state* ts)
   do {
     ts->acks_pending = 0;
     ci_tcp_calc_rcv_wnd(ts, "send_ack");
-    ci_assert(!ci_ip_timer_pending(netif, &ts->delack_tid));
+    ci_assert(! ci_tcp_timer_pending(ts, CI_TCP_TIMER_DELACK));
 
     peer->snd_una = tcp_rcv_nxt(ts);
     peer->snd_max = tcp_rcv_wnd_right_edge_sent(ts);
@@ -62,6 +62,12 @@ ci_inline void ci_tcp_tx_finish(ci_netif* netif, ci_tcp_state* ts,
   }
 
   tcp->tcp_seq_be32 = CI_BSWAP_BE32(seq);
+
+#if CI_CFG_TCP_RACK
+  /* Transmit time, for RACK loss detection. */
+  if( NI_OPTS(netif).tcp_rack )
+    ci_frc64(&pkt->pf.tcp_tx.xmit_frc);
+#endif
 }
 
 
@@ -514,6 +514,7 @@ struct recvmsg_spinstate {
   int spin_limit_by_so;
   ci_uint32 timeout;
 #ifndef __KERNEL__
+  int spin_adaptive;
   uint32_t poison;
   const volatile uint32_t* future;
   citp_signal_info* si;
@@ -640,7 +641,8 @@ ci_udp_recvmsg_socklocked_spin(ci_netif* ni, ci_udp_state* us,
     }
 
     if( spin_state->timeout ) {
-      ci_uint32 spin_ms = NI_OPTS(ni).spin_usec >> 10;
+      ci_uint32 spin_ms = (now_frc - spin_state->start_frc) /
+                          IPTIMER_STATE(ni)->khz;
       if( spin_ms < spin_state->timeout )
         spin_state->timeout -= spin_ms;
       else {
@@ -769,6 +771,7 @@ ci_udp_recvmsg_common(ci_udp_recv_info *rinf)
       spin_state.future = &spin_state.poison;
       spin_state.schedule_frc = spin_state.start_frc;
       spin_state.max_spin = us->s.b.spin_cycles;
+      spin_state.spin_adaptive = NI_OPTS(ni).spin_adaptive;
       if( us->s.so.rcvtimeo_msec ) {
         ci_uint64 max_so_spin = (ci_uint64)us->s.so.rcvtimeo_msec *
             IPTIMER_STATE(ni)->khz;
@@ -777,6 +780,9 @@ ci_udp_recvmsg_common(ci_udp_recv_info *rinf)
           spin_state.spin_limit_by_so = 1;
         }
       }
+      spin_state.max_spin =
+        ci_netif_spin_adaptive_cap(ni, spin_state.max_spin,
+                                   &spin_state.spin_limit_by_so);
     }
   }
 
@@ -806,6 +812,12 @@ ci_udp_recvmsg_common(ci_udp_recv_info *rinf)
 
  out:
   ni->state->is_spinner = 0;
+#ifndef __KERNEL__
+  /* Let the adaptive spin budget learn how long this wait really was. */
+  if( spin_state.spin_adaptive && rc >= 0 )
+    ci_netif_spin_adaptive_update(ni, &us->s.b,
+                                  ci_frc64_get() - spin_state.start_frc);
+#endif
   return rc;
 
  slow_path:
@@ -1304,6 +1316,9 @@ int ci_udp_zc_recv(ci_udp_iomsg_args* a, struct onload_zc_recv_args* args)
           spin_state.spin_limit_by_so = 1;
         }
       }
+      spin_state.max_spin =
+        ci_netif_spin_adaptive_cap(ni, spin_state.max_spin,
+                                   &spin_state.spin_limit_by_so);
     }
   }
 
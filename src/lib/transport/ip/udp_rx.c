@@ -121,6 +121,34 @@ int ci_udp_csum_correct(ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp)
 }
 
 
+/* Get a buffer with which to queue a datagram on one more socket.  Take it
+ * from the fan-out pool if we can: it's already accounted in [n_rx_pkts],
+ * so is not subject to EF_MAX_RX_PACKETS.
+ */
+static ci_ip_pkt_fmt* ci_udp_fanout_node_get(ci_netif* ni)
+{
+  ci_ip_pkt_fmt* q_pkt;
+
+  if( OO_PP_NOT_NULL(ni->state->udp_fanout_pool) ) {
+    q_pkt = PKT(ni, ni->state->udp_fanout_pool);
+    ni->state->udp_fanout_pool = q_pkt->next;
+    --ni->state->udp_fanout_pool_n;
+    ci_assert_equal(q_pkt->refcount, 0);
+    q_pkt->refcount = 1;
+    CITP_STATS_NETIF_INC(ni, udp_fanout_pool_hit);
+    return q_pkt;
+  }
+
+  if( ni->state->n_rx_pkts > NI_OPTS(ni).max_rx_packets ||
+      (q_pkt = ci_netif_pkt_alloc(ni, 0)) == NULL )
+    return NULL;
+  ++ni->state->n_rx_pkts;
+  if( NI_OPTS(ni).udp_fanout_pool )
+    CITP_STATS_NETIF_INC(ni, udp_fanout_pool_miss);
+  return q_pkt;
+}
+
+
 int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
 {
   /* Deliver a received packet to a socket. */
@@ -145,6 +173,7 @@ int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
     int multi_destination_pkt;
 
   fast_receive:
+    ci_netif_pkt_efct_fill(ni, state->pkt);
     multi_destination_pkt =
       CI_IP_IS_MULTICAST(oo_ip_hdr(pkt)->ip_daddr_be32) ||
       oo_ip_hdr(pkt)->ip_daddr_be32 == CI_IP_ALL_BROADCAST;
@@ -169,10 +198,8 @@ int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
        * looked at on the receive path.  The indirect packet looks like an
        * empty "fragment" at the head of the real packet.
        */
-      if( ni->state->n_rx_pkts > NI_OPTS(ni).max_rx_packets ||
-          (q_pkt = ci_netif_pkt_alloc(ni, 0)) == NULL )
+      if( (q_pkt = ci_udp_fanout_node_get(ni)) == NULL )
         goto drop;
-      ++ni->state->n_rx_pkts;
       q_pkt->pf.udp.pay_len = pkt->pf.udp.pay_len;
       q_pkt->tstamp_frc = pkt->tstamp_frc;
 #if CI_CFG_TIMESTAMPING
@@ -181,6 +208,8 @@ int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
       oo_offbuf_init(&q_pkt->buf, PKT_START(q_pkt), 0);
       q_pkt->flags = (CI_PKT_FLAG_INDIRECT | CI_PKT_FLAG_UDP |
                       CI_PKT_FLAG_RX);
+      if( NI_OPTS(ni).udp_fanout_pool )
+        q_pkt->rx_flags = CI_PKT_RX_FLAG_UDP_FANOUT;
       q_pkt->frag_next = OO_PKT_P(pkt);
       q_pkt->n_buffers = pkt->n_buffers + 1;
       ci_netif_pkt_hold(ni, pkt);
@@ -328,8 +357,10 @@ void ci_udp_handle_rx(ci_netif* ni, ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp,
       return;
     }
 
-    if( oo_tcpdump_check_no_match(ni, pkt, pkt->intf_i) )
+    if( oo_tcpdump_check_no_match(ni, pkt, pkt->intf_i) ) {
+      ci_netif_pkt_efct_fill(ni, pkt);
       oo_tcpdump_dump_pkt(ni, pkt);
+    }
 
 #ifndef NDEBUG
     if( !NI_OPTS(ni).scalable_filter_enable )
@@ -651,6 +651,9 @@ int citp_epoll_create(int size, int flags)
   ep->avoid_spin_once = 0;
   ep->closing = 0;
   ep->phase = 0;
+  /* Start out assuming that a full spin is worthwhile. */
+  ep->spin_wait_avg = citp.spin_cycles / OO_EPOLL_SPIN_WAIT_MULT;
+  ep->spin_pass_avg = 0;
   citp_fdtable_insert(fdi, fd, 0);
   Log_POLL(ci_log("%s: fd=%d driver_fd=%d epfd=%d", __FUNCTION__,
                   fd, ep->epfd_os, (int) ep->shared->epfd));
@@ -1777,6 +1780,53 @@ citp_epoll_ctl_try_sync(struct citp_epoll_fd* ep, citp_fdinfo* fdi,
 }
 
 
+/* Returns the number of cycles that epoll_wait() should spin for on this
+ * set with EF_EPOLL_SPIN_ADAPTIVE, or 0 if it should block straight away.
+ */
+static ci_uint64 citp_epoll_spin_budget(struct citp_epoll_fd* ep)
+{
+  ci_uint64 budget;
+
+  /* Events are expected to take longer to arrive than we're prepared to
+   * spin for, so don't burn the CPU. */
+  if( ep->spin_wait_avg > citp.spin_cycles )
+    return 0;
+
+  budget = ep->spin_wait_avg * OO_EPOLL_SPIN_WAIT_MULT;
+  /* A pass over a set whose members span several stacks costs more than a
+   * pass over a single stack.  Make sure every member gets a few looks. */
+  budget = CI_MAX(budget, ep->spin_pass_avg * OO_EPOLL_SPIN_MIN_PASSES);
+  return CI_MIN(budget, citp.spin_cycles);
+}
+
+
+static inline ci_uint64 citp_epoll_spin_avg(ci_uint64 avg, ci_uint64 sample)
+{
+  return avg + ((ci_int64) sample - (ci_int64) avg) /
+               (1 << OO_EPOLL_SPIN_AVG_SHIFT);
+}
+
+
+/* Feed the outcome of one epoll_wait() into the adaptive spin state:
+ * [waited] is the time until events arrived (or we gave up), and [spun]
+ * is the time spent in [passes] spin passes before that.
+ */
+static void citp_epoll_spin_update(struct citp_epoll_fd* ep, ci_uint64 waited,
+                                   ci_uint64 spun, int passes)
+{
+  /* A wait far beyond the spin timeout tells us no more than that spinning
+   * was pointless.  Clamp it so that we recover quickly once events start
+   * arriving more often again. */
+  waited = CI_MIN(waited, citp.spin_cycles * 2);
+  ep->spin_wait_avg = citp_epoll_spin_avg(ep->spin_wait_avg, waited);
+  if( passes > 0 )
+    ep->spin_pass_avg = citp_epoll_spin_avg(ep->spin_pass_avg, spun / passes);
+  Log_VVPOLL(ci_log("%s: waited=%"CI_PRIu64" passes=%d => avg=%"CI_PRIu64
+                    " pass=%"CI_PRIu64, __FUNCTION__, waited, passes,
+                    ep->spin_wait_avg, ep->spin_pass_avg));
+}
+
+
 int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
                     struct citp_ordered_wait* ordering, int maxevents,
                     ci_int64 timeout_hr, const sigset_t *sigmask,
@@ -1789,6 +1839,9 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
   sigset_t sigsaved;
   int pwait_was_spinning = 0;
   int have_spin = 0;
+  int spin_adaptive = 0;
+  int spin_passes = 0;
+  ci_uint64 spin_budget = citp.spin_cycles;
 
   ci_assert_ge(timeout_hr, 0);
   ci_assert_le(timeout_hr, OO_EPOLL_MAX_TIMEOUT_HR);
@@ -1868,6 +1921,12 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
     eps.ul_epoll_spin |=
       oo_per_thread_get()->spinstate & (1 << ONLOAD_SPIN_SO_BUSY_POLL);
   }
+  if( eps.ul_epoll_spin && CITP_OPTS.ul_epoll_spin_adaptive ) {
+    spin_adaptive = 1;
+    spin_budget = citp_epoll_spin_budget(ep);
+    if( spin_budget == 0 )
+      eps.ul_epoll_spin = 0;
+  }
 
   if(CI_UNLIKELY( eps.phase )) {
     /* In last epoll_wait we have not managed to obtain all the
@@ -1984,6 +2043,11 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
     if( rc == maxevents )
       ep->phase = eps.phase;
 
+    if( have_spin && spin_adaptive )
+      citp_epoll_spin_update(ep, ci_frc64_get() - base_poll_start_frc,
+                             eps.this_poll_frc - base_poll_start_frc,
+                             spin_passes);
+
     /* If we've been spinning for some time before getting events, then any
      * events are probably past the limit being used for ordering.  Tell caller
      * that it would be worth polling again.
@@ -2009,7 +2073,8 @@ no_events:
   }
 
   /* Blocking.  Shall we spin? */
-  if( KEEP_POLLING(eps.ul_epoll_spin, eps.this_poll_frc, base_poll_start_frc) ) {
+  if( KEEP_POLLING_FOR(eps.ul_epoll_spin, eps.this_poll_frc,
+                       base_poll_start_frc, spin_budget) ) {
     if( !pwait_was_spinning && sigmask != NULL) {
       if( ep->avoid_spin_once ) {
         eps.ul_epoll_spin = 0;
@@ -2054,6 +2119,7 @@ no_events:
     }
 
     have_spin = 1;
+    ++spin_passes;
 
     /* When we're WODAing we can't return anything we find with later polls,
      * so we don't poll on individual sockets.  However, we do need to ensure
@@ -2067,6 +2133,10 @@ no_events:
       struct oo_epoll1_spin_on_arg op = {};
       op.epoll_fd = fdi->fd;
       op.timeout_us = timeout_hr_to_us(timeout_hr);
+      if( spin_adaptive )
+        /* Don't let the kernel spin beyond the adaptive budget. */
+        op.timeout_us = CI_MIN(op.timeout_us, timeout_hr_to_us(spin_budget -
+                              (eps.this_poll_frc - base_poll_start_frc)));
       op.sleep_iter_us = CITP_OPTS.sleep_spin_usec;
 
       citp_epoll_ctl_try_sync(ep, fdi, timeout_hr, 0);
@@ -2192,6 +2262,12 @@ no_events:
     }
   }
 
+  if( spin_adaptive && rc >= 0 )
+    citp_epoll_spin_update(ep, ci_frc64_get() - base_poll_start_frc,
+                           have_spin ?
+                             eps.this_poll_frc - base_poll_start_frc : 0,
+                           spin_passes);
+
   if( rc && ordering ) {
     ordering->poll_again = 1;
     citp_epoll_find_timeout(&timeout_hr, &poll_start_frc);
@@ -2591,36 +2667,75 @@ static void citp_epoll_latest_rx(ci_netif* ni, struct timespec* ts_out)
   citp_epoll_netif_limit(ni, ts_out, 0);
 }
 
-static void citp_epoll_earliest_rx(ci_netif* ni, struct timespec* ts_out)
+
+/* Returns true if every timestamping interface has had its event queue
+ * polled until empty since it last received, so that the drained watermarks
+ * cover all packets the stack has seen.  Stack must be locked.
+ */
+static int citp_epoll_rx_drained(ci_netif* ni)
 {
-  citp_epoll_netif_limit(ni, ts_out, 1);
+  ci_netif_state_nic_t* nsn;
+  int intf_i;
+
+  OO_STACK_FOR_EACH_INTF_I(ni, intf_i) {
+    nsn = &ni->state->nic[intf_i];
+    if( (nsn->oo_vi_flags & OO_VI_FLAGS_RX_HW_TS_EN) &&
+        ci_rx_stamp_ns(&nsn->last_rx_timestamp) > nsn->rx_drained_ns )
+      return 0;
+  }
+  return 1;
+}
+
+
+/* Gets the earliest of the drained watermarks of the timestamping
+ * interfaces.  No packet stamped at or before this time is still waiting to
+ * be polled.  Does not need the stack lock.
+ */
+static void citp_epoll_drained_limit(ci_netif* ni, struct timespec* ts_out)
+{
+  ci_netif_state_nic_t* nsn;
+  ci_uint64 limit = 0, ns;
+  int intf_i, any = 0;
+
+  OO_STACK_FOR_EACH_INTF_I(ni, intf_i) {
+    nsn = &ni->state->nic[intf_i];
+    if( ! (nsn->oo_vi_flags & OO_VI_FLAGS_RX_HW_TS_EN) )
+      continue;
+    ns = CI_READ_ONCE(nsn->rx_drained_ns);
+    if( ! any || ns < limit )
+      limit = ns;
+    any = 1;
+  }
+  ts_out->tv_sec = limit / 1000000000ull;
+  ts_out->tv_nsec = limit % 1000000000ull;
 }
 
 
 static void citp_epoll_get_ordering_limit(ci_netif* ni,
                                           struct timespec* limit_out)
 {
-  struct timespec base_ts;
-
   if( ni ) {
     if( CITP_OPTS.woda_single_if == 0 ) {
-      ci_netif_lock(ni);
-      citp_epoll_latest_rx(ni, &base_ts);
-      ci_netif_poll_n(ni, 0x7fffffff);
-      citp_epoll_earliest_rx(ni, limit_out);
-      ci_netif_unlock(ni);
-
-      /* It's always the case that the earliest RX across all interfaces
-       * provides a safe limit. However, if we have one or more interfaces
-       * that aren't receiving traffic our earliest RX stamp may be from a
-       * very long time ago. To deal with that possibility we have a fallback
-       * base_ts. Because we've done a full poll after that stamp we know that
-       * it's safe too, so fall back to using base_ts if it's more recent than
-       * limit. */
-      if( citp_timespec_compare(&base_ts, limit_out) > 0 ) {
-        limit_out->tv_sec = base_ts.tv_sec;
-        limit_out->tv_nsec = base_ts.tv_nsec;
+      /* The poll loop maintains, for each interface, a watermark before
+       * which everything it received has been delivered to sockets; the
+       * earliest of these is a safe limit across all interfaces.  An idle
+       * interface's watermark keeps pace with the others, as it is drained
+       * by every poll.
+       *
+       * So we need only a normal poll here, and only if nobody else is
+       * already polling.  Its budget may leave an interface with events
+       * still pending though, and its watermark behind.  Only then do we
+       * fall back to polling until every event queue is empty.
+       */
+      if( ci_netif_trylock(ni) ) {
+        ci_netif_poll(ni);
+        if( ! citp_epoll_rx_drained(ni) ) {
+          CITP_STATS_NETIF_INC(ni, woda_drain_polls);
+          ci_netif_poll_n(ni, 0x7fffffff);
+        }
+        ci_netif_unlock(ni);
       }
+      citp_epoll_drained_limit(ni, limit_out);
     }
     else {
       /* In single interface WODA mode we don't need to ensure that all
@@ -2645,11 +2760,32 @@ static void citp_epoll_get_ordering_limit(ci_netif* ni,
 }
 
 
-static int citp_epoll_ordering_compare(const void* a, const void* b)
+static inline int citp_epoll_ordering_before(const struct citp_ordering_info* a,
+                                             const struct citp_ordering_info* b)
 {
-  return citp_timespec_compare(
-                          &((const struct citp_ordering_info*)a)->oo_event.ts,
-                          &((const struct citp_ordering_info*)b)->oo_event.ts);
+  return citp_timespec_compare(&a->oo_event.ts, &b->oo_event.ts) < 0;
+}
+
+
+/* Restores the heap property below [i] in a binary min-heap of ready
+ * sockets, keyed on the timestamp of their next available data.
+ */
+static void citp_epoll_heap_down(struct citp_ordering_info* heap, int n, int i)
+{
+  struct citp_ordering_info tmp;
+  int child;
+
+  while( (child = 2 * i + 1) < n ) {
+    if( child + 1 < n &&
+        citp_epoll_ordering_before(&heap[child + 1], &heap[child]) )
+      ++child;
+    if( ! citp_epoll_ordering_before(&heap[child], &heap[i]) )
+      break;
+    tmp = heap[i];
+    heap[i] = heap[child];
+    heap[child] = tmp;
+    i = child;
+  }
 }
 
 
@@ -2662,23 +2798,28 @@ citp_epoll_sort_results(struct epoll_event*__restrict__ events,
                         struct timespec* limit)
 {
   int i;
+  int n = ready_socks;
   int ordered_events = 0;
   struct timespec next;
   struct timespec* next_data_limit;
+  struct citp_ordering_info cur;
   if( ready_socks < maxevents )
     maxevents = ready_socks;
 
   /* Update ordering info to point at the corresponding event, so that we know
-   * which event it corresponds to after sorting.
+   * which event it corresponds to after reordering.
    */
   for( i = 0; i < ready_socks; i++ )
     ordering_info[i].event = &wait_events[i];
 
-  /* Sort list of ready sockets based on timestamp of next available data. */
-  qsort(ordering_info, ready_socks, sizeof(*ordering_info),
-        citp_epoll_ordering_compare);
+  /* Merge the ready sockets by timestamp of next available data.  We stop
+   * after at most maxevents, and often sooner, so rather than sorting the
+   * whole list we heapify it and pop only what we deliver.
+   */
+  for( i = n / 2 - 1; i >= 0; i-- )
+    citp_epoll_heap_down(ordering_info, n, i);
 
-  /* Working from head of list, copy ordered data into output array, stopping
+  /* Working from head of heap, copy ordered data into output array, stopping
    * when any of the following conditions are true:
    * - we have filled the output event array (i == maxevents)
    * - the timestamp for the current event is after the limit
@@ -2690,39 +2831,45 @@ citp_epoll_sort_results(struct epoll_event*__restrict__ events,
   Log_VPOLL(ci_log("%s: maxevents=%d limit %lus %dns", __func__, maxevents,
                    (unsigned long)limit->tv_sec, (int)limit->tv_nsec));
   for( i = 0; i < maxevents; i++ ) {
+    /* If this event is after the limit, stop here. */
+    if( ordering_info[0].oo_event.ts.tv_sec != 0 &&
+        citp_timespec_compare(limit, &ordering_info[0].oo_event.ts) < 0 )
+      break;
+
+    cur = ordering_info[0];
+    ordering_info[0] = ordering_info[--n];
+    citp_epoll_heap_down(ordering_info, n, 0);
+
     /* If this event has a valid timestamp, then get ordering data for it. */
-    if( ordering_info[i].oo_event.ts.tv_sec != 0 ) {
+    if( cur.oo_event.ts.tv_sec != 0 ) {
       Log_VPOLL(ci_log("%s: ev=%d ts %lus %dns", __func__, i,
-                       (unsigned long)ordering_info[i].oo_event.ts.tv_sec,
-                       (int)ordering_info[i].oo_event.ts.tv_nsec));
-      /* If this event is after the limit, stop here. */
-      if( citp_timespec_compare(limit, &ordering_info[i].oo_event.ts) < 0 )
-        break;
+                       (unsigned long)cur.oo_event.ts.tv_sec,
+                       (int)cur.oo_event.ts.tv_nsec));
 
       /* If there is another ready socket then use the start of their data
        * to bound the amount we claim as available from this socket.
        */
-      if( (i + 1) < ready_socks && ordering_info[i + 1].oo_event.ts.tv_sec &&
-          citp_timespec_compare(&ordering_info[i + 1].oo_event.ts, limit) < 0 )
-        next_data_limit = &ordering_info[i + 1].oo_event.ts;
+      if( n > 0 && ordering_info[0].oo_event.ts.tv_sec &&
+          citp_timespec_compare(&ordering_info[0].oo_event.ts, limit) < 0 )
+        next_data_limit = &ordering_info[0].oo_event.ts;
       else
         next_data_limit = limit;
 
       /* Get the number of bytes available in order, and the timestamp of the
        * first data that is after that.
        */
-      if( ordering_info[i].fdi )
-        citp_fdinfo_get_ops(ordering_info[i].fdi)->ordered_data(
-                                       ordering_info[i].fdi, next_data_limit,
-                                       &next, &ordering_info[i].oo_event.bytes);
+      if( cur.fdi )
+        citp_fdinfo_get_ops(cur.fdi)->ordered_data(cur.fdi, next_data_limit,
+                                                   &next,
+                                                   &cur.oo_event.bytes);
 
       /* If we have more data then don't let us return anything beyond that. */
       if( next.tv_sec && citp_timespec_compare(&next, limit) < 0 )
         *limit = next;
     }
 
-    memcpy(&events[i], ordering_info[i].event, sizeof(struct epoll_event));
-    memcpy(&oo_events[i], &ordering_info[i].oo_event,
+    memcpy(&events[i], cur.event, sizeof(struct epoll_event));
+    memcpy(&oo_events[i], &cur.oo_event,
            sizeof(struct onload_ordered_epoll_event));
     ordered_events++;
   }
@@ -4,6 +4,126 @@
 #include "internal.h"
 #include "ul_poll.h"
 #include "ul_select.h"
+#include <pthread.h>
+
+
+/****************************************************************************
+ ****************************** READINESS CACHE *****************************
+ ****************************************************************************/
+
+/* Apps that poll() or select() over thousands of fds typically pass the
+ * same set every time, with few of the sockets in it ready.  So we
+ * remember each socket that we find not ready, along with its sleep_seq,
+ * and skip it next time unless it has been woken since.  A socket is woken
+ * whenever it may have become readable, writable or errored.  Sockets that
+ * were ready are always looked at again, as the app may have drained them.
+ */
+
+static pthread_key_t poll_cache_key;
+static pthread_once_t poll_cache_once = PTHREAD_ONCE_INIT;
+static int poll_cache_key_ok;
+
+
+static void citp_ul_poll_cache_dtor(void* arg)
+{
+  struct oo_ul_poll_cache* c = arg;
+  ci_free(c->poll_ents);
+  ci_free(c->select_ents);
+  ci_free(c);
+}
+
+
+static void citp_ul_poll_cache_key_init(void)
+{
+  poll_cache_key_ok =
+    pthread_key_create(&poll_cache_key, citp_ul_poll_cache_dtor) == 0;
+}
+
+
+/* Returns this thread's cache for a poll() (or select(), if [is_select]) of
+ * [n] entries, or NULL if the call is too small to be worth caching.
+ */
+static struct oo_ul_poll_cache_ent*
+citp_ul_poll_cache_get(int n, int is_select)
+{
+  struct oo_per_thread* pt;
+  struct oo_ul_poll_cache* c;
+  struct oo_ul_poll_cache_ent** ents;
+  int* ents_n;
+  int i;
+
+  if( CITP_OPTS.ul_poll_cache == 0 || n < CITP_OPTS.ul_poll_cache )
+    return NULL;
+
+  pt = oo_per_thread_get();
+  if(CI_UNLIKELY( (c = pt->poll_cache) == NULL )) {
+    pthread_once(&poll_cache_once, citp_ul_poll_cache_key_init);
+    if( ! poll_cache_key_ok || (c = ci_calloc(1, sizeof(*c))) == NULL )
+      return NULL;
+    if( pthread_setspecific(poll_cache_key, c) != 0 ) {
+      ci_free(c);
+      return NULL;
+    }
+    pt->poll_cache = c;
+  }
+
+  ents = is_select ? &c->select_ents : &c->poll_ents;
+  ents_n = is_select ? &c->select_n : &c->poll_n;
+  if(CI_UNLIKELY( *ents_n < n )) {
+    ci_free(*ents);
+    *ents_n = 0;
+    if( (*ents = ci_alloc(n * sizeof(**ents))) == NULL )
+      return NULL;
+    for( i = 0; i < n; ++i )
+      (*ents)[i].fd = -1;
+    *ents_n = n;
+  }
+  return *ents;
+}
+
+
+/* Returns true if socket [fdi] was found not ready for [events] last time,
+ * and hasn't been woken since.  Otherwise returns false, and the sleep_seq
+ * to record in [ent] if the socket turns out not to be ready now.
+ *
+ * The socket's stack is polled first if necessary, as the poll() op would
+ * have done.  We do that only once per stack per pass over the set though.
+ */
+ci_inline int
+citp_ul_poll_cache_hit(const struct oo_ul_poll_cache_ent* ent,
+                       citp_fdinfo* fdi, unsigned events,
+                       ci_netif** cache_ni, ci_uint64 now_frc, unsigned spin,
+                       ci_uint64* sleep_seq_out)
+{
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
+  ci_netif* ni = epi->sock.netif;
+
+  if( ni != *cache_ni ) {
+    citp_poll_if_needed(ni, now_frc, spin);
+    *cache_ni = ni;
+  }
+  *sleep_seq_out = epi->sock.s->b.sleep_seq.all;
+  /* Read the sequence number before the socket state that it guards. */
+  ci_rmb();
+  return ent->fd == fdi->fd && ent->events == events &&
+         ent->fdi_seq == fdi->seq && ent->sleep_seq == *sleep_seq_out;
+}
+
+
+ci_inline void
+citp_ul_poll_cache_set(struct oo_ul_poll_cache_ent* ent, citp_fdinfo* fdi,
+                       unsigned events, ci_uint64 sleep_seq, int ready)
+{
+  if( ready ) {
+    ent->fd = -1;
+  }
+  else {
+    ent->fd = fdi->fd;
+    ent->events = events;
+    ent->fdi_seq = fdi->seq;
+    ent->sleep_seq = sleep_seq;
+  }
+}
 
 
 /****************************************************************************
@@ -169,6 +289,7 @@ ci_inline int citp_ul_select(struct oo_ul_select_state*__restrict__ s)
     CITP_FDTABLE_LOCK_RD();
 
   s->is_kernel_fd = 0;
+  s->cache_ni = NULL;
 
   for( fd = 0; fd < s->nfds_inited; ++fd ) {
     r = FD_ISSET(fd, s->rdi);
@@ -179,6 +300,10 @@ ci_inline int citp_ul_select(struct oo_ul_select_state*__restrict__ s)
       citp_fdinfo_p fdip = citp_fdtable.table[fd].fdip;
       if( fdip_is_normal(fdip) ) {
 	citp_fdinfo* fdi = fdip_to_fdi(fdip);
+        struct oo_ul_poll_cache_ent* ent = NULL;
+        unsigned events = 0;
+        ci_uint64 sleep_seq = 0;
+        int n_before = n;
 
         /* If SO_BUSY_POLL behaviour requested need to check if there is
          * a spinning socket in the set, and remove flag to enable spinning
@@ -189,8 +314,21 @@ ci_inline int citp_ul_select(struct oo_ul_select_state*__restrict__ s)
           s->ul_select_spin &= ~(1 << ONLOAD_SPIN_SO_BUSY_POLL);
         }
 
+        if( s->cache != NULL && citp_fdinfo_is_socket(fdi) ) {
+          ent = &s->cache[fd];
+          events = (r ? 1 : 0) | (w ? 2 : 0) | (e ? 4 : 0);
+          if( citp_ul_poll_cache_hit(ent, fdi, events, &s->cache_ni,
+                                     s->now_frc, s->ul_select_spin,
+                                     &sleep_seq) ) {
+            s->is_ul_fd = 1;
+            continue;
+          }
+        }
+
 	if( citp_fdinfo_get_ops(fdi)->select(fdi, &n, r, w, e, s) ) {
 	  s->is_ul_fd = 1;
+          if( ent != NULL )
+            citp_ul_poll_cache_set(ent, fdi, events, sleep_seq, n != n_before);
 	  continue;
 	}
       }
@@ -270,6 +408,7 @@ int citp_ul_do_select(int nfds, fd_set* rds, fd_set* wrs, fd_set* exs,
   n_bytes_bs = n_words_bs * sizeof(ci_fd_mask);
   n_bytes_as = (n_words - n_words_bs) * sizeof(ci_fd_mask);
   s.is_ul_fd = 0;
+  s.cache = citp_ul_poll_cache_get(s.nfds_inited, 1);
   s.ul_select_spin = 
     oo_per_thread_get()->spinstate & (1 << ONLOAD_SPIN_SELECT);
   if( s.ul_select_spin ) {
@@ -557,6 +696,7 @@ static int citp_ul_poll(int nfds, struct oo_ul_poll_state*__restrict__ ps)
   ps->n_ul_ready = 0;
   ps->n_ul_fds = 0;
   ps->nkfds = 0;
+  ps->cache_ni = NULL;
 
   if( citp_fdtable_not_mt_safe() )
     CITP_FDTABLE_LOCK_RD();
@@ -567,6 +707,10 @@ static int citp_ul_poll(int nfds, struct oo_ul_poll_state*__restrict__ ps)
     if( fd < citp_fdtable.inited_count ) {
       citp_fdinfo_p fdip = citp_fdtable.table[fd].fdip;
       if( fdip_is_normal(fdip) ) {
+        citp_fdinfo* fdi = fdip_to_fdi(fdip);
+        struct oo_ul_poll_cache_ent* ent = NULL;
+        ci_uint64 sleep_seq = 0;
+
         ++ps->n_ul_fds;
 
         /* If SO_BUSY_POLL behaviour requested need to check if there is
@@ -578,10 +722,22 @@ static int citp_ul_poll(int nfds, struct oo_ul_poll_state*__restrict__ ps)
           ps->ul_poll_spin &= ~(1 << ONLOAD_SPIN_SO_BUSY_POLL);
         }
 
-        if( citp_fdinfo_get_ops(fdip_to_fdi(fdip))->poll(fdip_to_fdi(fdip),
-                                                         &ps->pfds[i], ps) ) {
+        if( ps->cache != NULL && citp_fdinfo_is_socket(fdi) ) {
+          ent = &ps->cache[i];
+          if( citp_ul_poll_cache_hit(ent, fdi, ps->pfds[i].events,
+                                     &ps->cache_ni, ps->this_poll_frc,
+                                     ps->ul_poll_spin, &sleep_seq) ) {
+            ps->pfds[i].revents = 0;
+            continue;
+          }
+        }
+
+        if( citp_fdinfo_get_ops(fdi)->poll(fdi, &ps->pfds[i], ps) ) {
           if( ps->pfds[i].revents != 0 )
             ++ps->n_ul_ready;
+          if( ent != NULL )
+            citp_ul_poll_cache_set(ent, fdi, ps->pfds[i].events, sleep_seq,
+                                   ps->pfds[i].revents != 0);
           continue;
         }
       }
@@ -654,6 +810,7 @@ int citp_ul_do_poll(struct pollfd*__restrict__ fds, nfds_t nfds,
   }
   ps.kfds = ps.kfds_local;
   ps.kfd_map = ps.kfd_map_local;
+  ps.cache = citp_ul_poll_cache_get(nfds, 0);
 
  poll_again:
   n = citp_ul_poll(nfds, &ps);
@@ -149,6 +149,7 @@ static void citp_dump_opts(citp_opts_t *o)
   DUMP_OPT_INT("EF_UL_POLL",		ul_poll);
   DUMP_OPT_INT("EF_POLL_SPIN",		ul_poll_spin);
   DUMP_OPT_INT("EF_POLL_FAST",		ul_poll_fast);
+  DUMP_OPT_INT("EF_POLL_CACHE",		ul_poll_cache);
   DUMP_OPT_INT("EF_POLL_FAST_USEC",	ul_poll_fast_usec);
   DUMP_OPT_INT("EF_POLL_NONBLOCK_FAST_USEC", ul_poll_nonblock_fast_usec);
   DUMP_OPT_INT("EF_SELECT_FAST_USEC",	ul_select_fast_usec);
@@ -168,6 +169,7 @@ static void citp_dump_opts(citp_opts_t *o)
   DUMP_OPT_INT("EF_SO_BUSY_POLL_SPIN",  so_busy_poll_spin);
   DUMP_OPT_INT("EF_UL_EPOLL",	        ul_epoll);
   DUMP_OPT_INT("EF_EPOLL_SPIN",	        ul_epoll_spin);
+  DUMP_OPT_INT("EF_EPOLL_SPIN_ADAPTIVE", ul_epoll_spin_adaptive);
   DUMP_OPT_INT("EF_EPOLL_CTL_FAST",     ul_epoll_ctl_fast);
   DUMP_OPT_INT("EF_EPOLL_CTL_HANDOFF",  ul_epoll_ctl_handoff);
   DUMP_OPT_INT("EF_EPOLL_MT_SAFE",      ul_epoll_mt_safe);
@@ -411,6 +413,7 @@ static void citp_opts_getenv(citp_opts_t* opts)
   GET_ENV_OPT_INT("EF_UL_POLL",		ul_poll);
   GET_ENV_OPT_INT("EF_POLL_SPIN",	ul_poll_spin);
   GET_ENV_OPT_INT("EF_POLL_FAST",	ul_poll_fast);
+  GET_ENV_OPT_INT("EF_POLL_CACHE",	ul_poll_cache);
   GET_ENV_OPT_INT("EF_POLL_FAST_USEC",  ul_poll_fast_usec);
   GET_ENV_OPT_INT("EF_POLL_NONBLOCK_FAST_USEC", ul_poll_nonblock_fast_usec);
   GET_ENV_OPT_INT("EF_SELECT_FAST_USEC",  ul_select_fast_usec);
@@ -430,6 +433,7 @@ static void citp_opts_getenv(citp_opts_t* opts)
   GET_ENV_OPT_INT("EF_SO_BUSY_POLL_SPIN", so_busy_poll_spin);
   GET_ENV_OPT_INT("EF_UL_EPOLL",        ul_epoll);
   GET_ENV_OPT_INT("EF_EPOLL_SPIN",      ul_epoll_spin);
+  GET_ENV_OPT_INT("EF_EPOLL_SPIN_ADAPTIVE", ul_epoll_spin_adaptive);
   GET_ENV_OPT_INT("EF_EPOLL_CTL_FAST",  ul_epoll_ctl_fast);
   GET_ENV_OPT_INT("EF_EPOLL_CTL_HANDOFF",ul_epoll_ctl_handoff);
   GET_ENV_OPT_INT("EF_EPOLL_MT_SAFE",   ul_epoll_mt_safe);
@@ -130,6 +130,15 @@ enum {
   EPOLL_PHASE_DONE_OTHER = 2,
 };
 
+/* EF_EPOLL_SPIN_ADAPTIVE tuning.  We spin for OO_EPOLL_SPIN_WAIT_MULT times
+ * the average wait, but for no fewer than OO_EPOLL_SPIN_MIN_PASSES passes
+ * over the set.  Each new sample is given a weight of
+ * 1 / (1 << OO_EPOLL_SPIN_AVG_SHIFT) in the moving averages.
+ */
+#define OO_EPOLL_SPIN_WAIT_MULT   4
+#define OO_EPOLL_SPIN_MIN_PASSES  4
+#define OO_EPOLL_SPIN_AVG_SHIFT   3
+
 #define EPOLL_STACK_EITEM 1
 #define EPOLL_NON_STACK_EITEM 2
 /*! Data associated with each epoll epfd.  */
@@ -194,6 +203,14 @@ struct citp_epoll_fd {
    * value of highest bit matters */
   int phase;
 
+  /* EF_EPOLL_SPIN_ADAPTIVE state, in cycles: moving average of how long
+   * epoll_wait() has had to wait for events on this set, and of the cost
+   * of one spin pass over the members.  Updated without the lock by
+   * concurrent waiters, which is fine for statistics of this nature.
+   */
+  ci_uint64 spin_wait_avg;
+  ci_uint64 spin_pass_avg;
+
 #if CI_CFG_TIMESTAMPING
   /* When using WODA with large numbers of sockets performance can be harmed
    * by repeated large alloc/free calls, so we cache memory allocated for this
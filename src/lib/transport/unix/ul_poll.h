@@ -19,8 +19,30 @@
 
 #define OO_POLL_MAX_OSP    16
 
+#define KEEP_POLLING_FOR(what, now, start, cycles)                      \
+  (what && (((now) = ci_frc64_get()) - (start) < (cycles)))
+
 #define KEEP_POLLING(what, now, start)                                  \
-  (what && (((now) = ci_frc64_get()) - (start) < citp.spin_cycles))
+  KEEP_POLLING_FOR(what, now, start, citp.spin_cycles)
+
+
+/* Per-thread memory of sockets found not ready by poll() and select(), so
+ * that an unchanged set need not be re-evaluated in full.  Entries are
+ * indexed by position in the pollfd array, or by fd for select().
+ */
+struct oo_ul_poll_cache_ent {
+  ci_uint64             fdi_seq;    /* citp_fdinfo::seq of the socket */
+  ci_uint64             sleep_seq;  /* its sleep_seq when found not ready */
+  int                   fd;         /* -1 if no entry */
+  unsigned              events;     /* events it was polled for */
+};
+
+struct oo_ul_poll_cache {
+  struct oo_ul_poll_cache_ent* poll_ents;
+  int                          poll_n;
+  struct oo_ul_poll_cache_ent* select_ents;
+  int                          select_n;
+};
 
 
 struct oo_ul_poll_state {
@@ -49,6 +71,12 @@ struct oo_ul_poll_state {
   int stat_incremented;
 #endif
 
+  /* Readiness cache entries for [pfds], or NULL if not caching. */
+  struct oo_ul_poll_cache_ent* cache;
+
+  /* Stack most recently polled on behalf of cached sockets. */
+  ci_netif*             cache_ni;
+
   /* Kernel file descriptors */
 
   /* Maps entry number in [kfds] onto entry number in [pfds]. */
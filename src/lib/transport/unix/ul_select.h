@@ -35,6 +35,9 @@ struct oo_ul_select_state {
 #if CI_CFG_SPIN_STATS
   int stat_incremented;
 #endif
+  /* Readiness cache entries indexed by fd, or NULL if not caching. */
+  struct oo_ul_poll_cache_ent* cache;
+  ci_netif* cache_ni;
 };
 
 
@@ -102,12 +102,22 @@ cp_unit_nl_handle_route_msg(struct cp_session*, in_addr_t dest,
 			    in_addr_t gateway, int ifindex, uint32_t nlmsg_pid,
 			    uint32_t nlmsg_seq);
 
+extern struct nlmsghdr*
+cp_unit_nl_build_neigh_msg(char* buf, int ifindex, int type, int state,
+                           in_addr_t dest, const uint8_t* macaddr,
+                           int reachable_ms, uint32_t nlmsg_pid,
+                           uint32_t nlmsg_seq);
+
 extern void
 cp_unit_nl_handle_neigh_msg(struct cp_session* s, int ifindex, int type,
                             int state, in_addr_t dest, const uint8_t* macaddr,
                             int reachable_ms, uint32_t nlmsg_pid,
                             uint32_t nlmsg_seq);
 
+extern void
+cp_unit_nl_handle_addr_msg(struct cp_session* s, uint16_t nlmsg_type, int af,
+                           int ifindex, const void* addr, int prefixlen);
+
 /* Functions for inserting simulated netlink replies. */
 extern void
 cp_unit_insert_route(struct cp_session* s, in_addr_t dest, int dest_prefix,
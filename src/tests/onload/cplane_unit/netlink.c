@@ -195,17 +195,16 @@ cp_unit_nl_handle_route_msg(struct cp_session* s, in_addr_t dest,
 }
 
 
-/* This function fabricates a netlink message simulating the message
+/* This function fabricates in buf a netlink message simulating the message
  * that the kernel generates in response to the addition or removal of
- * a neighbour, and passes it to the control plane. */
-void
-cp_unit_nl_handle_neigh_msg(struct cp_session* s, int ifindex, int type,
-                            int state, in_addr_t dest, const uint8_t* macaddr,
-                            int reachable_ms, uint32_t nlmsg_pid,
-                            uint32_t nlmsg_seq)
+ * a neighbour. */
+struct nlmsghdr*
+cp_unit_nl_build_neigh_msg(char* buf, int ifindex, int type, int state,
+                           in_addr_t dest, const uint8_t* macaddr,
+                           int reachable_ms, uint32_t nlmsg_pid,
+                           uint32_t nlmsg_seq)
 {
   struct nlmsghdr* nlh;
-  char buf[MNL_SOCKET_BUFFER_SIZE];
   struct ndmsg* ndm;
 
   CP_TEST(ifindex != 0);
@@ -240,11 +239,62 @@ cp_unit_nl_handle_neigh_msg(struct cp_session* s, int ifindex, int type,
     mnl_attr_put(nlh, NDA_CACHEINFO, sizeof(struct nda_cacheinfo), &cacheinfo);
   }
 
+  return nlh;
+}
+
+
+/* Like cp_unit_nl_build_neigh_msg(), but passes the message to the control
+ * plane. */
+void
+cp_unit_nl_handle_neigh_msg(struct cp_session* s, int ifindex, int type,
+                            int state, in_addr_t dest, const uint8_t* macaddr,
+                            int reachable_ms, uint32_t nlmsg_pid,
+                            uint32_t nlmsg_seq)
+{
+  char buf[MNL_SOCKET_BUFFER_SIZE];
+  struct nlmsghdr* nlh = cp_unit_nl_build_neigh_msg(buf, ifindex, type, state,
+                                                    dest, macaddr,
+                                                    reachable_ms, nlmsg_pid,
+                                                    nlmsg_seq);
+
   /* Pass the message to the control plane. */
   cp_nl_net_handle_msg(s, nlh, nlh->nlmsg_len);
 }
 
 
+/* Fabricates a netlink message adding or removing a local address, as the
+ * kernel sends both on changes and in reply to a dump, and passes it to the
+ * control plane.  [addr] points to an in_addr_t or to a 16-byte IPv6
+ * address, according to [af]. */
+void
+cp_unit_nl_handle_addr_msg(struct cp_session* s, uint16_t nlmsg_type, int af,
+                           int ifindex, const void* addr, int prefixlen)
+{
+  char buf[MNL_SOCKET_BUFFER_SIZE];
+  struct nlmsghdr* nlh;
+  struct ifaddrmsg* ifa;
+  size_t addr_len = af == AF_INET ? sizeof(in_addr_t) : 16;
+
+  nlh = mnl_nlmsg_put_header(buf);
+  nlh->nlmsg_type = nlmsg_type;
+  nlh->nlmsg_pid = 0;
+  nlh->nlmsg_seq = 0;
+
+  ifa = mnl_nlmsg_put_extra_header(nlh, sizeof(*ifa));
+  ifa->ifa_family = af;
+  ifa->ifa_prefixlen = prefixlen;
+  ifa->ifa_flags = 0;
+  ifa->ifa_scope = RT_SCOPE_UNIVERSE;
+  ifa->ifa_index = ifindex;
+
+  mnl_attr_put(nlh, IFA_ADDRESS, addr_len, addr);
+  if( af == AF_INET )
+    mnl_attr_put(nlh, IFA_LOCAL, addr_len, addr);
+
+  cp_nl_net_handle_msg(s, nlh, nlh->nlmsg_len);
+}
+
+
 int cp_unit_cplane_ioctl(int fd, long unsigned int op, ...)
 {
   void* arg __attribute__((unused));
@@ -28,9 +28,11 @@ void cp_unit_init_session(struct cp_session* s)
     .hwport_max = 8,
     .llap_max = 32,
     .ipif_max = 64,
+    .ip6if_max = 64,
     .fwd_ln2 = 8,
     .svc_arrays_max = 64,
     .svc_ep_max = 1024,
+    .svc_lookups_max = 64,
   };
   s->bond_max = 64;
   s->mac_max_ln2 = 10;
@@ -0,0 +1,207 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
+
+#include "cplane_unit.h"
+#include <cplane/server.h>
+#include "../../../tools/cplane/mask.h"
+
+#include "../../tap/tap.h"
+
+
+/* Addresses are spread over two interfaces, so that each ifindex chain holds
+ * rows that are not adjacent in the table. */
+#define IFINDEX_A 2
+#define IFINDEX_B 3
+#define N_ADDRS   48
+
+
+static int addr_ifindex(int i)
+{
+  return (i & 1) ? IFINDEX_B : IFINDEX_A;
+}
+
+static in_addr_t addr4(int i)
+{
+  return htonl(0x0a000001 + i);
+}
+
+static void addr6(ci_ip6_addr_t ip6, int i)
+{
+  memset(ip6, 0, sizeof(ci_ip6_addr_t));
+  ((uint8_t*) ip6)[0] = 0xfd;
+  ((uint8_t*) ip6)[15] = i + 1;
+}
+
+
+static int/*bool*/
+record_ifindex(struct oo_cplane_handle* cp, ci_ifid_t ifindex, void* data)
+{
+  *(ci_ifid_t*) data = ifindex;
+  return 1;
+}
+
+
+/* Feeds the addresses for which [present] is set to the control plane, either
+ * as individual updates or as the reply to a dump, which removes the rest. */
+static void add_addrs(struct cp_session* s, int af, const bool* present,
+                      bool dump)
+{
+  int i;
+
+  if( dump ) {
+    cp_ipif_dump_start(s, af);
+    cp_row_mask_init(s->seen, af == AF_INET ? s->mib->dim->ipif_max :
+                                              s->mib->dim->ip6if_max);
+    s->state = af == AF_INET ? CP_DUMP_IPIF : CP_DUMP_IP6IF;
+  }
+
+  for( i = 0; i < N_ADDRS; i++ ) {
+    in_addr_t ip = addr4(i);
+    ci_ip6_addr_t ip6;
+
+    if( ! present[i] )
+      continue;
+    addr6(ip6, i);
+    cp_unit_nl_handle_addr_msg(s, RTM_NEWADDR, af, addr_ifindex(i),
+                               af == AF_INET ? (void*) &ip : (void*) ip6,
+                               af == AF_INET ? 24 : 64);
+  }
+
+  if( dump ) {
+    if( af == AF_INET )
+      cp_ipif_dump_done(s);
+    else
+      cp_ip6if_dump_done(s);
+    s->state = CP_DUMP_IDLE;
+  }
+}
+
+
+static void del_addr(struct cp_session* s, int af, int i)
+{
+  in_addr_t ip = addr4(i);
+  ci_ip6_addr_t ip6;
+
+  addr6(ip6, i);
+  cp_unit_nl_handle_addr_msg(s, RTM_DELADDR, af, addr_ifindex(i),
+                             af == AF_INET ? (void*) &ip : (void*) ip6,
+                             af == AF_INET ? 24 : 64);
+}
+
+
+/* Checks the lookups through the index against the table itself: every
+ * present address is found on the right interface, every absent one is not,
+ * and a lookup by ifindex finds the first row of that interface, as a scan
+ * of the table would. */
+static void check_lookups(struct oo_cplane_handle* cp, int af,
+                          const bool* present, const char* what)
+{
+  struct cp_mibs* mib = &cp->mib[*cp->mib[0].version & 1];
+  int i, found_ok = 1, missing_ok = 1, first_ok = 1;
+  ci_ifid_t ifindex;
+  cicp_rowid_t id, first;
+
+  for( i = 0; i < N_ADDRS; i++ ) {
+    int found;
+    ci_ip6_addr_t ip6;
+
+    ifindex = CI_IFID_BAD;
+    if( af == AF_INET ) {
+      found = oo_cp_find_ipif_by_ip(cp, addr4(i), record_ifindex, &ifindex);
+    }
+    else {
+      addr6(ip6, i);
+      found = oo_cp_find_ipif_by_ip6(cp, ip6, record_ifindex, &ifindex);
+    }
+    if( present[i] && (! found || ifindex != addr_ifindex(i)) )
+      found_ok = 0;
+    if( ! present[i] && found )
+      missing_ok = 0;
+  }
+
+  if( af == AF_INET ) {
+    for( ifindex = IFINDEX_A; ifindex <= IFINDEX_B; ifindex++ ) {
+      first = CICP_ROWID_BAD;
+      for( id = 0; id < mib->dim->ipif_max; id++ ) {
+        if( cicp_ipif_row_is_free(&mib->ipif[id]) )
+          break;
+        if( mib->ipif[id].ifindex == ifindex ) {
+          first = id;
+          break;
+        }
+      }
+      if( cp_ipif_any_row_by_ifindex(mib, ifindex) != first )
+        first_ok = 0;
+      if( oo_cp_ifindex_to_ip(cp, ifindex) !=
+          (first == CICP_ROWID_BAD ? INADDR_ANY : mib->ipif[first].net_ip) )
+        first_ok = 0;
+    }
+  }
+
+  ok(found_ok, "%s: present %s addresses found", what,
+     af == AF_INET ? "IPv4" : "IPv6");
+  ok(missing_ok, "%s: absent %s addresses not found", what,
+     af == AF_INET ? "IPv4" : "IPv6");
+  if( af == AF_INET )
+    ok(first_ok, "%s: lookups by ifindex find the first row", what);
+}
+
+
+static void test_af(struct cp_session* s, struct oo_cplane_handle* cp, int af)
+{
+  bool present[N_ADDRS];
+  int i;
+
+  /* An initial dump into an empty table. */
+  for( i = 0; i < N_ADDRS; i++ )
+    present[i] = true;
+  add_addrs(s, af, present, true);
+  check_lookups(cp, af, present, "initial dump");
+
+  /* Removals move rows down the table. */
+  for( i = 0; i < N_ADDRS; i += 3 ) {
+    del_addr(s, af, i);
+    present[i] = false;
+  }
+  check_lookups(cp, af, present, "after removals");
+
+  /* New addresses go on the end of the table and of the chains. */
+  for( i = 0; i < N_ADDRS; i += 6 )
+    present[i] = true;
+  add_addrs(s, af, present, false);
+  check_lookups(cp, af, present, "after additions");
+
+  /* A dump that misses some addresses removes them. */
+  for( i = 0; i < N_ADDRS; i++ )
+    present[i] = (i % 5) != 0;
+  add_addrs(s, af, present, true);
+  check_lookups(cp, af, present, "after partial dump");
+}
+
+
+int main(void)
+{
+  const char mac1[] = {0x00, 0x0f, 0x53, 0x00, 0x00, 0x01};
+  const char mac2[] = {0x00, 0x0f, 0x53, 0x00, 0x00, 0x02};
+  struct cp_session s;
+  struct oo_cplane_handle cp;
+
+  cp_unit_init();
+  cp_unit_init_session(&s);
+  cp_unit_init_cp_handle(&cp, &s);
+  cp_unit_nl_handle_link_msg(&s, RTM_NEWLINK, IFINDEX_A, "ethO0", mac1);
+  cp_unit_nl_handle_link_msg(&s, RTM_NEWLINK, IFINDEX_B, "ethO1", mac2);
+
+  test_af(&s, &cp, AF_INET);
+  test_af(&s, &cp, AF_INET6);
+
+  cp_unit_destroy_session(&s);
+  done_testing();
+
+  return 0;
+}
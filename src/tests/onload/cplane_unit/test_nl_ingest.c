@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <time.h>
+
+#include "cplane_unit.h"
+#include <cplane/server.h>
+
+#include "../../tap/tap.h"
+
+
+/* Cplane ignores neighbour entries for loopback (ifindex=1), so we use
+ * different value here. */
+#define ETHO0_IFINDEX 2
+
+/* Each batch holds UPDATES consecutive state changes for each of
+ * CP_NL_BATCH_MSGS / UPDATES neighbours, as happens when the kernel's
+ * neighbour table churns. */
+#define UPDATES    4
+#define NEIGHBOURS (CP_NL_BATCH_MSGS / UPDATES)
+#define ROUNDS     20000
+#define MSG_SIZE   256
+
+static char bufs[CP_NL_BATCH_MSGS][MSG_SIZE];
+static struct iovec iov[CP_NL_BATCH_MSGS];
+static struct mmsghdr msgs[CP_NL_BATCH_MSGS];
+
+
+static void neigh_mac(uint8_t* mac, int neigh, int update, int round)
+{
+  mac[0] = 0x00;
+  mac[1] = 0x0f;
+  mac[2] = 0x53;
+  mac[3] = neigh;
+  mac[4] = update;
+  mac[5] = round;
+}
+
+
+static void build_batch(int round)
+{
+  int i;
+
+  for( i = 0; i < CP_NL_BATCH_MSGS; i++ ) {
+    uint8_t mac[6];
+    struct nlmsghdr* nlh;
+    int neigh = i % NEIGHBOURS;
+
+    neigh_mac(mac, neigh, i / NEIGHBOURS, round);
+    nlh = cp_unit_nl_build_neigh_msg(bufs[i], ETHO0_IFINDEX, RTM_NEWNEIGH,
+                                     NUD_REACHABLE, htonl(0x0a000001 + neigh),
+                                     mac, 1, 0, 0);
+    iov[i].iov_base = nlh;
+    iov[i].iov_len = MSG_SIZE;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_len = nlh->nlmsg_len;
+  }
+}
+
+
+static bool neighbours_match(struct cp_session* s, int round)
+{
+  int neigh;
+
+  for( neigh = 0; neigh < NEIGHBOURS; neigh++ ) {
+    ci_addr_t addr = CI_ADDR_FROM_IP4(htonl(0x0a000001 + neigh));
+    cicp_mac_rowid_t id = cp_mac_find_row(s, AF_INET, addr, ETHO0_IFINDEX);
+    uint8_t mac[6];
+
+    neigh_mac(mac, neigh, UPDATES - 1, round);
+    if( id == CICP_MAC_ROWID_BAD || memcmp(s->mac[id].mac, mac, 6) != 0 )
+      return false;
+  }
+  return true;
+}
+
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/* Feeds ROUNDS batches of neighbour updates to the control plane, either
+ * one datagram at a time as before, or as a batch, and reports the rate. */
+static double run(struct cp_session* s, bool batched)
+{
+  double start, elapsed = 0;
+  int round, i;
+
+  for( round = 0; round < ROUNDS; round++ ) {
+    build_batch(round);
+    start = now_ns();
+    if( batched ) {
+      cp_nl_net_handle_batch(s, msgs, CP_NL_BATCH_MSGS);
+    }
+    else {
+      for( i = 0; i < CP_NL_BATCH_MSGS; i++ )
+        cp_nl_net_handle_msg(s, iov[i].iov_base, msgs[i].msg_len);
+    }
+    elapsed += now_ns() - start;
+  }
+  return (double) ROUNDS * CP_NL_BATCH_MSGS * 1e9 / elapsed;
+}
+
+
+int main(void)
+{
+  const char mac1[] = {0x00, 0x0f, 0x53, 0x00, 0x00, 0x00};
+  struct cp_session s;
+  double rate_single, rate_batched;
+
+  cp_unit_init();
+  cp_unit_init_session(&s);
+  cp_unit_nl_handle_link_msg(&s, RTM_NEWLINK, ETHO0_IFINDEX, "ethO0", mac1);
+
+  rate_single = run(&s, false);
+  ok(neighbours_match(&s, ROUNDS - 1),
+     "Neighbours are up to date after unbatched updates");
+  cmp_ok(s.stats.nlmsg.coalesced, "==", 0, "Nothing coalesced");
+
+  rate_batched = run(&s, true);
+  ok(neighbours_match(&s, ROUNDS - 1),
+     "Neighbours are up to date after batched updates");
+  cmp_ok(s.stats.nlmsg.coalesced, "==",
+         ROUNDS * NEIGHBOURS * (UPDATES - 1),
+         "Superseded neighbour updates coalesced");
+
+  /* Timing is not reliable enough for a pass/fail criterion. */
+  diag("unbatched: %.0f msgs/s", rate_single);
+  diag("batched:   %.0f msgs/s", rate_batched);
+
+  cp_unit_destroy_session(&s);
+  done_testing();
+
+  return 0;
+}
@@ -64,6 +64,29 @@ static unsigned n_svc_arrays_used(struct cp_session* s)
 }
 
 
+static unsigned n_svc_lookups_used(struct cp_session* s)
+{
+  int i;
+  unsigned count = 0;
+  for( i = 0; i < s->mib[0].dim->svc_lookups_max; ++i )
+    if( cp_row_mask_get(s->service_lookup_used, i) )
+      count++;
+  return count;
+}
+
+
+static struct cp_svc_endpoint*
+svc_lookup_slot(struct cp_mibs* mib, cicp_mac_rowid_t rowid, int slot)
+{
+  struct cp_svc_ep_dllist* svc = &mib->svc_ep_table[rowid];
+  struct cp_svc_lookup* lookup = &mib->svc_lookups[svc->u.service.lookup_id];
+  unsigned element_id = lookup->slots[slot];
+  cicp_rowid_t array_id =
+    lookup->arrays[element_id / CP_SVC_BACKENDS_PER_ARRAY];
+  return &mib->svc_arrays[array_id].eps[element_id % CP_SVC_BACKENDS_PER_ARRAY];
+}
+
+
 static int find_dll_array_mismatch(struct cp_mibs* mib, cicp_mac_rowid_t rowid)
 {
   struct cp_svc_ep_dllist* svc = &mib->svc_ep_table[rowid];
@@ -748,6 +771,7 @@ void test_svc_load_balancing(void)
   struct cp_mibs *mib;
   cicp_mac_rowid_t id, id_b;
   unsigned count_b[n_backends];
+  unsigned n_moved = 0;
   int i;
 
   cp_unit_init_session(&s);
@@ -761,15 +785,28 @@ void test_svc_load_balancing(void)
     count_b[i] = 0;
   }
 
+  /* Flows from successive source ports spread over the backends, and each
+   * flow sticks to its backend. */
   mib = cp_get_active_mib(&s);
   for( i = 0; i < 100 * n_backends; ++i ) {
     ci_addr_sh_t dnat_addr = addr;
     ci_uint16 dnat_port = port;
-    cp_svc_check_dnat(&h, &dnat_addr, &dnat_port);
+    ci_uint32 flow_hash = onload_hash3(CI_ADDR_FROM_IP4(0x0a000001),
+                                       htons(32768 + i),
+                                       CI_ADDR_FROM_ADDR_SH(addr), htons(port),
+                                       IPPROTO_TCP);
+    cp_svc_check_dnat(&h, &dnat_addr, &dnat_port, flow_hash);
     id_b = cp_svc_find_match(mib, dnat_addr, dnat_port);
     ci_assert( CICP_MAC_ROWID_IS_VALID(id_b) );
     count_b[mib->svc_ep_table[id_b].u.backend.element_id]++;
+
+    dnat_addr = addr;
+    dnat_port = port;
+    cp_svc_check_dnat(&h, &dnat_addr, &dnat_port, flow_hash);
+    if( cp_svc_find_match(mib, dnat_addr, dnat_port) != id_b )
+      ++n_moved;
   }
+  cmp_ok(n_moved, "==", 0, "Flows keep their backend");
 
   for( i = 0; i < n_backends; ++i ) {
     if( count_b[i] < 60 )
@@ -781,6 +818,80 @@ void test_svc_load_balancing(void)
 
 
 
+void test_svc_lookup(void)
+{
+  enum { n_backends = 200 };
+  ci_addr_sh_t addr = CI_ADDR_SH_FROM_IP4(0x01010101);
+  ci_addr_sh_t addr_b = CI_ADDR_SH_FROM_IP4(0x0a000001);
+  ci_addr_sh_t addr_del;
+  ci_uint16 port = 80, port_del;
+  struct cp_session s;
+  struct cp_mibs *mib;
+  cicp_mac_rowid_t id, id_b;
+  static struct cp_svc_endpoint before[CP_SVC_LOOKUP_SIZE];
+  unsigned count[n_backends];
+  unsigned min_count, max_count, moved, held_by_deleted;
+  int i;
+
+  cp_unit_init_session(&s);
+
+  id = cp_svc_add(&s, addr, port);
+  ok(CICP_MAC_ROWID_IS_VALID(id), "Added service");
+  for( i = 0; i < n_backends; ++i ) {
+    id_b = cp_svc_backend_add(&s, id, addr_b, 8080 + i);
+    ci_assert( CICP_MAC_ROWID_IS_VALID(id_b) );
+    addr_b.ip4 = htonl(ntohl(addr_b.ip4) + 1);
+  }
+  cmp_ok(n_svc_lookups_used(&s), "==", 1, "Claimed lookup table");
+  cp_mibs_verify_identical(&s, false);
+
+  /* Every backend gets an equal share of the slots, give or take one. */
+  mib = cp_get_active_mib(&s);
+  memset(count, 0, sizeof(count));
+  for( i = 0; i < CP_SVC_LOOKUP_SIZE; ++i ) {
+    struct cp_svc_ep_dllist* svc = &mib->svc_ep_table[id];
+    count[mib->svc_lookups[svc->u.service.lookup_id].slots[i]]++;
+    before[i] = *svc_lookup_slot(mib, id, i);
+  }
+  min_count = max_count = count[0];
+  for( i = 1; i < n_backends; ++i ) {
+    min_count = CI_MIN(min_count, count[i]);
+    max_count = CI_MAX(max_count, count[i]);
+  }
+  cmp_ok(max_count - min_count, "<=", 1, "Slots are shared evenly");
+
+  /* Removing a backend that isn't at the tail of the arrays moves the
+   * tail backend in the arrays, but otherwise should hand its slots to the
+   * remaining backends and leave most other slots alone. */
+  addr_del = before[0].addr;
+  port_del = before[0].port;
+  cp_svc_backend_del(&s, id, addr_del, port_del);
+  cp_mibs_verify_identical(&s, false);
+
+  mib = cp_get_active_mib(&s);
+  moved = held_by_deleted = 0;
+  for( i = 0; i < CP_SVC_LOOKUP_SIZE; ++i ) {
+    struct cp_svc_endpoint* ep = svc_lookup_slot(mib, id, i);
+    if( CI_IPX_ADDR_EQ(ep->addr, addr_del) && ep->port == port_del )
+      held_by_deleted++;
+    if( CI_IPX_ADDR_EQ(before[i].addr, addr_del) &&
+        before[i].port == port_del )
+      continue;
+    if( !CI_IPX_ADDR_EQ(before[i].addr, ep->addr) || before[i].port != ep->port )
+      moved++;
+  }
+  cmp_ok(held_by_deleted, "==", 0, "Deleted backend has no slots");
+  cmp_ok(moved, "<", CP_SVC_LOOKUP_SIZE / 20,
+         "Few slots moved between remaining backends");
+
+  cp_svc_del(&s, id);
+  cmp_ok(n_svc_lookups_used(&s), "==", 0, "Freed lookup table");
+
+  cp_unit_destroy_session(&s);
+}
+
+
+
 int main(void)
 {
   cp_unit_init();
@@ -802,6 +913,7 @@ int main(void)
   test_svc_hash_table_full();
   test_svc_erase();
   test_svc_load_balancing();
+  test_svc_lookup();
 
   done_testing();
 }
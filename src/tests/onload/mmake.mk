@@ -1,7 +1,9 @@
 # SPDX-License-Identifier: BSD-2-Clause
 # X-SPDX-Copyright-Text: (c) Copyright 2002-2020 Xilinx, Inc.
 SUBDIRS	:= wire_order tproxy_preload hwtimestamping \
-           sync_preload l3xudp_preload
+           sync_preload l3xudp_preload udp_fanout replay_rx \
+           tcp_send_contend \
+           oo_perf
 
 ifneq ($(ONLOAD_ONLY),1)
 # These tests have dependency on kernel_compat lib,
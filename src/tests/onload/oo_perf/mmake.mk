@@ -0,0 +1,15 @@
+# SPDX-License-Identifier: BSD-2-Clause
+# X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc.
+TARGETS	:= oo_perf oo_perf_check
+
+all: $(TARGETS)
+
+oo_perf_check: oo_perf_check.sh
+	cp $< $@
+	chmod +x $@
+
+targets:
+	@echo $(TARGETS)
+
+clean:
+	@$(MakeClean)
@@ -0,0 +1,699 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+**  \brief  Regression benchmarks for the transport library
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/* A set of microbenchmarks that exercise the main paths of the transport
+ * library within a single process, so that they run anywhere Onload does,
+ * without a NIC:
+ *
+ *   EF_NO_HW=1 EF_TCP_SERVER_LOOPBACK=1 EF_TCP_CLIENT_LOOPBACK=1 \
+ *     EF_MCAST_SEND=3 onload ./oo_perf -m 239.100.1.2
+ *
+ * With loopback acceleration both ends of each TCP connection share this
+ * process's stack, and with EF_MCAST_SEND=3 so do multicast datagrams.  The
+ * oo_perf_check script sets this up and compares with a baseline.
+ *
+ * Each result is printed as "<name> <value> <unit>".  Rates ("/s") and
+ * percentages are better when higher; all others are better when lower.  Given a
+ * baseline file in the same format (-b), each line also gets the baseline
+ * value, the change and a verdict, and the exit status is 1 if any result is
+ * worse than the baseline by more than the threshold (-T).
+ *
+ * Tests:
+ *   tcp_pingpong  round trip over a TCP connection
+ *   pipe_pingpong round trip over a pair of pipes
+ *   tcp_bulk      one-way streaming throughput
+ *   udp           datagram send and receive rates
+ *   tcp_churn     connect, accept and close
+ *   epoll         epoll_wait() with one ready fd among many idle ones
+ *   poll_idle     poll() of an idle socket, i.e. a stack poll with no events
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+
+#define TRY(x)                                                  \
+  do {                                                          \
+    if( (x) < 0 ) {                                             \
+      fprintf(stderr, "ERROR: %s failed at %s:%d (errno=%d %s)\n", \
+              #x, __FILE__, __LINE__, errno, strerror(errno));  \
+      exit(1);                                                  \
+    }                                                           \
+  } while( 0 )
+
+
+static struct in_addr cfg_addr;
+static struct in_addr cfg_mcast;
+static int cfg_have_mcast;
+static int cfg_size = 1;
+static double cfg_scale = 1.0;
+static const char* cfg_tests;
+static const char* cfg_baseline;
+static double cfg_threshold = 5.0;
+
+static int n_regressions;
+
+
+/**********************************************************************
+ * Results and baseline comparison
+ */
+
+struct baseline {
+  char name[64];
+  double value;
+};
+
+static struct baseline* baselines;
+static int n_baselines;
+
+
+static void load_baseline(const char* path)
+{
+  FILE* f = fopen(path, "r");
+  char line[256];
+
+  if( f == NULL ) {
+    fprintf(stderr, "ERROR: can't open baseline %s: %s\n", path,
+            strerror(errno));
+    exit(1);
+  }
+  while( fgets(line, sizeof(line), f) != NULL ) {
+    struct baseline b;
+    if( line[0] == '#' || sscanf(line, "%63s %lf", b.name, &b.value) != 2 )
+      continue;
+    baselines = realloc(baselines, (n_baselines + 1) * sizeof(*baselines));
+    if( baselines == NULL ) {
+      fprintf(stderr, "ERROR: out of memory\n");
+      exit(1);
+    }
+    baselines[n_baselines++] = b;
+  }
+  fclose(f);
+}
+
+
+static const struct baseline* find_baseline(const char* name)
+{
+  int i;
+  for( i = 0; i < n_baselines; ++i )
+    if( ! strcmp(baselines[i].name, name) )
+      return &baselines[i];
+  return NULL;
+}
+
+
+static void report(const char* name, double value, const char* unit)
+{
+  const struct baseline* b = find_baseline(name);
+  int higher_better = strstr(unit, "/s") != NULL || ! strcmp(unit, "%");
+  double change;
+
+  printf("%-28s %14.1f %-8s", name, value, unit);
+  if( b != NULL && b->value != 0 ) {
+    /* Positive change is always an improvement. */
+    change = (value - b->value) / b->value * 100.0;
+    if( ! higher_better )
+      change = -change;
+    printf(" %14.1f %+7.1f%% %s", b->value, change,
+           change < -cfg_threshold ? "REGRESSED" :
+           change > cfg_threshold ? "improved" : "ok");
+    if( change < -cfg_threshold )
+      ++n_regressions;
+  }
+  else if( cfg_baseline != NULL ) {
+    printf(" %14s %8s %s", "-", "-", "new");
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+
+/**********************************************************************
+ * Helpers
+ */
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static int scaled(int n)
+{
+  int v = n * cfg_scale;
+  return v > 0 ? v : 1;
+}
+
+
+static int cmp_double(const void* a, const void* b)
+{
+  double x = *(const double*) a, y = *(const double*) b;
+  return x < y ? -1 : x > y;
+}
+
+
+static void readn(int fd, char* buf, int len)
+{
+  int n;
+  for( ; len > 0; len -= n, buf += n ) {
+    n = read(fd, buf, len);
+    if( n <= 0 ) {
+      fprintf(stderr, "ERROR: read returned %d (errno=%d %s)\n", n, errno,
+              strerror(errno));
+      exit(1);
+    }
+  }
+}
+
+
+static void writen(int fd, const char* buf, int len)
+{
+  int n;
+  for( ; len > 0; len -= n, buf += n )
+    TRY(n = write(fd, buf, len));
+}
+
+
+static int tcp_listener(struct sockaddr_in* sa)
+{
+  socklen_t sa_len = sizeof(*sa);
+  int one = 1;
+  int s;
+
+  TRY(s = socket(AF_INET, SOCK_STREAM, 0));
+  TRY(setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)));
+  memset(sa, 0, sizeof(*sa));
+  sa->sin_family = AF_INET;
+  sa->sin_addr = cfg_addr;
+  TRY(bind(s, (struct sockaddr*) sa, sizeof(*sa)));
+  TRY(listen(s, 128));
+  TRY(getsockname(s, (struct sockaddr*) sa, &sa_len));
+  return s;
+}
+
+
+/* Connects a TCP pair: *cli is the connecting end, *srv the accepted one. */
+static void tcp_pair(int lsn, const struct sockaddr_in* sa, int* cli,
+                     int* srv)
+{
+  int one = 1;
+
+  TRY(*cli = socket(AF_INET, SOCK_STREAM, 0));
+  TRY(connect(*cli, (const struct sockaddr*) sa, sizeof(*sa)));
+  TRY(*srv = accept(lsn, NULL, NULL));
+  TRY(setsockopt(*cli, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)));
+  TRY(setsockopt(*srv, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)));
+}
+
+
+/**********************************************************************
+ * Ping-pong latency
+ */
+
+struct pong_args {
+  int rfd, wfd;
+  int iters;
+};
+
+
+static void* pong_thread(void* arg)
+{
+  struct pong_args* a = arg;
+  char* buf = malloc(cfg_size);
+  int i;
+
+  for( i = 0; i < a->iters; ++i ) {
+    readn(a->rfd, buf, cfg_size);
+    writen(a->wfd, buf, cfg_size);
+  }
+  free(buf);
+  return NULL;
+}
+
+
+/* Reports the mean and 99th percentile of the round trip time between this
+ * thread, writing to [wfd] and reading from [rfd], and a thread echoing from
+ * [peer_rfd] to [peer_wfd]. */
+static void pingpong(const char* name, int rfd, int wfd,
+                     int peer_rfd, int peer_wfd)
+{
+  const int warm = 1000;
+  const int iters = scaled(100000);
+  struct pong_args args = { peer_rfd, peer_wfd, warm + iters };
+  double* rtt = malloc(iters * sizeof(*rtt));
+  char* buf = calloc(1, cfg_size);
+  char metric[64];
+  double sum = 0, t;
+  pthread_t tid;
+  int i;
+
+  TRY(pthread_create(&tid, NULL, pong_thread, &args) == 0 ? 0 : -1);
+  for( i = 0; i < warm; ++i ) {
+    writen(wfd, buf, cfg_size);
+    readn(rfd, buf, cfg_size);
+  }
+  for( i = 0; i < iters; ++i ) {
+    t = now_ns();
+    writen(wfd, buf, cfg_size);
+    readn(rfd, buf, cfg_size);
+    rtt[i] = now_ns() - t;
+    sum += rtt[i];
+  }
+  pthread_join(tid, NULL);
+
+  qsort(rtt, iters, sizeof(*rtt), cmp_double);
+  snprintf(metric, sizeof(metric), "%s.rtt_mean", name);
+  report(metric, sum / iters, "ns");
+  snprintf(metric, sizeof(metric), "%s.rtt_p50", name);
+  report(metric, rtt[iters / 2], "ns");
+  snprintf(metric, sizeof(metric), "%s.rtt_p99", name);
+  report(metric, rtt[(int) (iters * 0.99)], "ns");
+  free(rtt);
+  free(buf);
+}
+
+
+static void test_tcp_pingpong(void)
+{
+  struct sockaddr_in sa;
+  int lsn = tcp_listener(&sa);
+  int cli, srv;
+
+  tcp_pair(lsn, &sa, &cli, &srv);
+  pingpong("tcp_pingpong", cli, cli, srv, srv);
+  close(cli);
+  close(srv);
+  close(lsn);
+}
+
+
+static void test_pipe_pingpong(void)
+{
+  int ping[2], pong[2];
+
+  TRY(pipe(ping));
+  TRY(pipe(pong));
+  pingpong("pipe_pingpong", pong[0], ping[1], ping[0], pong[1]);
+  close(ping[0]);
+  close(ping[1]);
+  close(pong[0]);
+  close(pong[1]);
+}
+
+
+/**********************************************************************
+ * Bulk throughput
+ */
+
+#define BULK_CHUNK  (64 * 1024)
+
+struct bulk_args {
+  int fd;
+  long bytes;
+};
+
+
+static void* bulk_sender(void* arg)
+{
+  struct bulk_args* a = arg;
+  char* buf = calloc(1, BULK_CHUNK);
+  long left;
+
+  for( left = a->bytes; left > 0; left -= BULK_CHUNK )
+    writen(a->fd, buf, left < BULK_CHUNK ? left : BULK_CHUNK);
+  free(buf);
+  return NULL;
+}
+
+
+static void test_tcp_bulk(void)
+{
+  struct sockaddr_in sa;
+  int lsn = tcp_listener(&sa);
+  struct bulk_args args;
+  char* buf = malloc(BULK_CHUNK);
+  long got = 0;
+  double t;
+  pthread_t tid;
+  int cli, srv, n;
+
+  tcp_pair(lsn, &sa, &cli, &srv);
+  args.fd = cli;
+  args.bytes = (long) scaled(2048) * 1024 * 1024;
+
+  t = now_ns();
+  TRY(pthread_create(&tid, NULL, bulk_sender, &args) == 0 ? 0 : -1);
+  while( got < args.bytes ) {
+    TRY(n = read(srv, buf, BULK_CHUNK));
+    if( n == 0 )
+      break;
+    got += n;
+  }
+  t = now_ns() - t;
+  pthread_join(tid, NULL);
+
+  report("tcp_bulk.throughput", got / t * 1e9 / (1024 * 1024), "MiB/s");
+  free(buf);
+  close(cli);
+  close(srv);
+  close(lsn);
+}
+
+
+/**********************************************************************
+ * UDP rates
+ */
+
+struct udp_args {
+  int fd;
+  int msgs;
+  double elapsed;
+};
+
+
+static void* udp_sender(void* arg)
+{
+  struct udp_args* a = arg;
+  char* buf = calloc(1, cfg_size);
+  double t = now_ns();
+  int i;
+
+  for( i = 0; i < a->msgs; ++i )
+    TRY(send(a->fd, buf, cfg_size, 0));
+  a->elapsed = now_ns() - t;
+  free(buf);
+  return NULL;
+}
+
+
+static void test_udp(void)
+{
+  struct sockaddr_in sa;
+  socklen_t sa_len = sizeof(sa);
+  struct timeval tv = { 0, 200000 };
+  struct udp_args args;
+  char* buf = malloc(cfg_size > 0 ? cfg_size : 1);
+  double first = 0, last = 0;
+  pthread_t tid;
+  int rx, tx, got = 0;
+
+  TRY(rx = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(tx = socket(AF_INET, SOCK_DGRAM, 0));
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr = cfg_have_mcast ? cfg_mcast : cfg_addr;
+  TRY(bind(rx, (struct sockaddr*) &sa, sizeof(sa)));
+  TRY(getsockname(rx, (struct sockaddr*) &sa, &sa_len));
+  if( cfg_have_mcast ) {
+    struct ip_mreq mreq;
+    unsigned char loop = 1;
+    mreq.imr_multiaddr = cfg_mcast;
+    mreq.imr_interface = cfg_addr;
+    TRY(setsockopt(rx, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)));
+    TRY(setsockopt(tx, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)));
+  }
+  TRY(setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)));
+  TRY(connect(tx, (struct sockaddr*) &sa, sizeof(sa)));
+
+  args.fd = tx;
+  args.msgs = scaled(1000000);
+  TRY(pthread_create(&tid, NULL, udp_sender, &args) == 0 ? 0 : -1);
+  /* The receiver may not keep up, so count what arrives until the stream
+   * goes quiet. */
+  while( recv(rx, buf, cfg_size, 0) >= 0 ) {
+    if( got++ == 0 )
+      first = now_ns();
+    last = now_ns();
+  }
+  pthread_join(tid, NULL);
+
+  report("udp.send_rate", args.msgs / args.elapsed * 1e9, "msg/s");
+  if( got > 1 )
+    report("udp.recv_rate", (got - 1) / (last - first) * 1e9, "msg/s");
+  report("udp.delivered", 100.0 * got / args.msgs, "%");
+  free(buf);
+  close(rx);
+  close(tx);
+}
+
+
+/**********************************************************************
+ * Connection churn
+ */
+
+static void test_tcp_churn(void)
+{
+  struct sockaddr_in sa;
+  int lsn = tcp_listener(&sa);
+  const int conns = scaled(5000);
+  double t;
+  int i, cli, srv;
+
+  t = now_ns();
+  for( i = 0; i < conns; ++i ) {
+    TRY(cli = socket(AF_INET, SOCK_STREAM, 0));
+    TRY(connect(cli, (struct sockaddr*) &sa, sizeof(sa)));
+    TRY(srv = accept(lsn, NULL, NULL));
+    /* Close the accepted end first so that TIME_WAIT lands on the
+     * listener's port rather than using up ephemeral ports. */
+    close(srv);
+    close(cli);
+  }
+  t = now_ns() - t;
+
+  report("tcp_churn.rate", conns / t * 1e9, "conn/s");
+  close(lsn);
+}
+
+
+/**********************************************************************
+ * epoll_wait() scaling
+ */
+
+static void test_epoll(void)
+{
+  struct sockaddr_in sa;
+  struct epoll_event ev, evs[8];
+  struct rlimit rl;
+  int lsn = tcp_listener(&sa);
+  const int iters = scaled(100000);
+  int max_fds = 4096;
+  int* idle;
+  int n_idle = 0, n, i, ep, cli, srv;
+  char metric[64];
+  double t;
+
+  /* Leave room for the stack's own fds. */
+  if( getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < max_fds + 64 )
+    max_fds = rl.rlim_cur > 128 ? rl.rlim_cur - 64 : 64;
+  idle = calloc(max_fds, sizeof(*idle));
+
+  /* One connection always has a byte waiting. */
+  tcp_pair(lsn, &sa, &cli, &srv);
+  writen(cli, "x", 1);
+  TRY(ep = epoll_create(1));
+  ev.events = EPOLLIN;
+  ev.data.fd = srv;
+  TRY(epoll_ctl(ep, EPOLL_CTL_ADD, srv, &ev));
+
+  for( n = 1; n <= max_fds; n *= 4 ) {
+    /* Bring the number of idle sockets up to n - 1. */
+    for( ; n_idle < n - 1; ++n_idle ) {
+      struct sockaddr_in usa;
+      TRY(idle[n_idle] = socket(AF_INET, SOCK_DGRAM, 0));
+      memset(&usa, 0, sizeof(usa));
+      usa.sin_family = AF_INET;
+      usa.sin_addr = cfg_addr;
+      TRY(bind(idle[n_idle], (struct sockaddr*) &usa, sizeof(usa)));
+      ev.events = EPOLLIN;
+      ev.data.fd = idle[n_idle];
+      TRY(epoll_ctl(ep, EPOLL_CTL_ADD, idle[n_idle], &ev));
+    }
+
+    for( i = 0; i < 1000; ++i )
+      epoll_wait(ep, evs, 8, 0);
+    t = now_ns();
+    for( i = 0; i < iters; ++i )
+      if( epoll_wait(ep, evs, 8, 0) != 1 ) {
+        fprintf(stderr, "ERROR: epoll_wait didn't find the ready fd\n");
+        exit(1);
+      }
+    t = now_ns() - t;
+    snprintf(metric, sizeof(metric), "epoll.wait_%d", n);
+    report(metric, t / iters, "ns");
+  }
+
+  for( i = 0; i < n_idle; ++i )
+    close(idle[i]);
+  free(idle);
+  close(ep);
+  close(cli);
+  close(srv);
+  close(lsn);
+}
+
+
+/**********************************************************************
+ * Idle poll
+ */
+
+static void test_poll_idle(void)
+{
+  struct sockaddr_in sa;
+  int lsn = tcp_listener(&sa);
+  const int iters = scaled(1000000);
+  struct pollfd pfd;
+  double t;
+  int i, cli, srv;
+
+  tcp_pair(lsn, &sa, &cli, &srv);
+  pfd.fd = srv;
+  pfd.events = POLLIN;
+
+  for( i = 0; i < 1000; ++i )
+    poll(&pfd, 1, 0);
+  t = now_ns();
+  for( i = 0; i < iters; ++i )
+    poll(&pfd, 1, 0);
+  t = now_ns() - t;
+
+  report("poll_idle.poll", t / iters, "ns");
+  close(cli);
+  close(srv);
+  close(lsn);
+}
+
+
+/**********************************************************************
+ * Main
+ */
+
+static const struct {
+  const char* name;
+  void (*fn)(void);
+} tests[] = {
+  { "tcp_pingpong",  test_tcp_pingpong },
+  { "pipe_pingpong", test_pipe_pingpong },
+  { "tcp_bulk",      test_tcp_bulk },
+  { "udp",           test_udp },
+  { "tcp_churn",     test_tcp_churn },
+  { "epoll",         test_epoll },
+  { "poll_idle",     test_poll_idle },
+};
+
+
+static int selected(const char* name)
+{
+  const char* p;
+  size_t len = strlen(name);
+
+  if( cfg_tests == NULL )
+    return 1;
+  for( p = cfg_tests; (p = strstr(p, name)) != NULL; p += len )
+    if( (p == cfg_tests || p[-1] == ',') && (p[len] == ',' || p[len] == 0) )
+      return 1;
+  return 0;
+}
+
+
+static void usage(const char* prog)
+{
+  int i;
+
+  fprintf(stderr, "usage: %s [options]\n"
+          "  -t <t1,t2..>  tests to run (default all)\n"
+          "  -a <addr>     local address (default 127.0.0.1)\n"
+          "  -m <group>    multicast group for the UDP test (default "
+          "unicast to -a)\n"
+          "  -s <bytes>    message size for ping-pong and UDP (default %d)\n"
+          "  -x <factor>   scale iteration counts (default %.1f)\n"
+          "  -b <file>     baseline output to compare with\n"
+          "  -T <pct>      regression threshold (default %.1f%%)\n"
+          "tests:", prog, cfg_size, cfg_scale, cfg_threshold);
+  for( i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i )
+    fprintf(stderr, " %s", tests[i].name);
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int i, c;
+
+  inet_aton("127.0.0.1", &cfg_addr);
+
+  while( (c = getopt(argc, argv, "t:a:m:s:x:b:T:")) != -1 )
+    switch( c ) {
+    case 't':
+      cfg_tests = optarg;
+      break;
+    case 'a':
+      if( ! inet_aton(optarg, &cfg_addr) )
+        usage(argv[0]);
+      break;
+    case 'm':
+      if( ! inet_aton(optarg, &cfg_mcast) )
+        usage(argv[0]);
+      cfg_have_mcast = 1;
+      break;
+    case 's':
+      cfg_size = atoi(optarg);
+      break;
+    case 'x':
+      cfg_scale = atof(optarg);
+      break;
+    case 'b':
+      cfg_baseline = optarg;
+      break;
+    case 'T':
+      cfg_threshold = atof(optarg);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  if( optind != argc || cfg_size < 1 || cfg_size > 65000 || cfg_scale <= 0 )
+    usage(argv[0]);
+
+  if( cfg_baseline != NULL )
+    load_baseline(cfg_baseline);
+
+  printf("# %-26s %14s %-8s", "name", "value", "unit");
+  if( cfg_baseline != NULL )
+    printf(" %14s %8s %s", "baseline", "change", "verdict");
+  printf("\n");
+
+  for( i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i )
+    if( selected(tests[i].name) )
+      tests[i].fn();
+
+  if( n_regressions ) {
+    printf("# %d regression%s beyond %.1f%%\n", n_regressions,
+           n_regressions == 1 ? "" : "s", cfg_threshold);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,359 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+**  \brief  Per-packet receive cost against a replaying test NIC
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/* Measures the CPU cost of receiving a packet without real hardware.  The
+ * efct_test driver provides a software NIC whose receive queues can replay a
+ * pcap stream at a set rate (see src/tests/resource/efct_test).  This
+ * benchmark builds a stream of UDP or multicast datagrams addressed to the
+ * test interface, loads it into the device through configfs, receives it on
+ * an Onload socket and reports the CPU time consumed per packet:
+ *
+ *   onload ./replay_rx_bench -i <test-if> -m udp -n 1000000 -r 500000
+ *
+ * The device must already be registered with
+ * "mkdir /sys/kernel/config/efct_test/<test-if>", and this must run as root
+ * to write to configfs.  For a meaningful CPU figure run without spinning
+ * (EF_POLL_USEC=0): with spinning the process is busy whatever the load and
+ * the figure degenerates to wall time.  Setting the device's tx_mode to
+ * "sink" keeps transmitted packets (e.g. IGMP) out of the kernel.
+ *
+ * Output is one "key: value" per line so that CI can compare runs.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+
+#define TRY(x)                                                  \
+  do {                                                          \
+    if( (x) < 0 ) {                                             \
+      fprintf(stderr, "ERROR: %s failed at %s:%d (errno=%d %s)\n", \
+              #x, __FILE__, __LINE__, errno, strerror(errno));  \
+      exit(1);                                                  \
+    }                                                           \
+  } while( 0 )
+
+
+#define CONFIGFS_ROOT  "/sys/kernel/config/efct_test"
+
+static const char* cfg_ifname;
+static int cfg_mcast;
+static struct in_addr cfg_group;
+static int cfg_port = 8123;
+static int cfg_pkts = 1000000;
+static unsigned cfg_pps = 1000000;
+static int cfg_size = 64;
+static int cfg_flows = 1;
+static int cfg_rxq = 0;
+static int cfg_configure = 1;
+
+
+static void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s -i <ifname> [options]\n"
+          "  -m udp|mcast  traffic to replay (default udp)\n"
+          "  -g <group>    multicast group (default 239.100.1.1)\n"
+          "  -p <port>     UDP port (default %d)\n"
+          "  -n <pkts>     packets to inject (default %d)\n"
+          "  -r <pps>      injection rate (default %u)\n"
+          "  -s <bytes>    payload size (default %d)\n"
+          "  -f <flows>    distinct source addresses (default %d)\n"
+          "  -q <rxq>      device receive queue to drive (default %d)\n"
+          "  -c            don't configure the device, just receive\n",
+          prog, cfg_port, cfg_pkts, cfg_pps, cfg_size, cfg_flows, cfg_rxq);
+  exit(1);
+}
+
+
+static void get_if_addrs(const char* ifname, struct in_addr* addr,
+                         unsigned char* mac)
+{
+  struct ifreq ifr;
+  int s;
+
+  TRY(s = socket(AF_INET, SOCK_DGRAM, 0));
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name) - 1);
+  TRY(ioctl(s, SIOCGIFADDR, &ifr));
+  *addr = ((struct sockaddr_in*) &ifr.ifr_addr)->sin_addr;
+  TRY(ioctl(s, SIOCGIFHWADDR, &ifr));
+  memcpy(mac, ifr.ifr_hwaddr.sa_data, 6);
+  close(s);
+}
+
+
+static uint16_t ip_csum(const void* hdr, int len)
+{
+  const uint16_t* p = hdr;
+  uint32_t sum = 0;
+
+  for( ; len > 1; len -= 2 )
+    sum += *p++;
+  while( sum >> 16 )
+    sum = (sum & 0xffff) + (sum >> 16);
+  return ~sum;
+}
+
+
+/* Builds a pcap file holding one datagram for each flow. */
+static void* build_pcap(struct in_addr daddr, const unsigned char* dmac,
+                        size_t* len_out)
+{
+  const int frame_len = 14 + 20 + 8 + cfg_size;
+  const size_t rec_len = 16 + frame_len;
+  unsigned char* buf;
+  unsigned char* p;
+  int f;
+
+  *len_out = 24 + cfg_flows * rec_len;
+  buf = calloc(1, *len_out);
+  if( buf == NULL ) {
+    fprintf(stderr, "ERROR: out of memory\n");
+    exit(1);
+  }
+
+  /* Native-endian pcap header with Ethernet link type */
+  *(uint32_t*) (buf + 0) = 0xa1b2c3d4;
+  *(uint16_t*) (buf + 4) = 2;
+  *(uint16_t*) (buf + 6) = 4;
+  *(uint32_t*) (buf + 16) = 65535;
+  *(uint32_t*) (buf + 20) = 1;
+
+  for( f = 0, p = buf + 24; f < cfg_flows; ++f, p += rec_len ) {
+    unsigned char* eth = p + 16;
+    unsigned char* ip = eth + 14;
+    unsigned char* udp = ip + 20;
+    uint32_t saddr = htonl(0xc0000200 + 1 + f % 254); /* 192.0.2.x */
+
+    *(uint32_t*) (p + 8) = frame_len;
+    *(uint32_t*) (p + 12) = frame_len;
+
+    if( cfg_mcast ) {
+      uint32_t g = ntohl(daddr.s_addr);
+      unsigned char mmac[6] = { 0x01, 0x00, 0x5e, (g >> 16) & 0x7f,
+                                (g >> 8) & 0xff, g & 0xff };
+      memcpy(eth, mmac, 6);
+    }
+    else {
+      memcpy(eth, dmac, 6);
+    }
+    memcpy(eth + 6, "\x02\x00\x00\x00\x00\x01", 6);
+    eth[12] = 0x08;
+    eth[13] = 0x00;
+
+    ip[0] = 0x45;
+    *(uint16_t*) (ip + 2) = htons(20 + 8 + cfg_size);
+    *(uint16_t*) (ip + 6) = htons(0x4000);
+    ip[8] = 64;
+    ip[9] = IPPROTO_UDP;
+    memcpy(ip + 12, &saddr, 4);
+    memcpy(ip + 16, &daddr.s_addr, 4);
+    *(uint16_t*) (ip + 10) = ip_csum(ip, 20);
+
+    *(uint16_t*) (udp + 0) = htons(10000 + f);
+    *(uint16_t*) (udp + 2) = htons(cfg_port);
+    *(uint16_t*) (udp + 4) = htons(8 + cfg_size);
+    /* A zero checksum means none for UDP over IPv4. */
+  }
+  return buf;
+}
+
+
+static void write_attr(const char* attr, const void* data, size_t len)
+{
+  char path[256];
+  ssize_t rc;
+  int fd;
+
+  snprintf(path, sizeof(path), CONFIGFS_ROOT "/%s/rx%d/%s",
+           cfg_ifname, cfg_rxq, attr);
+  fd = open(path, O_WRONLY);
+  if( fd < 0 ) {
+    fprintf(stderr, "ERROR: can't open %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+  while( len > 0 ) {
+    TRY(rc = write(fd, data, len));
+    data = (const char*) data + rc;
+    len -= rc;
+  }
+  /* configfs applies binary attributes on close */
+  TRY(close(fd));
+}
+
+
+static void write_attr_uint(const char* attr, unsigned v)
+{
+  char buf[16];
+  write_attr(attr, buf, snprintf(buf, sizeof(buf), "%u\n", v));
+}
+
+
+static int make_receiver(struct in_addr local)
+{
+  struct sockaddr_in sa;
+  struct timeval tv = { 1, 0 };
+  int s;
+
+  TRY(s = socket(AF_INET, SOCK_DGRAM, 0));
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(cfg_port);
+  sa.sin_addr = cfg_mcast ? cfg_group : local;
+  TRY(bind(s, (struct sockaddr*) &sa, sizeof(sa)));
+  if( cfg_mcast ) {
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr = cfg_group;
+    mreq.imr_interface = local;
+    TRY(setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)));
+  }
+  /* The stream is over once nothing has arrived for a second. */
+  TRY(setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)));
+  return s;
+}
+
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static double cpu_ns(void)
+{
+  struct rusage ru;
+  TRY(getrusage(RUSAGE_SELF, &ru));
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e9 +
+         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e3;
+}
+
+
+int main(int argc, char* argv[])
+{
+  struct in_addr local;
+  unsigned char mac[6];
+  double wall_start = 0, wall_end = 0, cpu_start = 0, cpu_end;
+  long got = 0;
+  char* buf;
+  int s, c;
+
+  inet_aton("239.100.1.1", &cfg_group);
+
+  while( (c = getopt(argc, argv, "i:m:g:p:n:r:s:f:q:c")) != -1 )
+    switch( c ) {
+    case 'i':
+      cfg_ifname = optarg;
+      break;
+    case 'm':
+      if( ! strcmp(optarg, "udp") )
+        cfg_mcast = 0;
+      else if( ! strcmp(optarg, "mcast") )
+        cfg_mcast = 1;
+      else
+        usage(argv[0]);
+      break;
+    case 'g':
+      if( ! inet_aton(optarg, &cfg_group) )
+        usage(argv[0]);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 'n':
+      cfg_pkts = atoi(optarg);
+      break;
+    case 'r':
+      cfg_pps = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      cfg_size = atoi(optarg);
+      break;
+    case 'f':
+      cfg_flows = atoi(optarg);
+      break;
+    case 'q':
+      cfg_rxq = atoi(optarg);
+      break;
+    case 'c':
+      cfg_configure = 0;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  if( optind != argc || cfg_ifname == NULL || cfg_pkts < 1 || cfg_pps < 1 ||
+      cfg_size < 1 || cfg_size > 1400 || cfg_flows < 1 )
+    usage(argv[0]);
+
+  get_if_addrs(cfg_ifname, &local, mac);
+  buf = calloc(1, cfg_size);
+  if( buf == NULL ) {
+    fprintf(stderr, "ERROR: out of memory\n");
+    return 1;
+  }
+
+  /* The socket must exist, and so its filter be in place, before the
+   * device starts injecting. */
+  s = make_receiver(local);
+
+  if( cfg_configure ) {
+    size_t len;
+    void* pcap = build_pcap(cfg_mcast ? cfg_group : local, mac, &len);
+    write_attr("pcap", pcap, len);
+    write_attr_uint("pps", cfg_pps);
+    free(pcap);
+    /* Writing num_pkts restarts the count, and so starts the stream. */
+    write_attr_uint("num_pkts", cfg_pkts);
+  }
+
+  while( got < cfg_pkts ) {
+    if( recv(s, buf, cfg_size, 0) < 0 ) {
+      if( errno == EAGAIN || errno == EWOULDBLOCK )
+        break;
+      TRY(-1);
+    }
+    /* Time from the first packet, so that setup isn't counted. */
+    if( got++ == 0 ) {
+      wall_start = now_ns();
+      cpu_start = cpu_ns();
+    }
+    wall_end = now_ns();
+  }
+  /* If the stream fell short the loop ended with a timeout, but blocking
+   * costs no CPU time. */
+  cpu_end = cpu_ns();
+
+  printf("traffic: %s\n", cfg_mcast ? "mcast" : "udp");
+  printf("payload_bytes: %d\n", cfg_size);
+  printf("flows: %d\n", cfg_flows);
+  printf("rate_pps: %u\n", cfg_pps);
+  printf("injected: %d\n", cfg_pkts);
+  printf("received: %ld\n", got);
+  if( got > 1 ) {
+    printf("cpu_ns_per_pkt: %.1f\n", (cpu_end - cpu_start) / (got - 1));
+    printf("wall_ns_per_pkt: %.1f\n", (wall_end - wall_start) / (got - 1));
+  }
+  return got == cfg_pkts ? 0 : 2;
+}
@@ -0,0 +1,282 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+**  \brief  Throughput of many threads writing to one TCP socket
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/* Measures how TCP send() scales when several threads write small messages
+ * to the same connected socket, as an order gateway does.  Both ends of the
+ * connection live in this process, so with Onload they share a stack and
+ * no NIC is needed:
+ *
+ *   EF_NO_HW=1 EF_TCP_CLIENT_LOOPBACK=1 EF_TCP_SERVER_LOOPBACK=1 \
+ *     onload ./tcp_send_contend_bench -t 16
+ *
+ * For 1, 2, 4, ... writer threads the benchmark sends a fixed number of
+ * messages in total and reports the time per message and the message
+ * rate.  Each message carries its writer's id and a sequence number, and
+ * the benchmark fails if any message arrives torn or out of order with
+ * respect to the earlier messages from the same writer.  Compare the stack's
+ * tcp_send_ni_lock_contends and tcp_send_defer_joined counters
+ * (onload_stackdump lots) to see which path the writers took.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+
+#define TRY(x)                                                  \
+  do {                                                          \
+    if( (x) < 0 ) {                                             \
+      fprintf(stderr, "ERROR: %s failed at %s:%d (errno=%d %s)\n", \
+              #x, __FILE__, __LINE__, errno, strerror(errno));  \
+      exit(1);                                                  \
+    }                                                           \
+  } while( 0 )
+
+#define MAX_WRITERS  64
+
+
+static struct in_addr cfg_addr;
+static int cfg_port = 8124;
+static int cfg_max_writers = 16;
+static int cfg_msgs = 1000000;
+static int cfg_size = 64;
+
+static int sender;
+static int receiver;
+static int n_writers;
+static int msgs_per_writer;
+static pthread_barrier_t start_barrier;
+
+/* Each message starts with this header, and the rest of it is filled with
+ * the low byte of the writer's id. */
+struct msg_hdr {
+  uint32_t writer;
+  uint32_t seq;
+};
+
+
+static void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s [options]\n"
+          "  -a <addr>    local address to connect over (default 127.0.0.1)\n"
+          "  -p <port>    TCP port (default %d)\n"
+          "  -t <n>       maximum number of writer threads (default %d)\n"
+          "  -m <msgs>    messages per measurement (default %d)\n"
+          "  -s <bytes>   message size (default %d, at least %d)\n",
+          prog, cfg_port, cfg_max_writers, cfg_msgs, cfg_size,
+          (int) sizeof(struct msg_hdr));
+  exit(1);
+}
+
+
+static void make_connection(void)
+{
+  struct sockaddr_in sa;
+  int one = 1;
+  int listener;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(cfg_port);
+  sa.sin_addr = cfg_addr;
+
+  TRY(listener = socket(AF_INET, SOCK_STREAM, 0));
+  TRY(setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)));
+  TRY(bind(listener, (struct sockaddr*) &sa, sizeof(sa)));
+  TRY(listen(listener, 1));
+
+  TRY(sender = socket(AF_INET, SOCK_STREAM, 0));
+  TRY(setsockopt(sender, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)));
+  TRY(connect(sender, (struct sockaddr*) &sa, sizeof(sa)));
+  TRY(receiver = accept(listener, NULL, NULL));
+  close(listener);
+}
+
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void* writer_fn(void* arg)
+{
+  char* buf = calloc(1, cfg_size);
+  struct msg_hdr hdr;
+  int i, rc;
+
+  if( buf == NULL ) {
+    fprintf(stderr, "ERROR: out of memory\n");
+    exit(1);
+  }
+  memset(buf, (uintptr_t) arg, cfg_size);
+  hdr.writer = (uintptr_t) arg;
+  pthread_barrier_wait(&start_barrier);
+
+  for( i = 0; i < msgs_per_writer; ++i ) {
+    hdr.seq = i;
+    memcpy(buf, &hdr, sizeof(hdr));
+    TRY(rc = send(sender, buf, cfg_size, 0));
+    if( rc != cfg_size ) {
+      fprintf(stderr, "ERROR: short send (%d of %d bytes)\n", rc, cfg_size);
+      exit(1);
+    }
+  }
+
+  free(buf);
+  return NULL;
+}
+
+
+/* Checks that a message is whole, and is the next one from its writer. */
+static void check_msg(const char* msg, uint32_t* next_seq)
+{
+  struct msg_hdr hdr;
+  int i;
+
+  memcpy(&hdr, msg, sizeof(hdr));
+  if( hdr.writer >= n_writers ) {
+    fprintf(stderr, "ERROR: message from unknown writer %u\n", hdr.writer);
+    exit(1);
+  }
+  if( hdr.seq != next_seq[hdr.writer] ) {
+    fprintf(stderr, "ERROR: writer %u: message %u arrived when %u was "
+            "expected\n", hdr.writer, hdr.seq, next_seq[hdr.writer]);
+    exit(1);
+  }
+  for( i = sizeof(hdr); i < cfg_size; ++i )
+    if( (unsigned char) msg[i] != (unsigned char) hdr.writer ) {
+      fprintf(stderr, "ERROR: writer %u: message %u is corrupt at byte %d\n",
+              hdr.writer, hdr.seq, i);
+      exit(1);
+    }
+  ++next_seq[hdr.writer];
+}
+
+
+/* Reads and checks every message sent in a round. */
+static void receive_all(long n_msgs)
+{
+  static char buf[65536];
+  uint32_t next_seq[MAX_WRITERS] = { 0 };
+  long n_bytes = n_msgs * cfg_size;
+  int fill = 0, off, rc;
+
+  while( n_bytes > 0 ) {
+    TRY(rc = recv(receiver, buf + fill, sizeof(buf) - fill, 0));
+    if( rc == 0 ) {
+      fprintf(stderr, "ERROR: connection closed\n");
+      exit(1);
+    }
+    n_bytes -= rc;
+    fill += rc;
+    for( off = 0; fill - off >= cfg_size; off += cfg_size )
+      check_msg(buf + off, next_seq);
+    memmove(buf, buf + off, fill - off);
+    fill -= off;
+  }
+  if( n_bytes < 0 ) {
+    fprintf(stderr, "ERROR: received %ld bytes too many\n", -n_bytes);
+    exit(1);
+  }
+}
+
+
+static void run(void)
+{
+  pthread_t threads[MAX_WRITERS];
+  double start, elapsed;
+  long n_msgs;
+  int i;
+
+  msgs_per_writer = cfg_msgs / n_writers;
+  n_msgs = (long) msgs_per_writer * n_writers;
+  pthread_barrier_init(&start_barrier, NULL, n_writers + 1);
+  for( i = 0; i < n_writers; ++i )
+    if( pthread_create(&threads[i], NULL, writer_fn,
+                       (void*) (uintptr_t) i) != 0 ) {
+      fprintf(stderr, "ERROR: pthread_create failed\n");
+      exit(1);
+    }
+
+  pthread_barrier_wait(&start_barrier);
+  start = now_ns();
+  receive_all(n_msgs);
+  elapsed = now_ns() - start;
+
+  for( i = 0; i < n_writers; ++i )
+    pthread_join(threads[i], NULL);
+  pthread_barrier_destroy(&start_barrier);
+
+  printf("%8d %12ld %10.1f %10.3f\n", n_writers, n_msgs,
+         elapsed / n_msgs, n_msgs * 1e3 / elapsed);
+  fflush(stdout);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int c;
+
+  inet_aton("127.0.0.1", &cfg_addr);
+
+  while( (c = getopt(argc, argv, "a:p:t:m:s:")) != -1 )
+    switch( c ) {
+    case 'a':
+      if( ! inet_aton(optarg, &cfg_addr) )
+        usage(argv[0]);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 't':
+      cfg_max_writers = atoi(optarg);
+      break;
+    case 'm':
+      cfg_msgs = atoi(optarg);
+      break;
+    case 's':
+      cfg_size = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  if( optind != argc || cfg_max_writers < 1 ||
+      cfg_max_writers > MAX_WRITERS || cfg_msgs < cfg_max_writers ||
+      cfg_size < (int) sizeof(struct msg_hdr) || cfg_size > 65536 )
+    usage(argv[0]);
+
+  make_connection();
+  printf("# %6s %12s %10s %10s\n", "writers", "msgs", "ns/msg", "Mmsg/s");
+  n_writers = 0;
+  while( n_writers < cfg_max_writers ) {
+    /* Double the number of writers each round: 1, 2, 4, ... */
+    n_writers = n_writers ? n_writers * 2 : 1;
+    if( n_writers > cfg_max_writers )
+      n_writers = cfg_max_writers;
+    run();
+  }
+
+  close(sender);
+  close(receiver);
+  return 0;
+}
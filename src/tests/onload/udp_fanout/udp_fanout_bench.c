@@ -0,0 +1,220 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+**  \brief  Cost of delivering one multicast datagram to many sockets
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/* Measures the cost of multicast fan-out within a single stack against the
+ * number of subscribing sockets.  One sender and N receivers live in this
+ * process, so with Onload they all share a stack and datagrams are looped
+ * back in software, without needing a NIC:
+ *
+ *   EF_NO_HW=1 EF_MCAST_SEND=3 EF_UDP_FANOUT_POOL=256 \
+ *     onload ./udp_fanout_bench -n 32
+ *
+ * For each subscriber count the benchmark sends datagrams in small bursts,
+ * draining every receiver after each burst, and reports the time per
+ * datagram sent and per delivery made.  Compare runs with
+ * EF_UDP_FANOUT_POOL=0 to see the cost of per-receiver buffer allocation.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+
+#define TRY(x)                                                  \
+  do {                                                          \
+    if( (x) < 0 ) {                                             \
+      fprintf(stderr, "ERROR: %s failed at %s:%d (errno=%d %s)\n", \
+              #x, __FILE__, __LINE__, errno, strerror(errno));  \
+      exit(1);                                                  \
+    }                                                           \
+  } while( 0 )
+
+
+static struct in_addr cfg_group;
+static struct in_addr cfg_iface;
+static int cfg_port = 8123;
+static int cfg_max_subs = 32;
+static int cfg_msgs = 100000;
+static int cfg_burst = 32;
+static int cfg_size = 64;
+
+
+static void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s [options]\n"
+          "  -g <group>   multicast group (default 239.100.1.1)\n"
+          "  -i <addr>    local interface address (default any)\n"
+          "  -p <port>    UDP port (default %d)\n"
+          "  -n <subs>    maximum number of subscribers (default %d)\n"
+          "  -m <msgs>    datagrams per measurement (default %d)\n"
+          "  -b <burst>   datagrams sent between drains (default %d)\n"
+          "  -s <bytes>   payload size (default %d)\n",
+          prog, cfg_port, cfg_max_subs, cfg_msgs, cfg_burst, cfg_size);
+  exit(1);
+}
+
+
+static int make_receiver(void)
+{
+  struct sockaddr_in sa;
+  struct ip_mreq mreq;
+  int one = 1;
+  int s;
+
+  TRY(s = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)));
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(cfg_port);
+  sa.sin_addr = cfg_group;
+  TRY(bind(s, (struct sockaddr*) &sa, sizeof(sa)));
+  mreq.imr_multiaddr = cfg_group;
+  mreq.imr_interface = cfg_iface;
+  TRY(setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)));
+  return s;
+}
+
+
+static int make_sender(void)
+{
+  struct sockaddr_in sa;
+  unsigned char loop = 1;
+  int s;
+
+  TRY(s = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(setsockopt(s, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)));
+  TRY(setsockopt(s, IPPROTO_IP, IP_MULTICAST_IF, &cfg_iface,
+                 sizeof(cfg_iface)));
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(cfg_port);
+  sa.sin_addr = cfg_group;
+  TRY(connect(s, (struct sockaddr*) &sa, sizeof(sa)));
+  return s;
+}
+
+
+static int drain(int s, char* buf)
+{
+  int n = 0;
+  while( recv(s, buf, cfg_size, MSG_DONTWAIT) >= 0 )
+    ++n;
+  if( errno != EAGAIN )
+    TRY(-1);
+  return n;
+}
+
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void run(int sender, const int* subs, int n_subs, char* buf)
+{
+  long delivered = 0;
+  double start, elapsed;
+  int sent, i, j;
+
+  /* Warm up so that the stack has grown any pools it needs. */
+  for( i = 0; i < cfg_burst; ++i )
+    TRY(send(sender, buf, cfg_size, 0));
+  for( j = 0; j < n_subs; ++j )
+    drain(subs[j], buf);
+
+  start = now_ns();
+  for( sent = 0; sent < cfg_msgs; sent += cfg_burst ) {
+    for( i = 0; i < cfg_burst; ++i )
+      TRY(send(sender, buf, cfg_size, 0));
+    for( j = 0; j < n_subs; ++j )
+      delivered += drain(subs[j], buf);
+  }
+  elapsed = now_ns() - start;
+
+  printf("%6d %12d %12ld %10.1f %10.1f\n", n_subs, sent, delivered,
+         elapsed / sent, delivered ? elapsed / delivered : 0.0);
+  fflush(stdout);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int* subs;
+  char* buf;
+  int sender, n_subs, c;
+
+  inet_aton("239.100.1.1", &cfg_group);
+  cfg_iface.s_addr = htonl(INADDR_ANY);
+
+  while( (c = getopt(argc, argv, "g:i:p:n:m:b:s:")) != -1 )
+    switch( c ) {
+    case 'g':
+      if( ! inet_aton(optarg, &cfg_group) )
+        usage(argv[0]);
+      break;
+    case 'i':
+      if( ! inet_aton(optarg, &cfg_iface) )
+        usage(argv[0]);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 'n':
+      cfg_max_subs = atoi(optarg);
+      break;
+    case 'm':
+      cfg_msgs = atoi(optarg);
+      break;
+    case 'b':
+      cfg_burst = atoi(optarg);
+      break;
+    case 's':
+      cfg_size = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  if( optind != argc || cfg_max_subs < 1 || cfg_msgs < 1 || cfg_burst < 1 ||
+      cfg_size < 1 )
+    usage(argv[0]);
+
+  subs = calloc(cfg_max_subs, sizeof(*subs));
+  buf = calloc(1, cfg_size);
+  if( subs == NULL || buf == NULL ) {
+    fprintf(stderr, "ERROR: out of memory\n");
+    return 1;
+  }
+
+  sender = make_sender();
+  printf("# %6s %12s %12s %10s %10s\n", "subs", "sent", "delivered",
+         "ns/dgram", "ns/deliv");
+  n_subs = 0;
+  while( n_subs < cfg_max_subs ) {
+    /* Double the number of subscribers each round: 1, 2, 4, ... */
+    int target = n_subs ? n_subs * 2 : 1;
+    if( target > cfg_max_subs )
+      target = cfg_max_subs;
+    while( n_subs < target )
+      subs[n_subs++] = make_receiver();
+    run(sender, subs, n_subs, buf);
+  }
+
+  return 0;
+}
@@ -12,11 +12,14 @@ struct efct_configfs_rxq_item {
   int ix;
   int ms_per_pkt;
   int num_pkts;
+  unsigned pps;
+  size_t pcap_bytes;
 };
 
 struct efct_configfs_dev_item {
   struct config_group group;
   struct net_device *dev;
+  int tx_mode;
   struct efct_configfs_rxq_item rxqs[EFCT_TEST_RXQS_N];
 };
 
@@ -141,14 +144,64 @@ static ssize_t rxq_num_pkts_show(struct config_item *item, char *page)
 
 CONFIGFS_ATTR(rxq_, num_pkts);
 
+static ssize_t rxq_pps_store(struct config_item *item,
+                             const char *page, size_t count)
+{
+  struct efct_configfs_rxq_item *rxq = to_rxq_item(item);
+  unsigned v;
+  int rc = kstrtouint(page, 10, &v);
+
+  if( rc )
+    return rc;
+  rc = efct_test_netdev_set_rxq_pps(rxq_item_to_dev(rxq)->dev, rxq->ix, v);
+  if( rc < 0 )
+    return rc;
+  rxq->pps = v;
+  return count;
+}
+
+static ssize_t rxq_pps_show(struct config_item *item, char *page)
+{
+  return sprintf(page, "%u\n", to_rxq_item(item)->pps);
+}
+
+CONFIGFS_ATTR(rxq_, pps);
+
 static struct configfs_attribute *rxq_attrs[] = {
   &rxq_attr_ms_per_pkt,
   &rxq_attr_num_pkts,
+  &rxq_attr_pps,
+  NULL,
+};
+
+/* A pcap file of Ethernet frames to inject in place of the test packet.
+ * Writing an empty file restores the test packet. */
+#define EFCT_TEST_PCAP_MAX  (64 << 20)
+
+static ssize_t rxq_pcap_write(struct config_item *item,
+                              const void *data, size_t size)
+{
+  struct efct_configfs_rxq_item *rxq = to_rxq_item(item);
+  int rc;
+
+  rc = efct_test_netdev_set_rxq_replay(rxq_item_to_dev(rxq)->dev, rxq->ix,
+                                       data, size);
+  if( rc < 0 )
+    return rc;
+  rxq->pcap_bytes = size;
+  return size;
+}
+
+CONFIGFS_BIN_ATTR_WO(rxq_, pcap, NULL, EFCT_TEST_PCAP_MAX);
+
+static struct configfs_bin_attribute *rxq_bin_attrs[] = {
+  &rxq_attr_pcap,
   NULL,
 };
 
 static struct config_item_type rxq_item_type = {
   .ct_attrs = rxq_attrs,
+  .ct_bin_attrs = rxq_bin_attrs,
   .ct_owner = THIS_MODULE,
 };
 
@@ -159,8 +212,38 @@ static ssize_t dev_ifindex_show(struct config_item *item, char *page)
 
 CONFIGFS_ATTR_RO(dev_, ifindex);
 
+static const char* const tx_mode_names[] = {
+  [EFCT_TEST_TX_KERNEL] = "kernel",
+  [EFCT_TEST_TX_SINK] = "sink",
+  [EFCT_TEST_TX_LOOPBACK] = "loopback",
+};
+
+static ssize_t dev_tx_mode_store(struct config_item *item,
+                                 const char *page, size_t count)
+{
+  struct efct_configfs_dev_item *dev = to_dev_item(item);
+  int mode, rc;
+
+  mode = sysfs_match_string(tx_mode_names, page);
+  if( mode < 0 )
+    return mode;
+  rc = efct_test_netdev_set_tx_mode(dev->dev, mode);
+  if( rc < 0 )
+    return rc;
+  dev->tx_mode = mode;
+  return count;
+}
+
+static ssize_t dev_tx_mode_show(struct config_item *item, char *page)
+{
+  return sprintf(page, "%s\n", tx_mode_names[to_dev_item(item)->tx_mode]);
+}
+
+CONFIGFS_ATTR(dev_, tx_mode);
+
 static struct configfs_attribute *dev_attrs[] = {
   &dev_attr_ifindex,
+  &dev_attr_tx_mode,
   NULL,
 };
 
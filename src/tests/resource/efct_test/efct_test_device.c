@@ -5,6 +5,9 @@
 #include <linux/module.h>
 #include <linux/netdevice.h>
 #include <linux/rtnetlink.h>
+#include <linux/if_ether.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
 #ifdef __has_include
 #if __has_include(<linux/set_memory.h>)
 #include <linux/set_memory.h>
@@ -65,6 +68,7 @@ struct efct_test_device* efct_test_add_test_dev(struct device* parent,
   set_memory_wc((unsigned long)tdev->evq_window, 1);
 
   tdev->dev.ops = &test_devops;
+  spin_lock_init(&tdev->lock);
   dev_hold(net_dev);
   tdev->net_dev = net_dev;
   adev = &tdev->dev.auxdev;
@@ -116,6 +120,21 @@ void efct_test_remove_test_dev(struct efct_test_device* tdev)
   kfree(tdev->evq_window);
 }
 
+/* (Re)start packet injection after a change to the rxq's settings.  The
+ * caller must have cancelled the timer. */
+static void efct_test_rxq_start_tick(struct efct_test_rxq* q)
+{
+  if( q->pps ) {
+    q->pps_credit = 0;
+    q->pps_stamp = ktime_get();
+    hrtimer_start(&q->rx_tick, ns_to_ktime(EFCT_TEST_RX_TICK_NS),
+                  HRTIMER_MODE_REL);
+  }
+  else if( q->ms_per_pkt ) {
+    hrtimer_start(&q->rx_tick, ms_to_ktime(q->ms_per_pkt), HRTIMER_MODE_REL);
+  }
+}
+
 int efct_test_set_rxq_ms_per_pkt(struct efct_test_device* tdev, int rxq,
                                  int ms_per_pkt)
 {
@@ -126,9 +145,144 @@ int efct_test_set_rxq_ms_per_pkt(struct efct_test_device* tdev, int rxq,
   hrtimer_cancel(&q->rx_tick);
 
   q->ms_per_pkt = ms_per_pkt;
-  if( ms_per_pkt ){
-    hrtimer_start(&q->rx_tick, ms_to_ktime(ms_per_pkt), HRTIMER_MODE_REL);
+  efct_test_rxq_start_tick(q);
+  return 0;
+}
+
+int efct_test_set_rxq_pps(struct efct_test_device* tdev, int rxq,
+                          unsigned pps)
+{
+  struct efct_test_rxq* q = &tdev->rxqs[rxq];
+
+  if( rxq < 0 || rxq >= EFCT_TEST_RXQS_N || q->evq == -1 )
+    return -EINVAL;
+  hrtimer_cancel(&q->rx_tick);
+
+  q->pps = pps;
+  efct_test_rxq_start_tick(q);
+  return 0;
+}
+
+
+#define PCAP_MAGIC_US       0xa1b2c3d4
+#define PCAP_MAGIC_NS       0xa1b23c4d
+#define PCAP_LINKTYPE_ETH   1
+
+struct pcap_file_hdr {
+  uint32_t magic;
+  uint16_t version_major;
+  uint16_t version_minor;
+  int32_t  thiszone;
+  uint32_t sigfigs;
+  uint32_t snaplen;
+  uint32_t linktype;
+};
+
+struct pcap_rec_hdr {
+  uint32_t ts_sec;
+  uint32_t ts_frac;
+  uint32_t incl_len;
+  uint32_t orig_len;
+};
+
+void efct_test_free_replay(struct efct_test_replay* replay)
+{
+  if( replay == NULL )
+    return;
+  kvfree(replay->frames);
+  kvfree(replay->data);
+  kfree(replay);
+}
+
+/* Builds a replay stream from the Ethernet frames in a pcap file.  Frames
+ * that do not fit in an rx buffer are skipped. */
+static struct efct_test_replay* efct_test_parse_pcap(const void* pcap,
+                                                     size_t len)
+{
+  const struct pcap_file_hdr* fh = pcap;
+  const struct pcap_rec_hdr* rh;
+  struct efct_test_replay* replay;
+  const uint8_t* p;
+  const uint8_t* end = (const uint8_t*) pcap + len;
+  unsigned n = 0, off = 0;
+  bool swapped;
+
+#define PCAP32(x)  (swapped ? swab32(x) : (x))
+  if( len < sizeof(*fh) )
+    return ERR_PTR(-EINVAL);
+  if( fh->magic == PCAP_MAGIC_US || fh->magic == PCAP_MAGIC_NS )
+    swapped = false;
+  else if( fh->magic == swab32(PCAP_MAGIC_US) ||
+           fh->magic == swab32(PCAP_MAGIC_NS) )
+    swapped = true;
+  else
+    return ERR_PTR(-EINVAL);
+  if( PCAP32(fh->linktype) != PCAP_LINKTYPE_ETH )
+    return ERR_PTR(-EPROTONOSUPPORT);
+
+  /* First pass: count the frames. */
+  for( p = (const uint8_t*) (fh + 1); p + sizeof(*rh) <= end;
+       p += sizeof(*rh) + PCAP32(rh->incl_len) ) {
+    rh = (const struct pcap_rec_hdr*) p;
+    if( PCAP32(rh->incl_len) > end - p - sizeof(*rh) )
+      return ERR_PTR(-EINVAL);
+    if( PCAP32(rh->incl_len) >= ETH_HLEN &&
+        PCAP32(rh->incl_len) <= EFCT_TEST_FRAME_MAX )
+      ++n;
+  }
+  if( n == 0 )
+    return ERR_PTR(-ENODATA);
+
+  replay = kzalloc(sizeof(*replay), GFP_KERNEL);
+  if( replay == NULL )
+    return ERR_PTR(-ENOMEM);
+  replay->frames = kvmalloc_array(n, sizeof(replay->frames[0]), GFP_KERNEL);
+  replay->data = kvmalloc(len, GFP_KERNEL);
+  if( replay->frames == NULL || replay->data == NULL ) {
+    efct_test_free_replay(replay);
+    return ERR_PTR(-ENOMEM);
+  }
+
+  for( p = (const uint8_t*) (fh + 1); p + sizeof(*rh) <= end;
+       p += sizeof(*rh) + PCAP32(rh->incl_len) ) {
+    unsigned flen;
+    rh = (const struct pcap_rec_hdr*) p;
+    flen = PCAP32(rh->incl_len);
+    if( flen < ETH_HLEN || flen > EFCT_TEST_FRAME_MAX )
+      continue;
+    replay->frames[replay->n_frames].off = off;
+    replay->frames[replay->n_frames].len = flen;
+    memcpy(replay->data + off, p + sizeof(*rh), flen);
+    off += flen;
+    ++replay->n_frames;
   }
+#undef PCAP32
+  return replay;
+}
+
+int efct_test_set_rxq_replay(struct efct_test_device* tdev, int rxq,
+                             const void* pcap, size_t len)
+{
+  struct efct_test_rxq* q = &tdev->rxqs[rxq];
+  struct efct_test_replay* replay = NULL;
+  struct efct_test_replay* old;
+
+  if( rxq < 0 || rxq >= EFCT_TEST_RXQS_N || q->evq == -1 )
+    return -EINVAL;
+  /* An empty write goes back to the built-in test packet. */
+  if( len != 0 ) {
+    replay = efct_test_parse_pcap(pcap, len);
+    if( IS_ERR(replay) )
+      return PTR_ERR(replay);
+  }
+
+  hrtimer_cancel(&q->rx_tick);
+  old = q->replay;
+  q->replay = replay;
+  q->replay_next = 0;
+  efct_test_rxq_start_tick(q);
+
+  efct_test_free_replay(old);
   return 0;
 }
 
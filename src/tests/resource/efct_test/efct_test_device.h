@@ -44,6 +44,8 @@ struct efct_test_txq {
 #define EFCT_TEST_PKT_BYTES       2048
 #define EFCT_TEST_PKTS_PER_SUPERBUF   \
           (EFCT_RX_SUPERBUF_BYTES / EFCT_TEST_PKT_BYTES)
+/* Frames start after 64 bytes of metadata and 2 bytes of padding */
+#define EFCT_TEST_FRAME_MAX       (EFCT_TEST_PKT_BYTES - 64 - 2)
 
 struct efct_test_suberbuf {
   /* Page address of the superbuf */
@@ -54,6 +56,17 @@ struct efct_test_suberbuf {
   bool rollover;
 };
 
+/* A captured packet stream, replayed by an rxq in place of the built-in test
+ * packet.  [data] holds the frames back to back. */
+struct efct_test_replay {
+  unsigned n_frames;
+  struct {
+    unsigned off;
+    unsigned len;
+  } *frames;
+  uint8_t *data;
+};
+
 /* The currently "active" superbuffers are the half-open interval
  * [curr_bid, next_bid) (% EFCT_TEST_MAX_SUPERBUFS) */
 struct efct_test_rxq {
@@ -81,10 +94,34 @@ struct efct_test_rxq {
   int num_pkts;
   /* Current number of packets sent. Resets when num_pkts is updated. */
   int curr_pkts;
+  /* Injection rate in packets per second.  When non-zero this replaces
+   * ms_per_pkt, and packets are written in bursts every
+   * EFCT_TEST_RX_TICK_NS. */
+  unsigned pps;
+  /* Packet-nanoseconds owed at the current rate, and when it was updated */
+  uint64_t pps_credit;
+  ktime_t pps_stamp;
+  /* Frames to inject, or NULL for the built-in test packet */
+  struct efct_test_replay *replay;
+  /* Index of the next frame of [replay] */
+  unsigned replay_next;
   /* Pointer to test device */
   struct efct_test_device *tdev;
 };
 
+#define EFCT_TEST_RX_TICK_NS    100000
+#define EFCT_TEST_RX_BURST_MAX  256
+
+/* What happens to packets sent through the test device */
+enum efct_test_tx_mode {
+  /* Delivered to the kernel stack via the net device */
+  EFCT_TEST_TX_KERNEL,
+  /* Discarded once completed */
+  EFCT_TEST_TX_SINK,
+  /* Received again on the lowest-numbered bound rxq */
+  EFCT_TEST_TX_LOOPBACK,
+};
+
 #define EFCT_TEST_EVQS_N 12
 #define EFCT_TEST_TXQS_N 12
 #define EFCT_TEST_RXQS_N  8
@@ -100,6 +137,10 @@ struct efct_test_device {
   struct efct_test_txq txqs[EFCT_TEST_TXQS_N];
   struct efct_test_rxq rxqs[EFCT_TEST_RXQS_N];
   uint8_t *evq_window;
+  enum efct_test_tx_mode tx_mode;
+  /* Serialises writes to rx superbufs and event queues between the rx
+   * timer and tx loopback. */
+  spinlock_t lock;
 };
 
 extern struct efct_test_device* efct_test_add_test_dev(struct device* parent, struct net_device* net_dev);
@@ -108,5 +149,10 @@ extern int efct_test_set_rxq_ms_per_pkt(struct efct_test_device* tdev, int rxq,
                                         int ms_per_pkt);
 extern int efct_test_set_rxq_num_pkts(struct efct_test_device* tdev, int rxq,
                                         int num_pkts);
+extern int efct_test_set_rxq_pps(struct efct_test_device* tdev, int rxq,
+                                 unsigned pps);
+extern int efct_test_set_rxq_replay(struct efct_test_device* tdev, int rxq,
+                                    const void* pcap, size_t len);
+extern void efct_test_free_replay(struct efct_test_replay* replay);
 
 #endif /* EFCT_TEST_DEVICE_H */
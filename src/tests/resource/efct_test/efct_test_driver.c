@@ -96,6 +96,45 @@ int efct_test_netdev_set_rxq_num_pkts(struct net_device* net_dev, int rxq,
   return efct_test_set_rxq_num_pkts(tdev, rxq, num_pkts);
 }
 
+int efct_test_netdev_set_rxq_pps(struct net_device* net_dev, int rxq,
+                                 unsigned pps)
+{
+  int rc;
+
+  printk(KERN_INFO "efct_test pps dev=%s q=%d pps=%u\n",
+         net_dev->name, rxq, pps);
+  if( (rc = check_netdev(__func__, net_dev)) < 0 )
+    return rc;
+
+  return efct_test_set_rxq_pps(tdev, rxq, pps);
+}
+
+int efct_test_netdev_set_rxq_replay(struct net_device* net_dev, int rxq,
+                                    const void* pcap, size_t len)
+{
+  int rc;
+
+  printk(KERN_INFO "efct_test replay dev=%s q=%d bytes=%zu\n",
+         net_dev->name, rxq, len);
+  if( (rc = check_netdev(__func__, net_dev)) < 0 )
+    return rc;
+
+  return efct_test_set_rxq_replay(tdev, rxq, pcap, len);
+}
+
+int efct_test_netdev_set_tx_mode(struct net_device* net_dev, int tx_mode)
+{
+  int rc;
+
+  printk(KERN_INFO "efct_test tx_mode dev=%s mode=%d\n",
+         net_dev->name, tx_mode);
+  if( (rc = check_netdev(__func__, net_dev)) < 0 )
+    return rc;
+
+  tdev->tx_mode = tx_mode;
+  return 0;
+}
+
 static int __init efct_test_init(void)
 {
   int rc;
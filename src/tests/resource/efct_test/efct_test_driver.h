@@ -13,5 +13,10 @@ extern int efct_test_netdev_set_rxq_ms_per_pkt(struct net_device* dev, int rxq,
                                                int ms_per_pkt);
 extern int efct_test_netdev_set_rxq_num_pkts(struct net_device* dev, int rxq,
                                                int num_pkts);
+extern int efct_test_netdev_set_rxq_pps(struct net_device* dev, int rxq,
+                                        unsigned pps);
+extern int efct_test_netdev_set_rxq_replay(struct net_device* dev, int rxq,
+                                           const void* pcap, size_t len);
+extern int efct_test_netdev_set_tx_mode(struct net_device* dev, int tx_mode);
 
 #endif /* EFCT_TEST_DRIVER_H */
@@ -362,6 +362,7 @@ static void efct_test_free_rxq(struct efx_auxiliary_client *handle, int rxq_idx)
   cancel_delayed_work_sync(&rxq->timer);
 
   hrtimer_cancel(&rxq->rx_tick);
+  efct_test_free_replay(rxq->replay);
 
   evq_push_rx_flush_complete(&tdev->evqs[evq], rxq_idx);
 
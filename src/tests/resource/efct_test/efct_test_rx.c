@@ -3,6 +3,10 @@
 
 #include "efct_test_device.h"
 #include "efct_test_tx.h"
+#include "efct_test_rx.h"
+
+#include <linux/if_ether.h>
+#include <linux/in.h>
 
 #include <ci/tools.h>
 #include <ci/tools/bitfield.h>
@@ -59,60 +63,94 @@ static struct efct_test_suberbuf* get_next_buff(struct efct_test_rxq *rxq)
   return &rxq->buffers[rxq->next_bid % EFCT_TEST_MAX_SUPERBUFS];
 }
 
+static char* current_slot(struct efct_test_rxq *rxq)
+{
+  char *buf = (char *)get_current_buff(rxq)->page;
+  return buf + (rxq->pkt % EFCT_TEST_PKTS_PER_SUPERBUF) * EFCT_TEST_PKT_BYTES;
+}
+
 /* return value: Did we write the packet? */
-static bool write_fake_packet(struct efct_test_rxq *rxq)
+static bool write_packet(struct efct_test_rxq *rxq, const struct iovec *iov,
+                         int iovcnt)
 {
-  char * buf;
-  int ix;
   char *dst;
+  int i;
 
   /* Are we in a valid superbuf? If not, return early. */
   if(rxq->curr_bid >= rxq->next_bid)
       return false; 
 
-  buf = (char *)get_current_buff(rxq)->page;
-  ix = rxq->pkt % EFCT_TEST_PKTS_PER_SUPERBUF;
-  dst = buf + ix * EFCT_TEST_PKT_BYTES + 64; /* 64 bytes for metadata*/
+  dst = current_slot(rxq) + 64; /* 64 bytes for metadata*/
 
   /* 2 byte offset so that ip header is nicely aligned */
   memset(dst, 0, 2);
   dst+=2;
 
   /* Copy the packet */
-  memcpy(dst, fake_pkt, sizeof(fake_pkt));
-  
-  /* Also include pkt and curr_bid in the packet*/
-  memcpy(dst + sizeof(fake_pkt), &rxq->pkt, sizeof(rxq->pkt));
-  memcpy(dst + sizeof(fake_pkt) + sizeof(rxq->pkt), &rxq->curr_bid,
-         sizeof(rxq->curr_bid));
+  for( i = 0; i < iovcnt; i++ ) {
+    memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+    dst += iov[i].iov_len;
+  }
 
   return true;
 }
 
-static void write_real_fake_metadata(struct efct_test_rxq *rxq)
+/* Fill in the classes that the parser would report for this frame. */
+static void classify_frame(const uint8_t *f, size_t len, ci_oword_t *meta)
+{
+  unsigned l3 = EFCT_RX_HEADER_L3_CLASS_OTHER;
+  unsigned l4 = EFCT_RX_HEADER_L4_CLASS_OTHER;
+  unsigned off = ETH_HLEN;
+  unsigned proto = 0;
+  bool frag = false;
+  uint16_t ethertype = (f[12] << 8) | f[13];
+
+  if( ethertype == ETH_P_8021Q && len >= ETH_HLEN + 4 ) {
+    ethertype = (f[16] << 8) | f[17];
+    off += 4;
+  }
+  if( ethertype == ETH_P_IP && len >= off + 20 ) {
+    l3 = EFCT_RX_HEADER_L3_CLASS_IP4;
+    proto = f[off + 9];
+    frag = ((f[off + 6] << 8) | f[off + 7]) & 0x3fff;
+  }
+  else if( ethertype == ETH_P_IPV6 && len >= off + 40 ) {
+    l3 = EFCT_RX_HEADER_L3_CLASS_IP6;
+    proto = f[off + 6];
+  }
+  if( l3 != EFCT_RX_HEADER_L3_CLASS_OTHER ) {
+    if( frag )
+      l4 = EFCT_RX_HEADER_L4_CLASS_FRAGMENT;
+    else if( proto == IPPROTO_TCP )
+      l4 = EFCT_RX_HEADER_L4_CLASS_TCP;
+    else if( proto == IPPROTO_UDP )
+      l4 = EFCT_RX_HEADER_L4_CLASS_UDP;
+  }
+  CI_SET_OWORD_FIELD(*meta, EFCT_RX_HEADER_L2_CLASS,
+                     EFCT_RX_HEADER_L2_CLASS_ETH_01VLAN);
+  CI_SET_OWORD_FIELD(*meta, EFCT_RX_HEADER_L3_CLASS, l3);
+  CI_SET_OWORD_FIELD(*meta, EFCT_RX_HEADER_L4_CLASS, l4);
+}
+
+static void write_real_fake_metadata(struct efct_test_rxq *rxq,
+                                     unsigned packet_length)
 {
-  char *buf;
-  int ix;
   ci_oword_t meta = {}; /* Zero initialise */
   ci_oword_t *meta_dst;
   bool sentinel;
-  unsigned packet_length;
 
   /* A most likely unnecessary check since this will be called after
-    * write_fake_packet. */
+    * write_packet. */
   if(rxq->curr_bid >= rxq->next_bid)
     return;
 
-  buf = (char *)get_current_buff(rxq)->page;
-  ix = rxq->pkt % EFCT_TEST_PKTS_PER_SUPERBUF;
   sentinel = get_current_buff(rxq)->sentinel;
-  meta_dst = (ci_oword_t *)(buf + ix * EFCT_TEST_PKT_BYTES);
-  packet_length = sizeof(fake_pkt) + sizeof(rxq->pkt) + sizeof(rxq->curr_bid);
-  CI_POPULATE_OWORD_4(meta,
+  meta_dst = (ci_oword_t *)current_slot(rxq);
+  CI_POPULATE_OWORD_3(meta,
                       EFCT_RX_HEADER_PACKET_LENGTH, packet_length,
                       EFCT_RX_HEADER_NEXT_FRAME_LOC, 1,
-                      EFCT_RX_HEADER_L4_CLASS, 1, /* Test packet is udp */
                       EFCT_RX_HEADER_SENTINEL, sentinel);
+  classify_frame((uint8_t *)meta_dst + 64 + 2, packet_length, &meta);
 
   
   WRITE_ONCE(meta_dst->u64[1], meta.u64[1]);
@@ -184,18 +222,111 @@ static void do_rollover(struct efct_test_rxq *rxq, bool forced)
     rxq->curr_bid++;
   }
 
-  printk(KERN_INFO "%s superbuf rollover\n", __func__);
+  pr_debug("%s superbuf rollover\n", __func__);
   rxq->pkt = 0;
 }
 
+/* Writes one frame and its metadata, moving on to the next superbuf when
+ * this one is full.  The caller pushes the rx event.
+ * return value: Did we write the packet? */
+static bool rx_one(struct efct_test_rxq *rxq, const struct iovec *iov,
+                   int iovcnt)
+{
+  unsigned len = 0;
+  int i;
+
+  for( i = 0; i < iovcnt; i++ )
+    len += iov[i].iov_len;
+  if( len < ETH_HLEN || len > EFCT_TEST_FRAME_MAX )
+    return false;
+
+  if( !write_packet(rxq, iov, iovcnt) ) {
+    printk(KERN_ERR "%s failed to write the packet."
+           " Are there enough sbufs? curr_bid = %u next_bid = %u\n",
+           __func__, rxq->curr_bid, rxq->next_bid);
+    return false;
+  }
+
+  /* Don't increment rxq->pkt yet */
+
+  /* Write the corresponding metadata */
+  write_real_fake_metadata(rxq, len);
+
+  /* We have to wait until after the metadata is written before we can
+  * increment pkt, otherwise the frame and the metadata would end up in
+  * different packet buffers */
+  rxq->pkt++;
+
+  if( rxq->pkt >= EFCT_TEST_PKTS_PER_SUPERBUF ) {
+    do_rollover(rxq, 0);
+  }
+  return true;
+}
+
+/* Injects the next packet of the rxq's stream: either the replayed frames
+ * or the built-in test packet, tagged with its position. */
+static bool rx_next(struct efct_test_rxq *rxq)
+{
+  struct iovec iov[3];
+  bool written;
+
+  if( rxq->replay ) {
+    struct efct_test_replay *replay = rxq->replay;
+    iov[0].iov_base = replay->data + replay->frames[rxq->replay_next].off;
+    iov[0].iov_len = replay->frames[rxq->replay_next].len;
+    written = rx_one(rxq, iov, 1);
+    if( written && ++rxq->replay_next == replay->n_frames )
+      rxq->replay_next = 0;
+    return written;
+  }
+
+  /* Also include pkt and curr_bid in the packet*/
+  iov[0].iov_base = (void *)fake_pkt;
+  iov[0].iov_len = sizeof(fake_pkt);
+  iov[1].iov_base = &rxq->pkt;
+  iov[1].iov_len = sizeof(rxq->pkt);
+  iov[2].iov_base = &rxq->curr_bid;
+  iov[2].iov_len = sizeof(rxq->curr_bid);
+  return rx_one(rxq, iov, 3);
+}
+
+/* How many packets are due this tick.  At a configured rate this is the
+ * time since the last tick times the rate, in bursts of at most
+ * EFCT_TEST_RX_BURST_MAX; anything beyond that is dropped rather than
+ * queued so that a slow consumer doesn't see an ever-growing backlog. */
+static unsigned rx_pkts_due(struct efct_test_rxq *rxq)
+{
+  ktime_t now;
+  unsigned n;
+
+  if( !rxq->pps )
+    return 1;
+
+  now = ktime_get();
+  rxq->pps_credit += (uint64_t)ktime_to_ns(ktime_sub(now, rxq->pps_stamp)) *
+                     rxq->pps;
+  rxq->pps_stamp = now;
+  if( rxq->pps_credit >= (uint64_t)EFCT_TEST_RX_BURST_MAX * NSEC_PER_SEC ) {
+    rxq->pps_credit = 0;
+    return EFCT_TEST_RX_BURST_MAX;
+  }
+  n = div_u64(rxq->pps_credit, NSEC_PER_SEC);
+  rxq->pps_credit -= (uint64_t)n * NSEC_PER_SEC;
+  return n;
+}
+
 enum hrtimer_restart efct_rx_tick(struct hrtimer *hr)
 {
   struct efct_test_rxq *rxq = container_of(hr, struct efct_test_rxq, rx_tick);
   struct efct_test_device *tdev = rxq->tdev;
   struct efct_test_evq *evq = &tdev->evqs[rxq->evq];
+  unsigned n, batch = 0;
+  unsigned long flags;
 
+  n = rx_pkts_due(rxq);
   if( !rxq->num_pkts || rxq->curr_pkts == rxq->num_pkts )
       goto out;
+  n = min_t(unsigned, n, rxq->num_pkts - rxq->curr_pkts);
 
   /* Should we write a forced metadata packet? */
   /* TODO: Decide whether we want this, and if so should it be periodic? user
@@ -213,38 +344,50 @@ enum hrtimer_restart efct_rx_tick(struct hrtimer *hr)
     memset(old_buff, 0, sizeof(struct efct_test_suberbuf));
   }
 
-  /* Write a packet */
-  if( !write_fake_packet(rxq) ) {
-    printk(KERN_ERR "%s failed to write the fake packet."
-           " Are there enough sbufs? curr_bid = %u next_bid = %u\n",
-           __func__, rxq->curr_bid, rxq->next_bid);
-    goto out;
-  }
-
-  /* Don't increment rxq->pkt yet */
-
-  /* Write the corresponding metadata */
-  write_real_fake_metadata(rxq);
-
-  /* Push event to queue*/
-  evq_push_rx(evq, 1);
-
-  /* We have to wait until after the metadata is written before we can
-  * increment pkt, otherwise the frame and the metadata would end up in
-  * different packet buffers */
-  rxq->pkt++;
-
-  if( rxq->pkt >= EFCT_TEST_PKTS_PER_SUPERBUF ) {
-    do_rollover(rxq, 0);
+  /* Write a burst of packets, with one event for each run that lands in the
+   * same superbuf, as the hardware would. */
+  spin_lock_irqsave(&tdev->lock, flags);
+  while( n-- && rx_next(rxq) ) {
+    rxq->curr_pkts++;
+    batch++;
+    if( rxq->pkt == 0 ) {
+      evq_push_rx(evq, batch);
+      batch = 0;
+    }
   }
-
-  rxq->curr_pkts++;
+  if( batch )
+    evq_push_rx(evq, batch);
+  spin_unlock_irqrestore(&tdev->lock, flags);
 
 out:
-  hrtimer_forward_now(hr, ms_to_ktime(rxq->ms_per_pkt));
+  if( rxq->pps )
+    hrtimer_forward_now(hr, ns_to_ktime(EFCT_TEST_RX_TICK_NS));
+  else
+    hrtimer_forward_now(hr, ms_to_ktime(rxq->ms_per_pkt));
   return HRTIMER_RESTART;
 }
 
+void efct_test_rx_loopback(struct efct_test_device *tdev,
+                           const struct iovec *iov, int iovcnt)
+{
+  struct efct_test_rxq *rxq = NULL;
+  unsigned long flags;
+  int i;
+
+  for( i = 0; i < EFCT_TEST_RXQS_N; i++ )
+    if( tdev->rxqs[i].evq >= 0 ) {
+      rxq = &tdev->rxqs[i];
+      break;
+    }
+  if( rxq == NULL )
+    return;
+
+  spin_lock_irqsave(&tdev->lock, flags);
+  if( rx_one(rxq, iov, iovcnt) )
+    evq_push_rx(&tdev->evqs[rxq->evq], 1);
+  spin_unlock_irqrestore(&tdev->lock, flags);
+}
+
 void efct_test_rx_timer(struct work_struct *work)
 {
   struct efct_test_rxq *rxq = container_of(work, struct efct_test_rxq,
@@ -265,6 +408,7 @@ void efct_test_rx_timer(struct work_struct *work)
     ci_qword_t buffer_start = *rxq->post_register;
     struct efct_test_suberbuf *buffer;
     uint64_t phys_addr;
+    unsigned long flags;
 
     if(rxq->next_bid > rxq->curr_bid &&
       (rxq->next_bid % EFCT_TEST_MAX_SUPERBUFS == 
@@ -275,9 +419,9 @@ void efct_test_rx_timer(struct work_struct *work)
         goto out;
       }
     
-    printk(KERN_INFO "%s: received buffer 0x%llx\n",
-           __func__, buffer_start.u64[0]);
+    pr_debug("%s: received buffer 0x%llx\n", __func__, buffer_start.u64[0]);
 
+    spin_lock_irqsave(&rxq->tdev->lock, flags);
     buffer = get_next_buff(rxq);
 
     phys_addr = CI_QWORD_FIELD(buffer_start, EFCT_TEST_PAGE_ADDRESS);
@@ -288,11 +432,14 @@ void efct_test_rx_timer(struct work_struct *work)
     rxq->next_bid++;
     if( buffer->rollover )
       do_rollover(rxq, 1);
+    spin_unlock_irqrestore(&rxq->tdev->lock, flags);
 
     memset(rxq->post_register, 0x00, sizeof(*rxq->post_register));
   }
 
 out:
+  /* When injecting at a configured rate, superbufs are consumed far faster
+   * than the default period would replace them. */
   if( atomic_read(&rxq->timer_running) )
-    schedule_delayed_work(&rxq->timer, 100);
+    schedule_delayed_work(&rxq->timer, rxq->pps ? 1 : 100);
 }
@@ -5,6 +5,7 @@
 #define EFCT_TEST_RX_H
 
 #include <linux/workqueue.h>
+#include <linux/uio.h>
 
 #include <ci/driver/efab/hardware/ef10ct.h>
 
@@ -13,4 +14,8 @@ extern enum hrtimer_restart efct_rx_tick(struct hrtimer *hr);
 
 extern void evq_push_rx_flush_complete(struct efct_test_evq *evq, int rxq);
 
+struct efct_test_device;
+extern void efct_test_rx_loopback(struct efct_test_device *tdev,
+                                  const struct iovec *iov, int iovcnt);
+
 #endif /* EFCT_TEST_RX_H */
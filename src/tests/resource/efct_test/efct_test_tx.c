@@ -10,6 +10,7 @@
 #include <ci/driver/kernel_compat.h>
 
 #include "efct_test_device.h"
+#include "efct_test_rx.h"
 
 #define EFCT_TX_APERTURE 4096
 
@@ -115,11 +116,13 @@ static bool efct_test_poll_tx(struct efct_test_txq *txq)
   struct efct_test_evq *evq = &tdev->evqs[txq->evq];
   bool got_pkt = false;
   struct iovec pkt_data[2];
+  struct iovec frame[2];
   int pkt_start;
   int pkt_tail;
   int pkt_end;
   bool wrapped;
   size_t pkt_length;
+  unsigned long flags;
 
   /* This code is taken from zf_emu. There the CTPIO aperture is populated
    * with all bits set, and the emu detects a packet being written when this
@@ -158,7 +161,23 @@ static bool efct_test_poll_tx(struct efct_test_txq *txq)
     else {
       pkt_data[0].iov_len = pkt_length;
     }
-    efct_test_inject_pkt(tdev->net_dev, pkt_data, wrapped ? 2 : 1, pkt_length);
+    switch( tdev->tx_mode ) {
+    case EFCT_TEST_TX_KERNEL:
+      efct_test_inject_pkt(tdev->net_dev, pkt_data, wrapped ? 2 : 1,
+                           pkt_length);
+      break;
+    case EFCT_TEST_TX_SINK:
+      break;
+    case EFCT_TEST_TX_LOOPBACK:
+      /* The aperture holds the frame padded to EFCT_TX_ALIGNMENT. */
+      memcpy(frame, pkt_data, sizeof(frame));
+      if( wrapped )
+        frame[1].iov_len = header.packet_length - frame[0].iov_len;
+      else
+        frame[0].iov_len = header.packet_length;
+      efct_test_rx_loopback(tdev, frame, wrapped ? 2 : 1);
+      break;
+    }
 
     memset(header_ptr, 0xff, EFCT_TX_HEADER_BYTES);
     memset(pkt_data[0].iov_base, 0xff, pkt_data[0].iov_len);
@@ -166,7 +185,9 @@ static bool efct_test_poll_tx(struct efct_test_txq *txq)
       memset(pkt_data[1].iov_base, 0xff, pkt_data[1].iov_len);
 
     txq->ptr += total_length;
+    spin_lock_irqsave(&tdev->lock, flags);
     evq_push_tx(evq, txq->pkt_ctr);
+    spin_unlock_irqrestore(&tdev->lock, flags);
     txq->pkt_ctr += 1;
     got_pkt = true;
   }
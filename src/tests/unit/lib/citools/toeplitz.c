@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Functions under test */
+#include <ci/tools.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+
+static const ci_uint8 key[40] = {
+  0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+  0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+  0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+  0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+  0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+static void test_byte_table(void)
+{
+  /* Each table entry must be the hash of an input that is all zero apart
+   * from that byte. */
+  ci_uint32 table[256];
+  ci_uint8 input[12];
+  int offset, v;
+
+  for( offset = 0; offset < sizeof(input); ++offset ) {
+    ci_toeplitz_hash_byte_table(key, offset, table);
+    for( v = 0; v < 256; ++v ) {
+      memset(input, 0, sizeof(input));
+      input[offset] = v;
+      CHECK(table[v], ==, ci_toeplitz_hash(key, input, sizeof(input)));
+    }
+  }
+}
+
+static void test_byte_table_combine(void)
+{
+  /* Hashing a tuple with the varying bytes zeroed and XORing in the table
+   * entries gives the hash of the whole tuple. */
+  ci_uint32 table10[256], table11[256];
+  ci_uint8 input[12] = {
+    0x42, 0x43, 0x44, 0x45, 0x0a, 0x01, 0x02, 0x03, 0x04, 0xd2, 0, 0,
+  };
+  ci_uint32 base;
+  int port;
+
+  ci_toeplitz_hash_byte_table(key, 10, table10);
+  ci_toeplitz_hash_byte_table(key, 11, table11);
+  base = ci_toeplitz_hash(key, input, sizeof(input));
+
+  for( port = 0; port < 0x10000; port += 251 ) {
+    input[10] = port >> 8;
+    input[11] = port & 0xff;
+    CHECK(base ^ table10[input[10]] ^ table11[input[11]], ==,
+          ci_toeplitz_hash(key, input, sizeof(input)));
+  }
+}
+
+int main(void)
+{
+  TEST_RUN(test_byte_table);
+  TEST_RUN(test_byte_table_combine);
+  TEST_END();
+}
@@ -0,0 +1,374 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/if_xdp.h>
+
+/* Functions under test */
+#include <etherfabric/ef_vi.h>
+#include <ci/driver/efab/hardware/af_xdp.h>
+extern void efxdp_vi_init(ef_vi* vi);
+
+/* Test infrastructure */
+#include "unit_test.h"
+
+#ifndef XDP_PKT_CONTD
+#define XDP_PKT_CONTD (1 << 0)
+#endif
+#ifndef XDP_RING_NEED_WAKEUP
+#define XDP_RING_NEED_WAKEUP (1 << 0)
+#endif
+
+#define RING_SIZE 16
+#define BUF_LEN 2048
+
+/* Fake AF_XDP memory: the offsets block followed by the four rings. */
+struct fake_ring {
+  uint32_t producer;
+  uint32_t consumer;
+  uint32_t flags;
+  union {
+    struct xdp_desc desc[RING_SIZE];
+    uint64_t addr[RING_SIZE];
+  };
+};
+
+struct fake_xdp {
+  struct efab_af_xdp_offsets offsets;
+  struct fake_ring rx, tx, fr, cr;
+};
+
+static ef_vi* vi;
+static struct fake_xdp* xdp;
+static ef_vi_stats stats;
+static int kicks;
+
+static int fake_kick(ef_vi* vi)
+{
+  ++kicks;
+  return 0;
+}
+
+static void init_ring(struct efab_af_xdp_offsets_ring* ofs,
+                      struct fake_ring* ring)
+{
+  ofs->producer = (char*) &ring->producer - (char*) xdp;
+  ofs->consumer = (char*) &ring->consumer - (char*) xdp;
+  ofs->desc = (char*) &ring->desc - (char*) xdp;
+  ofs->flags = (char*) &ring->flags - (char*) xdp;
+}
+
+static void vi_alloc(void)
+{
+  int i;
+
+  xdp = calloc(1, sizeof(*xdp));
+  init_ring(&xdp->offsets.rings.rx, &xdp->rx);
+  init_ring(&xdp->offsets.rings.tx, &xdp->tx);
+  init_ring(&xdp->offsets.rings.fr, &xdp->fr);
+  init_ring(&xdp->offsets.rings.cr, &xdp->cr);
+
+  vi = calloc(1, sizeof(*vi));
+  vi->ep_state = calloc(1, sizeof(*vi->ep_state));
+  vi->evq_base = (char*) xdp;
+  vi->vi_rxq.mask = RING_SIZE - 1;
+  vi->vi_rxq.ids = calloc(RING_SIZE, sizeof(vi->vi_rxq.ids[0]));
+  vi->vi_txq.mask = RING_SIZE - 1;
+  vi->vi_txq.ids = calloc(RING_SIZE, sizeof(vi->vi_txq.ids[0]));
+  for( i = 0; i < RING_SIZE; ++i )
+    vi->vi_txq.ids[i] = EF_REQUEST_ID_MASK;
+  vi->xdp_kick = fake_kick;
+  memset(&stats, 0, sizeof(stats));
+  vi->vi_stats = &stats;
+  kicks = 0;
+  efxdp_vi_init(vi);
+}
+
+static void vi_free(void)
+{
+  free(vi->vi_txq.ids);
+  free(vi->vi_rxq.ids);
+  free(vi->ep_state);
+  free(vi);
+  free(xdp);
+}
+
+static void rx_put(uint64_t addr, uint32_t len, uint32_t options)
+{
+  struct xdp_desc* d = &xdp->rx.desc[xdp->rx.producer++ % RING_SIZE];
+  d->addr = addr;
+  d->len = len;
+  d->options = options;
+}
+
+static void test_rx_single(void)
+{
+  ef_event evs[4];
+  int n;
+
+  vi_alloc();
+  rx_put(3 * BUF_LEN + 256, 60, 0);
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 1);
+  CHECK(EF_EVENT_TYPE(evs[0]), ==, EF_EVENT_TYPE_RX);
+  CHECK(evs[0].rx.rq_id, ==, 3);
+  CHECK(evs[0].rx.ofs, ==, 256);
+  CHECK(evs[0].rx.len, ==, 60);
+  CHECK(evs[0].rx.flags & (EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT),
+        ==, EF_EVENT_FLAG_SOP);
+  vi_free();
+}
+
+static void test_rx_multi_buffer(void)
+{
+  ef_event evs[4];
+  int n;
+
+  vi_alloc();
+  rx_put(1 * BUF_LEN + 256, 1792, XDP_PKT_CONTD);
+  rx_put(2 * BUF_LEN + 256, 1792, XDP_PKT_CONTD);
+  rx_put(5 * BUF_LEN + 256, 100, 0);
+
+  /* Poll in two steps to check the state survives across calls. */
+  n = ef_eventq_poll(vi, evs, 2);
+  CHECK(n, ==, 2);
+  CHECK(evs[0].rx.rq_id, ==, 1);
+  CHECK(evs[0].rx.len, ==, 1792);
+  CHECK(evs[0].rx.flags & (EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT),
+        ==, EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT);
+  CHECK(evs[1].rx.rq_id, ==, 2);
+  CHECK(evs[1].rx.len, ==, 3584);
+  CHECK(evs[1].rx.flags & (EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT),
+        ==, EF_EVENT_FLAG_CONT);
+
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 1);
+  CHECK(evs[0].rx.rq_id, ==, 5);
+  CHECK(evs[0].rx.len, ==, 3684);
+  CHECK(evs[0].rx.flags & (EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT), ==, 0);
+
+  /* The next packet starts afresh. */
+  rx_put(7 * BUF_LEN + 256, 64, 0);
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 1);
+  CHECK(evs[0].rx.len, ==, 64);
+  CHECK(evs[0].rx.flags & (EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT),
+        ==, EF_EVENT_FLAG_SOP);
+  vi_free();
+}
+
+static void test_tx_multi_buffer(void)
+{
+  ef_iovec iov[3] = {
+    { 1 * BUF_LEN + 128, 2000 },
+    { 2 * BUF_LEN + 128, 2000 },
+    { 3 * BUF_LEN + 128, 500 },
+  };
+  ef_request_id ids[EF_VI_TRANSMIT_BATCH];
+  ef_event evs[4];
+  int i, n, rc;
+
+  /* A socket the kernel could not bind for multi-buffer refuses them. */
+  vi_alloc();
+  rc = ef_vi_transmitv_init(vi, iov, 3, 42);
+  CHECK(rc, ==, -EINVAL);
+  CHECK(vi->ep_state->txq.added, ==, 0);
+  vi_free();
+
+  vi_alloc();
+  xdp->offsets.flags = EFAB_AF_XDP_FLAG_SG;
+  rc = ef_vi_transmitv_init(vi, iov, 3, 42);
+  CHECK(rc, ==, 0);
+  CHECK(vi->ep_state->txq.added, ==, 3);
+  for( i = 0; i < 3; ++i ) {
+    CHECK(xdp->tx.desc[i].addr, ==, iov[i].iov_base);
+    CHECK(xdp->tx.desc[i].len, ==, iov[i].iov_len);
+    CHECK(xdp->tx.desc[i].options, ==, i < 2 ? XDP_PKT_CONTD : 0);
+  }
+  CHECK(vi->vi_txq.ids[0], ==, EF_REQUEST_ID_MASK);
+  CHECK(vi->vi_txq.ids[1], ==, EF_REQUEST_ID_MASK);
+  CHECK(vi->vi_txq.ids[2], ==, 42);
+
+  /* A single-buffer packet after it is not marked as continued. */
+  rc = ef_vi_transmitv_init(vi, iov, 1, 43);
+  CHECK(rc, ==, 0);
+  CHECK(xdp->tx.desc[3].options, ==, 0);
+
+  /* A packet that does not fit in the ring is refused as a whole. */
+  rc = ef_vi_transmitv_init(vi, iov, 3, 44);
+  CHECK(rc, ==, 0);
+  rc = ef_vi_transmitv_init(vi, iov, 3, 45);
+  CHECK(rc, ==, 0);
+  rc = ef_vi_transmitv_init(vi, iov, 3, 46);
+  CHECK(rc, ==, 0);
+  rc = ef_vi_transmitv_init(vi, iov, 3, 47);
+  CHECK(rc, ==, -EAGAIN);
+  CHECK(vi->ep_state->txq.added, ==, 13);
+
+  /* Completions are per buffer, and yield one id per packet. */
+  xdp->cr.producer = 4;
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 1);
+  CHECK(EF_EVENT_TYPE(evs[0]), ==, EF_EVENT_TYPE_TX);
+  n = ef_vi_transmit_unbundle(vi, &evs[0], ids);
+  CHECK(n, ==, 2);
+  CHECK(ids[0], ==, 42);
+  CHECK(ids[1], ==, 43);
+  vi_free();
+}
+
+static void test_tx_kick(void)
+{
+  ef_iovec iov = { 1 * BUF_LEN, 60 };
+  int rc;
+
+  /* Without need_wakeup every push of a near-empty ring kicks. */
+  vi_alloc();
+  rc = ef_vi_transmitv(vi, &iov, 1, 1);
+  CHECK(rc, ==, 0);
+  CHECK(kicks, ==, 1);
+  CHECK(stats.xdp_kicks, ==, 1);
+  CHECK(stats.xdp_kicks_elided, ==, 0);
+  CHECK(xdp->tx.producer, ==, 1);
+  vi_free();
+}
+
+static void test_tx_kick_elided(void)
+{
+  ef_iovec iov = { 1 * BUF_LEN, 60 };
+  ef_event evs[4];
+  int rc;
+
+  vi_alloc();
+  xdp->offsets.flags = EFAB_AF_XDP_FLAG_NEED_WAKEUP;
+
+  /* The kernel is processing the ring: no system call. */
+  rc = ef_vi_transmitv(vi, &iov, 1, 1);
+  CHECK(rc, ==, 0);
+  CHECK(kicks, ==, 0);
+  CHECK(stats.xdp_kicks_elided, ==, 1);
+  CHECK(xdp->tx.producer, ==, 1);
+
+  /* Nor is one made later from the poll. */
+  ef_eventq_poll(vi, evs, 4);
+  CHECK(kicks, ==, 0);
+
+  /* The kernel asks to be woken. */
+  xdp->tx.flags = XDP_RING_NEED_WAKEUP;
+  rc = ef_vi_transmitv(vi, &iov, 1, 2);
+  CHECK(rc, ==, 0);
+  CHECK(kicks, ==, 1);
+  CHECK(stats.xdp_kicks, ==, 1);
+  CHECK(stats.xdp_kicks_elided, ==, 1);
+  vi_free();
+}
+
+static void test_busy_poll(void)
+{
+  ef_iovec iov = { 1 * BUF_LEN, 60 };
+  ef_event evs[4];
+  int rc, n;
+
+  /* Polling an idle queue does not normally make system calls. */
+  vi_alloc();
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 0);
+  CHECK(kicks, ==, 0);
+  vi_free();
+
+  /* In busy-poll mode polling kicks to run the NAPI context when there is
+   * something new for it, but checking for events without the stack lock
+   * never does... */
+  vi_alloc();
+  xdp->offsets.flags = EFAB_AF_XDP_FLAG_NEED_WAKEUP |
+                       EFAB_AF_XDP_FLAG_BUSY_POLL;
+  ef_vi_receive_init(vi, 1 * BUF_LEN, 0);
+  ef_vi_receive_push(vi);
+  CHECK(kicks, ==, 0);
+  rc = efxdp_ef_eventq_check_event(vi, 0);
+  CHECK(rc, ==, 0);
+  CHECK(kicks, ==, 0);
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 0);
+  CHECK(kicks, ==, 1);
+  CHECK(stats.xdp_kicks, ==, 1);
+
+  /* ...nor does polling again when neither ring has moved... */
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 0);
+  CHECK(kicks, ==, 1);
+
+  /* ...but a refill or a send since the last kick does... */
+  ef_vi_receive_init(vi, 2 * BUF_LEN, 0);
+  ef_vi_receive_push(vi);
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(kicks, ==, 2);
+  rc = ef_vi_transmitv(vi, &iov, 1, 1);
+  CHECK(rc, ==, 0);
+  CHECK(kicks, ==, 2);
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(kicks, ==, 3);
+  CHECK(stats.xdp_kicks, ==, 3);
+
+  /* ...and nor does polling when there is something there already. */
+  ef_vi_receive_init(vi, 3 * BUF_LEN, 0);
+  ef_vi_receive_push(vi);
+  rx_put(1 * BUF_LEN, 60, 0);
+  rc = efxdp_ef_eventq_check_event(vi, 0);
+  CHECK(rc, ==, 1);
+  n = ef_eventq_poll(vi, evs, 4);
+  CHECK(n, ==, 1);
+  CHECK(kicks, ==, 3);
+  vi_free();
+}
+
+static void test_fill_wakeup(void)
+{
+  ef_iovec iov = { 4 * BUF_LEN, 60 };
+  int rc;
+
+  /* Refilling only kicks when the kernel says it has stalled. */
+  vi_alloc();
+  xdp->offsets.flags = EFAB_AF_XDP_FLAG_NEED_WAKEUP;
+  ef_vi_receive_init(vi, 1 * BUF_LEN, 0);
+  ef_vi_receive_push(vi);
+  CHECK(xdp->fr.producer, ==, 1);
+  CHECK(kicks, ==, 0);
+
+  /* The wakeup is counted on its own, and does not count as having handed
+   * the TX ring to the kernel. */
+  rc = ef_vi_transmitv_init(vi, &iov, 1, 1);
+  CHECK(rc, ==, 0);
+  xdp->fr.flags = XDP_RING_NEED_WAKEUP;
+  ef_vi_receive_init(vi, 2 * BUF_LEN, 0);
+  ef_vi_receive_push(vi);
+  CHECK(xdp->fr.producer, ==, 2);
+  CHECK(kicks, ==, 1);
+  CHECK(stats.xdp_rx_kicks, ==, 1);
+  CHECK(stats.xdp_kicks, ==, 0);
+  CHECK(vi->ep_state->txq.previous, ==, 0);
+  vi_free();
+
+  /* The ring's flags mean nothing without XDP_USE_NEED_WAKEUP. */
+  vi_alloc();
+  xdp->fr.flags = XDP_RING_NEED_WAKEUP;
+  ef_vi_receive_init(vi, 1 * BUF_LEN, 0);
+  ef_vi_receive_push(vi);
+  CHECK(kicks, ==, 0);
+  vi_free();
+}
+
+int main(void)
+{
+  TEST_RUN(test_rx_single);
+  TEST_RUN(test_rx_multi_buffer);
+  TEST_RUN(test_tx_multi_buffer);
+  TEST_RUN(test_tx_kick);
+  TEST_RUN(test_tx_kick_elided);
+  TEST_RUN(test_busy_poll);
+  TEST_RUN(test_fill_wakeup);
+  TEST_END();
+}
@@ -0,0 +1,265 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+
+#include <time.h>
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+
+/* A stack with one packet set and a fake VI whose RX ring is never read. */
+#define RXQ_LIMIT 256
+
+static ci_netif* ni;
+static ef_vi* vi;
+static int n_receive_init;
+static int n_receive_push;
+static int more_bufs_push = -1;
+
+/* Dependencies */
+static int fake_receive_init(ef_vi* vi, ef_addr addr, ef_request_id dma_id)
+{
+  ++vi->ep_state->rxq.added;
+  ++n_receive_init;
+  return 0;
+}
+
+static void fake_receive_push(ef_vi* vi)
+{
+  ++n_receive_push;
+}
+
+/* Always offer set 0; tests arrange for it to run short when they want the
+ * refill to go looking for more buffers. */
+int ci_netif_pktset_best(ci_netif* ni)
+{
+  return 0;
+}
+
+int ci_tcp_helper_more_bufs(ci_netif* ni)
+{
+  more_bufs_push = n_receive_push;
+  return -ENOMEM;
+}
+
+static void pkts_free_all(void)
+{
+  int i;
+
+  ni->packets->set[0].free = OO_PP_NULL;
+  ni->packets->set[0].n_free = 0;
+  ni->packets->n_free = 0;
+  for( i = PKTS_PER_SET - 1; i >= 0; --i ) {
+    ci_ip_pkt_fmt* pkt = (ci_ip_pkt_fmt*) __PKT_BUF(ni, i);
+    OO_PP_INIT(ni, pkt->pp, i);
+    pkt->refcount = 0;
+    pkt->flags = 0;
+    ci_netif_pkt_put(ni, pkt);
+  }
+  ni->state->n_rx_pkts = 0;
+}
+
+static void stack_alloc(void)
+{
+  ni = calloc(1, sizeof(*ni));
+  ni->state = calloc(1, sizeof(*ni->state));
+  ni->state->lock.lock = CI_EPLOCK_LOCKED;
+  ni->state->rxq_limit = RXQ_LIMIT;
+  NI_OPTS(ni).max_rx_packets = PKTS_PER_SET;
+
+  ni->packets = calloc(1, sizeof(*ni->packets) + sizeof(ni->packets->set[0]));
+  /* These fields are const in user-level builds. */
+  *(ci_uint32*) &ni->packets->sets_n = 1;
+  *(ci_uint32*) &ni->packets->sets_max = 1;
+  *(ci_int32*) &ni->packets->n_pkts_allocated = PKTS_PER_SET;
+  ni->packets->set[0].page_order = CI_CFG_PKTS_PER_SET_S;
+  ni->pkt_bufs = calloc(1, sizeof(ni->pkt_bufs[0]));
+  ni->pkt_bufs[0] = calloc(PKTS_PER_SET, CI_CFG_PKT_BUF_SIZE);
+  ni->dma_addrs = calloc(1, sizeof(ni->dma_addrs[0]));
+  ni->state->nonb_pkt_pool = CI_ILL_END;
+  oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ni->state->reap_list));
+  pkts_free_all();
+
+  vi = calloc(1, sizeof(*vi));
+  vi->ep_state = calloc(1, sizeof(*vi->ep_state));
+  vi->vi_rxq.mask = 511;
+  vi->nic_type.arch = EF_VI_ARCH_EF10;
+  vi->ops.receive_init = fake_receive_init;
+  vi->ops.receive_push = fake_receive_push;
+  n_receive_init = n_receive_push = 0;
+}
+
+static void stack_free(void)
+{
+  free(vi->ep_state);
+  free(vi);
+  free(ni->dma_addrs);
+  free(ni->pkt_bufs[0]);
+  free(ni->pkt_bufs);
+  free(ni->packets);
+  free(ni->state);
+  free(ni);
+}
+
+static void test_ci_netif_rx_post(void)
+{
+  int n;
+
+  stack_alloc();
+
+  /* An empty ring is filled to the limit with a single doorbell. */
+  n = ci_netif_rx_post(ni, 0, vi);
+  CHECK(n, ==, RXQ_LIMIT);
+  CHECK(n_receive_init, ==, RXQ_LIMIT);
+  CHECK(n_receive_push, ==, 1);
+  CHECK(ni->state->n_rx_pkts, ==, RXQ_LIMIT);
+  CHECK(ni->packets->n_free, ==, PKTS_PER_SET - RXQ_LIMIT);
+  CHECK(ni->packets->set[0].n_free, ==, PKTS_PER_SET - RXQ_LIMIT);
+
+  /* Topping up after the NIC has consumed some buffers also rings it once,
+   * and only whole batches are posted. */
+  vi->ep_state->rxq.removed += 3 * CI_CFG_RX_DESC_BATCH + 1;
+  n = ci_netif_rx_post(ni, 0, vi);
+  CHECK(n, ==, 3 * CI_CFG_RX_DESC_BATCH);
+  CHECK(n_receive_push, ==, 2);
+
+  stack_free();
+}
+
+static void test_ci_netif_rx_post_short(void)
+{
+  int n;
+
+  stack_alloc();
+  /* There is room for another packet set, so running short sends the
+   * refill to allocate one. */
+  *(ci_uint32*) &ni->packets->sets_max = 2;
+
+  /* Leave set 0 with one batch and a bit. */
+  while( ni->packets->n_free > CI_CFG_RX_DESC_BATCH + 5 ) {
+    ci_ip_pkt_fmt* pkt = PKT(ni, ni->packets->set[0].free);
+    ni->packets->set[0].free = pkt->next;
+    --ni->packets->set[0].n_free;
+    --ni->packets->n_free;
+  }
+
+  /* The batch we could fill is on the NIC before we go looking for more
+   * memory, and isn't rung for a second time afterwards. */
+  more_bufs_push = -1;
+  n = ci_netif_rx_post(ni, 0, vi);
+  CHECK(n, ==, CI_CFG_RX_DESC_BATCH);
+  CHECK(more_bufs_push, ==, 1);
+  CHECK(n_receive_push, ==, 1);
+
+  stack_free();
+}
+
+static void test_ci_netif_spin_adaptive_update(void)
+{
+  citp_waitable w = { .spin_cycles = 6400 };
+  int i;
+
+  stack_alloc();
+
+  /* Waits that spinning could have covered grow the budget to cover them,
+   * at least doubling it, and up to the socket's spin timeout. */
+  ci_netif_spin_adaptive_update(ni, &w, 100);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 100);
+  ci_netif_spin_adaptive_update(ni, &w, 150);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 200);
+  ci_netif_spin_adaptive_update(ni, &w, 4000);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 4000);
+  ci_netif_spin_adaptive_update(ni, &w, 5000);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 6400);
+
+  /* Waits the budget covered leave it alone. */
+  ci_netif_spin_adaptive_update(ni, &w, 50);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 6400);
+  CHECK(ni->state->spin_adaptive_misses, ==, 0);
+
+  /* Only a run of waits longer than the spin timeout shrinks it, and a
+   * covered wait breaks the run. */
+  for( i = 0; i < 3; ++i )
+    ci_netif_spin_adaptive_update(ni, &w, 10000);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 6400);
+  CHECK(ni->state->spin_adaptive_misses, ==, 3);
+  ci_netif_spin_adaptive_update(ni, &w, 50);
+  CHECK(ni->state->spin_adaptive_misses, ==, 0);
+  for( i = 0; i < 4; ++i )
+    ci_netif_spin_adaptive_update(ni, &w, 10000);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 3200);
+  CHECK(ni->state->spin_adaptive_misses, ==, 0);
+
+  /* Halving stops at 1/64 of the timeout, and the next miss run turns
+   * spinning off altogether. */
+  for( i = 0; i < 5 * 4; ++i )
+    ci_netif_spin_adaptive_update(ni, &w, 10000);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 100);
+  for( i = 0; i < 4; ++i )
+    ci_netif_spin_adaptive_update(ni, &w, 10000);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 0);
+
+  /* With no budget, long waits are no longer counted as misses, but a
+   * short one starts it growing again. */
+  ci_netif_spin_adaptive_update(ni, &w, 10000);
+  CHECK(ni->state->spin_adaptive_misses, ==, 0);
+  ci_netif_spin_adaptive_update(ni, &w, 300);
+  CHECK(ni->state->spin_adaptive_cycles, ==, 300);
+
+  stack_free();
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Microbenchmark: cost per descriptor of refilling the ring after the NIC
+ * has consumed a poll's worth of buffers.  Prints results but does not check
+ * them, as timing is not reliable enough for a pass/fail criterion.
+ */
+static void bench_ci_netif_rx_post(void)
+{
+  enum { ROUNDS = 2000, CONSUMED = 64 };
+  double start, elapsed = 0;
+  int r, n_posted = 0;
+
+  stack_alloc();
+  ci_netif_rx_post(ni, 0, vi);
+
+  for( r = 0; r < ROUNDS; ++r ) {
+    vi->ep_state->rxq.removed += CONSUMED;
+    if( ni->packets->n_free < CONSUMED ) {
+      /* Recycle everything; the fake NIC never looks at the buffers.  Only
+       * those still on the ring count as in use for receive. */
+      pkts_free_all();
+      ni->state->n_rx_pkts = RXQ_LIMIT - CONSUMED;
+      ni->packets->n_free -= ni->state->n_rx_pkts;
+      ni->packets->set[0].n_free -= ni->state->n_rx_pkts;
+      ni->packets->set[0].free = OO_PKT_P((ci_ip_pkt_fmt*)
+                                 __PKT_BUF(ni, ni->state->n_rx_pkts));
+    }
+    start = now_ns();
+    n_posted += ci_netif_rx_post(ni, 0, vi);
+    elapsed += now_ns() - start;
+  }
+
+  CHECK(n_posted, ==, ROUNDS * CONSUMED);
+  printf("  rx refill: %.2f ns/desc, %.2f doorbells/refill\n",
+         elapsed / n_posted, (double) (n_receive_push - 1) / ROUNDS);
+
+  stack_free();
+}
+
+int main(void)
+{
+  TEST_RUN(test_ci_netif_rx_post);
+  TEST_RUN(test_ci_netif_rx_post_short);
+  TEST_RUN(test_ci_netif_spin_adaptive_update);
+  TEST_RUN(bench_ci_netif_rx_post);
+  TEST_END();
+}
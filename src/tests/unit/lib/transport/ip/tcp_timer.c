@@ -0,0 +1,195 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2024 Xilinx, Inc. */
+
+#include <time.h>
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+
+/* A stack with just a timer wheel and an array of TCP sockets. */
+#define EP_OFS  CI_ROUND_UP(sizeof(ci_netif_state), EP_BUF_SIZE)
+#define START   1000
+
+static ci_netif* ni;
+
+static ci_tcp_state* sock(int i)
+{
+  return (ci_tcp_state*) ((char*) ni->state + EP_OFS + i * EP_BUF_SIZE);
+}
+
+static void stack_alloc(int n_socks)
+{
+  ci_ip_timer_state* ipts;
+  int i;
+
+  ni = calloc(1, sizeof(*ni));
+  ni->state = calloc(1, EP_OFS + n_socks * EP_BUF_SIZE);
+  /* These fields are const in user-level builds. */
+  *(ci_uint32*) &ni->state->ep_ofs = EP_OFS;
+  *(ci_uint32*) &ni->state->n_ep_bufs = n_socks;
+
+  ipts = IPTIMER_STATE(ni);
+  ipts->sched_ticks = ipts->ci_ip_time_real_ticks = START;
+  ipts->closest_timer = START + 2 * CI_IPTIME_BUCKETS;
+  oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ipts->fire_list));
+  for( i = 0; i < CI_IPTIME_WHEELSIZE; i++ )
+    oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ipts->warray[i]));
+
+  for( i = 0; i < n_socks; ++i ) {
+    ci_tcp_state* ts = sock(i);
+    oo_p sp;
+    ts->s.b.bufid = i;
+    ts->s.b.state = CI_TCP_ESTABLISHED;
+    ts->tcp_tid.fn = CI_IP_TIMER_TCP_MUX;
+    sp = TS_OFF(ni, ts);
+    OO_P_ADD(sp, CI_MEMBER_OFFSET(ci_tcp_state, tcp_tid));
+    ci_ip_timer_init(ni, &ts->tcp_tid, sp, "tcpt");
+  }
+}
+
+static void stack_free(void)
+{
+  free(ni->state);
+  free(ni);
+}
+
+static void advance(ci_iptime_t ticks)
+{
+  IPTIMER_STATE(ni)->ci_ip_time_real_ticks += ticks;
+  ci_ip_timer_poll(ni);
+}
+
+static void test_ci_tcp_timer_set(void)
+{
+  ci_tcp_state* ts;
+
+  stack_alloc(1);
+  ts = sock(0);
+
+  /* The first timer arms the wheel entry; a later one leaves it alone. */
+  ci_tcp_timer_set(ni, ts, CI_TCP_TIMER_RTO, START + 100);
+  ci_tcp_timer_set(ni, ts, CI_TCP_TIMER_KALIVE, START + 1000);
+  CHECK_TRUE(ci_ip_timer_pending(ni, &ts->tcp_tid));
+  CHECK(ts->tcp_tid.time, ==, START + 100);
+  CHECK(ni->state->stats.tcp_timer_wheel_ops, ==, 1);
+  CHECK(ni->state->stats.tcp_timer_deferred_ops, ==, 1);
+
+  /* Pushing the earliest deadline back doesn't touch the wheel... */
+  ci_tcp_timer_modify(ni, ts, CI_TCP_TIMER_RTO, START + 200);
+  CHECK(ts->tcp_tid.time, ==, START + 100);
+  CHECK(ci_tcp_timer_time(ts, CI_TCP_TIMER_RTO), ==, START + 200);
+  CHECK(ni->state->stats.tcp_timer_wheel_ops, ==, 1);
+
+  /* ...but bringing one forward does. */
+  ci_tcp_timer_set(ni, ts, CI_TCP_TIMER_DELACK, START + 50);
+  CHECK(ts->tcp_tid.time, ==, START + 50);
+  CHECK(ni->state->stats.tcp_timer_wheel_ops, ==, 2);
+  CHECK(ts->timers_pending, ==, (1u << CI_TCP_TIMER_RTO) |
+                                (1u << CI_TCP_TIMER_DELACK) |
+                                (1u << CI_TCP_TIMER_KALIVE));
+
+  /* Clearing one of several leaves the entry to expire early... */
+  ci_tcp_timer_clear(ni, ts, CI_TCP_TIMER_DELACK);
+  CHECK_FALSE(ci_tcp_timer_pending(ts, CI_TCP_TIMER_DELACK));
+  CHECK_TRUE(ci_ip_timer_pending(ni, &ts->tcp_tid));
+
+  /* ...whereupon it is re-armed for the earliest remaining deadline. */
+  advance(50);
+  CHECK(ni->state->stats.tcp_timer_expiries, ==, 1);
+  CHECK(ni->state->stats.tcp_timer_early_expiries, ==, 1);
+  CHECK_TRUE(ci_ip_timer_pending(ni, &ts->tcp_tid));
+  CHECK(ts->tcp_tid.time, ==, START + 200);
+  CHECK(ts->timers_pending, ==, (1u << CI_TCP_TIMER_RTO) |
+                                (1u << CI_TCP_TIMER_KALIVE));
+
+  /* Clearing the last timer takes the entry off the wheel. */
+  ci_tcp_timer_clear(ni, ts, CI_TCP_TIMER_RTO);
+  CHECK_TRUE(ci_ip_timer_pending(ni, &ts->tcp_tid));
+  ci_tcp_timer_clear(ni, ts, CI_TCP_TIMER_KALIVE);
+  CHECK_FALSE(ci_ip_timer_pending(ni, &ts->tcp_tid));
+  CHECK(ts->timers_pending, ==, 0);
+
+  stack_free();
+}
+
+static void test_ci_tcp_timeout_mux(void)
+{
+  ci_tcp_state* ts;
+  ci_iptime_t idle = 2000, expect;
+
+  stack_alloc(1);
+  ts = sock(0);
+  ts->s.s_flags |= CI_SOCK_FLAG_KALIVE;
+  ts->c.t_ka_time = idle;
+
+  /* A keepalive timer that expires soon after the last receive is
+   * restarted for the rest of the idle time, rounded up to a bucket. */
+  ts->t_last_recv_ack = START;
+  ci_tcp_timer_set(ni, ts, CI_TCP_TIMER_KALIVE, START + 10);
+  ci_tcp_timer_set(ni, ts, CI_TCP_TIMER_RTO, START + 500);
+  advance(10);
+  expect = ci_tcp_kalive_bucket(START + idle, idle);
+  CHECK(expect % (1u << CI_TCP_KALIVE_BUCKET_BITS), ==, 0);
+  CHECK(ni->state->stats.tcp_timer_expiries, ==, 1);
+  CHECK(ni->state->stats.tcp_timer_early_expiries, ==, 0);
+  CHECK_TRUE(ci_tcp_timer_pending(ts, CI_TCP_TIMER_KALIVE));
+  CHECK(ci_tcp_timer_time(ts, CI_TCP_TIMER_KALIVE), ==, expect);
+
+  /* The RTO wasn't due, and is now the earliest deadline. */
+  CHECK_TRUE(ci_tcp_timer_pending(ts, CI_TCP_TIMER_RTO));
+  CHECK(ts->tcp_tid.time, ==, START + 500);
+
+  ci_tcp_timer_clear(ni, ts, CI_TCP_TIMER_RTO);
+  ci_tcp_timer_clear(ni, ts, CI_TCP_TIMER_KALIVE);
+  stack_free();
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Microbenchmark: cost of restarting the RTO on every ACK across many
+ * connections, as time advances.  Prints results but does not check them,
+ * as timing is not reliable enough for a pass/fail criterion.
+ */
+static void bench_ci_tcp_timer_restart(void)
+{
+  enum { SOCKS = 1024, TICKS = 2000, RTO = 200 };
+  ci_uint64 ops = (ci_uint64) SOCKS * TICKS;
+  double start, elapsed = 0;
+  int i, t;
+
+  stack_alloc(SOCKS);
+  for( i = 0; i < SOCKS; ++i )
+    ci_tcp_timer_set(ni, sock(i), CI_TCP_TIMER_RTO, START + RTO);
+
+  for( t = 0; t < TICKS; ++t ) {
+    start = now_ns();
+    advance(1);
+    for( i = 0; i < SOCKS; ++i )
+      ci_tcp_timer_modify(ni, sock(i), CI_TCP_TIMER_RTO,
+                          ci_tcp_time_now(ni) + RTO);
+    elapsed += now_ns() - start;
+  }
+
+  CHECK(ni->state->stats.tcp_timer_early_expiries, ==,
+        ni->state->stats.tcp_timer_expiries);
+  printf("  rto restart: %.2f ns/op, %.4f wheel ops/op\n", elapsed / ops,
+         (double) ni->state->stats.tcp_timer_wheel_ops / ops);
+
+  stack_free();
+}
+
+int main(void)
+{
+  TEST_RUN(test_ci_tcp_timer_set);
+  TEST_RUN(test_ci_tcp_timeout_mux);
+  TEST_RUN(bench_ci_tcp_timer_restart);
+  TEST_END();
+}
@@ -13,9 +13,14 @@ UNIT_TEST_WRAPPER ?=
 # In principle, this could be autogenerated by searching the source directory.
 ALL_UNIT_TESTS := \
   header/ci/internal/ip_timestamp \
+  lib/transport/ip/netif \
+  lib/transport/ip/netif_event \
   lib/transport/ip/netif_init \
   lib/transport/ip/tcp_rx \
+  lib/transport/ip/tcp_timer \
   lib/ciul/checksum \
+  lib/ciul/efxdp_vi \
+  lib/citools/toeplitz \
 
 # The tests to be run, and their corresponding files
 TESTS := $(filter $(UNIT_TEST_FILTER)%, $(ALL_UNIT_TESTS))
@@ -24,7 +29,8 @@ OBJECTS := $(TESTS:%=%.o)
 PASSED := $(TESTS:%=%.passed)
 
 # Library objects names are mangled with a prefix. Deal with that madness here.
-LIB_PREFIXES := lib/transport/common/ci_tp_common_ lib/transport/ip/ci_ip_
+LIB_PREFIXES := lib/transport/common/ci_tp_common_ lib/transport/ip/ci_ip_ \
+                lib/citools/ci_tools_ lib/ciul/ci_ul_
 
 lib_prefix = $(notdir $(filter $(dir $(1))%,$(LIB_PREFIXES)))
 lib_object = ../../$(dir $(1))$(call lib_prefix,$(1))$(notdir $(1)).o
@@ -63,6 +69,10 @@ NO_PIE = $(shell echo 'int main(void){return 0;}' | \
 # invididual test without waiting for several seconds of flappery first.
 $(TARGETS): MMAKE_DIR_LINKFLAGS += -Wl,--unresolved-symbols=ignore-all $(NO_PIE)
 $(filter lib/%, $(TARGETS)): $$(call lib_object,$$@)
+lib/ciul/efxdp_vi: ../../lib/ciul/ci_ul_pt_tx.o
+lib/transport/ip/netif_event: ../../lib/transport/ip/ci_ip_netif.o
+lib/transport/ip/tcp_rx: ../../lib/transport/ip/ci_ip_tcp_misc.o
+lib/transport/ip/tcp_timer: ../../lib/transport/ip/ci_ip_iptimer.o
 $(TARGETS): %: %.o stubs.o
 	$(MMakeLinkCApp)
 
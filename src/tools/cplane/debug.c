@@ -65,6 +65,12 @@ void cp_mibs_verify_identical(struct cp_session* s, bool llap_only)
     ci_assert_equal(a->net_ipset, b->net_ipset);
     ci_assert_equal(a->scope, b->scope);
   }
+  ci_assert(!memcmp(s->mib[0].ipif_index, s->mib[1].ipif_index,
+                    sizeof(s->mib[0].ipif_index[0]) *
+                    s->mib[0].dim->ipif_max));
+  ci_assert(!memcmp(s->mib[0].ip6if_index, s->mib[1].ip6if_index,
+                    sizeof(s->mib[0].ip6if_index[0]) *
+                    s->mib[0].dim->ip6if_max));
   for( i = 0; i < s->mib[0].dim->svc_arrays_max; i++ ) {
     struct cp_svc_ep_array* a = &s->mib[0].svc_arrays[i];
     struct cp_svc_ep_array* b = &s->mib[1].svc_arrays[i];
@@ -87,6 +93,11 @@ void cp_mibs_verify_identical(struct cp_session* s, bool llap_only)
       ci_assert_equal(a->u.service.head_array_id, b->u.service.head_array_id);
       ci_assert_equal(a->u.service.tail_array_id, b->u.service.tail_array_id);
       ci_assert_equal(a->u.service.n_backends, b->u.service.n_backends);
+      ci_assert_equal(a->u.service.lookup_id, b->u.service.lookup_id);
+      if( CICP_ROWID_IS_VALID(a->u.service.lookup_id) )
+        ci_assert(!memcmp(&s->mib[0].svc_lookups[a->u.service.lookup_id],
+                          &s->mib[1].svc_lookups[a->u.service.lookup_id],
+                          sizeof(struct cp_svc_lookup)));
       break;
     case CP_SVC_BACKEND:
       ci_assert_equal(a->u.backend.svc_id, b->u.backend.svc_id);
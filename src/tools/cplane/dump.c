@@ -266,3 +266,15 @@ void cp_periodic_dump(struct cp_session* s)
   cp_dump_init(s);
 }
 
+
+/* We have lost a netlink message, so whatever we are dumping now can't be
+ * trusted and the tables may have missed an update.  Dump everything again:
+ * cp_dump_fini() restarts a user-requested dump at once and schedules a
+ * periodic one to restart shortly. */
+void cp_dump_resync(struct cp_session* s)
+{
+  if( s->state == CP_DUMP_IDLE )
+    cp_dump_init(s);
+  else
+    cp_dump_fini(s, false);
+}
@@ -707,17 +707,18 @@ ipif_find_row(ci_ifid_t ifindex, ci_ip_addr_t net_ip,
               cicp_prefixlen_t net_ipset, struct cp_mibs* mib)
 {
   cicp_rowid_t i;
+  int n;
 
   /* This function must not be called if ipif table
    * may be uncompressed. */
 
-  for( i = 0; i < mib->dim->ipif_max; i++ ) {
+  CP_IFADDR_CHAIN_FOR_EACH(i, n, mib->ipif_index, mib->dim->ipif_max,
+                           cp_ipif_addr_bucket(net_ip, mib->dim->ipif_max),
+                           addr_head, addr_next) {
     if( mib->ipif[i].ifindex == ifindex &&
         mib->ipif[i].net_ip == net_ip &&
         mib->ipif[i].net_ipset == net_ipset )
       return i;
-    if( cicp_ipif_row_is_free(&mib->ipif[i]) )
-      return CICP_ROWID_BAD;
   }
   return CICP_ROWID_BAD;
 }
@@ -733,6 +734,23 @@ ipif_find_free(struct cp_mibs* mib)
   return CICP_ROWID_BAD;
 }
 
+/* Finds the first free row of a compact table, in which all occupied rows
+ * precede all free ones, without scanning the occupied rows. */
+static cicp_rowid_t
+ipif_find_free_compact(struct cp_mibs* mib)
+{
+  cicp_rowid_t lo = 0, hi = mib->dim->ipif_max, mid;
+
+  while( lo < hi ) {
+    mid = lo + (hi - lo) / 2;
+    if( cicp_ipif_row_is_free(&mib->ipif[mid]) )
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo < mib->dim->ipif_max ? lo : CICP_ROWID_BAD;
+}
+
 static void
 ipif_compact_one(struct cp_mibs* mib, cicp_rowid_t id)
 {
@@ -768,6 +786,55 @@ ipif_compact(struct cp_mibs* mib)
     cicp_ipif_row_free(&mib->ipif[free]);
 }
 
+/* Links a newly-added row onto the tails of its chains.  The row must be the
+ * last occupied row of a compact table, so the chains stay in ascending row
+ * order.  The row's links are written before the row is reachable, so that a
+ * reader walking the chain never follows a stale link. */
+static void
+cp_ifaddr_index_append(struct cp_ifaddr_index* index, cicp_rowid_t id,
+                       unsigned addr_b, unsigned ifindex_b)
+{
+  cicp_rowid_t* link;
+
+  index[id].addr_next = index[id].ifindex_next = CICP_ROWID_BAD;
+  ci_wmb();
+  for( link = &index[addr_b].addr_head; *link != CICP_ROWID_BAD;
+       link = &index[*link].addr_next )
+    ;
+  *link = id;
+  for( link = &index[ifindex_b].ifindex_head; *link != CICP_ROWID_BAD;
+       link = &index[*link].ifindex_next )
+    ;
+  *link = id;
+}
+
+/* Rebuilds the hashed index of the ipif table after rows have been removed
+ * or moved.  Rows are pushed onto the chains from the last to the first, so
+ * that the chains are in ascending row order. */
+void
+cp_ipif_index_rebuild(struct cp_mibs* mib)
+{
+  struct cp_ifaddr_index* index = mib->ipif_index;
+  int max = mib->dim->ipif_max;
+  cicp_rowid_t id;
+  unsigned b;
+
+  for( id = 0; id < max; id++ )
+    index[id].addr_head = index[id].ifindex_head = CICP_ROWID_BAD;
+
+  for( id = max - 1; id >= 0; id-- ) {
+    index[id].addr_next = index[id].ifindex_next = CICP_ROWID_BAD;
+    if( cicp_ipif_row_is_free(&mib->ipif[id]) )
+      continue;
+    b = cp_ipif_addr_bucket(mib->ipif[id].net_ip, max);
+    index[id].addr_next = index[b].addr_head;
+    index[b].addr_head = id;
+    b = cp_ifaddr_ifindex_bucket(mib->ipif[id].ifindex, max);
+    index[id].ifindex_next = index[b].ifindex_head;
+    index[b].ifindex_head = id;
+  }
+}
+
 static void
 ipif_handle(struct cp_session* s, uint16_t nlmsg_type,
             struct ifaddrmsg* ifmsg, size_t bytes)
@@ -824,7 +891,7 @@ ipif_handle(struct cp_session* s, uint16_t nlmsg_type,
         ipif = &mib->ipif[id];
       }
       else {
-        id = ipif_find_free(mib);
+        id = ipif_find_free_compact(mib);
         if( id == CICP_ROWID_BAD ) {
           static bool printed = false;
           s->stats.ipif.full++;
@@ -840,6 +907,11 @@ ipif_handle(struct cp_session* s, uint16_t nlmsg_type,
         cp_mibs_under_change(s);
         ipif->ifindex = ifindex;
         ipif->net_ip = net_ip;
+        cp_ifaddr_index_append(mib->ipif_index, id,
+                               cp_ipif_addr_bucket(net_ip,
+                                                   mib->dim->ipif_max),
+                               cp_ifaddr_ifindex_bucket(ifindex,
+                                                        mib->dim->ipif_max));
         if( ! mib_i )
           cp_ipif_notify_oof(s, mib, AF_INET, id);
       }
@@ -873,6 +945,7 @@ ipif_handle(struct cp_session* s, uint16_t nlmsg_type,
         cp_mibs_under_change(s);
         cicp_ipif_row_free(&mib->ipif[id]);
         ipif_compact_one(mib, id);
+        cp_ipif_index_rebuild(mib);
         s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
                     CP_SESSION_LADDR_REFRESH_NEEDED;
       }
@@ -910,8 +983,10 @@ void cp_ipif_dump_done(struct cp_session* s)
       cicp_ipif_row_free(ipif);
     }
 
-    if( has_unseen )
+    if( has_unseen ) {
       ipif_compact(mib);
+      cp_ipif_index_rebuild(mib);
+    }
   MIB_UPDATE_LOOP_END(mib, s);
 }
 
@@ -920,14 +995,15 @@ ip6if_find_row(ci_ifid_t ifindex, ci_ip6_addr_t net_ip,
                cicp_prefixlen_t net_ipset, const struct cp_mibs* mib)
 {
   cicp_rowid_t i;
+  int n;
 
-  for( i = 0; i < mib->dim->ip6if_max; i++ ) {
+  CP_IFADDR_CHAIN_FOR_EACH(i, n, mib->ip6if_index, mib->dim->ip6if_max,
+                           cp_ip6if_addr_bucket(net_ip, mib->dim->ip6if_max),
+                           addr_head, addr_next) {
     if( mib->ip6if[i].ifindex == ifindex &&
         !memcmp(mib->ip6if[i].net_ip6, net_ip, sizeof(ci_ip6_addr_t)) &&
         mib->ip6if[i].net_ipset == net_ipset )
       return i;
-    if( cicp_ip6if_row_is_free(&mib->ip6if[i]) )
-      return CICP_ROWID_BAD;
   }
   return CICP_ROWID_BAD;
 }
@@ -944,6 +1020,21 @@ ip6if_find_free(const struct cp_mibs* mib)
   return CICP_ROWID_BAD;
 }
 
+static cicp_rowid_t
+ip6if_find_free_compact(const struct cp_mibs* mib)
+{
+  cicp_rowid_t lo = 0, hi = mib->dim->ip6if_max, mid;
+
+  while( lo < hi ) {
+    mid = lo + (hi - lo) / 2;
+    if( cicp_ip6if_row_is_free(&mib->ip6if[mid]) )
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo < mib->dim->ip6if_max ? lo : CICP_ROWID_BAD;
+}
+
 static void
 ip6if_compact_one(struct cp_mibs* mib, cicp_rowid_t id)
 {
@@ -975,6 +1066,30 @@ ip6if_compact(struct cp_mibs* mib)
     cicp_ip6if_row_free(&mib->ip6if[free]);
 }
 
+void
+cp_ip6if_index_rebuild(struct cp_mibs* mib)
+{
+  struct cp_ifaddr_index* index = mib->ip6if_index;
+  int max = mib->dim->ip6if_max;
+  cicp_rowid_t id;
+  unsigned b;
+
+  for( id = 0; id < max; id++ )
+    index[id].addr_head = index[id].ifindex_head = CICP_ROWID_BAD;
+
+  for( id = max - 1; id >= 0; id-- ) {
+    index[id].addr_next = index[id].ifindex_next = CICP_ROWID_BAD;
+    if( cicp_ip6if_row_is_free(&mib->ip6if[id]) )
+      continue;
+    b = cp_ip6if_addr_bucket(mib->ip6if[id].net_ip6, max);
+    index[id].addr_next = index[b].addr_head;
+    index[b].addr_head = id;
+    b = cp_ifaddr_ifindex_bucket(mib->ip6if[id].ifindex, max);
+    index[id].ifindex_next = index[b].ifindex_head;
+    index[b].ifindex_head = id;
+  }
+}
+
 static void
 ip6if_handle(struct cp_session* s, uint16_t nlmsg_type,
              struct ifaddrmsg* ifmsg, size_t bytes)
@@ -1010,7 +1125,7 @@ ip6if_handle(struct cp_session* s, uint16_t nlmsg_type,
         ip6if = &mib->ip6if[id];
       }
       else {
-        id = ip6if_find_free(mib);
+        id = ip6if_find_free_compact(mib);
         if( id == CICP_ROWID_BAD ) {
           static bool printed = false;
           if( ! printed ) {
@@ -1025,6 +1140,11 @@ ip6if_handle(struct cp_session* s, uint16_t nlmsg_type,
         cp_mibs_under_change(s);
         ip6if->ifindex = ifindex;
         memcpy(ip6if->net_ip6, net_ip, sizeof(net_ip));
+        cp_ifaddr_index_append(mib->ip6if_index, id,
+                               cp_ip6if_addr_bucket(net_ip,
+                                                    mib->dim->ip6if_max),
+                               cp_ifaddr_ifindex_bucket(ifindex,
+                                                        mib->dim->ip6if_max));
         if( ! mib_i )
           cp_ipif_notify_oof(s, mib, AF_INET6, id);
       }
@@ -1056,6 +1176,7 @@ ip6if_handle(struct cp_session* s, uint16_t nlmsg_type,
         cp_mibs_under_change(s);
         cicp_ip6if_row_free(&mib->ip6if[id]);
         ip6if_compact_one(mib, id);
+        cp_ip6if_index_rebuild(mib);
         s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
                     CP_SESSION_LADDR_REFRESH_NEEDED;
       }
@@ -1090,8 +1211,10 @@ void cp_ip6if_dump_done(struct cp_session* s)
       cicp_ip6if_row_free(ip6if);
     }
 
-    if( has_unseen )
+    if( has_unseen ) {
       ip6if_compact(mib);
+      cp_ip6if_index_rebuild(mib);
+    }
   MIB_UPDATE_LOOP_END(mib, s);
 }
 
@@ -1460,130 +1583,322 @@ ssize_t cp_sock_recv(struct cp_session* s, int sock)
   return recv(sock, s->buf, s->buf_size, 0);
 }
 
-CP_UNIT_EXTERN void
+static void
+cp_nl_net_handle_one(struct cp_session* s, struct nlmsghdr* nlhdr)
+{
+  switch( nlhdr->nlmsg_type ) {
+    case NLMSG_ERROR:
+      error_handle(s, NLMSG_DATA(nlhdr),
+                   NLMSG_PAYLOAD(nlhdr, sizeof(struct nlmsgerr)));
+      break;
+
+    case NLMSG_NOOP:
+      break;
+
+    case NLMSG_DONE:
+      cp_do_dump(s);
+      break;
+
+    case RTM_NEWNEIGH:
+    case RTM_DELNEIGH:
+      neigh_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
+                   NLMSG_PAYLOAD(nlhdr, sizeof(struct ndmsg)));
+      break;
+
+    case RTM_NEWRULE:
+      cp_newrule_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
+                        NLMSG_PAYLOAD(nlhdr,
+                                      sizeof(struct fib_rule_hdr)));
+      /* cp_newrule_handle() sets
+       * CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED if really needed,
+       * but we have to set CP_SESSION_FLAG_FWD_REFRESH_NEEDED unless we
+       * are in a dump. */
+      if( s->state != CP_DUMP_RULE )
+        s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED;
+      break;
+    case RTM_DELRULE:
+      s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
+                  CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED;
+      break;
+
+    case RTM_NEWROUTE:
+    {
+      struct rtmsg* rtm = NLMSG_DATA(nlhdr);
+
+      switch( rtm->rtm_family ) {
+        case AF_INET:
+          if( rtm->rtm_src_len != 32 && rtm->rtm_src_len != 0 )
+            goto bad_newroute;
+          break;
+        case AF_INET6:
+          if( rtm->rtm_src_len != 128 && rtm->rtm_src_len != 0)
+            goto bad_newroute;
+          break;
+        default:
+          goto bad_newroute;
+      }
+      if( nlhdr->nlmsg_pid == s->sock_net_name.nl_pid &&
+          nlhdr->nlmsg_seq != CP_FWD_FLAG_DUMP ) {
+        /* this is an answer to our request for a particular /32 route */
+        cp_nl_route_handle(s, nlhdr, rtm,
+                           NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
+        break;
+      }
+
+      /* We use the same parser for RTM_NEWRULE and RTM_NEWROUTE,
+       * because the netlink messages are really structured in the same
+       * way. */
+      CI_BUILD_ASSERT(sizeof(struct fib_rule_hdr) == sizeof(struct rtmsg));
+      cp_newrule_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
+                        NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
+
+      /* Maintain our mirror of the route tables */
+      cp_nl_route_table_update(s, nlhdr, rtm,
+                               NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
+
+      /* We need to refresh fwd cache if it is a new route.
+       * We always refresh fwd cache during full dump.
+       * So we do not check if it is a new route or re-dump of existing
+       * route; let's refresh in any case. */
+      s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED;
+      break;
+    bad_newroute:
+      ci_log("ERROR: unknown address family %d or unexpected source "
+             "address length %d in a RTM_NEWROUTE message",
+             rtm->rtm_family, rtm->rtm_src_len);
+      ci_assert(0);
+      break;
+    }
+    case RTM_DELROUTE:
+      /* Maintain our mirror of the route tables */
+      cp_nl_route_table_update(s, nlhdr, NLMSG_DATA(nlhdr),
+                               NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
+      s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
+                  CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED;
+      break;
+
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+      ipif_handle_generic(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
+                          NLMSG_PAYLOAD(nlhdr, sizeof(struct ifaddrmsg)));
+      break;
+
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+      llap_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
+                  NLMSG_PAYLOAD(nlhdr, sizeof(struct ifinfomsg)));
+      break;
+
+    default:
+      ci_log("ERROR: unknown RTM message type %d", nlhdr->nlmsg_type);
+      ci_assert(0);
+      break;
+  }
+}
+
+#ifdef CP_ANYUNIT
+/* The server handles datagrams in batches; unit tests feed them one at a
+ * time. */
+void
 cp_nl_net_handle_msg(struct cp_session* s, struct nlmsghdr* nlhdr,
                      ssize_t bytes)
 {
   while( NLMSG_OK(nlhdr, bytes) ) {
-    switch( nlhdr->nlmsg_type ) {
-      case NLMSG_ERROR:
-        error_handle(s, NLMSG_DATA(nlhdr),
-                     NLMSG_PAYLOAD(nlhdr, sizeof(struct nlmsgerr)));
-        break;
+    cp_nl_net_handle_one(s, nlhdr);
+    nlhdr = NLMSG_NEXT(nlhdr, bytes);
+  }
+}
+#endif
 
-      case NLMSG_NOOP:
-        break;
 
-      case NLMSG_DONE:
-        cp_do_dump(s);
-        break;
+/* Each neighbour message carries the complete state of the entry, so when
+ * a batch has several messages about the same neighbour, only the last one
+ * needs to be applied and published to the fwd table.  Replies to our own
+ * requests and parts of a dump are always applied.
+ *
+ * We do not coalesce link and address messages: other messages depend on
+ * the order in which they are applied.  Route and rule messages are
+ * already coalesced into one fwd cache refresh per batch. */
+struct cp_nl_neigh_key {
+  ci_addr_t addr;
+  ci_ifid_t ifindex;
+  int af;
+};
 
-      case RTM_NEWNEIGH:
-      case RTM_DELNEIGH:
-        neigh_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
-                     NLMSG_PAYLOAD(nlhdr, sizeof(struct ndmsg)));
-        break;
+struct cp_nl_coalesce {
+  struct cp_nl_neigh_key key;
+  int last; /* index in the batch of the last message with this key */
+};
 
-      case RTM_NEWRULE:
-        cp_newrule_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
-                          NLMSG_PAYLOAD(nlhdr,
-                                        sizeof(struct fib_rule_hdr)));
-        /* cp_newrule_handle() sets
-         * CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED if really needed,
-         * but we have to set CP_SESSION_FLAG_FWD_REFRESH_NEEDED unless we
-         * are in a dump. */
-        if( s->state != CP_DUMP_RULE )
-          s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED;
-        break;
-      case RTM_DELRULE:
-        s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
-                    CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED;
-        break;
+#define CP_NL_COALESCE_SIZE (CP_NL_BATCH_MSGS * 4)
 
-      case RTM_NEWROUTE:
-      {
-        struct rtmsg* rtm = NLMSG_DATA(nlhdr);
+static bool
+cp_nl_neigh_key(struct cp_session* s, struct nlmsghdr* nlhdr,
+                struct cp_nl_neigh_key* key)
+{
+  struct ndmsg* ndmsg = NLMSG_DATA(nlhdr);
+  size_t bytes;
+
+  if( (nlhdr->nlmsg_type != RTM_NEWNEIGH &&
+       nlhdr->nlmsg_type != RTM_DELNEIGH) ||
+      (nlhdr->nlmsg_flags & NLM_F_MULTI) ||
+      nlhdr->nlmsg_pid == s->sock_net_name.nl_pid ||
+      nlhdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct ndmsg)) )
+    return false;
+
+  memset(key, 0, sizeof(*key));
+  key->af = ndmsg->ndm_family;
+  key->ifindex = ndmsg->ndm_ifindex;
+  bytes = NLMSG_PAYLOAD(nlhdr, sizeof(struct ndmsg));
+  RTA_LOOP(ndmsg, attr, bytes) {
+    if( (attr->rta_type & NLA_TYPE_MASK) == NDA_DST ) {
+      memcpy(&key->addr, RTA_DATA(attr),
+             CI_MIN(RTA_PAYLOAD(attr), sizeof(key->addr)));
+      return true;
+    }
+  }
+  return false;
+}
 
-        switch( rtm->rtm_family ) {
-          case AF_INET:
-            if( rtm->rtm_src_len != 32 && rtm->rtm_src_len != 0 )
-              goto bad_newroute;
-            break;
-          case AF_INET6:
-            if( rtm->rtm_src_len != 128 && rtm->rtm_src_len != 0)
-              goto bad_newroute;
-            break;
-          default:
-            goto bad_newroute;
-        }
-        if( nlhdr->nlmsg_pid == s->sock_net_name.nl_pid &&
-            nlhdr->nlmsg_seq != CP_FWD_FLAG_DUMP ) {
-          /* this is an answer to our request for a particular /32 route */
-          cp_nl_route_handle(s, nlhdr, rtm,
-                             NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
-          break;
-        }
+static struct cp_nl_coalesce*
+cp_nl_coalesce_find(struct cp_nl_coalesce* table,
+                    const struct cp_nl_neigh_key* key, bool insert)
+{
+  const uint32_t* words = (const uint32_t*) &key->addr;
+  uint32_t hash = key->ifindex ^ ((uint32_t) key->af << 16);
+  int i;
+
+  for( i = 0; i < sizeof(key->addr) / sizeof(uint32_t); i++ )
+    hash = (hash ^ words[i]) * 0x9e3779b1;
+  hash ^= hash >> 16;
+
+  for( i = 0; i < CP_NL_COALESCE_SIZE; i++ ) {
+    struct cp_nl_coalesce* c = &table[(hash + i) % CP_NL_COALESCE_SIZE];
+    if( c->last < 0 ) {
+      if( ! insert )
+        return NULL;
+      c->key = *key;
+      return c;
+    }
+    if( memcmp(&c->key, key, sizeof(*key)) == 0 )
+      return c;
+  }
+  return NULL;
+}
 
-        /* We use the same parser for RTM_NEWRULE and RTM_NEWROUTE,
-         * because the netlink messages are really structured in the same
-         * way. */
-        CI_BUILD_ASSERT(sizeof(struct fib_rule_hdr) == sizeof(struct rtmsg));
-        cp_newrule_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
-                          NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
-
-        /* Maintain our mirror of the route tables */
-        cp_nl_route_table_update(s, nlhdr, rtm,
-                                 NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
-
-        /* We need to refresh fwd cache if it is a new route.
-         * We always refresh fwd cache during full dump.
-         * So we do not check if it is a new route or re-dump of existing
-         * route; let's refresh in any case. */
-        s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED;
-        break;
-      bad_newroute:
-        ci_log("ERROR: unknown address family %d or unexpected source "
-               "address length %d in a RTM_NEWROUTE message",
-               rtm->rtm_family, rtm->rtm_src_len);
-        ci_assert(0);
-        break;
+/* Handles n datagrams read from the NETLINK_ROUTE socket in one go. */
+CP_UNIT_EXTERN void
+cp_nl_net_handle_batch(struct cp_session* s, struct mmsghdr* msgs, int n)
+{
+  struct cp_nl_coalesce table[CP_NL_COALESCE_SIZE];
+  struct cp_nl_neigh_key key;
+  struct cp_nl_coalesce* c;
+  struct nlmsghdr* nlhdr;
+  ssize_t bytes;
+  int i, seq;
+
+  for( i = 0; i < CP_NL_COALESCE_SIZE; i++ )
+    table[i].last = -1;
+
+  /* Find the last message about each neighbour.  If the table is full, the
+   * remaining neighbours are not coalesced. */
+  seq = 0;
+  for( i = 0; i < n; i++ ) {
+    nlhdr = msgs[i].msg_hdr.msg_iov->iov_base;
+    bytes = msgs[i].msg_len;
+    for( ; NLMSG_OK(nlhdr, bytes); nlhdr = NLMSG_NEXT(nlhdr, bytes), seq++ ) {
+      if( cp_nl_neigh_key(s, nlhdr, &key) &&
+          (c = cp_nl_coalesce_find(table, &key, true)) != NULL )
+        c->last = seq;
+    }
+  }
+
+  seq = 0;
+  for( i = 0; i < n; i++ ) {
+    nlhdr = msgs[i].msg_hdr.msg_iov->iov_base;
+    bytes = msgs[i].msg_len;
+    for( ; NLMSG_OK(nlhdr, bytes); nlhdr = NLMSG_NEXT(nlhdr, bytes), seq++ ) {
+      if( cp_nl_neigh_key(s, nlhdr, &key) &&
+          (c = cp_nl_coalesce_find(table, &key, false)) != NULL &&
+          c->last != seq ) {
+        s->stats.nlmsg.coalesced++;
+        continue;
       }
-      case RTM_DELROUTE:
-        /* Maintain our mirror of the route tables */
-        cp_nl_route_table_update(s, nlhdr, NLMSG_DATA(nlhdr),
-                                 NLMSG_PAYLOAD(nlhdr, sizeof(struct rtmsg)));
-        s->flags |= CP_SESSION_FLAG_FWD_REFRESH_NEEDED |
-                    CP_SESSION_FLAG_FWD_PREFIX_CHECK_NEEDED;
-        break;
+      cp_nl_net_handle_one(s, nlhdr);
+    }
+  }
+}
 
-      case RTM_NEWADDR:
-      case RTM_DELADDR:
-        ipif_handle_generic(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
-                            NLMSG_PAYLOAD(nlhdr, sizeof(struct ifaddrmsg)));
-        break;
 
-      case RTM_NEWLINK:
-      case RTM_DELLINK:
-        llap_handle(s, nlhdr->nlmsg_type, NLMSG_DATA(nlhdr),
-                    NLMSG_PAYLOAD(nlhdr, sizeof(struct ifinfomsg)));
-        break;
+/* Reads a batch of datagrams from the NETLINK_ROUTE socket into
+ * s->nl_batch.  Returns the number of datagrams, and sets *truncated if
+ * any of them did not fit. */
+static int
+cp_nl_net_recv_batch(struct cp_session* s, int sock, bool* truncated)
+{
+  struct cp_nl_batch* b = s->nl_batch;
+  int i, n;
 
-      default:
-        ci_log("ERROR: unknown RTM message type %d", nlhdr->nlmsg_type);
-        ci_assert(0);
-        break;
+  if( b == NULL ) {
+    b = calloc(1, sizeof(*b));
+    if( b == NULL ) {
+      errno = ENOMEM;
+      return -1;
+    }
+    b->msg_size = CP_NL_BATCH_MSG_SIZE;
+    s->nl_batch = b;
+  }
+  if( b->grow ) {
+    free(b->buf);
+    b->buf = NULL;
+    b->msg_size *= 2;
+    b->grow = false;
+  }
+  if( b->buf == NULL ) {
+    b->buf = malloc(CP_NL_BATCH_MSGS * b->msg_size);
+    if( b->buf == NULL ) {
+      errno = ENOMEM;
+      return -1;
+    }
+    for( i = 0; i < CP_NL_BATCH_MSGS; i++ ) {
+      b->iov[i].iov_base = b->buf + i * b->msg_size;
+      b->iov[i].iov_len = b->msg_size;
+      memset(&b->msgs[i].msg_hdr, 0, sizeof(b->msgs[i].msg_hdr));
+      b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+      b->msgs[i].msg_hdr.msg_iovlen = 1;
     }
-    nlhdr = NLMSG_NEXT(nlhdr, bytes);
   }
+
+  n = recvmmsg(sock, b->msgs, CP_NL_BATCH_MSGS, 0, NULL);
+  if( n <= 0 )
+    return n;
+
+  s->stats.nlmsg.batches++;
+  s->stats.nlmsg.datagrams += n;
+  *truncated = false;
+  for( i = 0; i < n; i++ ) {
+    if( b->msgs[i].msg_hdr.msg_flags & MSG_TRUNC ) {
+      s->stats.nlmsg.truncated++;
+      CI_RLLOG(10, "%s: netlink datagram does not fit %zu bytes, re-syncing",
+               __FUNCTION__, b->msg_size);
+      b->grow = true;
+      *truncated = true;
+    }
+  }
+  return n;
 }
 
 
 void nl_net_handle(struct cp_session* s, struct cp_epoll_state* state)
 {
-  ssize_t bytes;
+  bool truncated;
+  int n;
 
-  while ( (bytes = cp_sock_recv(s, s->sock_net)) > 0 )
-    cp_nl_net_handle_msg(s, s->buf, bytes);
+  while( (n = cp_nl_net_recv_batch(s, s->sock_net, &truncated)) > 0 ) {
+    cp_nl_net_handle_batch(s, s->nl_batch->msgs, n);
+    if( truncated )
+      cp_dump_resync(s);
+  }
 }
 
 
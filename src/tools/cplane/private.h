@@ -125,6 +125,21 @@ struct cp_timer {
   timer_t t;
 };
 
+/* The NETLINK_ROUTE socket is read with recvmmsg(), up to CP_NL_BATCH_MSGS
+ * datagrams at a time.  Each datagram has a slot of msg_size bytes, which
+ * starts at CP_NL_BATCH_MSG_SIZE and is doubled if the kernel sends us
+ * anything larger. */
+#define CP_NL_BATCH_MSGS     32
+#define CP_NL_BATCH_MSG_SIZE (64 * 1024)
+
+struct cp_nl_batch {
+  size_t msg_size;
+  char* buf;
+  bool grow;
+  struct iovec iov[CP_NL_BATCH_MSGS];
+  struct mmsghdr msgs[CP_NL_BATCH_MSGS];
+};
+
 /* NETLINK_GENERIC groups we'd like to listen on. */
 enum cp_genl_group {
   /* nlctrl/notify: */
@@ -395,6 +410,9 @@ struct cp_session {
   size_t buf_size;
   void* buf;
 
+  /* Buffers to read batches of NETLINK_ROUTE messages */
+  struct cp_nl_batch* nl_batch;
+
   /* Netlink socket name */
   struct sockaddr_nl sock_net_name;
 
@@ -521,6 +539,8 @@ struct cp_session {
 
   /* Which service backend arrays are in use? */
   cp_row_mask_t service_used;
+  /* Which service lookup tables are in use? */
+  cp_row_mask_t service_lookup_used;
 
   /* Private per-llap-entry data */
   struct cp_llap_priv* llap_priv;
@@ -765,6 +785,7 @@ cp_get_fwd_data_scratch(struct cp_fwd_row* r)
                               void* mib_mem);
   void cp_nl_net_handle_msg(struct cp_session*, struct nlmsghdr*,
                             ssize_t bytes);
+  void cp_nl_net_handle_batch(struct cp_session*, struct mmsghdr*, int n);
   void init_ipp_list(struct cp_ip_prefix_list*, cicp_rowid_t size);
   ci_uint64 cp_frc64_get(void);
   void cp_nl_dump_all_done(struct cp_session*);
@@ -809,6 +830,9 @@ void cp_dump_init(struct cp_session* s);
 void cp_dump_start(struct cp_session* s);
 void cp_do_dump(struct cp_session*);
 void cp_periodic_dump(struct cp_session* s);
+void cp_dump_resync(struct cp_session* s);
+void cp_ipif_index_rebuild(struct cp_mibs* mib);
+void cp_ip6if_index_rebuild(struct cp_mibs* mib);
 int cp_nl_send_dump_req(struct cp_session* s, int sock,
                         struct nlmsghdr* nlh, int nlmsg_type,
                         int nlmsg_flags, size_t bytes);
@@ -83,6 +83,7 @@ static int cfg_hwport_max = CI_CFG_MAX_HWPORTS;
 static int cfg_llap_max = 32;
 static int cfg_ipif_max = CI_CFG_MAX_LOCAL_IPADDRS;
 static int cfg_svc_arrays_max = 0;
+static int cfg_svc_lookups_max = 0;
 static int cfg_svc_ep_max = 0;
 static int cfg_bond_max = 64;
 static int cfg_mac_max = 1024;
@@ -152,6 +153,10 @@ static ci_cfg_desc cfg_opts[] = {
     "this option is set to CI_CFG_MAX_LOCAL_IPADDRS" },
   { 0, "service-arrays-max", CI_CFG_UINT, &cfg_svc_arrays_max,
     "maximum number of k8s service backend arrays" },
+  { 0, "service-lookups-max", CI_CFG_UINT, &cfg_svc_lookups_max,
+    "maximum number of k8s services with a Maglev lookup table for "
+    "consistent backend selection; each table takes about 8KB twice over, "
+    "and services without one pick backends by hash from their arrays" },
   { 0, "service-endpoints-max", CI_CFG_UINT, &cfg_svc_ep_max,
     "maximum number of k8s service endpoints (frontends + backends) "
     "(will be rounded up to a power of 2)" },
@@ -330,6 +335,8 @@ cp_session_init_memory(struct cp_session* s, struct cp_tables_dim* m,
       cicp_ipif_row_free(&mib->ipif[id]);
     for( id = 0; id < mib->dim->ip6if_max; id++ )
       cicp_ip6if_row_free(&mib->ip6if[id]);
+    cp_ipif_index_rebuild(mib);
+    cp_ip6if_index_rebuild(mib);
     for( id = 0; id < mib->dim->llap_max; id++ )
       cicp_llap_row_free(&mib->llap[id]);
     snprintf(mib->sku->value, sizeof(mib->sku->value), "%s", onload_product);
@@ -343,11 +350,12 @@ cp_session_init_memory(struct cp_session* s, struct cp_tables_dim* m,
   s->mac_used = cp_row_mask_alloc(s->mac_mask + 1);
   s->ip6_mac_used = cp_row_mask_alloc(s->mac_mask + 1);
   s->service_used = cp_row_mask_alloc(m->svc_arrays_max);
+  s->service_lookup_used = cp_row_mask_alloc(m->svc_lookups_max);
 
   /* Any allocations that succeed here will be leaked if others fail, but the
    * caller will exit on failure so this is fine */
   if( s->seen == NULL || s->mac_used == NULL || s->ip6_mac_used == NULL ||
-      s->service_used == NULL )
+      s->service_used == NULL || s->service_lookup_used == NULL )
     return -ENOMEM;
 
 #define CHECK_CALLOC(target, num) \
@@ -1091,10 +1099,14 @@ int main(int argc, char** argv)
     dim.svc_arrays_max = cfg_svc_arrays_max;
     /* Round up to next power of 2 */
     dim.svc_ep_max = ci_pow2(ci_log2_ge(cfg_svc_ep_max, 1));
+    /* Every service with backends holds at least one array, so there is
+     * no use for more lookup tables than arrays. */
+    dim.svc_lookups_max = CI_MIN(cfg_svc_lookups_max, cfg_svc_arrays_max);
   }
   else {
     dim.svc_arrays_max = 0;
     dim.svc_ep_max = 0;
+    dim.svc_lookups_max = 0;
   }
 
   dim.fwd_ln2 = ci_log2_ge(cfg_fwd_max, 1);
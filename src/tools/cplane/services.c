@@ -25,6 +25,14 @@
  * indices do not rely on hashes and are are stored in the service's frontend
  * element in the hash table.  It is envisaged that, for efficiency, the inner
  * arrays will at some point occupy and align with an entire page.
+ *
+ * Services with up to CP_SVC_LOOKUP_MAX_BACKENDS backends also have a Maglev
+ * lookup table, from a third table.  Each slot names one of the backends, and
+ * a hash picks a slot, so choosing a backend takes constant time however
+ * many backends there are.  Each backend prefers the slots in its own
+ * permutation, which depends only on its address and port.  So when a backend
+ * is added or removed and the table is repopulated, few slots move between
+ * the other backends.
  */
 
 #include "private.h"
@@ -223,6 +231,128 @@ svc_array_remove(struct cp_session* s, struct cp_mibs* mib,
 }
 
 
+/* Mixes one word into a backend's hash. */
+static inline ci_uint32 svc_lookup_hash_step(ci_uint32 h, ci_uint32 word)
+{
+  /* Finaliser from MurmurHash3 */
+  h ^= word;
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+
+static ci_uint32
+svc_lookup_hash(const struct cp_svc_endpoint* ep, ci_uint32 seed)
+{
+  ci_uint32 h = seed;
+  int i;
+  for( i = 0; i < 4; ++i )
+    h = svc_lookup_hash_step(h, ep->addr.u32[i]);
+  return svc_lookup_hash_step(h, ep->port);
+}
+
+
+/* Fills a service's lookup table.  Each backend has a permutation of the
+ * slots given by an offset and a skip, and the backends take turns to claim
+ * the next free slot in their permutation until every slot is taken.  This
+ * gives each backend either floor or ceil of CP_SVC_LOOKUP_SIZE / n_backends
+ * slots. */
+static void
+svc_lookup_populate(struct cp_mibs* mib, struct cp_svc_ep_dllist* svc)
+{
+  struct cp_svc_lookup* lookup = &mib->svc_lookups[svc->u.service.lookup_id];
+  unsigned n = svc->u.service.n_backends;
+  ci_uint32 offset[CP_SVC_LOOKUP_MAX_BACKENDS];
+  ci_uint32 skip[CP_SVC_LOOKUP_MAX_BACKENDS];
+  ci_uint32 next[CP_SVC_LOOKUP_MAX_BACKENDS];
+  cicp_rowid_t array_id = svc->u.service.head_array_id;
+  unsigned i, slot, filled;
+
+  ci_assert_gt(n, 0);
+  ci_assert_le(n, CP_SVC_LOOKUP_MAX_BACKENDS);
+
+  for( i = 0; i < n; ++i ) {
+    struct cp_svc_endpoint* ep;
+    if( i % CP_SVC_BACKENDS_PER_ARRAY == 0 ) {
+      if( i != 0 )
+        array_id = mib->svc_arrays[array_id].next;
+      ci_assert( CICP_ROWID_IS_VALID(array_id) );
+      lookup->arrays[i / CP_SVC_BACKENDS_PER_ARRAY] = array_id;
+    }
+    ep = &mib->svc_arrays[array_id].eps[i % CP_SVC_BACKENDS_PER_ARRAY];
+    offset[i] = svc_lookup_hash(ep, 1) % CP_SVC_LOOKUP_SIZE;
+    skip[i] = svc_lookup_hash(ep, 2) % (CP_SVC_LOOKUP_SIZE - 1) + 1;
+    next[i] = 0;
+  }
+
+  for( slot = 0; slot < CP_SVC_LOOKUP_SIZE; ++slot )
+    lookup->slots[slot] = (ci_uint16) -1;
+
+  for( filled = 0; ; ) {
+    for( i = 0; i < n; ++i ) {
+      do {
+        slot = (offset[i] + (ci_uint64) next[i]++ * skip[i]) %
+               CP_SVC_LOOKUP_SIZE;
+      } while( lookup->slots[slot] != (ci_uint16) -1 );
+      lookup->slots[slot] = i;
+      if( ++filled == CP_SVC_LOOKUP_SIZE )
+        return;
+    }
+  }
+}
+
+
+/* Returns a free lookup table for the service if it will need one after
+ * its backends have changed, or CICP_ROWID_BAD if not. */
+static cicp_rowid_t
+svc_lookup_find_free(struct cp_session* s, cicp_mac_rowid_t svc_id)
+{
+  struct cp_svc_ep_dllist* svc = &cp_get_active_mib(s)->svc_ep_table[svc_id];
+
+  if( CICP_ROWID_IS_VALID(svc->u.service.lookup_id) )
+    return CICP_ROWID_BAD;
+  return cp_row_mask_iter_set(s->service_lookup_used, 0,
+                              cp_get_active_mib(s)->dim->svc_lookups_max,
+                              false);
+}
+
+
+/* Call this after updating a service's backends, in the mib update loop.
+ * It gives the service a lookup table or takes it away as needed, and
+ * repopulates it.  If the service needs a table and hasn't got one, it uses
+ * free_lookup_id if valid and otherwise does without. */
+static void
+svc_lookup_update(struct cp_session* s, struct cp_mibs* mib,
+                  struct cp_svc_ep_dllist* svc, cicp_rowid_t free_lookup_id)
+{
+  cicp_rowid_t* lookup_id = &svc->u.service.lookup_id;
+
+  if( svc->u.service.n_backends == 0 ||
+      svc->u.service.n_backends > CP_SVC_LOOKUP_MAX_BACKENDS ) {
+    if( CICP_ROWID_IS_VALID(*lookup_id) ) {
+      /* Note: Unsetting mask twice in mib loop is not an error. */
+      cp_row_mask_unset(s->service_lookup_used, *lookup_id);
+      *lookup_id = CICP_ROWID_BAD;
+    }
+    return;
+  }
+
+  if( ! CICP_ROWID_IS_VALID(*lookup_id) ) {
+    if( ! CICP_ROWID_IS_VALID(free_lookup_id) )
+      return;
+    /* Note: Setting mask twice in mib loop is not an error. */
+    cp_row_mask_set(s->service_lookup_used, free_lookup_id);
+    *lookup_id = free_lookup_id;
+  }
+
+  svc_lookup_populate(mib, svc);
+}
+
+
 static void svc_oof_add(struct cp_session* s, struct cp_svc_ep_dllist* svc)
 {
   int rc;
@@ -342,6 +472,7 @@ cp_svc_add(struct cp_session* s,
       svc->u.service.n_backends = 0;
       svc->u.service.head_array_id = CICP_ROWID_BAD;
       svc->u.service.tail_array_id = CICP_ROWID_BAD;
+      svc->u.service.lookup_id = CICP_ROWID_BAD;
       ci_mib_dllist_init(mib->dim, &svc->u.service.backends, 0, "back");
     }
 
@@ -358,8 +489,11 @@ cp_svc_backend_add(struct cp_session* s, const cicp_mac_rowid_t svc_id,
   struct cp_mibs* mib;
   cicp_mac_rowid_t id;
   cicp_rowid_t free_array_id = CICP_ROWID_BAD;
+  cicp_rowid_t free_lookup_id;
   bool was_externally_acceleratable = svc_externally_acceleratable(s, svc_id);
 
+  free_lookup_id = svc_lookup_find_free(s, svc_id);
+
   MIB_UPDATE_LOOP(mib, s, mib_i)
 
     struct cp_svc_ep_dllist* svc = &mib->svc_ep_table[svc_id];
@@ -397,6 +531,7 @@ cp_svc_backend_add(struct cp_session* s, const cicp_mac_rowid_t svc_id,
         svc_array_append(s, mib, svc, &ep->ep, free_array_id);
 
       svc->u.service.n_backends++;
+      svc_lookup_update(s, mib, svc, free_lookup_id);
     }
 
   MIB_UPDATE_LOOP_END(mib, s);
@@ -433,6 +568,7 @@ cp_svc_del(struct cp_session* s, const cicp_mac_rowid_t rowid)
       svc_hash_ep_del(mib, ep - mib->svc_ep_table);
     }
     svc->u.service.n_backends = 0;
+    svc_lookup_update(s, mib, svc, CICP_ROWID_BAD);
 
     /* Free any backend arrays. */
     if( CICP_ROWID_IS_VALID(svc->u.service.head_array_id) )
@@ -487,6 +623,7 @@ cp_svc_backend_del(struct cp_session* s, cicp_mac_rowid_t svc_id,
     return 0;
 
   bool was_externally_acceleratable = svc_externally_acceleratable(s, svc_id);
+  cicp_rowid_t free_lookup_id = svc_lookup_find_free(s, svc_id);
 
   MIB_UPDATE_LOOP(mib, s, mib_i)
 
@@ -521,6 +658,7 @@ cp_svc_backend_del(struct cp_session* s, cicp_mac_rowid_t svc_id,
     }
     ci_mib_dllist_remove(mib->dim, &ep->u.backend.link);
     svc->u.service.n_backends--;
+    svc_lookup_update(s, mib, svc, free_lookup_id);
 
     svc_hash_ep_del(mib, rowid);
 
@@ -539,6 +677,8 @@ void cp_svc_erase_all(struct cp_session* s)
   size_t table_size = sizeof(struct cp_svc_ep_dllist) *
                       s->mib[0].dim->svc_ep_max;
   size_t mask_size = cp_row_mask_sizeof(s->mib[0].dim->svc_arrays_max);
+  size_t lookup_mask_size =
+    cp_row_mask_sizeof(s->mib[0].dim->svc_lookups_max);
 
   MIB_UPDATE_LOOP(mib, s, mib_i)
 
@@ -548,6 +688,7 @@ void cp_svc_erase_all(struct cp_session* s)
   MIB_UPDATE_LOOP_END(mib, s);
 
   cp_row_mask_init(s->service_used, mask_size);
+  cp_row_mask_init(s->service_lookup_used, lookup_mask_size);
 
   svc_oof_erase_all(s);
 }
@@ -11,6 +11,15 @@ CP_STAT("For RTM_GETRULE", int, rule);
 CP_STAT("For other message types", int, other);
 CP_STAT_GROUP_END(nlmsg_error)
 
+CP_STAT_GROUP_START("NETLINK_ROUTE batches", nlmsg)
+CP_STAT("Number of batches received", int, batches)
+CP_STAT("Number of datagrams received", int, datagrams)
+CP_STAT("Neighbour messages superseded by a later one in the same batch",
+        int, coalesced)
+CP_STAT("Datagrams truncated because they did not fit the buffer",
+        int, truncated)
+CP_STAT_GROUP_END(nlmsg)
+
 CP_STAT_GROUP_START("FWD table", fwd)
 CP_STAT("Overall number of collisions", int, collision)
 CP_STAT("Number of hash loops", int, hash_loop)
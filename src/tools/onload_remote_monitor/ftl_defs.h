@@ -277,6 +277,7 @@ typedef struct oo_p_dllink oo_p_dllink_t;
     FTL_TFIELD_STRUCT(ctx, oo_timespec,           \
                       last_rx_timestamp, ORM_OUTPUT_STACK)              \
     FTL_TFIELD_INT(ctx, ci_uint32, last_sync_flags, ORM_OUTPUT_STACK) \
+    FTL_TFIELD_INT(ctx, ci_uint64, rx_drained_ns, ORM_OUTPUT_STACK) \
   ) \
   FTL_TFIELD_INT(ctx, ci_uint32, nic_error_flags, ORM_OUTPUT_STACK) \
   ON_CI_HAVE_CTPIO(                                                 \
@@ -359,6 +360,7 @@ typedef struct oo_p_dllink oo_p_dllink_t;
   FTL_TFIELD_INT(ctx, ci_uint32, added, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))        \
   FTL_TFIELD_INT(ctx, ci_uint32, removed, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))      \
   FTL_TFIELD_INT(ctx, ci_uint32, ts_nsec, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))      \
+  FTL_TFIELD_INT(ctx, ci_uint32, xdp_kicked, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))   \
   FTL_TSTRUCT_END(ctx)
 
 #define STRUCT_EF_VI_RXQ_STATE(ctx)                                     \
@@ -370,6 +372,7 @@ typedef struct oo_p_dllink oo_p_dllink_t;
   FTL_TFIELD_INT(ctx, ci_uint32, bytes_acc, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))            \
   FTL_TFIELD_INT(ctx, ci_uint16, last_desc_i, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))      \
   FTL_TFIELD_INT(ctx, ci_uint16, rx_ps_credit_avail, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))   \
+  FTL_TFIELD_INT(ctx, ci_uint32, xdp_kicked, (ORM_OUTPUT_STACK | ORM_OUTPUT_VIS))           \
   FTL_TSTRUCT_END(ctx)
 
 #define STRUCT_EF_VI_STATE(ctx)                                 \
@@ -452,6 +455,9 @@ typedef struct oo_p_dllink oo_p_dllink_t;
   FTL_TFIELD_INT(ctx, ci_uint32, rx_ev_bad_desc_i, ORM_OUTPUT_STACK)         \
   FTL_TFIELD_INT(ctx, ci_uint32, rx_ev_bad_q_label, ORM_OUTPUT_STACK)        \
   FTL_TFIELD_INT(ctx, ci_uint32, evq_gap, ORM_OUTPUT_STACK)                  \
+  FTL_TFIELD_INT(ctx, ci_uint32, xdp_kicks, ORM_OUTPUT_STACK)                \
+  FTL_TFIELD_INT(ctx, ci_uint32, xdp_kicks_elided, ORM_OUTPUT_STACK)         \
+  FTL_TFIELD_INT(ctx, ci_uint32, xdp_rx_kicks, ORM_OUTPUT_STACK)             \
   FTL_TSTRUCT_END(ctx)
 
 #define STRUCT_SOCKET_CACHE(ctx)                                        \
@@ -554,6 +560,11 @@ typedef struct oo_p_dllink oo_p_dllink_t;
   FTL_TFIELD_INT(ctx, ci_uint64, sock_spin_cycles, ORM_OUTPUT_STACK)      \
   FTL_TFIELD_INT(ctx, ci_uint64, buzz_cycles, ORM_OUTPUT_STACK)           \
   FTL_TFIELD_INT(ctx, ci_uint64, timer_prime_cycles, ORM_OUTPUT_STACK)    \
+  FTL_TFIELD_INT(ctx, ci_uint64, spin_adaptive_cycles, ORM_OUTPUT_STACK)  \
+  FTL_TFIELD_INT(ctx, ci_uint32, spin_adaptive_misses, ORM_OUTPUT_STACK)  \
+  FTL_TFIELD_INT(ctx, ci_uint32, int_adaptive_usec, ORM_OUTPUT_STACK)     \
+  FTL_TFIELD_INT(ctx, ci_uint32, int_adaptive_quiet, ORM_OUTPUT_STACK)    \
+  FTL_TFIELD_INT(ctx, ci_uint64, int_adaptive_last_frc, ORM_OUTPUT_STACK) \
   FTL_TFIELD_INT(ctx, ci_uint32, timesync_bytes, ORM_OUTPUT_STACK)        \
   FTL_TFIELD_INT(ctx, ci_uint32, io_mmap_bytes, ORM_OUTPUT_STACK)         \
   FTL_TFIELD_INT(ctx, ci_uint32, buf_mmap_bytes, ORM_OUTPUT_STACK)        \
@@ -1061,6 +1072,8 @@ typedef struct oo_tcp_socket_stats oo_tcp_socket_stats;
     FTL_TFIELD_INT(ctx, ci_uint32, congrecover, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                 \
     FTL_TFIELD_INT(ctx, ci_int32, retrans_ptr, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                  \
     FTL_TFIELD_INT(ctx, ci_uint32, retrans_seq, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                 \
+    FTL_TFIELD_INT(ctx, ci_int32, sack_hint, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                    \
+    FTL_TFIELD_INT(ctx, ci_uint32, sacked_pkts, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                 \
     FTL_TFIELD_INT(ctx, ci_uint32, cwnd, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                        \
     FTL_TFIELD_INT(ctx, ci_uint32, cwnd_extra, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                  \
     FTL_TFIELD_INT(ctx, ci_uint32, ssthresh, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                    \
@@ -1097,10 +1110,9 @@ typedef struct oo_tcp_socket_stats oo_tcp_socket_stats;
     FTL_TFIELD_INT(ctx, ci_uint16, zwin_probes, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                 \
     FTL_TFIELD_INT(ctx, ci_uint16, zwin_acks, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))             \
     FTL_TFIELD_INT(ctx, ci_uint8, incoming_tcp_hdr_len, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))         \
-    FTL_TFIELD_STRUCT(ctx, ci_ip_timer, rto_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                \
-    FTL_TFIELD_STRUCT(ctx, ci_ip_timer, delack_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))             \
-    FTL_TFIELD_STRUCT(ctx, ci_ip_timer, zwin_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))               \
-    FTL_TFIELD_STRUCT(ctx, ci_ip_timer, kalive_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))             \
+    FTL_TFIELD_STRUCT(ctx, ci_ip_timer, tcp_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                \
+    FTL_TFIELD_ARRAYOFINT(ctx, ci_iptime_t, timer_time, CI_TCP_TIMER_N, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS)) \
+    FTL_TFIELD_INT(ctx, ci_uint32, timers_pending, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))              \
     ON_CI_CFG_TCP_SOCK_STATS(                                                 \
       FTL_TFIELD_STRUCT(ctx, ci_ip_timer, stats_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))            \
     )                                                                         \